@@ -225,6 +225,32 @@ namespace steemit { namespace app {
        return _app.p2p_node()->set_advanced_node_parameters(params);
     }
 
+    fc::variant_object network_node_api::get_message_cache_statistics() const
+    {
+       return _app.p2p_node()->get_message_cache_statistics();
+    }
+
+    fc::variant_object network_node_api::get_inventory_statistics() const
+    {
+       return _app.p2p_node()->get_inventory_statistics();
+    }
+
+    metrics_api::metrics_api( const api_context& ctx ) : _app( ctx.app )
+    {
+    }
+
+    void metrics_api::on_api_startup() {}
+
+    std::map< std::string, api_method_metrics > metrics_api::get_api_metrics() const
+    {
+       return _app.get_api_metrics().get_metrics();
+    }
+
+    void metrics_api::reset_api_metrics()
+    {
+       _app.get_api_metrics().reset();
+    }
+
     vector< string > get_relevant_accounts( const object* obj )
     {
        vector< string > result;
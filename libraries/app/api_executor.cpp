@@ -0,0 +1,119 @@
+#include <steemit/app/api_executor.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace steemit { namespace app {
+
+api_executor::api_executor( chain::database& db )
+   : _db( db )
+{
+}
+
+api_executor::~api_executor()
+{
+   stop();
+}
+
+void api_executor::start( uint32_t thread_count )
+{
+   FC_ASSERT( _workers.empty(), "api executor is already running" );
+   thread_count = std::max( thread_count, 1u );
+
+   for( uint32_t i = 0; i < thread_count; ++i )
+   {
+      std::unique_ptr< worker > w( new worker );
+      w->thread.reset( new fc::thread( "api_" + std::to_string( i ) ) );
+      w->pending = 0;
+      _workers.push_back( std::move( w ) );
+   }
+
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   _statistics.thread_count = thread_count;
+   ilog( "Executing read only API calls on ${n} threads", ("n", thread_count) );
+}
+
+void api_executor::stop()
+{
+   for( auto& w : _workers )
+      w->thread->quit();
+   _workers.clear();
+
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   _statistics.thread_count = 0;
+}
+
+api_executor::worker* api_executor::select_worker()
+{
+   // not started yet, or called by an applied_block handler which would wait for itself
+   if( _workers.empty() || _db.holds_write_lock() )
+      return nullptr;
+
+   const fc::thread& current = fc::thread::current();
+   worker* best = nullptr;
+   for( auto& w : _workers )
+   {
+      // A call made while executing another call, such as get_state calling get_accounts,
+      // already holds the read lock and must not wait for a worker
+      if( w->thread.get() == &current )
+      {
+         std::lock_guard< std::mutex > lock( _statistics_mutex );
+         ++_statistics.nested_calls;
+         return nullptr;
+      }
+      if( best == nullptr || w->pending < best->pending )
+         best = w.get();
+   }
+   return best;
+}
+
+api_executor::call_tracker::call_tracker( api_executor& executor, worker& w )
+   : _executor( executor ), _worker( w ), _queued( fc::time_point::now() )
+{
+   ++_worker.pending;
+
+   std::lock_guard< std::mutex > lock( _executor._statistics_mutex );
+   auto& stats = _executor._statistics;
+   ++stats.calls;
+   ++stats.queue_depth;
+   stats.max_queue_depth = std::max( stats.max_queue_depth, stats.queue_depth );
+}
+
+void api_executor::call_tracker::started()
+{
+   _started = fc::time_point::now();
+}
+
+void api_executor::call_tracker::failed()
+{
+   _failed = true;
+}
+
+api_executor::call_tracker::~call_tracker()
+{
+   --_worker.pending;
+
+   fc::time_point now = fc::time_point::now();
+   if( _started == fc::time_point() )
+      _started = now;
+   uint64_t wait_time = std::max< int64_t >( ( _started - _queued ).count(), 0 );
+   uint64_t execution_time = std::max< int64_t >( ( now - _started ).count(), 0 );
+
+   std::lock_guard< std::mutex > lock( _executor._statistics_mutex );
+   auto& stats = _executor._statistics;
+   --stats.queue_depth;
+   if( _failed )
+      ++stats.errors;
+   stats.total_wait_time += wait_time;
+   stats.max_wait_time = std::max( stats.max_wait_time, wait_time );
+   stats.total_execution_time += execution_time;
+   stats.max_execution_time = std::max( stats.max_execution_time, execution_time );
+}
+
+api_executor_statistics api_executor::get_statistics()const
+{
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   return _statistics;
+}
+
+} } // steemit::app
@@ -0,0 +1,179 @@
+#include <steemit/app/api_metrics.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <algorithm>
+
+namespace steemit { namespace app {
+
+api_metrics::~api_metrics()
+{
+   stop_logging();
+}
+
+void api_metrics::record( const std::string& method, uint64_t time, bool error, uint64_t response_bytes )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   auto& m = _metrics[ method ];
+   m.latency.record( time, error );
+   m.response_bytes += response_bytes;
+   m.max_response_bytes = std::max( m.max_response_bytes, response_bytes );
+}
+
+std::map< std::string, api_method_metrics > api_metrics::get_metrics()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   return _metrics;
+}
+
+void api_metrics::reset()
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _metrics.clear();
+}
+
+void api_metrics::start_logging( fc::microseconds interval, uint32_t method_count )
+{
+   stop_logging();
+   _log_interval = interval;
+   _log_method_count = method_count;
+   schedule_logging();
+}
+
+void api_metrics::stop_logging()
+{
+   if( !_log_task.valid() )
+      return;
+   try
+   {
+      _log_task.cancel_and_wait( "api_metrics::stop_logging()" );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Exception thrown while canceling the API metrics log task, ignoring: ${e}", ("e", e) );
+   }
+   _log_task = fc::future< void >();
+}
+
+void api_metrics::schedule_logging()
+{
+   _log_task = fc::schedule( [this]()
+   {
+      log_metrics();
+      if( !_log_task.canceled() )
+         schedule_logging();
+   }, fc::time_point::now() + _log_interval, "api_metrics_log" );
+}
+
+void api_metrics::log_metrics()const
+{
+   auto metrics = get_metrics();
+   if( metrics.empty() )
+      return;
+
+   std::vector< std::pair< std::string, api_method_metrics > > by_time( metrics.begin(), metrics.end() );
+   std::sort( by_time.begin(), by_time.end(), []( const std::pair< std::string, api_method_metrics >& a, const std::pair< std::string, api_method_metrics >& b )
+   {
+      return a.second.latency.total_time > b.second.latency.total_time;
+   });
+   if( by_time.size() > _log_method_count )
+      by_time.resize( _log_method_count );
+
+   ilog( "API methods by total time since startup:" );
+   for( const auto& m : by_time )
+   {
+      const auto& l = m.second.latency;
+      ilog( "   ${m}: ${c} calls, ${e} errors, ${t}ms total, ${a}us average, ${p}us p99, ${x}us max, ${b} bytes average",
+            ("m", m.first)("c", l.calls)("e", l.errors)("t", l.total_time / 1000)
+            ("a", l.total_time / std::max< uint64_t >( l.calls, 1 ))("p", l.percentile( 0.99 ))("x", l.max_time)
+            ("b", m.second.response_bytes / std::max< uint64_t >( l.calls, 1 )) );
+   }
+}
+
+std::string api_method_name( const std::vector< std::string >& api_names, uint64_t api_id, const std::string& method )
+{
+   if( api_id < api_names.size() && !api_names[ api_id ].empty() )
+      return api_names[ api_id ] + "." + method;
+   return std::to_string( api_id ) + "." + method;
+}
+
+metered_websocket_api_connection::metered_websocket_api_connection( fc::http::websocket_connection& c, api_metrics& metrics )
+   : fc::rpc::websocket_api_connection( c ), _metrics( metrics )
+{
+   // replace the handlers installed by websocket_api_connection to time each call
+   c.on_message_handler( [this]( const std::string& msg ){ on_metered_message( msg, true ); } );
+   c.on_http_handler( [this]( const std::string& msg ){ return on_metered_message( msg, false ); } );
+}
+
+std::string metered_websocket_api_connection::on_metered_message( const std::string& message, bool send_message )
+{
+   uint64_t api_id = 0;
+   std::string method;
+   std::string api_name;
+   try
+   {
+      auto request = fc::json::from_string( message );
+      if( request.is_object() && request.get_object().contains( "method" ) )
+      {
+         const auto& obj = request.get_object();
+         method = obj[ "method" ].as_string();
+         if( method == "call" && obj.contains( "params" ) )
+         {
+            const auto& params = obj[ "params" ].get_array();
+            if( params.size() == 3 )
+            {
+               if( params[0].is_string() )
+                  api_name = params[0].as_string();
+               else
+                  api_id = params[0].as_uint64();
+               method = params[1].as_string();
+            }
+         }
+      }
+   }
+   catch( const fc::exception& )
+   {
+      // malformed messages are rejected by on_message
+   }
+
+   // replies to calls made by this node to the client are not API calls
+   if( method.empty() )
+      return on_message( message, send_message );
+
+   fc::time_point start = fc::time_point::now();
+   std::string reply = on_message( message, send_message );
+   uint64_t time = ( fc::time_point::now() - start ).count();
+
+   // responses are {"id":...,"result":...} or {"id":...,"error":...}
+   size_t result_pos = reply.find( "\"result\":" );
+   size_t error_pos = reply.find( "\"error\":" );
+   bool error = error_pos < result_pos;
+
+   std::string name = api_name.empty() ? api_method_name( _api_names, api_id, method ) : api_name + "." + method;
+   _metrics.record( name, time, error, reply.size() );
+
+   if( !error && method == "get_api_by_name" )
+   {
+      // remember the id of the API returned, so later calls by id are recorded under its name
+      try
+      {
+         auto response = fc::json::from_string( reply ).get_object();
+         auto request = fc::json::from_string( message ).get_object();
+         const auto& params = request[ "params" ].get_array();
+         const auto& args = request[ "method" ].as_string() == "call" ? params[2].get_array() : params;
+         if( !args.empty() && response.contains( "result" ) && response[ "result" ].is_numeric() )
+         {
+            uint64_t id = response[ "result" ].as_uint64();
+            if( _api_names.size() <= id )
+               _api_names.resize( id + 1 );
+            _api_names[ id ] = args[0].as_string();
+         }
+      }
+      catch( const fc::exception& ) {}
+   }
+
+   return reply;
+}
+
+} } // steemit::app
@@ -0,0 +1,78 @@
+#include <steemit/app/api_response_cache.hpp>
+
+namespace steemit { namespace app {
+
+api_response_cache::api_response_cache( uint32_t max_entries )
+   : _max_entries( max_entries )
+{
+   _statistics.max_entries = max_entries;
+}
+
+void api_response_cache::set_max_entries( uint32_t max_entries )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _max_entries = max_entries;
+   _statistics.max_entries = max_entries;
+   while( _entries.size() > _max_entries )
+   {
+      _entries.pop_back();
+      ++_statistics.evictions;
+   }
+}
+
+void api_response_cache::clear_for_head( const chain::block_id_type& head )
+{
+   if( head == _head )
+      return;
+   if( !_entries.empty() )
+      ++_statistics.invalidations;
+   _entries.clear();
+   _head = head;
+}
+
+std::shared_ptr< const void > api_response_cache::find( const std::string& key, const chain::block_id_type& head )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   clear_for_head( head );
+
+   auto& by_key_idx = _entries.get< by_key >();
+   auto itr = by_key_idx.find( key );
+   if( itr == by_key_idx.end() )
+   {
+      ++_statistics.misses;
+      return std::shared_ptr< const void >();
+   }
+
+   ++_statistics.hits;
+   // move to the front of the least recently used list
+   _entries.relocate( _entries.begin(), _entries.project< 0 >( itr ) );
+   return itr->value;
+}
+
+void api_response_cache::insert( const std::string& key, const chain::block_id_type& head, std::shared_ptr< const void > value )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   if( _max_entries == 0 )
+      return;
+   clear_for_head( head );
+
+   // another thread may have computed the same response in the meantime
+   if( !_entries.push_front( entry{ key, value } ).second )
+      return;
+
+   while( _entries.size() > _max_entries )
+   {
+      _entries.pop_back();
+      ++_statistics.evictions;
+   }
+}
+
+api_response_cache_statistics api_response_cache::get_statistics()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   api_response_cache_statistics result = _statistics;
+   result.entries = _entries.size();
+   return result;
+}
+
+} } // steemit::app
@@ -23,6 +23,12 @@
  */
 #include <steemit/app/api.hpp>
 #include <steemit/app/api_access.hpp>
+#include <steemit/app/api_executor.hpp>
+#include <steemit/app/api_metrics.hpp>
+#include <steemit/app/api_response_cache.hpp>
+#include <steemit/app/change_subscriptions.hpp>
+#include <steemit/app/http_rpc_server.hpp>
+#include <steemit/app/operation_queue.hpp>
 #include <steemit/app/application.hpp>
 #include <steemit/app/plugin.hpp>
 
@@ -189,10 +195,32 @@ namespace detail {
          _websocket_tls_server->start_accept();
       } FC_CAPTURE_AND_RETHROW() }
 
+      void reset_http_server()
+      { try {
+         if( !_options->count("rpc-http-endpoint") )
+            return;
+
+         auto factory = [this]( fc::api_connection& conn, const std::shared_ptr< api_connection_context >& conn_ctx )
+         {
+            return register_public_apis( conn, conn_ctx );
+         };
+         _http_server = std::make_shared<http_rpc_server>( factory, _api_metrics, _options->at("rpc-http-max-body-size").as<uint32_t>() );
+         ilog("Configured HTTP rpc to listen on ${ip}", ("ip",_options->at("rpc-http-endpoint").as<string>()));
+         _http_server->listen( fc::ip::endpoint::from_string(_options->at("rpc-http-endpoint").as<string>()) );
+      } FC_CAPTURE_AND_RETHROW() }
+
       void on_connection( const fc::http::websocket_connection_ptr& c )
       {
-         auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
-         std::shared_ptr< api_connection_context > conn_ctx = std::make_shared< api_connection_context >();
+         auto wsc = std::make_shared<metered_websocket_api_connection>( *c, _api_metrics );
+         wsc->set_api_names( register_public_apis( *wsc ) );
+         c->set_session_data( wsc );
+      }
+
+      /** creates the public APIs of a new connection in conn_ctx, returns their names indexed by api id */
+      std::vector< std::string > register_public_apis( fc::api_connection& conn,
+                                                       std::shared_ptr< api_connection_context > conn_ctx = std::make_shared< api_connection_context >() )
+      {
+         std::vector< std::string > names;
 
          for( const std::string& name : _public_apis )
          {
@@ -204,14 +232,20 @@ namespace detail {
                continue;
             }
             conn_ctx->api_map[name] = api;
-            api->register_api( *wsc );
+            fc::api_id_type id = api->register_api( conn );
+            if( names.size() <= id )
+               names.resize( id + 1 );
+            names[id] = name;
          }
-         c->set_session_data( wsc );
+         return names;
       }
 
       application_impl(application* self)
          : _self(self),
-           _chain_db(std::make_shared<chain::database>())
+           _chain_db(std::make_shared<chain::database>()),
+           _api_executor(*_chain_db),
+           _change_subscriptions(*_chain_db),
+           _operation_queue(*_chain_db)
       {
       }
 
@@ -226,6 +260,7 @@ namespace detail {
          _self->register_api_factory< database_api >( "database_api" );
          _self->register_api_factory< network_node_api >( "network_node_api" );
          _self->register_api_factory< network_broadcast_api >( "network_broadcast_api" );
+         _self->register_api_factory< metrics_api >( "metrics_api" );
       }
 
       void startup()
@@ -251,6 +286,12 @@ namespace detail {
          }
          _chain_db->add_checkpoints( loaded_checkpoints );
 
+         _chain_db->set_pending_transaction_limits(
+            _options->at("max-pending-transactions").as<uint32_t>(),
+            _options->at("max-pending-transactions-size").as<uint64_t>(),
+            _options->at("max-pending-transactions-per-account").as<uint32_t>() );
+         _operation_queue.set_max_pending_blocks( _options->at("plugin-queue-max-blocks").as<uint32_t>() );
+
          if( _options->count("replay-blockchain") )
          {
             ilog("Replaying blockchain on user request.");
@@ -306,6 +347,13 @@ namespace detail {
             _force_validate = true;
          }
 
+         _api_executor.start( _options->at("api-threads").as<uint32_t>() );
+         _api_response_cache.set_max_entries( _options->at("api-response-cache-size").as<uint32_t>() );
+         _change_subscriptions.set_max_pending_changes( _options->at("api-subscription-max-pending").as<uint32_t>() );
+         uint32_t metrics_log_interval = _options->at("api-metrics-log-interval").as<uint32_t>();
+         if( metrics_log_interval > 0 )
+            _api_metrics.start_logging( fc::seconds( metrics_log_interval ), _options->at("api-metrics-log-methods").as<uint32_t>() );
+
          graphene::time::now();
 
          if( _options->count("api-user") )
@@ -348,6 +396,7 @@ namespace detail {
          reset_p2p_node(_data_dir);
          reset_websocket_server();
          reset_websocket_tls_server();
+         reset_http_server();
       } FC_LOG_AND_RETHROW() }
 
       optional< api_access_info > get_api_access_info(const string& username)const
@@ -787,9 +836,15 @@ namespace detail {
       api_access _apiaccess;
 
       std::shared_ptr<steemit::chain::database>            _chain_db;
+      api_executor                                          _api_executor;
+      api_metrics                                           _api_metrics;
+      api_response_cache                                    _api_response_cache;
+      change_subscription_manager                           _change_subscriptions;
+      operation_queue                                       _operation_queue;
       std::shared_ptr<graphene::net::node>                  _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
+      std::shared_ptr<http_rpc_server>                 _http_server;
 
       std::map<string, std::shared_ptr<abstract_plugin> > _plugins_available;
       std::map<string, std::shared_ptr<abstract_plugin> > _plugins_enabled;
@@ -808,6 +863,10 @@ application::application()
 
 application::~application()
 {
+   if( my->_http_server )
+      my->_http_server->close();
+   my->_api_executor.stop();
+   my->_operation_queue.stop();
    if( my->_p2p_network )
    {
       my->_p2p_network->close();
@@ -839,12 +898,23 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("rpc-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8090"), "Endpoint for websocket RPC to listen on")
          ("rpc-tls-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8089"), "Endpoint for TLS websocket RPC to listen on")
+         ("rpc-http-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8092"), "Endpoint for HTTP JSON-RPC to listen on")
+         ("rpc-http-max-body-size", bpo::value<uint32_t>()->default_value(1024*1024), "Maximum size in bytes of an HTTP JSON-RPC request body")
          ("server-pem,p", bpo::value<string>()->implicit_value("server.pem"), "The TLS certificate file for this server")
          ("server-pem-password,P", bpo::value<string>()->implicit_value(""), "Password for this certificate")
          ("dbg-init-key", bpo::value<string>(), "Block signing key to use for init witnesses, overrides genesis file")
          ("api-user", bpo::value< vector<string> >()->composing(), "API user specification, may be specified multiple times")
          ("public-api", bpo::value< vector<string> >()->composing()->default_value(default_apis, str_default_apis), "Set an API to be publicly available, may be specified multiple times")
          ("enable-plugin", bpo::value< vector<string> >()->composing()->default_value(default_plugins, str_default_plugins), "Plugin(s) to enable, may be specified multiple times")
+         ("max-pending-transactions", bpo::value<uint32_t>()->default_value(STEEMIT_MAX_PENDING_TRANSACTIONS), "Maximum number of transactions kept in the pending pool, 0 for no limit")
+         ("max-pending-transactions-size", bpo::value<uint64_t>()->default_value(STEEMIT_MAX_PENDING_TRANSACTIONS_SIZE), "Maximum total size in bytes of the transactions kept in the pending pool, 0 for no limit")
+         ("max-pending-transactions-per-account", bpo::value<uint32_t>()->default_value(STEEMIT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT), "Maximum number of pending transactions requiring the authority of a single account, 0 for no limit")
+         ("api-threads", bpo::value<uint32_t>()->default_value(1), "Number of threads executing read only database API calls, at least one")
+         ("api-response-cache-size", bpo::value<uint32_t>()->default_value(1000), "Maximum number of get_state and discussion query results cached until the next block, 0 to disable the cache")
+         ("api-subscription-max-pending", bpo::value<uint32_t>()->default_value(1000), "Maximum number of changed objects waiting to be sent to a subscribed API connection before they are dropped")
+         ("api-metrics-log-interval", bpo::value<uint32_t>()->default_value(0), "Seconds between logging the calls, errors, latency and response size of the most expensive API methods, 0 to disable")
+         ("api-metrics-log-methods", bpo::value<uint32_t>()->default_value(10), "Number of API methods logged at each api-metrics-log-interval")
+         ("plugin-queue-max-blocks", bpo::value<uint32_t>()->default_value(100), "Maximum number of blocks waiting for a plugin that processes operations on its own thread before block application waits for it, 0 for no limit")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -880,6 +950,11 @@ std::shared_ptr<abstract_plugin> application::get_plugin(const string& name) con
    return my->_plugins_enabled[name];
 }
 
+const fc::path& application::data_dir()const
+{
+   return my->_data_dir;
+}
+
 graphene::net::node_ptr application::p2p_node()
 {
    return my->_p2p_network;
@@ -890,6 +965,36 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+api_executor& application::get_api_executor()
+{
+   return my->_api_executor;
+}
+
+api_metrics& application::get_api_metrics()
+{
+   return my->_api_metrics;
+}
+
+api_response_cache& application::get_api_response_cache()
+{
+   return my->_api_response_cache;
+}
+
+change_subscription_manager& application::get_change_subscription_manager()
+{
+   return my->_change_subscriptions;
+}
+
+operation_queue& application::get_operation_queue()
+{
+   return my->_operation_queue;
+}
+
+std::shared_ptr<http_rpc_server> application::get_http_rpc_server()const
+{
+   return my->_http_server;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -928,6 +1033,11 @@ void application::shutdown_plugins()
 }
 void application::shutdown()
 {
+   if( my->_http_server )
+      my->_http_server->close();
+   my->_api_metrics.stop_logging();
+   my->_api_executor.stop();
+   my->_operation_queue.stop();
    if( my->_p2p_network )
       my->_p2p_network->close();
    if( my->_chain_db )
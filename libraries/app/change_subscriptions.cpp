@@ -0,0 +1,287 @@
+#include <steemit/app/change_subscriptions.hpp>
+
+#include <steemit/chain/steem_objects.hpp>
+#include <steemit/tags/tags_plugin.hpp>
+
+#include <fc/thread/thread.hpp>
+
+namespace steemit { namespace app {
+
+namespace {
+
+   template< typename T >
+   bool is_object_type( const graphene::db::object& obj )
+   {
+      return obj.id.space() == T::space_id && obj.id.type() == T::type_id;
+   }
+
+   bool has_prefix( const std::string& s, const char* prefix, size_t size )
+   {
+      return s.size() > size && s.compare( 0, size, prefix ) == 0;
+   }
+
+   void validate_key( const std::string& key )
+   {
+      if( key == "globals" || has_prefix( key, "account:", 8 ) || has_prefix( key, "tag:", 4 ) )
+         return;
+      FC_ASSERT( has_prefix( key, "comment:", 8 ) && key.find( '/', 8 ) != std::string::npos,
+                 "Invalid subscription key ${k}", ("k", key) );
+   }
+
+}
+
+const uint32_t change_subscription_manager::max_keys;
+
+change_subscription_manager::change_subscription_manager( chain::database& db )
+   : _db( db )
+{
+   _applied_block_connection = _db.applied_block.connect( [this]( const chain::signed_block& b ){ on_applied_block( b ); } );
+   _removed_objects_connection = _db.removed_objects.connect( [this]( const std::vector< const graphene::db::object* >& objs ){ on_removed_objects( objs ); } );
+   _changed_objects_connection = _db.changed_objects.connect( [this]( const std::vector< object_id_type >& ids ){ on_changed_objects( ids ); } );
+   _statistics.max_pending_changes = _max_pending_changes;
+}
+
+void change_subscription_manager::set_max_pending_changes( uint32_t max_pending_changes )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _max_pending_changes = max_pending_changes;
+   _statistics.max_pending_changes = max_pending_changes;
+}
+
+std::shared_ptr< change_subscription > change_subscription_manager::subscribe( change_subscription::callback_type cb, const std::vector< std::string >& keys )
+{
+   FC_ASSERT( keys.size() <= max_keys, "At most ${n} subscription keys are allowed", ("n", max_keys) );
+   for( const auto& key : keys )
+      validate_key( key );
+
+   auto result = std::make_shared< change_subscription >( std::move( cb ), boost::container::flat_set< std::string >( keys.begin(), keys.end() ) );
+
+   std::lock_guard< std::mutex > lock( _mutex );
+   _subscriptions.push_back( result );
+   return result;
+}
+
+change_subscription_statistics change_subscription_manager::get_statistics()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   change_subscription_statistics result = _statistics;
+   result.subscribers = 0;
+   for( const auto& s : _subscriptions )
+      if( !s.expired() )
+         ++result.subscribers;
+   return result;
+}
+
+void change_subscription_manager::on_applied_block( const chain::signed_block& b )
+{
+   // changed_objects is emitted right after applied_block with the changes of the whole block,
+   // unless undo is disabled while replaying, in which case it is not emitted at all
+   _in_block = false;
+   _wanted_keys.clear();
+   {
+      std::lock_guard< std::mutex > lock( _mutex );
+      for( const auto& weak : _subscriptions )
+      {
+         auto s = weak.lock();
+         if( s )
+            _wanted_keys.insert( s->keys.begin(), s->keys.end() );
+      }
+   }
+   if( _wanted_keys.empty() || !_db._undo_db.enabled() )
+      return;
+
+   _in_block = true;
+   _block_num = b.block_num();
+   _block_id = b.id();
+}
+
+void change_subscription_manager::on_removed_objects( const std::vector< const graphene::db::object* >& objs )
+{
+   if( !_in_block )
+      return;
+   for( const auto* obj : objs )
+      _removed[ obj->id ] = obj;
+}
+
+void change_subscription_manager::on_changed_objects( const std::vector< object_id_type >& ids )
+{
+   if( !_in_block )
+      return;
+   _in_block = false;
+
+   try
+   {
+      for( const auto& id : ids )
+      {
+         const graphene::db::object* obj = _db.find_object( id );
+         if( obj != nullptr )
+         {
+            add_change( *obj, false );
+            continue;
+         }
+         auto removed = _removed.find( id );
+         if( removed != _removed.end() )
+            add_change( *removed->second, true );
+      }
+      publish();
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Error computing the changes of block ${b}: ${e}", ("b", _block_num)("e", e.to_detail_string()) );
+   }
+
+   _changes.clear();
+   _removed.clear();
+}
+
+std::vector< std::string > change_subscription_manager::get_keys( const graphene::db::object& obj )const
+{
+   std::vector< std::string > keys;
+   if( is_object_type< chain::account_object >( obj ) )
+      keys.push_back( "account:" + static_cast< const chain::account_object& >( obj ).name );
+   else if( is_object_type< chain::comment_object >( obj ) )
+   {
+      const auto& c = static_cast< const chain::comment_object& >( obj );
+      keys.push_back( "comment:" + c.author + "/" + c.permlink );
+   }
+   else if( is_object_type< chain::comment_vote_object >( obj ) )
+   {
+      const auto* c = _db.find( static_cast< const chain::comment_vote_object& >( obj ).comment );
+      if( c != nullptr )
+         keys.push_back( "comment:" + c->author + "/" + c->permlink );
+   }
+   else if( is_object_type< tags::tag_object >( obj ) )
+   {
+      const auto* stats = _db.find( static_cast< const tags::tag_object& >( obj ).tag );
+      if( stats != nullptr )
+         keys.push_back( "tag:" + stats->tag );
+   }
+   else if( is_object_type< chain::witness_object >( obj ) )
+      keys.push_back( "account:" + static_cast< const chain::witness_object& >( obj ).owner );
+   else if( is_object_type< chain::limit_order_object >( obj ) )
+      keys.push_back( "account:" + static_cast< const chain::limit_order_object& >( obj ).seller );
+   else if( is_object_type< chain::convert_request_object >( obj ) )
+      keys.push_back( "account:" + static_cast< const chain::convert_request_object& >( obj ).owner );
+   else if( is_object_type< chain::dynamic_global_property_object >( obj ) )
+      keys.push_back( "globals" );
+   return keys;
+}
+
+void change_subscription_manager::add_change( const graphene::db::object& obj, bool removed )
+{
+   auto keys = get_keys( obj );
+   bool wanted = false;
+   for( const auto& key : keys )
+      wanted = wanted || _wanted_keys.find( key ) != _wanted_keys.end();
+   if( !wanted )
+      return;
+
+   auto change = std::make_shared< object_change >();
+   change->id = obj.id;
+   change->keys = std::move( keys );
+   if( removed )
+      change->removed = true;
+   else
+      change->object = obj.to_variant();
+   _changes.push_back( change );
+}
+
+void change_subscription_manager::publish()
+{
+   std::map< std::string, std::vector< std::shared_ptr< const object_change > > > changes_by_key;
+   for( const auto& change : _changes )
+      for( const auto& key : change->keys )
+         changes_by_key[ key ].push_back( change );
+
+   std::vector< std::shared_ptr< change_subscription > > ready;
+   {
+      std::lock_guard< std::mutex > lock( _mutex );
+      ++_statistics.blocks;
+      _statistics.changes += _changes.size();
+
+      auto itr = _subscriptions.begin();
+      while( itr != _subscriptions.end() )
+      {
+         auto s = itr->lock();
+         if( !s )
+         {
+            itr = _subscriptions.erase( itr );
+            continue;
+         }
+         ++itr;
+
+         bool changed = false;
+         for( const auto& key : s->keys )
+         {
+            auto key_changes = changes_by_key.find( key );
+            if( key_changes == changes_by_key.end() )
+               continue;
+            for( const auto& change : key_changes->second )
+            {
+               auto inserted = s->pending.emplace( change->id, change );
+               if( !inserted.second && inserted.first->second != change )
+               {
+                  // the subscriber has not been sent the previous value yet, only send the latest
+                  inserted.first->second = change;
+                  ++_statistics.coalesced_changes;
+               }
+               changed = true;
+            }
+         }
+         if( !changed )
+            continue;
+
+         s->block_num = _block_num;
+         s->block_id = _block_id;
+         if( s->pending.size() > _max_pending_changes )
+         {
+            s->pending.clear();
+            s->overflow = true;
+            ++_statistics.overflows;
+         }
+         if( !s->delivering )
+            ready.push_back( s );
+      }
+   }
+
+   for( const auto& s : ready )
+      deliver( s );
+}
+
+void change_subscription_manager::deliver( std::shared_ptr< change_subscription > s )
+{
+   // Runs after the block has been applied and the write lock released.  While the callback
+   // is sending, changes of later blocks accumulate in pending and are sent together next.
+   s->delivering = true;
+   fc::async( [this, s]()
+   {
+      while( !s->pending.empty() || s->overflow )
+      {
+         change_notification notification;
+         notification.block_num = s->block_num;
+         notification.block_id = s->block_id;
+         notification.overflow = s->overflow;
+         notification.changes.reserve( s->pending.size() );
+         for( const auto& change : s->pending )
+            notification.changes.push_back( *change.second );
+         s->pending.clear();
+         s->overflow = false;
+
+         try
+         {
+            s->callback( fc::variant( notification ) );
+            std::lock_guard< std::mutex > lock( _mutex );
+            ++_statistics.notifications;
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "Error sending object changes to a subscriber: ${e}", ("e", e.to_string()) );
+            std::lock_guard< std::mutex > lock( _mutex );
+            ++_statistics.errors;
+         }
+      }
+      s->delivering = false;
+   }, "change_subscription_delivery" );
+}
+
+} } // steemit::app
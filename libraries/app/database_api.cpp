@@ -1,4 +1,7 @@
 #include <steemit/app/api_context.hpp>
+#include <steemit/app/api_executor.hpp>
+#include <steemit/app/api_response_cache.hpp>
+#include <steemit/app/http_rpc_server.hpp>
 #include <steemit/app/application.hpp>
 #include <steemit/app/database_api.hpp>
 #include <steemit/chain/get_config.hpp>
@@ -18,11 +21,31 @@
 #include <iostream>
 
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
+#define GET_BATCH_MAX_CALLS 1000
 
 namespace steemit { namespace app {
 
 class database_api_impl;
 
+namespace detail {
+
+   /** Lookups shared by the calls of the batch being executed on this thread */
+   struct batch_context
+   {
+      flat_map< account_id_type, string >  account_names;
+      map< string, batch_call_result >     results; ///< by method name and params
+   };
+
+   thread_local batch_context* current_batch = nullptr;
+
+   struct batch_scope
+   {
+      batch_scope( batch_context& context ) { current_batch = &context; }
+      ~batch_scope() { current_batch = nullptr; }
+   };
+
+}
+
 
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
@@ -38,6 +61,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       void set_pending_transaction_callback( std::function<void(const variant&)> cb );
       void set_block_applied_callback( std::function<void(const variant& block_id)> cb );
       void cancel_all_subscriptions();
+      void subscribe_to_changes( std::function<void(const variant&)> cb, const vector<string>& keys );
 
       // Blocks and transactions
       optional<block_header> get_block_header(uint32_t block_num)const;
@@ -76,12 +100,47 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       // signal handlers
       void on_applied_block( const chain::signed_block& b );
 
+      /** the name of an account, remembered for the rest of the batch when called from get_batch */
+      string get_account_name( account_id_type id )const;
+
+      /** Runs a read only call on the application's API executor, or under the read lock if there is none */
+      template< typename Lambda >
+      auto execute_read( Lambda&& callback )const -> decltype( callback() )
+      {
+         if( _executor != nullptr )
+            return _executor->execute( callback );
+         return _db.with_read_lock( callback );
+      }
+
+      /** Like execute_read, but the result is looked up in and added to the response cache */
+      template< typename Lambda >
+      auto execute_cached_read( const string& key, Lambda&& callback )const -> decltype( callback() )
+      {
+         return execute_read( [&]() -> decltype( callback() )
+         {
+            if( _response_cache == nullptr )
+               return callback();
+            return _response_cache->get_or_compute( _db, key, callback );
+         });
+      }
+
       mutable fc::bloom_filter                _subscribe_filter;
       std::function<void(const fc::variant&)> _subscribe_callback;
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
       steemit::chain::database&                _db;
+      api_executor*                            _executor = nullptr;
+      api_response_cache*                      _response_cache = nullptr;
+      change_subscription_manager*             _change_subscriptions = nullptr;
+      std::shared_ptr< change_subscription >   _change_subscription;
+      operation_queue*                         _operation_queue = nullptr;
+
+      /** weak because the HTTP server owns the APIs of its connections */
+      std::weak_ptr< http_rpc_server >         _http_server;
+
+      /** comment summaries are maintained by the tags plugin, which may not be enabled */
+      const tags::comment_summary_index*       _comment_summaries = nullptr;
 
       boost::signals2::scoped_connection       _block_applied_connection;
 
@@ -151,6 +210,24 @@ void database_api::cancel_all_subscriptions()
 void database_api_impl::cancel_all_subscriptions()
 {
    set_subscribe_callback( std::function<void(const fc::variant&)>(), true);
+   _change_subscription.reset();
+}
+
+void database_api::subscribe_to_changes( std::function<void(const variant&)> cb, const vector<string>& keys )
+{
+   my->subscribe_to_changes( cb, keys );
+}
+
+void database_api_impl::subscribe_to_changes( std::function<void(const variant&)> cb, const vector<string>& keys )
+{
+   FC_ASSERT( _change_subscriptions != nullptr, "Change subscriptions are not available" );
+   _change_subscription.reset();
+   _change_subscription = _change_subscriptions->subscribe( cb, keys );
+}
+
+void database_api::unsubscribe_from_changes()
+{
+   my->_change_subscription.reset();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -163,13 +240,25 @@ database_api::database_api( steemit::chain::database& db )
    : my( new database_api_impl( db ) ) {}
 
 database_api::database_api( const steemit::app::api_context& ctx )
-   : database_api( *ctx.app.chain_database() ) {}
+   : database_api( *ctx.app.chain_database() )
+{
+   my->_executor = &ctx.app.get_api_executor();
+   my->_response_cache = &ctx.app.get_api_response_cache();
+   my->_change_subscriptions = &ctx.app.get_change_subscription_manager();
+   my->_operation_queue = &ctx.app.get_operation_queue();
+   my->_http_server = ctx.app.get_http_rpc_server();
+}
 
 database_api::~database_api() {}
 
 database_api_impl::database_api_impl( steemit::chain::database& db ):_db(db)
 {
    wlog("creating database api ${x}", ("x",int64_t(this)) );
+   try
+   {
+      _comment_summaries = &_db.get_index_type< tags::comment_summary_index >();
+   }
+   catch( const fc::exception& ) {}
 }
 
 database_api_impl::~database_api_impl()
@@ -187,7 +276,10 @@ void database_api::on_api_startup() {}
 
 optional<block_header> database_api::get_block_header(uint32_t block_num)const
 {
-   return my->get_block_header( block_num );
+   return my->execute_read( [&]() -> optional<block_header>
+   {
+      return my->get_block_header( block_num );
+   });
 }
 
 optional<block_header> database_api_impl::get_block_header(uint32_t block_num) const
@@ -200,7 +292,10 @@ optional<block_header> database_api_impl::get_block_header(uint32_t block_num) c
 
 optional<signed_block> database_api::get_block(uint32_t block_num)const
 {
-   return my->get_block( block_num );
+   return my->execute_read( [&]() -> optional<signed_block>
+   {
+      return my->get_block( block_num );
+   });
 }
 
 optional<signed_block> database_api_impl::get_block(uint32_t block_num)const
@@ -226,20 +321,34 @@ fc::variant_object database_api_impl::get_config()const
 
 dynamic_global_property_object database_api::get_dynamic_global_properties()const
 {
-   return my->get_dynamic_global_properties();
+   return my->execute_read( [&]() -> dynamic_global_property_object
+   {
+      return my->get_dynamic_global_properties();
+   });
 }
 
 chain_properties database_api::get_chain_properties()const
 {
-   return my->_db.get_witness_schedule_object().median_props;
+   return my->execute_read( [&]() -> chain_properties
+   {
+      return my->_db.get_witness_schedule_object().median_props;
+   });
 }
 
-feed_history_object database_api::get_feed_history()const {
-   return my->_db.get_feed_history();
+feed_history_object database_api::get_feed_history()const
+{
+   return my->execute_read( [&]() -> feed_history_object
+   {
+      return my->_db.get_feed_history();
+   });
 }
 
-price database_api::get_current_median_history_price()const {
-   return my->_db.get_feed_history().current_median_history;
+price database_api::get_current_median_history_price()const
+{
+   return my->execute_read( [&]() -> price
+   {
+      return my->_db.get_feed_history().current_median_history;
+   });
 }
 
 dynamic_global_property_object database_api_impl::get_dynamic_global_properties()const
@@ -249,21 +358,82 @@ dynamic_global_property_object database_api_impl::get_dynamic_global_properties(
 
 witness_schedule_object database_api::get_witness_schedule()const
 {
-   return witness_schedule_id_type()( my->_db );
+   return my->execute_read( [&]() -> witness_schedule_object
+   {
+      return witness_schedule_id_type()( my->_db );
+   });
 }
 
 hardfork_version database_api::get_hardfork_version()const
 {
-   return hardfork_property_id_type()( my->_db ).current_hardfork_version;
+   return my->execute_read( [&]() -> hardfork_version
+   {
+      return hardfork_property_id_type()( my->_db ).current_hardfork_version;
+   });
 }
 
 scheduled_hardfork database_api::get_next_scheduled_hardfork() const
 {
-   scheduled_hardfork shf;
-   const auto& hpo = hardfork_property_id_type()( my->_db );
-   shf.hf_version = hpo.next_hardfork;
-   shf.live_time = hpo.next_hardfork_time;
-   return shf;
+   return my->execute_read( [&]() -> scheduled_hardfork
+   {
+      scheduled_hardfork shf;
+      const auto& hpo = hardfork_property_id_type()( my->_db );
+      shf.hf_version = hpo.next_hardfork;
+      shf.live_time = hpo.next_hardfork_time;
+      return shf;
+   });
+}
+
+pending_transaction_pool_statistics database_api::get_pending_transaction_statistics()const
+{
+   return my->execute_read( [&]() -> pending_transaction_pool_statistics
+   {
+      return my->_db.get_pending_transaction_statistics();
+   });
+}
+
+fork_database_statistics database_api::get_fork_database_statistics()const
+{
+   return my->execute_read( [&]() -> fork_database_statistics
+   {
+      return my->_db.get_fork_database_statistics();
+   });
+}
+
+api_executor_statistics database_api::get_api_executor_statistics()const
+{
+   if( my->_executor == nullptr )
+      return api_executor_statistics();
+   return my->_executor->get_statistics();
+}
+
+api_response_cache_statistics database_api::get_api_response_cache_statistics()const
+{
+   if( my->_response_cache == nullptr )
+      return api_response_cache_statistics();
+   return my->_response_cache->get_statistics();
+}
+
+change_subscription_statistics database_api::get_change_subscription_statistics()const
+{
+   if( my->_change_subscriptions == nullptr )
+      return change_subscription_statistics();
+   return my->_change_subscriptions->get_statistics();
+}
+
+operation_queue_statistics database_api::get_operation_queue_statistics()const
+{
+   if( my->_operation_queue == nullptr )
+      return operation_queue_statistics();
+   return my->_operation_queue->get_statistics();
+}
+
+http_rpc_statistics database_api::get_http_rpc_statistics()const
+{
+   auto server = my->_http_server.lock();
+   if( !server )
+      return http_rpc_statistics();
+   return server->get_statistics();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -274,7 +444,10 @@ scheduled_hardfork database_api::get_next_scheduled_hardfork() const
 
 vector<set<string>> database_api::get_key_references( vector<public_key_type> key )const
 {
-   return my->get_key_references( key );
+   return my->execute_read( [&]() -> vector<set<string>>
+   {
+      return my->get_key_references( key );
+   });
 }
 
 /**
@@ -312,7 +485,10 @@ vector<set<string>> database_api_impl::get_key_references( vector<public_key_typ
 
 vector< extended_account > database_api::get_accounts( vector< string > names )const
 {
-   return my->get_accounts( names );
+   return my->execute_read( [&]() -> vector< extended_account >
+   {
+      return my->get_accounts( names );
+   });
 }
 
 vector< extended_account > database_api_impl::get_accounts( vector< string > names )const
@@ -340,7 +516,10 @@ vector< extended_account > database_api_impl::get_accounts( vector< string > nam
 
 vector<account_id_type> database_api::get_account_references( account_id_type account_id )const
 {
-   return my->get_account_references( account_id );
+   return my->execute_read( [&]() -> vector<account_id_type>
+   {
+      return my->get_account_references( account_id );
+   });
 }
 
 vector<account_id_type> database_api_impl::get_account_references( account_id_type account_id )const
@@ -362,7 +541,10 @@ vector<account_id_type> database_api_impl::get_account_references( account_id_ty
 
 vector<optional<account_object>> database_api::lookup_account_names(const vector<string>& account_names)const
 {
-   return my->lookup_account_names( account_names );
+   return my->execute_read( [&]() -> vector<optional<account_object>>
+   {
+      return my->lookup_account_names( account_names );
+   });
 }
 
 vector<optional<account_object>> database_api_impl::lookup_account_names(const vector<string>& account_names)const
@@ -380,7 +562,10 @@ vector<optional<account_object>> database_api_impl::lookup_account_names(const v
 
 set<string> database_api::lookup_accounts(const string& lower_bound_name, uint32_t limit)const
 {
-   return my->lookup_accounts( lower_bound_name, limit );
+   return my->execute_read( [&]() -> set<string>
+   {
+      return my->lookup_accounts( lower_bound_name, limit );
+   });
 }
 
 set<string> database_api_impl::lookup_accounts(const string& lower_bound_name, uint32_t limit)const
@@ -401,7 +586,10 @@ set<string> database_api_impl::lookup_accounts(const string& lower_bound_name, u
 
 uint64_t database_api::get_account_count()const
 {
-   return my->get_account_count();
+   return my->execute_read( [&]() -> uint64_t
+   {
+      return my->get_account_count();
+   });
 }
 
 uint64_t database_api_impl::get_account_count()const
@@ -417,7 +605,10 @@ uint64_t database_api_impl::get_account_count()const
 
 vector<optional<witness_object>> database_api::get_witnesses(const vector<witness_id_type>& witness_ids)const
 {
-   return my->get_witnesses( witness_ids );
+   return my->execute_read( [&]() -> vector<optional<witness_object>>
+   {
+      return my->get_witnesses( witness_ids );
+   });
 }
 
 vector<optional<witness_object>> database_api_impl::get_witnesses(const vector<witness_id_type>& witness_ids)const
@@ -434,35 +625,41 @@ vector<optional<witness_object>> database_api_impl::get_witnesses(const vector<w
 
 fc::optional<witness_object> database_api::get_witness_by_account( string account_name ) const
 {
-   return my->get_witness_by_account( account_name );
+   return my->execute_read( [&]() -> fc::optional<witness_object>
+   {
+      return my->get_witness_by_account( account_name );
+   });
 }
 
 vector< witness_object > database_api::get_witnesses_by_vote( string from, uint32_t limit )const
 {
-   //idump((from)(limit));
-   FC_ASSERT( limit <= 100 );
+   return my->execute_read( [&]() -> vector< witness_object >
+   {
+      //idump((from)(limit));
+      FC_ASSERT( limit <= 100 );
 
-   vector<witness_object> result;
-   result.reserve(limit);
+      vector<witness_object> result;
+      result.reserve(limit);
 
-   const auto& name_idx = my->_db.get_index_type< witness_index >().indices().get< by_name >();
-   const auto& vote_idx = my->_db.get_index_type< witness_index >().indices().get< by_vote_name >();
+      const auto& name_idx = my->_db.get_index_type< witness_index >().indices().get< by_name >();
+      const auto& vote_idx = my->_db.get_index_type< witness_index >().indices().get< by_vote_name >();
 
-   auto itr = vote_idx.begin();
-   if( from.size() ) {
-      auto nameitr = name_idx.find( from );
-      FC_ASSERT( nameitr != name_idx.end(), "invalid witness name ${n}", ("n",from) );
-      itr = vote_idx.iterator_to( *nameitr );
-   }
+      auto itr = vote_idx.begin();
+      if( from.size() ) {
+         auto nameitr = name_idx.find( from );
+         FC_ASSERT( nameitr != name_idx.end(), "invalid witness name ${n}", ("n",from) );
+         itr = vote_idx.iterator_to( *nameitr );
+      }
 
-   while( itr != vote_idx.end()  &&
-          result.size() < limit &&
-          itr->votes > 0 )
-   {
-      result.push_back(*itr);
-      ++itr;
-   }
-   return result;
+      while( itr != vote_idx.end()  &&
+             result.size() < limit &&
+             itr->votes > 0 )
+      {
+         result.push_back(*itr);
+         ++itr;
+      }
+      return result;
+   });
 }
 
 fc::optional<witness_object> database_api_impl::get_witness_by_account( string account_name ) const
@@ -476,7 +673,10 @@ fc::optional<witness_object> database_api_impl::get_witness_by_account( string a
 
 set< string > database_api::lookup_witness_accounts( const string& lower_bound_name, uint32_t limit ) const
 {
-   return my->lookup_witness_accounts( lower_bound_name, limit );
+   return my->execute_read( [&]() -> set< string >
+   {
+      return my->lookup_witness_accounts( lower_bound_name, limit );
+   });
 }
 
 set< string > database_api_impl::lookup_witness_accounts( const string& lower_bound_name, uint32_t limit ) const
@@ -501,7 +701,10 @@ set< string > database_api_impl::lookup_witness_accounts( const string& lower_bo
 
 uint64_t database_api::get_witness_count()const
 {
-   return my->get_witness_count();
+   return my->execute_read( [&]() -> uint64_t
+   {
+      return my->get_witness_count();
+   });
 }
 
 uint64_t database_api_impl::get_witness_count()const
@@ -517,7 +720,10 @@ uint64_t database_api_impl::get_witness_count()const
 
 order_book database_api::get_order_book( uint32_t limit )const
 {
-   return my->get_order_book( limit );
+   return my->execute_read( [&]() -> order_book
+   {
+      return my->get_order_book( limit );
+   });
 }
 
 order_book database_api_impl::get_order_book( uint32_t limit )const
@@ -576,7 +782,10 @@ std::string database_api_impl::get_transaction_hex(const signed_transaction& trx
 
 set<public_key_type> database_api::get_required_signatures( const signed_transaction& trx, const flat_set<public_key_type>& available_keys )const
 {
-   return my->get_required_signatures( trx, available_keys );
+   return my->execute_read( [&]() -> set<public_key_type>
+   {
+      return my->get_required_signatures( trx, available_keys );
+   });
 }
 
 set<public_key_type> database_api_impl::get_required_signatures( const signed_transaction& trx, const flat_set<public_key_type>& available_keys )const
@@ -594,7 +803,10 @@ set<public_key_type> database_api_impl::get_required_signatures( const signed_tr
 
 set<public_key_type> database_api::get_potential_signatures( const signed_transaction& trx )const
 {
-   return my->get_potential_signatures( trx );
+   return my->execute_read( [&]() -> set<public_key_type>
+   {
+      return my->get_potential_signatures( trx );
+   });
 }
 
 set<public_key_type> database_api_impl::get_potential_signatures( const signed_transaction& trx )const
@@ -634,7 +846,10 @@ set<public_key_type> database_api_impl::get_potential_signatures( const signed_t
 
 bool database_api::verify_authority( const signed_transaction& trx ) const
 {
-   return my->verify_authority( trx );
+   return my->execute_read( [&]() -> bool
+   {
+      return my->verify_authority( trx );
+   });
 }
 
 bool database_api_impl::verify_authority( const signed_transaction& trx )const
@@ -649,7 +864,10 @@ bool database_api_impl::verify_authority( const signed_transaction& trx )const
 
 bool database_api::verify_account_authority( const string& name_or_id, const flat_set<public_key_type>& signers )const
 {
-   return my->verify_account_authority( name_or_id, signers );
+   return my->execute_read( [&]() -> bool
+   {
+      return my->verify_account_authority( name_or_id, signers );
+   });
 }
 
 bool database_api_impl::verify_account_authority( const string& name_or_id, const flat_set<public_key_type>& keys )const
@@ -677,62 +895,88 @@ bool database_api_impl::verify_account_authority( const string& name_or_id, cons
    return verify_authority( trx );
 }
 
-vector<convert_request_object> database_api::get_conversion_requests( const string& account )const {
-  const auto& idx = my->_db.get_index_type<convert_index>().indices().get<by_owner>();
-  vector<convert_request_object> result;
-  auto itr = idx.lower_bound(account);
-  while( itr != idx.end() && itr->owner == account ) {
-     result.push_back(*itr);
-     ++itr;
-  }
-  return result;
+vector<convert_request_object> database_api::get_conversion_requests( const string& account )const
+{
+   return my->execute_read( [&]() -> vector<convert_request_object>
+   {
+     const auto& idx = my->_db.get_index_type<convert_index>().indices().get<by_owner>();
+     vector<convert_request_object> result;
+     auto itr = idx.lower_bound(account);
+     while( itr != idx.end() && itr->owner == account ) {
+        result.push_back(*itr);
+        ++itr;
+     }
+     return result;
+   });
 }
 
-discussion database_api::get_content( string author, string permlink )const {
-   const auto& by_permlink_idx = my->_db.get_index_type< comment_index >().indices().get< by_permlink >();
-   auto itr = by_permlink_idx.find( boost::make_tuple( author, permlink ) );
-   if( itr != by_permlink_idx.end() )
+discussion database_api::get_content( string author, string permlink )const
+{
+   return my->execute_read( [&]() -> discussion
    {
-      discussion result(*itr);
-      set_pending_payout(result);
-      result.active_votes = get_active_votes( author, permlink );
-      return result;
-   }
-   return discussion();
+      const auto& by_permlink_idx = my->_db.get_index_type< comment_index >().indices().get< by_permlink >();
+      auto itr = by_permlink_idx.find( boost::make_tuple( author, permlink ) );
+      if( itr != by_permlink_idx.end() )
+      {
+         discussion result(*itr);
+         set_pending_payout(result);
+         result.active_votes = get_active_votes( author, permlink );
+         return result;
+      }
+      return discussion();
+   });
 }
 
 vector<vote_state> database_api::get_active_votes( string author, string permlink )const
 {
-   vector<vote_state> result;
-   const auto& comment = my->_db.get_comment( author, permlink );
-   const auto& idx = my->_db.get_index_type<comment_vote_index>().indices().get< by_comment_voter >();
-   comment_id_type cid(comment.id);
-   auto itr = idx.lower_bound( cid );
-   while( itr != idx.end() && itr->comment == cid )
+   return my->execute_read( [&]() -> vector<vote_state>
    {
-      const auto& vo = itr->voter(my->_db);
-      result.push_back(vote_state{vo.name,itr->weight,itr->rshares,itr->vote_percent,itr->last_update});
-      ++itr;
-   }
-   return result;
+      vector<vote_state> result;
+      const auto& comment = my->_db.get_comment( author, permlink );
+      const auto& idx = my->_db.get_index_type<comment_vote_index>().indices().get< by_comment_voter >();
+      comment_id_type cid(comment.id);
+      auto itr = idx.lower_bound( cid );
+      while( itr != idx.end() && itr->comment == cid )
+      {
+         result.push_back(vote_state{my->get_account_name(itr->voter),itr->weight,itr->rshares,itr->vote_percent,itr->last_update});
+         ++itr;
+      }
+      return result;
+   });
 }
-vector<account_vote> database_api::get_account_votes( string voter )const {
-   vector<account_vote> result;
+vector<account_vote> database_api::get_account_votes( string voter )const
+{
+   return my->execute_read( [&]() -> vector<account_vote>
+   {
+      vector<account_vote> result;
 
-   const auto& voter_acnt = my->_db.get_account(voter);
-   const auto& idx = my->_db.get_index_type<comment_vote_index>().indices().get< by_voter_comment >();
+      const auto& voter_acnt = my->_db.get_account(voter);
+      const auto& idx = my->_db.get_index_type<comment_vote_index>().indices().get< by_voter_comment >();
 
-   account_id_type aid(voter_acnt.id);
-   auto itr = idx.lower_bound( aid );
-   auto end = idx.upper_bound( aid );
-   while( itr != end )
-   {
-      const auto& vo = itr->comment(my->_db);
-      result.push_back(account_vote{(vo.author+"/"+vo.permlink),itr->weight,itr->rshares,itr->vote_percent, itr->last_update});
-      ++itr;
-   }
-   return result;
+      account_id_type aid(voter_acnt.id);
+      auto itr = idx.lower_bound( aid );
+      auto end = idx.upper_bound( aid );
+      while( itr != end )
+      {
+         const auto& vo = itr->comment(my->_db);
+         result.push_back(account_vote{(vo.author+"/"+vo.permlink),itr->weight,itr->rshares,itr->vote_percent, itr->last_update});
+         ++itr;
+      }
+      return result;
+   });
 }
+string database_api_impl::get_account_name( account_id_type id )const
+{
+   if( detail::current_batch == nullptr )
+      return id( _db ).name;
+
+   auto& names = detail::current_batch->account_names;
+   auto itr = names.find( id );
+   if( itr == names.end() )
+      itr = names.emplace( id, id( _db ).name ).first;
+   return itr->second;
+}
+
 u256 to256( const fc::uint128& t ) {
    u256 result( t.high_bits() );
    result <<= 65;
@@ -771,6 +1015,21 @@ void database_api::set_pending_payout( discussion& d )const
    set_url(d);
 }
 void database_api::set_url( discussion& d )const {
+   if( my->_comment_summaries != nullptr )
+   {
+      const auto& summary_idx = my->_comment_summaries->indices().get< tags::by_comment >();
+      auto summary = summary_idx.find( d.id );
+      if( summary != summary_idx.end() )
+      {
+         d.url = summary->url;
+         d.root_title = summary->root_comment == d.id ? d.title : summary->root_comment( my->_db ).title;
+         /// votes are removed once the comment is paid out
+         if( d.cashout_time != fc::time_point_sec::maximum() )
+            d.active_vote_count = summary->active_vote_count;
+         return;
+      }
+   }
+
    const comment_object* root = &d;
    while( root->parent_author.size() ) {
       root = &my->_db.get_comment( root->parent_author, root->parent_permlink );
@@ -781,17 +1040,21 @@ void database_api::set_url( discussion& d )const {
       d.url += "#@" + d.author + "/" + d.permlink;
 }
 
-vector<discussion> database_api::get_content_replies( string author, string permlink )const {
-   const auto& by_permlink_idx = my->_db.get_index_type< comment_index >().indices().get< by_parent >();
-   auto itr = by_permlink_idx.find( boost::make_tuple( author, permlink ) );
-   vector<discussion> result;
-   while( itr != by_permlink_idx.end() && itr->parent_author == author && itr->parent_permlink == permlink )
+vector<discussion> database_api::get_content_replies( string author, string permlink )const
+{
+   return my->execute_read( [&]() -> vector<discussion>
    {
-      result.push_back(*itr);
-      set_pending_payout( result.back() );
-      ++itr;
-   }
-   return result;
+      const auto& by_permlink_idx = my->_db.get_index_type< comment_index >().indices().get< by_parent >();
+      auto itr = by_permlink_idx.find( boost::make_tuple( author, permlink ) );
+      vector<discussion> result;
+      while( itr != by_permlink_idx.end() && itr->parent_author == author && itr->parent_permlink == permlink )
+      {
+         result.push_back(*itr);
+         set_pending_payout( result.back() );
+         ++itr;
+      }
+      return result;
+   });
 }
 
 /**
@@ -800,71 +1063,164 @@ vector<discussion> database_api::get_content_replies( string author, string perm
 
 
 
-vector<discussion> database_api::get_replies_by_last_update( string start_parent_author, string start_permlink, uint32_t limit )const {
+vector<discussion> database_api::get_replies_by_last_update( string start_parent_author, string start_permlink, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_replies_by_last_update", start_parent_author, start_permlink, limit ), [&]() -> vector<discussion>
+   {
+
+      idump((start_parent_author)(start_permlink)(limit) );
+      const auto& last_update_idx = my->_db.get_index_type< comment_index >().indices().get< by_last_update >();
 
-   idump((start_parent_author)(start_permlink)(limit) );
-   const auto& last_update_idx = my->_db.get_index_type< comment_index >().indices().get< by_last_update >();
+      auto itr = last_update_idx.begin();
 
-   auto itr = last_update_idx.begin();
 
+      bool filter_by_parent_author = true;
+      if( start_permlink.size() )
+         itr = last_update_idx.iterator_to( my->_db.get_comment( start_parent_author, start_permlink ) );
+      else if( start_parent_author.size() ) {
+         itr = last_update_idx.lower_bound( boost::make_tuple( start_parent_author, time_point_sec::maximum(), object_id_type() ) );
+         filter_by_parent_author = true;
+      }
 
-   bool filter_by_parent_author = true;
-   if( start_permlink.size() )
-      itr = last_update_idx.iterator_to( my->_db.get_comment( start_parent_author, start_permlink ) );
-   else if( start_parent_author.size() ) {
-      itr = last_update_idx.lower_bound( boost::make_tuple( start_parent_author, time_point_sec::maximum(), object_id_type() ) );
-      filter_by_parent_author = true;
-   }
+      vector<discussion> result;
+      while( itr != last_update_idx.end() && result.size() < limit  ) {
+         if( filter_by_parent_author && itr->parent_author != start_parent_author ) {
+            return result;
+         }
 
-   vector<discussion> result;
-   while( itr != last_update_idx.end() && result.size() < limit  ) {
-      if( filter_by_parent_author && itr->parent_author != start_parent_author ) {
-         return result;
+         result.push_back( *itr );
+         set_pending_payout(result.back());
+         result.back().active_votes = get_active_votes( itr->author, itr->permlink );
+         ++itr;
+      }
+      return result;
+   });
+}
+
+
+namespace detail {
+
+   struct operation_name_visitor
+   {
+      typedef void result_type;
+      operation_name_visitor( string& n ) : name( n ) {}
+      string& name;
+
+      template< typename T >
+      void operator()( const T& )const
+      {
+         name = fc::get_typename< T >::name();
+         auto start = name.find_last_of( ':' ) + 1;
+         auto end   = name.find_last_of( '_' );
+         name = name.substr( start, end - start );
       }
+   };
+
+   /** operation::which() of an operation by the name it has in JSON, e.g. transfer */
+   uint16_t get_operation_type( const string& name )
+   {
+      static const std::map< string, uint16_t > types = []() -> std::map< string, uint16_t >
+      {
+         std::map< string, uint16_t > result;
+         for( int i = 0; i < operation::count(); ++i )
+         {
+            operation op;
+            op.set_which( i );
+            string n;
+            op.visit( operation_name_visitor( n ) );
+            result[ n ] = i;
+         }
+         return result;
+      }();
 
-      result.push_back( *itr );
-      set_pending_payout(result.back());
-      result.back().active_votes = get_active_votes( itr->author, itr->permlink );
-      ++itr;
+      auto itr = types.find( name );
+      FC_ASSERT( itr != types.end(), "Invalid operation name: ${n}", ("n", name) );
+      return itr->second;
    }
-   return result;
+
 }
 
+map<uint32_t,operation_object> database_api::get_account_history( string account, uint64_t from, uint32_t limit )const
+{
+   return my->execute_read( [&]() -> map<uint32_t,operation_object>
+   {
+      FC_ASSERT( limit <= 2000, "Limit of ${l} is greater than maxmimum allowed", ("l",limit) );
+      FC_ASSERT( from >= limit, "From must be greater than limit" );
 
-map<uint32_t,operation_object> database_api::get_account_history( string account, uint64_t from, uint32_t limit )const {
-   FC_ASSERT( limit <= 2000, "Limit of ${l} is greater than maxmimum allowed", ("l",limit) );
-   FC_ASSERT( from >= limit, "From must be greater than limit" );
-   idump((account)(from)(limit));
-   const auto& idx = my->_db.get_index_type<account_history_index>().indices().get<by_account>();
-   auto itr = idx.lower_bound( boost::make_tuple( account, from ) );
-   if( itr != idx.end() ) idump((*itr));
-   auto end = idx.upper_bound( boost::make_tuple( account, std::max( int64_t(0), int64_t(itr->sequence)-limit ) ) );
-   if( end != idx.end() ) idump((*end));
+      map<uint32_t,operation_object> result;
+      const auto& accounts = my->_db.get_index_type<account_index>().indices().get<by_name>();
+      auto acnt = accounts.find( account );
+      if( acnt == accounts.end() )
+         return result;
 
-   map<uint32_t,operation_object> result;
-   while( itr != end ) {
-      result[itr->sequence] = itr->op(my->_db);
-      ++itr;
-   }
-   return result;
+      const auto& idx = my->_db.get_index_type<account_history_index>().indices().get<by_account>();
+      auto itr = idx.lower_bound( boost::make_tuple( acnt->id, uint32_t( std::min< uint64_t >( from, uint32_t(-1) ) ) ) );
+      if( itr == idx.end() || itr->account != acnt->id )
+         return result;
+      auto end = idx.upper_bound( boost::make_tuple( acnt->id, uint32_t( std::max( int64_t(0), int64_t(itr->sequence)-limit ) ) ) );
+
+      while( itr != end ) {
+         result[itr->sequence] = itr->op(my->_db);
+         ++itr;
+      }
+      return result;
+   });
 }
 
-vector<tags::tag_stats_object> database_api::get_trending_tags( string after, uint32_t limit )const {
-  vector<tags::tag_stats_object> result;
-  const auto& tags_stats_idx = my->_db.get_index_type<tags::tag_stats_index>().indices().get<tags::by_tag>();
-  auto itr = tags_stats_idx.lower_bound(after);
+map<uint32_t,operation_object> database_api::get_account_history_by_type( string account, string op_type, uint64_t from, uint32_t limit )const
+{
+   return my->execute_read( [&]() -> map<uint32_t,operation_object>
+   {
+      FC_ASSERT( limit <= 2000, "Limit of ${l} is greater than maxmimum allowed", ("l",limit) );
+      FC_ASSERT( from >= limit, "From must be greater than limit" );
+      uint16_t type = detail::get_operation_type( op_type );
+
+      map<uint32_t,operation_object> result;
+      const auto& accounts = my->_db.get_index_type<account_index>().indices().get<by_name>();
+      auto acnt = accounts.find( account );
+      if( acnt == accounts.end() )
+         return result;
 
-  while( itr != tags_stats_idx.end() && limit > 0 ) {
-     result.push_back(*itr);
-     --limit; ++itr;
-  }
+      const auto& idx = my->_db.get_index_type<account_history_index>().indices().get<by_account_op_type>();
+      auto itr = idx.lower_bound( boost::make_tuple( acnt->id, type, uint32_t( std::min< uint64_t >( from, uint32_t(-1) ) ) ) );
+      if( itr == idx.end() || itr->account != acnt->id || itr->op_type != type )
+         return result;
+      auto end = idx.upper_bound( boost::make_tuple( acnt->id, type, uint32_t( std::max( int64_t(0), int64_t(itr->op_sequence)-limit ) ) ) );
 
-  return result;
+      while( itr != end ) {
+         result[itr->op_sequence] = itr->op(my->_db);
+         ++itr;
+      }
+      return result;
+   });
+}
+
+vector<tags::tag_stats_object> database_api::get_trending_tags( string after, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_trending_tags", after, limit ), [&]() -> vector<tags::tag_stats_object>
+   {
+     vector<tags::tag_stats_object> result;
+     const auto& tags_stats_idx = my->_db.get_index_type<tags::tag_stats_index>().indices().get<tags::by_tag>();
+     auto itr = tags_stats_idx.lower_bound(after);
+
+     while( itr != tags_stats_idx.end() && limit > 0 ) {
+        result.push_back(*itr);
+        --limit; ++itr;
+     }
+
+     return result;
+   });
 }
 
-discussion database_api::get_discussion( comment_id_type id )const {
+discussion database_api::get_discussion( comment_id_type id, uint32_t truncate_body )const {
    discussion d = id(my->_db);
-   set_url( d );
+   if( truncate_body && d.body.size() > truncate_body )
+   {
+      /// do not split a multi-byte UTF-8 character
+      while( truncate_body && ( d.body[truncate_body] & 0xC0 ) == 0x80 )
+         --truncate_body;
+      d.body.erase( truncate_body );
+   }
    set_pending_payout( d );
    return d;
 }
@@ -872,7 +1228,7 @@ discussion database_api::get_discussion( comment_id_type id )const {
 
 template<typename Index, typename StartItr>
 vector<discussion> database_api::get_discussions( const discussion_query& query, 
-                                                  const string& tag, 
+                                                  tags::tag_id_type tag,
                                                   comment_id_type parent,
                                                   const Index& tidx, StartItr tidx_itr )const
 {
@@ -899,7 +1255,7 @@ vector<discussion> database_api::get_discussions( const discussion_query& query,
    while( count > 0 && tidx_itr != tidx.end() ) {
       if( tidx_itr->tag != tag || tidx_itr->parent != parent )
          break;
-      result.push_back( get_discussion( tidx_itr->comment ) );
+      result.push_back( get_discussion( tidx_itr->comment, query.truncate_body ) );
 
       ++tidx_itr; --count;
    }
@@ -914,121 +1270,181 @@ comment_id_type database_api::get_parent( const discussion_query& query )const {
    return parent;
 }
 
-vector<discussion> database_api::get_discussions_by_trending( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
+vector<discussion> database_api::get_discussions_by_trending( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_trending", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_children_rshares2>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, fc::uint128_t::max_value() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_children_rshares2>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, fc::uint128_t::max_value() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
 
 
 
-vector<discussion> database_api::get_discussions_by_created( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
-   idump((parent));
+vector<discussion> database_api::get_discussions_by_created( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_created", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
+      idump((parent));
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_created>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, fc::time_point_sec::maximum() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_created>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, fc::time_point_sec::maximum() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
 
-vector<discussion> database_api::get_discussions_by_active( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
+vector<discussion> database_api::get_discussions_by_active( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_active", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_active>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, fc::time_point_sec::maximum() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_active>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, fc::time_point_sec::maximum() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
 
-vector<discussion> database_api::get_discussions_by_cashout( const discussion_query& query )const {
-   vector<discussion> result;
-   return result;
+vector<discussion> database_api::get_discussions_by_cashout( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_cashout", query ), [&]() -> vector<discussion>
+   {
+      vector<discussion> result;
+      return result;
+   });
 }
-vector<discussion> database_api::get_discussions_by_payout( const discussion_query& query )const {
-   vector<discussion> result;
-   return result;
+vector<discussion> database_api::get_discussions_by_payout( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_payout", query ), [&]() -> vector<discussion>
+   {
+      vector<discussion> result;
+      return result;
+   });
 }
-vector<discussion> database_api::get_discussions_by_votes( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
+vector<discussion> database_api::get_discussions_by_votes( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_votes", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_net_votes>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, std::numeric_limits<int32_t>::max() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_net_votes>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, std::numeric_limits<int32_t>::max() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
-vector<discussion> database_api::get_discussions_by_children( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
+vector<discussion> database_api::get_discussions_by_children( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_children", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_children>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, std::numeric_limits<int32_t>::max() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_children>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, std::numeric_limits<int32_t>::max() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
-vector<discussion> database_api::get_discussions_by_hot( const discussion_query& query )const {
-   query.validate();
-   auto tag = fc::to_lower( query.tag );
-   auto parent = get_parent( query );
+vector<discussion> database_api::get_discussions_by_hot( const discussion_query& query )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_hot", query ), [&]() -> vector<discussion>
+   {
+      query.validate();
+      auto tag = tags::find_tag( my->_db, fc::to_lower( query.tag ) );
+      if( !tag )
+         return vector<discussion>();
+      auto parent = get_parent( query );
 
-   const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_hot>();
-   auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, std::numeric_limits<double>::max() )  );
+      const auto& tidx = my->_db.get_index_type<tags::tag_index>().indices().get<tags::by_parent_hot>();
+      auto tidx_itr = tidx.lower_bound( boost::make_tuple( *tag, parent, std::numeric_limits<double>::max() )  );
 
-   return get_discussions( query, tag, parent, tidx, tidx_itr );
+      return get_discussions( query, *tag, parent, tidx, tidx_itr );
+   });
 }
 
 
 
-vector<category_object> database_api::get_trending_categories( string after, uint32_t limit )const {
-   limit = std::min( limit, uint32_t(100) );
-   vector<category_object> result; result.reserve( limit );
+vector<category_object> database_api::get_trending_categories( string after, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_trending_categories", after, limit ), [&]() -> vector<category_object>
+   {
+      limit = std::min( limit, uint32_t(100) );
+      vector<category_object> result; result.reserve( limit );
 
-   const auto& nidx = my->_db.get_index_type<chain::category_index>().indices().get<by_name>();
+      const auto& nidx = my->_db.get_index_type<chain::category_index>().indices().get<by_name>();
 
-   const auto& ridx = my->_db.get_index_type<chain::category_index>().indices().get<by_rshares>();
-   auto itr = ridx.begin();
-   if( after != "" && nidx.size() )
-   {
-      auto nitr = nidx.lower_bound( after );
-      if( nitr == nidx.end() ) itr = ridx.end();
-      else itr = ridx.iterator_to( *nitr );
-   }
+      const auto& ridx = my->_db.get_index_type<chain::category_index>().indices().get<by_rshares>();
+      auto itr = ridx.begin();
+      if( after != "" && nidx.size() )
+      {
+         auto nitr = nidx.lower_bound( after );
+         if( nitr == nidx.end() ) itr = ridx.end();
+         else itr = ridx.iterator_to( *nitr );
+      }
 
-   while( itr != ridx.end() && result.size() < limit ) {
-      result.push_back( *itr );
-      ++itr;
-   }
-   return result;
+      while( itr != ridx.end() && result.size() < limit ) {
+         result.push_back( *itr );
+         ++itr;
+      }
+      return result;
+   });
 }
 
-vector<category_object> database_api::get_best_categories( string after, uint32_t limit )const {
-   limit = std::min( limit, uint32_t(100) );
-   vector<category_object> result; result.reserve( limit );
-   return result;
+vector<category_object> database_api::get_best_categories( string after, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_best_categories", after, limit ), [&]() -> vector<category_object>
+   {
+      limit = std::min( limit, uint32_t(100) );
+      vector<category_object> result; result.reserve( limit );
+      return result;
+   });
 }
 
-vector<category_object> database_api::get_active_categories( string after, uint32_t limit )const {
-   limit = std::min( limit, uint32_t(100) );
-   vector<category_object> result; result.reserve( limit );
-   return result;
+vector<category_object> database_api::get_active_categories( string after, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_active_categories", after, limit ), [&]() -> vector<category_object>
+   {
+      limit = std::min( limit, uint32_t(100) );
+      vector<category_object> result; result.reserve( limit );
+      return result;
+   });
 }
 
-vector<category_object> database_api::get_recent_categories( string after, uint32_t limit )const {
-   limit = std::min( limit, uint32_t(100) );
-   vector<category_object> result; result.reserve( limit );
-   return result;
+vector<category_object> database_api::get_recent_categories( string after, uint32_t limit )const
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_recent_categories", after, limit ), [&]() -> vector<category_object>
+   {
+      limit = std::min( limit, uint32_t(100) );
+      vector<category_object> result; result.reserve( limit );
+      return result;
+   });
 }
 
 
@@ -1054,360 +1470,470 @@ void database_api::recursively_fetch_content( state& _state, discussion& root, s
   }
 }
 
-vector<string> database_api::get_miner_queue()const {
-   vector<string> result;
-   const auto& pow_idx = my->_db.get_index_type<witness_index>().indices().get<by_pow>();
+vector<string> database_api::get_miner_queue()const
+{
+   return my->execute_read( [&]() -> vector<string>
+   {
+      vector<string> result;
+      const auto& pow_idx = my->_db.get_index_type<witness_index>().indices().get<by_pow>();
 
-   auto itr = pow_idx.upper_bound(0);
-   while( itr != pow_idx.end() ) {
-      if( itr->pow_worker )
-         result.push_back( itr->owner );
-      ++itr;
-   }
-   return result;
+      auto itr = pow_idx.upper_bound(0);
+      while( itr != pow_idx.end() ) {
+         if( itr->pow_worker )
+            result.push_back( itr->owner );
+         ++itr;
+      }
+      return result;
+   });
 }
 
-vector<string> database_api::get_active_witnesses()const {
-   const auto& wso = my->_db.get_witness_schedule_object();
-   return wso.current_shuffled_witnesses;
+vector<string> database_api::get_active_witnesses()const
+{
+   return my->execute_read( [&]() -> vector<string>
+   {
+      const auto& wso = my->_db.get_witness_schedule_object();
+      return wso.current_shuffled_witnesses;
+   });
 }
 
 vector<discussion>  database_api::get_discussions_by_author_before_date(
     string author, string start_permlink, time_point_sec before_date, uint32_t limit )const
-{ try {
-     vector<discussion> result;
+{
+   return my->execute_cached_read( api_response_cache::make_key( "get_discussions_by_author_before_date", author, start_permlink, before_date, limit ), [&]() -> vector<discussion>
+   {
+      try
+      {
+         vector<discussion> result;
 
-     FC_ASSERT( limit <= 100 );
-     int count = 0;
-     const auto& didx = my->_db.get_index_type<comment_index>().indices().get<by_author_last_update>();
+         FC_ASSERT( limit <= 100 );
+         int count = 0;
+         const auto& didx = my->_db.get_index_type<comment_index>().indices().get<by_author_last_update>();
 
-     if( before_date == time_point_sec() )
-        before_date = time_point_sec::maximum();
+         if( before_date == time_point_sec() )
+            before_date = time_point_sec::maximum();
 
-     auto itr = didx.lower_bound( boost::make_tuple( author, time_point_sec::maximum() ) );
-     if( start_permlink.size() ) {
-        const auto& comment = my->_db.get_comment( author, start_permlink );
-        if( comment.created < before_date )
-           itr = didx.iterator_to(comment);
-     }
+         auto itr = didx.lower_bound( boost::make_tuple( author, time_point_sec::maximum() ) );
+         if( start_permlink.size() ) {
+            const auto& comment = my->_db.get_comment( author, start_permlink );
+            if( comment.created < before_date )
+               itr = didx.iterator_to(comment);
+         }
 
 
-     while( itr != didx.end() && itr->author ==  author && count < limit ) {
-        result.push_back( *itr );
-        set_pending_payout( result.back() );
-        result.back().active_votes = get_active_votes( itr->author, itr->permlink );
-        ++itr;
-        ++count;
-     }
+         while( itr != didx.end() && itr->author ==  author && count < limit ) {
+            result.push_back( *itr );
+            set_pending_payout( result.back() );
+            result.back().active_votes = get_active_votes( itr->author, itr->permlink );
+            ++itr;
+            ++count;
+         }
 
-     return result;
-} FC_CAPTURE_AND_RETHROW( (author)(start_permlink)(before_date)(limit) ) }
+         return result;
+      } FC_CAPTURE_AND_RETHROW( (author)(start_permlink)(before_date)(limit) )
+   });
+}
 
 
 state database_api::get_state( string path )const
 {
-   state _state;
-   _state.props         = get_dynamic_global_properties();
-   _state.current_route = path;
-   _state.feed_price    = get_current_median_history_price();
+   return my->execute_cached_read( api_response_cache::make_key( "get_state", path ), [&]() -> state
+   {
+      state _state;
+      _state.props         = get_dynamic_global_properties();
+      _state.current_route = path;
+      _state.feed_price    = get_current_median_history_price();
 
-   try {
-   if( path.size() && path[0] == '/' )
-      path = path.substr(1); /// remove '/' from front
+      try {
+      if( path.size() && path[0] == '/' )
+         path = path.substr(1); /// remove '/' from front
 
-   if( !path.size() )
-      path = "trending";
+      if( !path.size() )
+         path = "trending";
 
-   /// FETCH CATEGORY STATE
-   auto trending_cat = get_trending_categories( "", 100 );
-   for( const auto& c : trending_cat )
-   {
-      _state.category_idx.trending.push_back(c.name);
-      _state.categories[c.name] = c;
-   }
-   auto best_cat     = get_best_categories( "", 50 );
-   for( const auto& c : best_cat )
-   {
-      _state.category_idx.best.push_back(c.name);
-      _state.categories[c.name] = c;
-   }
-   /// END FETCH CATEGORY STATE
-
-   set<string> accounts;
-
-   vector<string> part; part.reserve(4);
-   boost::split( part, path, boost::is_any_of("/") );
-   part.resize(std::max( part.size(), size_t(4) ) ); // at least 4
-   idump((part));
-
-   auto tag = fc::to_lower( part[1] );
-   idump((part[1])(part[1]==string()));
-
-   if( part[0].size() && part[0][0] == '@' ) {
-      auto acnt = part[0].substr(1);
-      _state.accounts[acnt] = my->_db.get_account(acnt);
-      auto& eacnt = _state.accounts[acnt];
-      if( part[1] == "recommended" ) {
-          auto discussions = get_recommended_for( acnt, 100 );
-          eacnt.recommended = vector<string>();
-          for( const auto& d : discussions ) {
-              auto ref = d.author+"/"+d.permlink;
-              _state.content[ ref ] = d;
-              eacnt.recommended->push_back( ref );
-          }
+      /// FETCH CATEGORY STATE
+      auto trending_cat = get_trending_categories( "", 100 );
+      for( const auto& c : trending_cat )
+      {
+         _state.category_idx.trending.push_back(c.name);
+         _state.categories[c.name] = c;
       }
-      else if( part[1] == "transfers" ) {
-         auto history = get_account_history( acnt, uint64_t(-1), 1000 );
-         for( auto& item : history ) {
-            switch( item.second.op.which() ) {
-               case operation::tag<transfer_to_vesting_operation>::value:
-               case operation::tag<withdraw_vesting_operation>::value:
-               case operation::tag<interest_operation>::value:
-               case operation::tag<transfer_operation>::value:
-               case operation::tag<liquidity_reward_operation>::value:
-               case operation::tag<comment_reward_operation>::value:
-               case operation::tag<curate_reward_operation>::value:
-                  eacnt.transfer_history[item.first] =  item.second;
-                  break;
-               case operation::tag<comment_operation>::value:
-               //   eacnt.post_history[item.first] =  item.second;
-                  break;
-               case operation::tag<limit_order_create_operation>::value:
-               case operation::tag<limit_order_cancel_operation>::value:
-               case operation::tag<fill_convert_request_operation>::value:
-               case operation::tag<fill_order_operation>::value:
-               //   eacnt.market_history[item.first] =  item.second;
-                  break;
-               case operation::tag<vote_operation>::value:
-               case operation::tag<account_witness_vote_operation>::value:
-               case operation::tag<account_witness_proxy_operation>::value:
-               //   eacnt.vote_history[item.first] =  item.second;
-                  break;
-               case operation::tag<account_create_operation>::value:
-               case operation::tag<account_update_operation>::value:
-               case operation::tag<witness_update_operation>::value:
-               case operation::tag<pow_operation>::value:
-               case operation::tag<custom_operation>::value:
-               default:
-                  eacnt.other_history[item.first] =  item.second;
-            }
+      auto best_cat     = get_best_categories( "", 50 );
+      for( const auto& c : best_cat )
+      {
+         _state.category_idx.best.push_back(c.name);
+         _state.categories[c.name] = c;
+      }
+      /// END FETCH CATEGORY STATE
+
+      set<string> accounts;
+
+      vector<string> part; part.reserve(4);
+      boost::split( part, path, boost::is_any_of("/") );
+      part.resize(std::max( part.size(), size_t(4) ) ); // at least 4
+      idump((part));
+
+      auto tag = fc::to_lower( part[1] );
+      idump((part[1])(part[1]==string()));
+
+      if( part[0].size() && part[0][0] == '@' ) {
+         auto acnt = part[0].substr(1);
+         _state.accounts[acnt] = my->_db.get_account(acnt);
+         auto& eacnt = _state.accounts[acnt];
+         if( part[1] == "recommended" ) {
+             auto discussions = get_recommended_for( acnt, 100 );
+             eacnt.recommended = vector<string>();
+             for( const auto& d : discussions ) {
+                 auto ref = d.author+"/"+d.permlink;
+                 _state.content[ ref ] = d;
+                 eacnt.recommended->push_back( ref );
+             }
          }
-      } else if( part[1] == "recent-replies" ) {
-        auto replies = get_replies_by_last_update( acnt, "", 50 );
-        eacnt.recent_replies = vector<string>();
-        for( const auto& reply : replies ) {
-           auto reply_ref = reply.author+"/"+reply.permlink;
-           _state.content[ reply_ref ] = reply;
-           eacnt.recent_replies->push_back( reply_ref );
-        }
-      } else if( part[1] == "posts" ) {
-        int count = 0;
-        const auto& pidx = my->_db.get_index_type<comment_index>().indices().get<by_author_last_update>();
-        auto itr = pidx.lower_bound( boost::make_tuple(acnt, time_point_sec::maximum() ) );
-        eacnt.posts = vector<string>();
-        while( itr != pidx.end() && itr->author == acnt && count < 100 ) {
-           eacnt.posts->push_back(itr->permlink);
-           _state.content[acnt+"/"+itr->permlink] = *itr;
-           set_pending_payout( _state.content[acnt+"/"+itr->permlink] );
-           ++itr;
-           ++count;
-        }
-      } else if( part[1].size() == 0 || part[1] == "blog" ) {
+         else if( part[1] == "transfers" ) {
+            auto history = get_account_history( acnt, uint64_t(-1), 1000 );
+            for( auto& item : history ) {
+               switch( item.second.op.which() ) {
+                  case operation::tag<transfer_to_vesting_operation>::value:
+                  case operation::tag<withdraw_vesting_operation>::value:
+                  case operation::tag<interest_operation>::value:
+                  case operation::tag<transfer_operation>::value:
+                  case operation::tag<liquidity_reward_operation>::value:
+                  case operation::tag<comment_reward_operation>::value:
+                  case operation::tag<curate_reward_operation>::value:
+                     eacnt.transfer_history[item.first] =  item.second;
+                     break;
+                  case operation::tag<comment_operation>::value:
+                  //   eacnt.post_history[item.first] =  item.second;
+                     break;
+                  case operation::tag<limit_order_create_operation>::value:
+                  case operation::tag<limit_order_cancel_operation>::value:
+                  case operation::tag<fill_convert_request_operation>::value:
+                  case operation::tag<fill_order_operation>::value:
+                  //   eacnt.market_history[item.first] =  item.second;
+                     break;
+                  case operation::tag<vote_operation>::value:
+                  case operation::tag<account_witness_vote_operation>::value:
+                  case operation::tag<account_witness_proxy_operation>::value:
+                  //   eacnt.vote_history[item.first] =  item.second;
+                     break;
+                  case operation::tag<account_create_operation>::value:
+                  case operation::tag<account_update_operation>::value:
+                  case operation::tag<witness_update_operation>::value:
+                  case operation::tag<pow_operation>::value:
+                  case operation::tag<custom_operation>::value:
+                  default:
+                     eacnt.other_history[item.first] =  item.second;
+               }
+            }
+         } else if( part[1] == "recent-replies" ) {
+           auto replies = get_replies_by_last_update( acnt, "", 50 );
+           eacnt.recent_replies = vector<string>();
+           for( const auto& reply : replies ) {
+              auto reply_ref = reply.author+"/"+reply.permlink;
+              _state.content[ reply_ref ] = reply;
+              eacnt.recent_replies->push_back( reply_ref );
+           }
+         } else if( part[1] == "posts" ) {
            int count = 0;
-           const auto& pidx = my->_db.get_index_type<comment_index>().indices().get<by_blog>();
-           auto itr = pidx.lower_bound( boost::make_tuple(acnt, std::string(""), time_point_sec::maximum() ) );
-           eacnt.blog = vector<string>();
-           while( itr != pidx.end() && itr->author == acnt && count < 100 && !itr->parent_author.size() ) {
-              eacnt.blog->push_back(itr->permlink);
+           const auto& pidx = my->_db.get_index_type<comment_index>().indices().get<by_author_last_update>();
+           auto itr = pidx.lower_bound( boost::make_tuple(acnt, time_point_sec::maximum() ) );
+           eacnt.posts = vector<string>();
+           while( itr != pidx.end() && itr->author == acnt && count < 100 ) {
+              eacnt.posts->push_back(itr->permlink);
               _state.content[acnt+"/"+itr->permlink] = *itr;
               set_pending_payout( _state.content[acnt+"/"+itr->permlink] );
               ++itr;
               ++count;
            }
+         } else if( part[1].size() == 0 || part[1] == "blog" ) {
+              int count = 0;
+              const auto& pidx = my->_db.get_index_type<comment_index>().indices().get<by_blog>();
+              auto itr = pidx.lower_bound( boost::make_tuple(acnt, std::string(""), time_point_sec::maximum() ) );
+              eacnt.blog = vector<string>();
+              while( itr != pidx.end() && itr->author == acnt && count < 100 && !itr->parent_author.size() ) {
+                 eacnt.blog->push_back(itr->permlink);
+                 _state.content[acnt+"/"+itr->permlink] = *itr;
+                 set_pending_payout( _state.content[acnt+"/"+itr->permlink] );
+                 ++itr;
+                 ++count;
+              }
+         }
       }
-   }
-   /// pull a complete discussion
-   else if( part[1].size() && part[1][0] == '@' ) {
-
-      auto account  = part[1].substr( 1 );
-      auto category = part[0];
-      auto slug     = part[2];
-
-      auto key = account +"/" + slug;
-      idump((key));
-      auto dis = get_content( account, slug );
-      recursively_fetch_content( _state, dis, accounts );
-      _state.content[key] = std::move(dis);
-   }
-   else if( part[0] == "witnesses" || part[0] == "~witnesses") {
-      auto wits = get_witnesses_by_vote( "", 50 );
-      for( const auto& w : wits ) {
-         _state.witnesses[w.owner] = w;
+      /// pull a complete discussion
+      else if( part[1].size() && part[1][0] == '@' ) {
+
+         auto account  = part[1].substr( 1 );
+         auto category = part[0];
+         auto slug     = part[2];
+
+         auto key = account +"/" + slug;
+         idump((key));
+         auto dis = get_content( account, slug );
+         recursively_fetch_content( _state, dis, accounts );
+         _state.content[key] = std::move(dis);
       }
-      _state.pow_queue = get_miner_queue();
-   }
-   else if( part[0] == "trending"  ) {
-      auto trending_disc = get_discussions_by_trending( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.trending.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "witnesses" || part[0] == "~witnesses") {
+         auto wits = get_witnesses_by_vote( "", 50 );
+         for( const auto& w : wits ) {
+            _state.witnesses[w.owner] = w;
+         }
+         _state.pow_queue = get_miner_queue();
       }
-   }
-   else if( part[0] == "responses"  ) {
-      auto trending_disc = get_discussions_by_children( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.responses.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "trending"  ) {
+         auto trending_disc = get_discussions_by_trending( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.trending.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
       }
-   }
-   else if( !part[0].size() || part[0] == "hot" ) {
-      auto trending_disc = get_discussions_by_hot( {tag,20} );
-      idump((part[1])(part[1]==string()));
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.hot.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "responses"  ) {
+         auto trending_disc = get_discussions_by_children( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.responses.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
       }
-   }
-   else if( part[0] == "votes"  ) {
-      auto trending_disc = get_discussions_by_votes( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.votes.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( !part[0].size() || part[0] == "hot" ) {
+         auto trending_disc = get_discussions_by_hot( {tag,20} );
+         idump((part[1])(part[1]==string()));
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.hot.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
       }
-   }
-   else if( part[0] == "active"  ) {
-      auto trending_disc = get_discussions_by_active( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.active.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "votes"  ) {
+         auto trending_disc = get_discussions_by_votes( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.votes.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
       }
-   }
-   else if( part[0] == "created"  ) {
-      auto trending_disc = get_discussions_by_created( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.created.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "active"  ) {
+         auto trending_disc = get_discussions_by_active( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.active.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
       }
-   }
-   else if( part[0] == "recent"  ) {
-      auto trending_disc = get_discussions_by_created( {tag,20} );
-
-      auto& didx = _state.discussion_idx[tag];
-      for( const auto& d : trending_disc ) {
-         auto key = d.author +"/" + d.permlink;
-         didx.created.push_back( key );
-         if( d.author.size() ) accounts.insert(d.author);
-         _state.content[key] = std::move(d);
+      else if( part[0] == "created"  ) {
+         auto trending_disc = get_discussions_by_created( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.created.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
+      }
+      else if( part[0] == "recent"  ) {
+         auto trending_disc = get_discussions_by_created( {tag,20} );
+
+         auto& didx = _state.discussion_idx[tag];
+         for( const auto& d : trending_disc ) {
+            auto key = d.author +"/" + d.permlink;
+            didx.created.push_back( key );
+            if( d.author.size() ) accounts.insert(d.author);
+            _state.content[key] = std::move(d);
+         }
+      }
+      else {
+         elog( "What... no matches" );
       }
-   }
-   else {
-      elog( "What... no matches" );
-   }
 
-   for( const auto& a : accounts )
+      for( const auto& a : accounts )
+      {
+         _state.accounts.erase("");
+         _state.accounts[a] = my->_db.get_account( a );
+      }
+      for( auto& d : _state.content ) {
+         d.second.active_votes = get_active_votes( d.second.author, d.second.permlink );
+      }
+
+      _state.witness_schedule = my->_db.get_witness_schedule_object();
+
+    } catch ( const fc::exception& e ) {
+       _state.error = e.to_detail_string();
+    }
+    return _state;
+   });
+}
+
+annotated_signed_transaction database_api::get_transaction( transaction_id_type id )const
+{
+   return my->execute_read( [&]() -> annotated_signed_transaction
    {
-      _state.accounts.erase("");
-      _state.accounts[a] = my->_db.get_account( a );
-   }
-   for( auto& d : _state.content ) {
-      d.second.active_votes = get_active_votes( d.second.author, d.second.permlink );
-   }
+      const auto& idx = my->_db.get_index_type<operation_index>().indices().get<by_transaction_id>();
+      auto itr = idx.lower_bound( id );
+      if( itr != idx.end() && itr->trx_id == id ) {
+         auto blk = my->_db.fetch_block_by_number( itr->block );
+         FC_ASSERT( blk.valid() );
+         FC_ASSERT( blk->transactions.size() > itr->trx_in_block );
+         annotated_signed_transaction result = blk->transactions[itr->trx_in_block];
+         result.block_num       = itr->block;
+         result.transaction_num = itr->trx_in_block;
+         return result;
+      }
+      FC_ASSERT( false, "Unknown Transaction ${t}", ("t",id));
+   });
+}
 
-   _state.witness_schedule = my->_db.get_witness_schedule_object();
+vector<discussion> database_api::get_recommended_for( const string& u, uint32_t limit  )const
+{
+   return my->execute_read( [&]() -> vector<discussion>
+   {
+      FC_ASSERT( limit <= 1000 );
+
+      // maintained by the tags plugin as votes arrive, see tags::recommendation_object
+      auto recommended = tags::get_recommendations( my->_db, my->_db.get_account( u ), limit );
 
- } catch ( const fc::exception& e ) {
-    _state.error = e.to_detail_string();
- }
- return _state;
+      vector<discussion> dresult; dresult.reserve( recommended.size() );
+      for( const auto& id : recommended )
+         dresult.push_back( get_discussion( id ) );
+      return dresult;
+   });
 }
 
-annotated_signed_transaction database_api::get_transaction( transaction_id_type id )const {
-   const auto& idx = my->_db.get_index_type<operation_index>().indices().get<by_transaction_id>();
-   auto itr = idx.lower_bound( id );
-   if( itr != idx.end() && itr->trx_id == id ) {
-      auto blk = my->_db.fetch_block_by_number( itr->block );
-      FC_ASSERT( blk.valid() );
-      FC_ASSERT( blk->transactions.size() > itr->trx_in_block );
-      annotated_signed_transaction result = blk->transactions[itr->trx_in_block];
-      result.block_num       = itr->block;
-      result.transaction_num = itr->trx_in_block;
-      return result;
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+// Batches                                                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+   typedef std::function< fc::variant( const database_api&, const fc::variants& ) > batch_method;
+
+   template< typename T >
+   T batch_param( const fc::variants& params, size_t i )
+   {
+      FC_ASSERT( i < params.size(), "Missing parameter ${i}", ("i", i) );
+      return params[ i ].as< T >();
    }
-   FC_ASSERT( false, "Unknown Transaction ${t}", ("t",id));
-}
 
-vector<discussion> database_api::get_recommended_for( const string& u, uint32_t limit  )const {
-   FC_ASSERT( limit <= 1000 );
-   auto start_time = fc::time_point::now();
+#define BATCH_METHOD( name, ... ) \
+   { #name, []( const database_api& api, const fc::variants& p ) { return fc::variant( api.name( __VA_ARGS__ ) ); } }
+
+   /** the read only methods that can be called from get_batch */
+   const map< string, batch_method >& batch_methods()
+   {
+      static const map< string, batch_method > methods = {
+         BATCH_METHOD( get_block_header, batch_param< uint32_t >( p, 0 ) ),
+         BATCH_METHOD( get_block, batch_param< uint32_t >( p, 0 ) ),
+         BATCH_METHOD( get_state, batch_param< string >( p, 0 ) ),
+         BATCH_METHOD( get_dynamic_global_properties, ),
+         BATCH_METHOD( get_chain_properties, ),
+         BATCH_METHOD( get_feed_history, ),
+         BATCH_METHOD( get_current_median_history_price, ),
+         BATCH_METHOD( get_witness_schedule, ),
+         BATCH_METHOD( get_hardfork_version, ),
+         BATCH_METHOD( get_next_scheduled_hardfork, ),
+         BATCH_METHOD( get_trending_tags, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_trending_categories, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_best_categories, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_active_categories, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_recent_categories, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_accounts, batch_param< vector< string > >( p, 0 ) ),
+         BATCH_METHOD( lookup_account_names, batch_param< vector< string > >( p, 0 ) ),
+         BATCH_METHOD( lookup_accounts, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_account_count, ),
+         BATCH_METHOD( get_account_history, batch_param< string >( p, 0 ), batch_param< uint64_t >( p, 1 ), batch_param< uint32_t >( p, 2 ) ),
+         BATCH_METHOD( get_account_history_by_type, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ), batch_param< uint64_t >( p, 2 ), batch_param< uint32_t >( p, 3 ) ),
+         BATCH_METHOD( get_conversion_requests, batch_param< string >( p, 0 ) ),
+         BATCH_METHOD( get_witness_by_account, batch_param< string >( p, 0 ) ),
+         BATCH_METHOD( get_witnesses_by_vote, batch_param< string >( p, 0 ), batch_param< uint32_t >( p, 1 ) ),
+         BATCH_METHOD( get_active_witnesses, ),
+         BATCH_METHOD( get_order_book, batch_param< uint32_t >( p, 0 ) ),
+         BATCH_METHOD( get_active_votes, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ) ),
+         BATCH_METHOD( get_account_votes, batch_param< string >( p, 0 ) ),
+         BATCH_METHOD( get_content, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ) ),
+         BATCH_METHOD( get_content_replies, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ) ),
+         BATCH_METHOD( get_discussions_by_trending, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_created, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_active, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_cashout, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_payout, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_votes, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_children, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_hot, batch_param< discussion_query >( p, 0 ) ),
+         BATCH_METHOD( get_discussions_by_author_before_date, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ),
+                       batch_param< time_point_sec >( p, 2 ), batch_param< uint32_t >( p, 3 ) ),
+         BATCH_METHOD( get_replies_by_last_update, batch_param< string >( p, 0 ), batch_param< string >( p, 1 ), batch_param< uint32_t >( p, 2 ) )
+      };
+      return methods;
+   }
+
+#undef BATCH_METHOD
 
-   const auto& user = my->_db.get_account(u);
-   const auto& rank_idx = my->_db.get_index_type<tags::peer_stats_index>().indices().get<tags::by_rank>();
-   const auto& vote_idx = my->_db.get_index_type<comment_vote_index>().indices().get<by_voter_last_update>();
+}
+
+batch_result database_api::get_batch( const vector<batch_call>& calls )const
+{
+   FC_ASSERT( calls.size() <= GET_BATCH_MAX_CALLS, "At most ${n} calls can be batched", ("n", GET_BATCH_MAX_CALLS) );
 
-   map<comment_id_type,float> stage;
+   return my->execute_read( [&]() -> batch_result
+   {
+      const auto& methods = detail::batch_methods();
+      detail::batch_context context;
+      detail::batch_scope scope( context );
 
-   auto max_age = my->_db.head_block_time() - fc::days(1);
+      batch_result result;
+      result.head_block_number = my->_db.head_block_num();
+      result.head_block_id = my->_db.head_block_id();
+      result.results.reserve( calls.size() );
 
-   auto itr = rank_idx.lower_bound( boost::make_tuple( user.get_id(), std::numeric_limits<float>::max() ) );
-   while( itr != rank_idx.end() && itr->voter == user.id && stage.size() < 1000 && itr->rank > 0 ) {
-      auto vitr = vote_idx.lower_bound( boost::make_tuple( itr->peer, fc::time_point_sec::maximum() ) );
-      int32_t max_votes_per_peer = 50;
-      while( max_votes_per_peer && vitr->voter == itr->peer && vitr->last_update >= max_age ) {
-         const auto& c = vitr->comment(my->_db);
-         if( c.parent_author.size() == 0 && c.created > max_age && c.author != u && c.net_rshares > 0 )
+      for( const auto& call : calls )
+      {
+         // the same call made twice in a batch has the same result, the state cannot change in between
+         string key = call.method + fc::json::to_string( call.params );
+         auto previous = context.results.find( key );
+         if( previous != context.results.end() )
          {
-            auto agediscount = float((c.created - max_age).count())/fc::days(1).count();
-            stage[vitr->comment] += agediscount * itr->rank * vitr->vote_percent;
-            max_votes_per_peer--;
+            result.results.push_back( previous->second );
+            continue;
          }
-         ++vitr;
-      }
-      ++itr;
-   }
-   auto vitr = vote_idx.lower_bound( boost::make_tuple( user.get_id(), fc::time_point_sec::maximum() ) );
-   while( vitr != vote_idx.end() && vitr->voter == user.get_id() && vitr->last_update > max_age ) {
-      stage.erase( vitr->comment );
-      ++vitr;
-   }
 
-   vector< pair<float,comment_id_type> > result;
-   result.reserve(stage.size());
-   for( const auto& item : stage ) result.push_back({item.second,item.first});
-   std::sort( result.begin(), result.end(), std::greater<pair<float,comment_id_type>>() );
+         batch_call_result call_result;
+         try
+         {
+            auto method = methods.find( call.method );
+            FC_ASSERT( method != methods.end(), "${m} cannot be called in a batch", ("m", call.method) );
+            call_result.result = method->second( *this, call.params );
+         }
+         catch( const fc::exception& e )
+         {
+            call_result.error = e.to_string();
+         }
+         catch( const std::exception& e )
+         {
+            call_result.error = string( e.what() );
+         }
 
-   vector<discussion> dresult; dresult.reserve(limit);
-   for( const auto& item : result ) {
-      dresult.push_back( get_discussion( item.second ) );
-      if( dresult.size() == limit ) break;
-   }
-   auto end_time = fc::time_point::now();
-   idump((start_time-end_time));
+         result.results.push_back( call_result );
+         context.results.emplace( std::move( key ), std::move( call_result ) );
+      }
 
-   return dresult;
+      return result;
+   });
 }
 
 } } // steemit::app
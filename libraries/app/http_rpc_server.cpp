@@ -0,0 +1,510 @@
+#include <steemit/app/http_rpc_server.hpp>
+#include <steemit/app/database_api.hpp>
+#include <steemit/app/json_writer.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+namespace steemit { namespace app {
+
+namespace {
+
+   /** The server side of an HTTP client's session, the client cannot be called back */
+   class http_api_session : public fc::api_connection
+   {
+      public:
+         virtual fc::variant send_call( fc::api_id_type api_id, std::string method_name, fc::variants args = fc::variants() ) override
+         {
+            FC_THROW( "Calls to the client are not supported over HTTP" );
+         }
+
+         virtual fc::variant send_callback( uint64_t callback_id, fc::variants args = fc::variants() ) override
+         {
+            FC_THROW( "Callbacks are not supported over HTTP" );
+         }
+
+         virtual void send_notice( uint64_t callback_id, fc::variants args = fc::variants() ) override {}
+   };
+
+   std::string make_response( uint32_t status, const char* reason, const std::string& body, bool keep_alive )
+   {
+      std::string result;
+      result.reserve( body.size() + 128 );
+      result += "HTTP/1.1 " + std::to_string( status ) + " " + reason + "\r\n";
+      result += "Content-Type: application/json\r\n";
+      result += "Content-Length: " + std::to_string( body.size() ) + "\r\n";
+      result += keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+      if( status == 405 )
+         result += "Allow: POST\r\n";
+      result += "\r\n";
+      result += body;
+      return result;
+   }
+
+   std::string make_error( uint32_t status, const char* reason )
+   {
+      return make_response( status, reason, fc::json::to_string( fc::mutable_variant_object( "error", reason ) ), false );
+   }
+
+   fc::variant make_rpc_error( const fc::variant& id, int64_t code, const std::string& message, const fc::variant& data = fc::variant() )
+   {
+      fc::mutable_variant_object error( "code", code );
+      error( "message", message );
+      if( !data.is_null() )
+         error( "data", data );
+      return fc::mutable_variant_object( "jsonrpc", "2.0" )( "id", id )( "error", error );
+   }
+
+   /**
+    *  Writes the result of the database_api methods with large results straight from the typed
+    *  result with json_writer, so they are not copied into an fc::variant tree first.  Returns
+    *  false for the other methods, which are called through the session as usual.
+    */
+   bool write_database_api_result( const fc::api< database_api >& api, const std::string& method, const fc::variants& params, std::string& json )
+   {
+      auto arg = [&]( size_t i ) -> const fc::variant&
+      {
+         FC_ASSERT( i < params.size(), "${method} is missing parameter ${i}", ("method", method)("i", i) );
+         return params[i];
+      };
+      auto query = [&]() { return arg( 0 ).as< discussion_query >(); };
+
+      if( method == "get_state" )
+         json = json_writer::to_string( api->get_state( arg( 0 ).as_string() ) );
+      else if( method == "get_block" )
+         json = json_writer::to_string( api->get_block( arg( 0 ).as< uint32_t >() ) );
+      else if( method == "get_account_history" )
+         json = json_writer::to_string( api->get_account_history( arg( 0 ).as_string(), arg( 1 ).as< uint64_t >(), arg( 2 ).as< uint32_t >() ) );
+      else if( method == "get_account_history_by_type" )
+         json = json_writer::to_string( api->get_account_history_by_type( arg( 0 ).as_string(), arg( 1 ).as_string(),
+                                                                          arg( 2 ).as< uint64_t >(), arg( 3 ).as< uint32_t >() ) );
+      else if( method == "get_content" )
+         json = json_writer::to_string( api->get_content( arg( 0 ).as_string(), arg( 1 ).as_string() ) );
+      else if( method == "get_content_replies" )
+         json = json_writer::to_string( api->get_content_replies( arg( 0 ).as_string(), arg( 1 ).as_string() ) );
+      else if( method == "get_replies_by_last_update" )
+         json = json_writer::to_string( api->get_replies_by_last_update( arg( 0 ).as_string(), arg( 1 ).as_string(), arg( 2 ).as< uint32_t >() ) );
+      else if( method == "get_discussions_by_author_before_date" )
+         json = json_writer::to_string( api->get_discussions_by_author_before_date( arg( 0 ).as_string(), arg( 1 ).as_string(),
+                                                                                    arg( 2 ).as< fc::time_point_sec >(), arg( 3 ).as< uint32_t >() ) );
+      else if( method == "get_discussions_by_trending" )
+         json = json_writer::to_string( api->get_discussions_by_trending( query() ) );
+      else if( method == "get_discussions_by_created" )
+         json = json_writer::to_string( api->get_discussions_by_created( query() ) );
+      else if( method == "get_discussions_by_active" )
+         json = json_writer::to_string( api->get_discussions_by_active( query() ) );
+      else if( method == "get_discussions_by_cashout" )
+         json = json_writer::to_string( api->get_discussions_by_cashout( query() ) );
+      else if( method == "get_discussions_by_payout" )
+         json = json_writer::to_string( api->get_discussions_by_payout( query() ) );
+      else if( method == "get_discussions_by_votes" )
+         json = json_writer::to_string( api->get_discussions_by_votes( query() ) );
+      else if( method == "get_discussions_by_children" )
+         json = json_writer::to_string( api->get_discussions_by_children( query() ) );
+      else if( method == "get_discussions_by_hot" )
+         json = json_writer::to_string( api->get_discussions_by_hot( query() ) );
+      else
+         return false;
+      return true;
+   }
+
+}
+
+struct http_rpc_server::request
+{
+   std::string                            method;
+   std::string                            target;
+   std::string                            version;
+   std::map< std::string, std::string >   headers; ///< by lower case name
+   std::string                            body;
+
+   /** parses the request line and headers, which end at header_end */
+   bool parse_head( const std::string& buffer, size_t header_end )
+   {
+      size_t line_end = buffer.find( "\r\n" );
+      std::vector< std::string > parts;
+      boost::split( parts, buffer.substr( 0, line_end ), boost::is_any_of( " " ) );
+      if( parts.size() != 3 || parts[2].compare( 0, 5, "HTTP/" ) != 0 )
+         return false;
+      method = parts[0];
+      target = parts[1];
+      version = parts[2];
+
+      size_t pos = line_end + 2;
+      while( pos < header_end )
+      {
+         line_end = buffer.find( "\r\n", pos );
+         if( line_end == std::string::npos || line_end > header_end )
+            line_end = header_end;
+         size_t colon = buffer.find( ':', pos );
+         if( colon == std::string::npos || colon > line_end )
+            return false;
+         std::string name = boost::algorithm::to_lower_copy( buffer.substr( pos, colon - pos ) );
+         headers[ name ] = boost::algorithm::trim_copy( buffer.substr( colon + 1, line_end - colon - 1 ) );
+         pos = line_end + 2;
+      }
+      return true;
+   }
+
+   std::string header( const std::string& name )const
+   {
+      auto itr = headers.find( name );
+      return itr == headers.end() ? std::string() : boost::algorithm::to_lower_copy( itr->second );
+   }
+
+   bool keep_alive()const
+   {
+      std::string connection = header( "connection" );
+      if( version == "HTTP/1.0" )
+         return connection == "keep-alive";
+      return connection != "close";
+   }
+};
+
+const uint32_t http_rpc_server::max_header_size;
+
+http_rpc_server::http_rpc_server( session_factory factory, api_metrics& metrics, uint32_t max_body_size )
+   : _session_factory( std::move( factory ) ), _metrics( metrics ), _max_body_size( max_body_size )
+{
+}
+
+http_rpc_server::~http_rpc_server()
+{
+   close();
+}
+
+void http_rpc_server::listen( const fc::ip::endpoint& endpoint )
+{
+   _tcp_server.set_reuse_address();
+   _tcp_server.listen( endpoint );
+   _accept_loop_complete = fc::async( [this](){ accept_loop(); }, "http_rpc_accept_loop" );
+}
+
+fc::ip::endpoint http_rpc_server::get_local_endpoint()const
+{
+   return _tcp_server.get_local_endpoint();
+}
+
+void http_rpc_server::close()
+{
+   if( _closing )
+      return;
+   _closing = true;
+
+   try
+   {
+      _tcp_server.close();
+      if( _accept_loop_complete.valid() )
+         _accept_loop_complete.cancel_and_wait( "http_rpc_server::close()" );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Exception thrown while closing the HTTP RPC server, ignoring: ${e}", ("e", e) );
+   }
+
+   for( const auto& socket : _sockets )
+   {
+      try
+      {
+         socket->close();
+      }
+      catch( const fc::exception& ) {}
+   }
+
+   // the connections still reference this server until they notice their socket was closed
+   for( uint32_t i = 0; i < 500 && !_sockets.empty(); ++i )
+      fc::usleep( fc::milliseconds( 10 ) );
+}
+
+std::string http_rpc_server::make_rpc_response( const fc::variant& id, const std::string& result )
+{
+   // the same members in the same order as the response built as a variant
+   std::string id_json = fc::json::to_string( id );
+   std::string response;
+   response.reserve( result.size() + id_json.size() + 32 );
+   response += "{\"jsonrpc\":\"2.0\",\"id\":";
+   response += id_json;
+   response += ",\"result\":";
+   response += result;
+   response += '}';
+   return response;
+}
+
+http_rpc_statistics http_rpc_server::get_statistics()const
+{
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   return _statistics;
+}
+
+void http_rpc_server::accept_loop()
+{
+   while( !_accept_loop_complete.canceled() )
+   {
+      auto socket = std::make_shared< fc::tcp_socket >();
+      try
+      {
+         _tcp_server.accept( *socket );
+      }
+      catch( const fc::canceled_exception& )
+      {
+         return;
+      }
+      catch( const fc::exception& e )
+      {
+         if( _closing )
+            return;
+         wlog( "Error accepting an HTTP RPC connection: ${e}", ("e", e.to_string()) );
+         continue;
+      }
+
+      _sockets.insert( socket );
+      fc::async( [this, socket](){ handle_connection( socket ); }, "http_rpc_connection" );
+   }
+}
+
+void http_rpc_server::handle_connection( std::shared_ptr< fc::tcp_socket > socket )
+{
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      ++_statistics.connections;
+      ++_statistics.total_connections;
+   }
+
+   try
+   {
+      auto session = std::make_shared< http_api_session >();
+      auto apis = std::make_shared< api_connection_context >();
+      std::vector< std::string > api_names = _session_factory( *session, apis );
+
+      std::string buffer;
+      char chunk[ 4096 ];
+      auto read_more = [&]()
+      {
+         size_t bytes = socket->readsome( chunk, sizeof( chunk ) );
+         buffer.append( chunk, bytes );
+      };
+      auto reject = [&]( uint32_t status, const char* reason )
+      {
+         std::string response = make_error( status, reason );
+         socket->write( response.data(), response.size() );
+         socket->flush();
+         std::lock_guard< std::mutex > lock( _statistics_mutex );
+         ++_statistics.rejected_requests;
+      };
+
+      bool keep_alive = true;
+      while( keep_alive && !_closing )
+      {
+         size_t header_end = buffer.find( "\r\n\r\n" );
+         if( header_end == std::string::npos )
+         {
+            if( buffer.size() > max_header_size )
+            {
+               reject( 431, "Request Header Fields Too Large" );
+               break;
+            }
+            read_more();
+            continue;
+         }
+
+         request req;
+         if( header_end > max_header_size || !req.parse_head( buffer, header_end ) )
+         {
+            reject( 400, "Bad Request" );
+            break;
+         }
+         if( !req.header( "transfer-encoding" ).empty() )
+         {
+            reject( 411, "Length Required" );
+            break;
+         }
+
+         uint64_t content_length = 0;
+         std::string length_header = req.header( "content-length" );
+         if( !length_header.empty() )
+         {
+            try
+            {
+               content_length = std::stoull( length_header );
+            }
+            catch( const std::exception& )
+            {
+               reject( 400, "Bad Request" );
+               break;
+            }
+         }
+         if( content_length > _max_body_size )
+         {
+            reject( 413, "Payload Too Large" );
+            break;
+         }
+
+         size_t body_start = header_end + 4;
+         if( buffer.size() < body_start + content_length && req.header( "expect" ) == "100-continue" )
+         {
+            static const char continue_response[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            socket->write( continue_response, sizeof( continue_response ) - 1 );
+            socket->flush();
+         }
+         while( buffer.size() < body_start + content_length )
+            read_more();
+
+         req.body = buffer.substr( body_start, content_length );
+         buffer.erase( 0, body_start + content_length );
+
+         keep_alive = req.keep_alive();
+         {
+            std::lock_guard< std::mutex > lock( _statistics_mutex );
+            ++_statistics.requests;
+            if( !buffer.empty() )
+               ++_statistics.pipelined_requests;
+         }
+
+         // pipelined requests are answered one after the other, in the order they were received
+         std::string response = handle_request( *session, *apis, api_names, req, keep_alive );
+         socket->write( response.data(), response.size() );
+         socket->flush();
+      }
+   }
+   catch( const fc::eof_exception& )
+   {
+   }
+   catch( const fc::canceled_exception& )
+   {
+   }
+   catch( const fc::exception& e )
+   {
+      if( !_closing )
+         wlog( "Error serving an HTTP RPC connection: ${e}", ("e", e.to_string()) );
+   }
+
+   try
+   {
+      socket->close();
+   }
+   catch( const fc::exception& ) {}
+
+   _sockets.erase( socket );
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   --_statistics.connections;
+}
+
+std::string http_rpc_server::handle_request( fc::api_connection& session, const api_connection_context& apis, std::vector< std::string >& api_names,
+                                             const request& req, bool keep_alive )
+{
+   if( req.method != "POST" )
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      ++_statistics.rejected_requests;
+      return make_response( 405, "Method Not Allowed", "", keep_alive );
+   }
+
+   fc::variant calls;
+   try
+   {
+      calls = fc::json::from_string( req.body );
+   }
+   catch( const fc::exception& e )
+   {
+      return make_response( 200, "OK", fc::json::to_string( make_rpc_error( fc::variant(), -32700, "Parse error", e.to_string() ) ), keep_alive );
+   }
+
+   std::string body;
+   if( calls.is_array() )
+   {
+      const auto& batch = calls.get_array();
+      if( batch.empty() )
+         body = fc::json::to_string( make_rpc_error( fc::variant(), -32600, "Invalid Request" ) );
+      else
+      {
+         body = "[";
+         for( const auto& call : batch )
+         {
+            if( body.size() > 1 )
+               body += ",";
+            body += handle_call( session, apis, api_names, call );
+         }
+         body += "]";
+      }
+   }
+   else
+      body = handle_call( session, apis, api_names, calls );
+
+   return make_response( 200, "OK", body, keep_alive );
+}
+
+std::string http_rpc_server::handle_call( fc::api_connection& session, const api_connection_context& apis, std::vector< std::string >& api_names,
+                                          const fc::variant& call )
+{
+   if( !call.is_object() )
+      return fc::json::to_string( make_rpc_error( fc::variant(), -32600, "Invalid Request" ) );
+
+   const auto& obj = call.get_object();
+   fc::variant id;
+   if( obj.contains( "id" ) )
+      id = obj[ "id" ];
+   if( !obj.contains( "method" ) || !obj[ "method" ].is_string() || ( obj.contains( "params" ) && !obj[ "params" ].is_array() ) )
+      return fc::json::to_string( make_rpc_error( id, -32600, "Invalid Request" ) );
+
+   std::string method = obj[ "method" ].as_string();
+   fc::variants params;
+   if( obj.contains( "params" ) )
+      params = obj[ "params" ].get_array();
+
+   fc::time_point start = fc::time_point::now();
+   std::string method_name = method;
+   std::string result;
+   bool error = true;
+   try
+   {
+      // the same dispatch as websocket connections, methods other than call go to the API with id 0
+      fc::api_id_type api_id = 0;
+      if( method == "call" )
+      {
+         FC_ASSERT( params.size() == 3 && params[2].is_array(), "call takes [api, method, params]" );
+         if( params[0].is_string() )
+         {
+            api_id = session.receive_call( 1, "get_api_by_name", fc::variants{ params[0] } ).as_uint64();
+            if( api_names.size() <= api_id )
+               api_names.resize( api_id + 1 );
+            api_names[ api_id ] = params[0].as_string();
+         }
+         else
+            api_id = params[0].as_uint64();
+         method = params[1].as_string();
+         fc::variants call_params = params[2].get_array();
+         params = std::move( call_params );
+      }
+      method_name = api_method_name( api_names, api_id, method );
+
+      std::string result_json;
+      std::shared_ptr< fc::api< database_api > > db_api;
+      if( api_id < api_names.size() && api_names[ api_id ] == "database_api" )
+      {
+         auto itr = apis.api_map.find( api_names[ api_id ] );
+         if( itr != apis.api_map.end() )
+            db_api = std::dynamic_pointer_cast< fc::api< database_api > >( itr->second );
+      }
+      if( !db_api || !write_database_api_result( *db_api, method, params, result_json ) )
+         result_json = fc::json::to_string( session.receive_call( api_id, method, params ) );
+
+      result = make_rpc_response( id, result_json );
+      error = false;
+   }
+   catch( const fc::exception& e )
+   {
+      result = fc::json::to_string( make_rpc_error( id, -32000, e.to_string(), fc::variant( e ) ) );
+   }
+   catch( const std::exception& e )
+   {
+      result = fc::json::to_string( make_rpc_error( id, -32000, e.what() ) );
+   }
+
+   _metrics.record( method_name, ( fc::time_point::now() - start ).count(), error, result.size() );
+   return result;
+}
+
+} } // steemit::app
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <steemit/app/api_context.hpp>
+#include <steemit/app/api_metrics.hpp>
 #include <steemit/app/database_api.hpp>
 #include <steemit/chain/protocol/types.hpp>
 
@@ -152,6 +153,42 @@ namespace steemit { namespace app {
           */
          std::vector<graphene::net::potential_peer_record> get_potential_peers() const;
 
+         /**
+          * @brief Get the size and hit/miss/eviction counters of the p2p message cache
+          */
+         fc::variant_object get_message_cache_statistics() const;
+
+         /**
+          * @brief Get inventory batching counters and the p2p cost per relayed transaction
+          */
+         fc::variant_object get_inventory_statistics() const;
+
+         /// internal method, not exposed via JSON RPC
+         void on_api_startup();
+
+      private:
+         application& _app;
+   };
+
+   /**
+    * @brief The metrics_api class reports the cost of the API methods called by clients
+    */
+   class metrics_api
+   {
+      public:
+         metrics_api(const api_context& ctx);
+
+         /**
+          * @brief Get the calls, errors, latency histogram and response size of each API method
+          *        called over websockets or HTTP since startup or the last reset, by api_name.method_name
+          */
+         std::map< std::string, api_method_metrics > get_api_metrics() const;
+
+         /**
+          * @brief Clear the metrics of all methods
+          */
+         void reset_api_metrics();
+
          /// internal method, not exposed via JSON RPC
          void on_api_startup();
 
@@ -210,6 +247,12 @@ FC_API(steemit::app::network_node_api,
        (get_potential_peers)
        (get_advanced_node_parameters)
        (set_advanced_node_parameters)
+       (get_message_cache_statistics)
+       (get_inventory_statistics)
+     )
+FC_API(steemit::app::metrics_api,
+       (get_api_metrics)
+       (reset_api_metrics)
      )
 FC_API(steemit::app::login_api,
        (login)
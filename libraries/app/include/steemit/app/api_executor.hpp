@@ -0,0 +1,136 @@
+#pragma once
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/mutex.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace steemit { namespace app {
+
+struct api_executor_statistics
+{
+   uint32_t thread_count = 0;
+   uint32_t queue_depth = 0;
+   uint32_t max_queue_depth = 0;
+
+   uint64_t calls = 0;
+   /** calls made from a worker thread, e.g. by get_state, run directly on that thread */
+   uint64_t nested_calls = 0;
+   uint64_t errors = 0;
+
+   /** time spent waiting for a worker and for the read lock, in microseconds */
+   uint64_t total_wait_time = 0;
+   uint64_t max_wait_time = 0;
+
+   /** time spent executing calls once the read lock was held, in microseconds */
+   uint64_t total_execution_time = 0;
+   uint64_t max_execution_time = 0;
+};
+
+/**
+ *  Executes read only API calls on a pool of worker threads so that expensive
+ *  queries do not delay block application on the chain thread and vice versa.
+ *
+ *  Every call holds the database read lock while it runs, so it observes the
+ *  state between two blocks or transactions and never a partially applied one.
+ *  The thread that made the call waits for the result, other tasks on that
+ *  thread keep running in the meantime.
+ *
+ *  The database tracks lock ownership per thread, so calls are never executed
+ *  on the calling thread where a yielding call could interleave with block
+ *  application, and a worker executes one call at a time even if it yields.
+ *  Only calls made while executing another call, or by the thread holding
+ *  the write lock, run directly since they already hold a lock.
+ */
+class api_executor
+{
+   public:
+      api_executor( chain::database& db );
+      ~api_executor();
+
+      /** starts thread_count workers, at least one */
+      void start( uint32_t thread_count );
+      void stop();
+
+      template< typename Lambda >
+      auto execute( Lambda&& callback ) -> decltype( callback() )
+      {
+         worker* w = select_worker();
+         if( w == nullptr )
+            return _db.with_read_lock( callback );
+
+         call_tracker tracker( *this, *w );
+         return w->thread->async( [&]() -> decltype( callback() )
+         {
+            fc::scoped_lock< fc::mutex > lock( w->calls );
+            return _db.with_read_lock( [&]() -> decltype( callback() )
+            {
+               tracker.started();
+               try
+               {
+                  return callback();
+               }
+               catch( ... )
+               {
+                  tracker.failed();
+                  throw;
+               }
+            });
+         }, "api_executor" ).wait();
+      }
+
+      api_executor_statistics get_statistics()const;
+
+   private:
+      struct worker
+      {
+         std::unique_ptr< fc::thread > thread;
+         std::atomic< uint32_t >       pending;
+
+         /** held while a call runs, so calls that yield do not interleave on the thread */
+         fc::mutex                     calls;
+      };
+
+      /** Records queue depth and timing of a call for as long as it is in flight */
+      class call_tracker
+      {
+         public:
+            call_tracker( api_executor& executor, worker& w );
+            ~call_tracker();
+
+            void started();
+            void failed();
+
+         private:
+            api_executor&   _executor;
+            worker&         _worker;
+            fc::time_point  _queued;
+            fc::time_point  _started;
+            bool            _failed = false;
+      };
+
+      /** @return the worker with the fewest pending calls, or nullptr if the call already holds a lock and runs on the current thread */
+      worker* select_worker();
+
+      chain::database&                        _db;
+      std::vector< std::unique_ptr< worker > > _workers;
+
+      mutable std::mutex                      _statistics_mutex;
+      api_executor_statistics                 _statistics;
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::api_executor_statistics,
+            (thread_count)(queue_depth)(max_queue_depth)
+            (calls)(nested_calls)(errors)
+            (total_wait_time)(max_wait_time)
+            (total_execution_time)(max_execution_time) )
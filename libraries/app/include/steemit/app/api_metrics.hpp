@@ -0,0 +1,85 @@
+#pragma once
+
+#include <steemit/app/latency_histogram.hpp>
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/time.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace steemit { namespace app {
+
+struct api_method_metrics
+{
+   latency_histogram latency;
+
+   /** size of the JSON responses, including error responses */
+   uint64_t          response_bytes = 0;
+   uint64_t          max_response_bytes = 0;
+};
+
+/**
+ *  Counts the calls, errors, latency and response size of every API method called by a
+ *  client, over websockets or HTTP, so expensive methods such as get_state can be found
+ *  without external tracing.  Methods are named api_name.method_name, e.g.
+ *  database_api.get_state.
+ *
+ *  When logging is started the most expensive methods by total time are logged at each
+ *  interval.
+ */
+class api_metrics
+{
+   public:
+      ~api_metrics();
+
+      void record( const std::string& method, uint64_t time, bool error, uint64_t response_bytes );
+
+      std::map< std::string, api_method_metrics > get_metrics()const;
+      void reset();
+
+      void start_logging( fc::microseconds interval, uint32_t method_count );
+      void stop_logging();
+
+   private:
+      void log_metrics()const;
+      void schedule_logging();
+
+      mutable std::mutex                           _mutex;
+      std::map< std::string, api_method_metrics >  _metrics;
+
+      fc::microseconds                             _log_interval;
+      uint32_t                                     _log_method_count = 0;
+      fc::future< void >                           _log_task;
+};
+
+/**
+ *  A websocket API connection which records the calls made by the client in api_metrics.
+ *  The api names are those returned by the session setup, extended by the names the
+ *  client looks up with get_api_by_name.
+ */
+class metered_websocket_api_connection : public fc::rpc::websocket_api_connection
+{
+   public:
+      metered_websocket_api_connection( fc::http::websocket_connection& c, api_metrics& metrics );
+
+      void set_api_names( std::vector< std::string > names ) { _api_names = std::move( names ); }
+
+   private:
+      std::string on_metered_message( const std::string& message, bool send_message );
+
+      api_metrics&                 _metrics;
+      std::vector< std::string >   _api_names;
+};
+
+/** the metric name of a call to method of the API with api_id, api_names are indexed by api id */
+std::string api_method_name( const std::vector< std::string >& api_names, uint64_t api_id, const std::string& method );
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::api_method_metrics, (latency)(response_bytes)(max_response_bytes) )
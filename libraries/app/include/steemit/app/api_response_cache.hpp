@@ -0,0 +1,110 @@
+#pragma once
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace steemit { namespace app {
+
+struct api_response_cache_statistics
+{
+   uint32_t entries = 0;
+   uint32_t max_entries = 0;
+
+   uint64_t hits = 0;
+   uint64_t misses = 0;
+   uint64_t evictions = 0;
+
+   /** number of times the cache was emptied because the head block changed */
+   uint64_t invalidations = 0;
+};
+
+/**
+ *  Caches the results of expensive read only API calls such as get_state and the
+ *  discussion queries, which front-ends repeat many times between two blocks.
+ *
+ *  Entries are keyed by method name and arguments and are only valid for the
+ *  head block they were computed at, the whole cache is dropped as soon as a
+ *  lookup observes a different head block.  Results therefore do not reflect
+ *  pending transactions received after they were computed.  The least recently
+ *  used entry is evicted once max_entries is reached, 0 disables the cache.
+ *
+ *  Lookups must be made while holding the database read lock.
+ */
+class api_response_cache
+{
+   public:
+      api_response_cache( uint32_t max_entries = 0 );
+
+      void set_max_entries( uint32_t max_entries );
+      bool enabled()const { return _max_entries > 0; }
+
+      template< typename... Args >
+      static std::string make_key( const char* method, const Args&... args )
+      {
+         fc::variants v{ fc::variant( args )... };
+         return std::string( method ) + fc::json::to_string( v );
+      }
+
+      template< typename Lambda >
+      auto get_or_compute( const chain::database& db, const std::string& key, Lambda&& compute ) -> decltype( compute() )
+      {
+         typedef decltype( compute() ) result_type;
+         if( !enabled() )
+            return compute();
+
+         chain::block_id_type head = db.head_block_id();
+         std::shared_ptr< const void > cached = find( key, head );
+         if( cached )
+            return *std::static_pointer_cast< const result_type >( cached );
+
+         std::shared_ptr< const result_type > result = std::make_shared< result_type >( compute() );
+         insert( key, head, result );
+         return *result;
+      }
+
+      api_response_cache_statistics get_statistics()const;
+
+   private:
+      std::shared_ptr< const void > find( const std::string& key, const chain::block_id_type& head );
+      void insert( const std::string& key, const chain::block_id_type& head, std::shared_ptr< const void > value );
+      void clear_for_head( const chain::block_id_type& head );
+
+      struct entry
+      {
+         std::string                    key;
+         std::shared_ptr< const void >  value;
+      };
+
+      struct by_key;
+      typedef boost::multi_index_container<
+         entry,
+         boost::multi_index::indexed_by<
+            boost::multi_index::sequenced<>,
+            boost::multi_index::hashed_unique< boost::multi_index::tag< by_key >,
+               boost::multi_index::member< entry, std::string, &entry::key > >
+         >
+      > entry_index_type;
+
+      mutable std::mutex             _mutex;
+      uint32_t                       _max_entries;
+      chain::block_id_type           _head;
+      entry_index_type               _entries;
+      api_response_cache_statistics  _statistics;
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::api_response_cache_statistics,
+            (entries)(max_entries)(hits)(misses)(evictions)(invalidations) )
@@ -39,6 +39,12 @@ namespace steemit { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class api_executor;
+   class api_metrics;
+   class api_response_cache;
+   class change_subscription_manager;
+   class operation_queue;
+   class http_rpc_server;
    class application;
 
    class application
@@ -79,6 +85,25 @@ namespace steemit { namespace app {
 
          graphene::net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         const fc::path& data_dir()const;
+
+         /// Executes read only API calls off the thread applying blocks, see api_executor
+         api_executor& get_api_executor();
+
+         /// Calls, errors, latency and response size of each API method called by clients
+         api_metrics& get_api_metrics();
+
+         /// Results of get_state and discussion queries shared by all API connections until the next block
+         api_response_cache& get_api_response_cache();
+
+         /// Pushes the objects changed by each block to subscribed API connections
+         change_subscription_manager& get_change_subscription_manager();
+
+         /// Hands the operations of each block to plugins processing them on their own thread
+         operation_queue& get_operation_queue();
+
+         /// The HTTP JSON-RPC endpoint, null unless rpc-http-endpoint is set
+         std::shared_ptr<http_rpc_server> get_http_rpc_server()const;
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
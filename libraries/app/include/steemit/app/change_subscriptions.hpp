@@ -0,0 +1,150 @@
+#pragma once
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <boost/container/flat_set.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace steemit { namespace app {
+
+using graphene::db::object_id_type;
+
+struct object_change
+{
+   object_id_type             id;
+   std::vector< std::string > keys;    ///< the subscription keys the object matches
+   fc::variant                object;  ///< the new value, null when removed
+   bool                       removed = false;
+};
+
+/**
+ *  Sent to a subscriber after each block that changed an object it subscribed to.  When the
+ *  subscriber was still busy with the previous notification the changes of several blocks are
+ *  coalesced, only the latest value of each object is sent.
+ */
+struct change_notification
+{
+   uint32_t                      block_num = 0;
+   chain::block_id_type          block_id;
+   std::vector< object_change >  changes;
+
+   /** changes were dropped because the subscriber did not keep up, it should refetch what it subscribed to */
+   bool                          overflow = false;
+};
+
+struct change_subscription_statistics
+{
+   uint32_t subscribers = 0;
+   uint32_t max_pending_changes = 0;
+
+   uint64_t blocks = 0;
+   uint64_t changes = 0;            ///< changes to subscribable objects, computed once per block
+   uint64_t notifications = 0;
+   uint64_t coalesced_changes = 0;  ///< changes replaced by a newer value of the same object before being sent
+   uint64_t overflows = 0;
+   uint64_t errors = 0;
+};
+
+class change_subscription_manager;
+
+/**
+ *  Held by the API connection that subscribed, the subscription ends when it is released
+ */
+class change_subscription
+{
+   public:
+      typedef std::function< void( const fc::variant& ) > callback_type;
+
+      change_subscription( callback_type cb, boost::container::flat_set< std::string > k )
+         : callback( std::move( cb ) ), keys( std::move( k ) ) {}
+
+   private:
+      friend class change_subscription_manager;
+
+      callback_type                                                   callback;
+      boost::container::flat_set< std::string >                       keys;
+
+      std::map< object_id_type, std::shared_ptr< const object_change > > pending;
+      uint32_t                                                        block_num = 0;
+      chain::block_id_type                                            block_id;
+      bool                                                            overflow = false;
+      bool                                                            delivering = false;
+};
+
+/**
+ *  Pushes the objects changed by each block to the API connections subscribed to them, so
+ *  clients do not have to poll get_state or get_dynamic_global_properties after every block.
+ *
+ *  The changes are taken from database::changed_objects and removed_objects once per block,
+ *  converted to variants once and matched against the subscription keys:
+ *
+ *     account:<name>               the account, its witness, limit orders and conversion requests
+ *     comment:<author>/<permlink>  the comment and its votes
+ *     tag:<tag>                    the tags plugin's tag objects of the comments with that tag
+ *     globals                      the dynamic global properties
+ *
+ *  Each subscriber is sent at most one notification at a time.  Changes arriving while one is
+ *  being sent are coalesced by object, and once more than max_pending_changes objects are
+ *  waiting they are dropped and the next notification has overflow set.
+ *
+ *  Changes made by pending transactions are not sent, only those of applied blocks.
+ */
+class change_subscription_manager
+{
+   public:
+      change_subscription_manager( chain::database& db );
+
+      void set_max_pending_changes( uint32_t max_pending_changes );
+
+      /** at most max_keys keys, each of one of the forms above */
+      std::shared_ptr< change_subscription > subscribe( change_subscription::callback_type cb, const std::vector< std::string >& keys );
+
+      change_subscription_statistics get_statistics()const;
+
+      static const uint32_t max_keys = 1000;
+
+   private:
+      void on_applied_block( const chain::signed_block& b );
+      void on_removed_objects( const std::vector< const graphene::db::object* >& objs );
+      void on_changed_objects( const std::vector< object_id_type >& ids );
+
+      std::vector< std::string > get_keys( const graphene::db::object& obj )const;
+      void add_change( const graphene::db::object& obj, bool removed );
+      void publish();
+      void deliver( std::shared_ptr< change_subscription > s );
+
+      chain::database&                                       _db;
+
+      boost::signals2::scoped_connection                     _applied_block_connection;
+      boost::signals2::scoped_connection                     _removed_objects_connection;
+      boost::signals2::scoped_connection                     _changed_objects_connection;
+
+      /** the block being applied, its changes are only collected for keys someone subscribed to */
+      bool                                                    _in_block = false;
+      uint32_t                                                _block_num = 0;
+      chain::block_id_type                                    _block_id;
+      boost::container::flat_set< std::string >               _wanted_keys;
+      std::vector< std::shared_ptr< const object_change > >   _changes;
+      std::map< object_id_type, const graphene::db::object* > _removed;
+
+      mutable std::mutex                                     _mutex;
+      std::vector< std::weak_ptr< change_subscription > >    _subscriptions;
+      uint32_t                                               _max_pending_changes = 1000;
+      change_subscription_statistics                         _statistics;
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::object_change, (id)(keys)(object)(removed) )
+FC_REFLECT( steemit::app::change_notification, (block_num)(block_id)(changes)(overflow) )
+FC_REFLECT( steemit::app::change_subscription_statistics,
+            (subscribers)(max_pending_changes)(blocks)(changes)(notifications)(coalesced_changes)(overflows)(errors) )
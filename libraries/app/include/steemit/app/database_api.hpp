@@ -1,4 +1,9 @@
 #pragma once
+#include <steemit/app/api_executor.hpp>
+#include <steemit/app/api_response_cache.hpp>
+#include <steemit/app/change_subscriptions.hpp>
+#include <steemit/app/http_rpc_server.hpp>
+#include <steemit/app/operation_queue.hpp>
 #include <steemit/app/state.hpp>
 #include <steemit/chain/protocol/types.hpp>
 
@@ -47,6 +52,27 @@ struct scheduled_hardfork
    fc::time_point_sec   live_time;
 };
 
+/**
+ *  A single call of a batch, params are the positional arguments of the database_api method
+ */
+struct batch_call
+{
+   string         method;
+   fc::variants   params;
+};
+
+struct batch_call_result
+{
+   fc::variant       result;
+   optional<string>  error; ///< set instead of result when the call failed
+};
+
+struct batch_result
+{
+   uint32_t                   head_block_number = 0; ///< every call was answered at this block
+   block_id_type              head_block_id;
+   vector<batch_call_result>  results;
+};
 
 class database_api_impl;
 
@@ -66,6 +92,9 @@ struct discussion_query {
    optional<string> start_permlink;
    optional<string> parent_author;
    optional<string> parent_permlink;
+
+   /** when non-zero only the first truncate_body bytes of each body are returned, for listings that show a preview */
+   uint32_t         truncate_body = 0;
 };
 
 /**
@@ -96,6 +125,17 @@ class database_api
        */
       void cancel_all_subscriptions();
 
+      /**
+       * @brief Receive the objects matching any of keys after each block that changes them, as a change_notification
+       * @param keys account:<name>, comment:<author>/<permlink>, tag:<tag> or globals, at most 1000
+       *
+       * This replaces the previous change subscription of this connection.  If the connection does not keep up
+       * the changes of several blocks are sent together, and once too many are waiting they are dropped and the
+       * notification has overflow set.
+       */
+      void subscribe_to_changes( std::function<void(const variant&)> cb, const vector<string>& keys );
+      void unsubscribe_from_changes();
+
       vector<tags::tag_stats_object> get_trending_tags( string after_tag, uint32_t limit )const;
 
       /**
@@ -149,6 +189,45 @@ class database_api
       hardfork_version               get_hardfork_version()const;
       scheduled_hardfork             get_next_scheduled_hardfork()const;
 
+      /**
+       * @brief Retrieve the size of the pending transaction pool and counters of how
+       *        pending transactions were accepted, evicted, re-applied or dropped
+       */
+      pending_transaction_pool_statistics get_pending_transaction_statistics()const;
+
+      /**
+       * @brief Retrieve the number of reversible blocks in the fork database and the size of
+       *        the ones whose transactions are kept in memory
+       */
+      fork_database_statistics get_fork_database_statistics()const;
+
+      /**
+       * @brief Retrieve the number of read only API calls waiting for or running on the API threads
+       *        and the time they spent waiting and executing
+       */
+      api_executor_statistics get_api_executor_statistics()const;
+
+      /**
+       * @brief Retrieve the size and hit rate of the cache of get_state and discussion query results
+       */
+      api_response_cache_statistics get_api_response_cache_statistics()const;
+
+      /**
+       * @brief Retrieve the number of change subscriptions and of the notifications sent, coalesced and dropped
+       */
+      change_subscription_statistics get_change_subscription_statistics()const;
+
+      /**
+       * @brief Retrieve the blocks waiting for and handled by each plugin that processes operations on
+       *        its own thread, and how long block application waited for them
+       */
+      operation_queue_statistics get_operation_queue_statistics()const;
+
+      /**
+       * @brief Retrieve the connections, requests and per method latencies of the HTTP JSON-RPC endpoint
+       */
+      http_rpc_statistics get_http_rpc_statistics()const;
+
       //////////
       // Keys //
       //////////
@@ -343,6 +422,25 @@ class database_api
        */
       map<uint32_t,operation_object> get_account_history( string account, uint64_t from, uint32_t limit )const;
 
+      /**
+       *  Like get_account_history but only returns operations of one type, numbered from 0 to N among the
+       *  operations of that type in the account's history, so e.g. transfers can be paged through without
+       *  reading the account's other operations.
+       *
+       *  @param op_type - the name of the operation, e.g. transfer or vote
+       */
+      map<uint32_t,operation_object> get_account_history_by_type( string account, string op_type, uint64_t from, uint32_t limit )const;
+
+      /**
+       *  Executes several read only calls in one round trip.  All calls are answered at the same head block
+       *  while holding the database read lock once, so the results are consistent with each other.  Lookups
+       *  such as voter names and identical calls are shared between the calls of the batch.
+       *
+       *  @param calls at most 1000 calls, see batch_methods in database_api.cpp for the methods that can be batched
+       *  @return one result per call in the same order, a failing call sets its error and does not fail the batch
+       */
+      batch_result get_batch( const vector<batch_call>& calls )const;
+
       ////////////////////////////
       // Handlers - not exposed //
       ////////////////////////////
@@ -351,11 +449,11 @@ class database_api
    private:
       void set_pending_payout( discussion& d )const;
       void set_url( discussion& d )const;
-      discussion get_discussion( comment_id_type )const;
+      discussion get_discussion( comment_id_type, uint32_t truncate_body = 0 )const;
 
       template<typename Index, typename StartItr>
       vector<discussion> get_discussions( const discussion_query& q,
-                                          const string& tag,
+                                          tags::tag_id_type tag,
                                           comment_id_type parent,
                                           const Index& idx, StartItr itr )const;
       comment_id_type get_parent( const discussion_query& q )const;
@@ -370,7 +468,11 @@ FC_REFLECT( steemit::app::order, (order_price)(steem)(sbd)(created) );
 FC_REFLECT( steemit::app::order_book, (asks)(bids) );
 FC_REFLECT( steemit::app::scheduled_hardfork, (hf_version)(live_time) );
 
-FC_REFLECT( steemit::app::discussion_query, (tag)(filter_tags)(start_author)(start_permlink)(parent_author)(parent_permlink)(limit) );
+FC_REFLECT( steemit::app::batch_call, (method)(params) );
+FC_REFLECT( steemit::app::batch_call_result, (result)(error) );
+FC_REFLECT( steemit::app::batch_result, (head_block_number)(head_block_id)(results) );
+
+FC_REFLECT( steemit::app::discussion_query, (tag)(filter_tags)(start_author)(start_permlink)(parent_author)(parent_permlink)(limit)(truncate_body) );
 
 FC_API(steemit::app::database_api,
    // Subscriptions
@@ -378,6 +480,8 @@ FC_API(steemit::app::database_api,
    (set_pending_transaction_callback)
    (set_block_applied_callback)
    (cancel_all_subscriptions)
+   (subscribe_to_changes)
+   (unsubscribe_from_changes)
 
    // tags
    (get_trending_tags)
@@ -409,6 +513,13 @@ FC_API(steemit::app::database_api,
    (get_witness_schedule)
    (get_hardfork_version)
    (get_next_scheduled_hardfork)
+   (get_pending_transaction_statistics)
+   (get_fork_database_statistics)
+   (get_api_executor_statistics)
+   (get_api_response_cache_statistics)
+   (get_change_subscription_statistics)
+   (get_operation_queue_statistics)
+   (get_http_rpc_statistics)
 
    // Keys
    (get_key_references)
@@ -421,6 +532,7 @@ FC_API(steemit::app::database_api,
    (get_account_count)
    (get_conversion_requests)
    (get_account_history)
+   (get_account_history_by_type)
 
    // Market
    (get_order_book)
@@ -443,6 +555,8 @@ FC_API(steemit::app::database_api,
    (get_discussions_by_author_before_date)
    (get_replies_by_last_update)
 
+   // batches
+   (get_batch)
 
    // Witnesses
    (get_witnesses)
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <steemit/app/api_context.hpp>
+#include <steemit/app/api_metrics.hpp>
+
+#include <fc/api.hpp>
+#include <fc/network/ip.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/future.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace steemit { namespace app {
+
+struct http_rpc_statistics
+{
+   uint32_t connections = 0;
+   uint64_t total_connections = 0;
+   uint64_t requests = 0;
+
+   /** requests that were already received while an earlier request of the same connection was answered */
+   uint64_t pipelined_requests = 0;
+
+   /** requests answered with an HTTP error, such as malformed or too large requests */
+   uint64_t rejected_requests = 0;
+};
+
+/**
+ *  Serves JSON-RPC over plain HTTP/1.1 so stateless clients and standard load balancers can
+ *  use the node without holding a websocket session.
+ *
+ *  Each TCP connection gets its own set of the public APIs, created by the session factory
+ *  just like for a websocket connection, so login_api and get_api_by_name work per connection.
+ *  Requests are POSTed JSON-RPC 2.0 objects or arrays of them, with the same methods as the
+ *  websocket endpoint: call with [api, method, params], or any method of the API with id 0.
+ *  The large results of database_api, such as get_state, the discussion lists, account history
+ *  and blocks, are written with json_writer rather than through an fc::variant.
+ *
+ *  Connections are kept alive unless the client asks otherwise, and pipelined requests are
+ *  answered in order.  Requests with a body larger than max_body_size are rejected and the
+ *  connection is closed.  Callbacks, and therefore subscriptions, are not available over HTTP.
+ *
+ *  Every call is recorded in api_metrics, along with the calls made over websockets.
+ */
+class http_rpc_server
+{
+   public:
+      /** registers the APIs of a new connection in its context, returns their names indexed by api id */
+      typedef std::function< std::vector< std::string >( fc::api_connection&, const std::shared_ptr< api_connection_context >& ) > session_factory;
+
+      http_rpc_server( session_factory factory, api_metrics& metrics, uint32_t max_body_size );
+      ~http_rpc_server();
+
+      void listen( const fc::ip::endpoint& endpoint );
+      fc::ip::endpoint get_local_endpoint()const;
+      void close();
+
+      http_rpc_statistics get_statistics()const;
+
+      static const uint32_t max_header_size = 16 * 1024;
+
+      /** the JSON-RPC response of a successful call, from the JSON of its result */
+      static std::string make_rpc_response( const fc::variant& id, const std::string& result );
+
+   private:
+      struct request;
+
+      void accept_loop();
+      void handle_connection( std::shared_ptr< fc::tcp_socket > socket );
+      /** api_names is extended with the APIs the connection looks up by name */
+      std::string handle_request( fc::api_connection& session, const api_connection_context& apis, std::vector< std::string >& api_names,
+                                  const request& req, bool keep_alive );
+      /** returns the JSON response */
+      std::string handle_call( fc::api_connection& session, const api_connection_context& apis, std::vector< std::string >& api_names,
+                               const fc::variant& call );
+
+      session_factory                                 _session_factory;
+      api_metrics&                                    _metrics;
+      uint32_t                                        _max_body_size;
+
+      fc::tcp_server                                  _tcp_server;
+      fc::future< void >                              _accept_loop_complete;
+      std::set< std::shared_ptr< fc::tcp_socket > >   _sockets;
+      bool                                            _closing = false;
+
+      mutable std::mutex                              _statistics_mutex;
+      http_rpc_statistics                             _statistics;
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::http_rpc_statistics,
+            (connections)(total_connections)(requests)(pipelined_requests)(rejected_requests) )
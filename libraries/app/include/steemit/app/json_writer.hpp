@@ -0,0 +1,222 @@
+#pragma once
+
+#include <steemit/chain/protocol/asset.hpp>
+#include <steemit/chain/protocol/operations.hpp>
+#include <steemit/chain/protocol/version.hpp>
+
+#include <fc/container/flat.hpp>
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/safe.hpp>
+#include <fc/uint128.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace steemit { namespace app {
+
+/**
+ *  Types written by converting them to an fc::variant first.  Reflected types are written
+ *  member by member unless they have their own to_variant, which must be listed here so the
+ *  output matches what fc::json produces for the same value.
+ */
+template< typename T >
+struct json_writer_uses_variant
+{
+   static const bool value = !fc::reflector< T >::is_defined::value || std::is_enum< T >::value;
+};
+
+template<> struct json_writer_uses_variant< chain::asset >            { static const bool value = true; };
+template<> struct json_writer_uses_variant< chain::version >          { static const bool value = true; };
+template<> struct json_writer_uses_variant< chain::hardfork_version > { static const bool value = true; };
+template<> struct json_writer_uses_variant< chain::public_key_type >  { static const bool value = true; };
+template<> struct json_writer_uses_variant< chain::extended_public_key_type >  { static const bool value = true; };
+template<> struct json_writer_uses_variant< chain::extended_private_key_type > { static const bool value = true; };
+template<> struct json_writer_uses_variant< graphene::db::object_id_type >     { static const bool value = true; };
+template<> struct json_writer_uses_variant< fc::uint128_t >                    { static const bool value = true; };
+
+template< uint8_t SpaceID, uint8_t TypeID, typename T >
+struct json_writer_uses_variant< graphene::db::object_id< SpaceID, TypeID, T > > { static const bool value = true; };
+
+/**
+ *  Serializes values to JSON directly into a string, using the FC_REFLECT metadata
+ *  rather than building an fc::variant tree and then printing it.  For large API
+ *  results such as state, vector<discussion> or account history this avoids
+ *  allocating a copy of every string and member of the response.
+ *
+ *  The output is equivalent to fc::json::to_string( fc::variant( v ) ): maps with
+ *  string keys become objects, other maps arrays of pairs, and 64 bit integers
+ *  that do not fit in 32 bits are quoted and operations are written as
+ *  [name, operation].  Leaf types that are not reflected, such as ids, keys,
+ *  times and assets, are still written through fc::variant.
+ */
+class json_writer
+{
+   public:
+      explicit json_writer( std::string& out ) : _out( out ) {}
+
+      template< typename T >
+      void write( const T& v ) { write_value( v ); }
+
+      template< typename T >
+      static std::string to_string( const T& v, size_t reserve = 0 )
+      {
+         std::string result;
+         result.reserve( reserve );
+         json_writer( result ).write( v );
+         return result;
+      }
+
+   private:
+      struct integer_tag {};
+      struct variant_tag {};
+      struct reflected_tag {};
+
+      template< typename T >
+      class member_visitor
+      {
+         public:
+            member_visitor( json_writer& w, const T& obj ) : _w( w ), _obj( obj ) {}
+
+            template< typename Member, class Class, Member (Class::*member) >
+            void operator()( const char* name )const
+            {
+               if( !_first )
+                  _w._out += ',';
+               _first = false;
+               _w.write_string( name );
+               _w._out += ':';
+               _w.write_value( _obj.*member );
+            }
+
+         private:
+            json_writer&  _w;
+            const T&      _obj;
+            mutable bool  _first = true;
+      };
+
+      struct operation_visitor;
+
+      void write_string( const char* s, size_t size );
+      void write_string( const std::string& s ) { write_string( s.data(), s.size() ); }
+      void write_string( const char* s );
+      void write_int64( int64_t i );
+      void write_uint64( uint64_t i );
+
+      void write_value( const std::string& s ) { write_string( s ); }
+      void write_value( bool b ) { _out += b ? "true" : "false"; }
+      void write_value( const fc::variant& v ) { _out += fc::json::to_string( v ); }
+      void write_value( const fc::variant_object& v ) { _out += fc::json::to_string( v ); }
+      void write_value( const std::vector< char >& v ) { _out += fc::json::to_string( fc::variant( v ) ); }
+      void write_value( const chain::operation& op );
+
+      template< typename T >
+      void write_value( const fc::safe< T >& v ) { write_value( v.value ); }
+
+      template< typename T >
+      void write_value( const fc::optional< T >& v )
+      {
+         if( v.valid() )
+            write_value( *v );
+         else
+            _out += "null";
+      }
+
+      template< typename A, typename B >
+      void write_value( const std::pair< A, B >& v )
+      {
+         _out += '[';
+         write_value( v.first );
+         _out += ',';
+         write_value( v.second );
+         _out += ']';
+      }
+
+      template< typename T >
+      void write_value( const std::vector< T >& v ) { write_array( v ); }
+      template< typename T >
+      void write_value( const std::deque< T >& v ) { write_array( v ); }
+      template< typename T >
+      void write_value( const std::set< T >& v ) { write_array( v ); }
+      template< typename T >
+      void write_value( const fc::flat_set< T >& v ) { write_array( v ); }
+      template< typename K, typename V >
+      void write_value( const std::map< K, V >& v ) { write_array( v ); }
+      template< typename K, typename V >
+      void write_value( const fc::flat_map< K, V >& v ) { write_array( v ); }
+
+      template< typename V >
+      void write_value( const std::map< std::string, V >& v )
+      {
+         _out += '{';
+         bool first = true;
+         for( const auto& item : v )
+         {
+            if( !first )
+               _out += ',';
+            first = false;
+            write_string( item.first );
+            _out += ':';
+            write_value( item.second );
+         }
+         _out += '}';
+      }
+
+      template< typename T >
+      void write_value( const T& v )
+      {
+         typedef typename std::conditional< std::is_integral< T >::value, integer_tag,
+                 typename std::conditional< json_writer_uses_variant< T >::value, variant_tag, reflected_tag >::type >::type tag;
+         write_value( v, tag() );
+      }
+
+      template< typename T >
+      void write_value( const T& v, integer_tag )
+      {
+         if( std::is_signed< T >::value )
+            write_int64( int64_t( v ) );
+         else
+            write_uint64( uint64_t( v ) );
+      }
+
+      template< typename T >
+      void write_value( const T& v, variant_tag )
+      {
+         _out += fc::json::to_string( fc::variant( v ) );
+      }
+
+      template< typename T >
+      void write_value( const T& v, reflected_tag )
+      {
+         _out += '{';
+         fc::reflector< T >::visit( member_visitor< T >( *this, v ) );
+         _out += '}';
+      }
+
+      template< typename Container >
+      void write_array( const Container& c )
+      {
+         _out += '[';
+         bool first = true;
+         for( const auto& item : c )
+         {
+            if( !first )
+               _out += ',';
+            first = false;
+            write_value( item );
+         }
+         _out += ']';
+      }
+
+      std::string& _out;
+};
+
+} } // steemit::app
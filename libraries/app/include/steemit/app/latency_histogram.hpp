@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace steemit { namespace app {
+
+/**
+ *  Counts call durations in buckets that double in size.  Bucket i counts the calls that took
+ *  less than 100 << i microseconds (100us, 200us, ... 3.2s), the last bucket all slower calls.
+ */
+struct latency_histogram
+{
+   static const uint32_t bucket_count = 17;
+
+   uint64_t                calls = 0;
+   uint64_t                errors = 0;
+   uint64_t                total_time = 0; ///< microseconds
+   uint64_t                max_time = 0;   ///< microseconds
+   std::vector< uint64_t > buckets;
+
+   void record( uint64_t time, bool error )
+   {
+      if( buckets.empty() )
+         buckets.resize( bucket_count );
+
+      uint32_t bucket = 0;
+      while( bucket + 1 < bucket_count && time >= ( uint64_t( 100 ) << bucket ) )
+         ++bucket;
+      ++buckets[ bucket ];
+
+      ++calls;
+      if( error )
+         ++errors;
+      total_time += time;
+      max_time = std::max( max_time, time );
+   }
+
+   /** an upper bound of the time within which the given fraction of the calls completed */
+   uint64_t percentile( double fraction )const
+   {
+      uint64_t target = uint64_t( fraction * calls );
+      uint64_t count = 0;
+      for( uint32_t i = 0; i < buckets.size(); ++i )
+      {
+         count += buckets[i];
+         if( count >= target && i + 1 < bucket_count )
+            return std::min( uint64_t( 100 ) << i, max_time );
+      }
+      return max_time;
+   }
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::latency_histogram, (calls)(errors)(total_time)(max_time)(buckets) )
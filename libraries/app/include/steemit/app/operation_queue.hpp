@@ -0,0 +1,189 @@
+#pragma once
+
+#include <steemit/chain/database.hpp>
+#include <steemit/chain/history_object.hpp>
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/signals2/connection.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace steemit { namespace app {
+
+/**
+ *  The operations of a block, including virtual operations, in the order they were applied.
+ */
+struct operation_batch
+{
+   uint32_t                                  block_num = 0;
+   chain::block_id_type                      block_id;
+   fc::time_point_sec                        timestamp;
+
+   /** when the batch was queued, batches up to this block will not be undone */
+   uint32_t                                  last_irreversible_block_num = 0;
+
+   std::vector< chain::operation_object >    operations;
+};
+
+struct operation_consumer_statistics
+{
+   std::string name;
+   uint32_t    queue_depth = 0;
+   uint32_t    max_queue_depth = 0;
+   uint32_t    last_block_num = 0;        ///< of the last batch handled
+
+   uint64_t    applied = 0;
+   uint64_t    undone = 0;
+   uint64_t    errors = 0;
+
+   /** time spent in the consumer's handlers, in microseconds */
+   uint64_t    total_handling_time = 0;
+   uint64_t    max_handling_time = 0;
+};
+
+struct operation_queue_statistics
+{
+   uint32_t max_pending_blocks = 0;
+   uint64_t blocks = 0;
+   uint64_t operations = 0;
+
+   /** times and microseconds block application waited for a consumer that fell behind */
+   uint64_t stalls = 0;
+   uint64_t stall_time = 0;
+
+   std::vector< operation_consumer_statistics > consumers;
+};
+
+class operation_queue;
+
+/**
+ *  A plugin's subscription to the operation_queue, see operation_queue::subscribe.
+ */
+class operation_consumer
+{
+   public:
+      typedef std::function< void( const operation_batch& ) > handler_type;
+
+      operation_consumer( const std::string& name, handler_type apply, handler_type undo );
+      ~operation_consumer();
+
+   private:
+      friend class operation_queue;
+
+      struct event
+      {
+         std::shared_ptr< const operation_batch > batch;
+         bool                                     undo = false;
+      };
+
+      void deliver();
+
+      std::string                                              _name;
+      handler_type                                             _apply;
+      handler_type                                             _undo;
+      std::unique_ptr< fc::thread >                            _thread;
+
+      /** the batches applied and not undone above the last irreversible block, only used by the chain thread */
+      std::deque< std::shared_ptr< const operation_batch > >  _reversible;
+
+      std::mutex                                               _mutex;
+      std::condition_variable                                  _changed;
+      std::deque< event >                                      _pending;
+      bool                                                     _delivering = false;
+      bool                                                     _stopped = false;
+      operation_consumer_statistics                            _statistics;
+};
+
+/**
+ *  Hands the operations of each applied block to plugins that process them on their own
+ *  thread, so the time they take does not add to the time it takes to apply a block.
+ *
+ *  The operations of a block are collected while it is applied and queued as one batch for
+ *  every consumer when it has been applied.  Each consumer has its own thread which handles
+ *  its batches one at a time in the order the blocks were applied.  When blocks are popped
+ *  on a fork switch, each consumer is sent the batches of the popped blocks to undo, newest
+ *  first, before the batches of the blocks of the new fork.  Blocks applied again from their
+ *  redo state have the batch they were first applied with.
+ *
+ *  At most max_pending_blocks batches wait for a consumer.  Once a consumer has that many
+ *  block application waits for it, so a slow consumer slows the node down instead of
+ *  consuming unbounded memory.
+ *
+ *  Handlers run while blocks are being applied and must not read the database.  A consumer
+ *  keeps its state outside of the object database and uses last_irreversible_block_num to
+ *  decide when changes can no longer be undone.
+ */
+class operation_queue
+{
+   public:
+      operation_queue( chain::database& db );
+      ~operation_queue();
+
+      void set_max_pending_blocks( uint32_t max_pending_blocks );
+
+      /**
+       *  apply is called with the batch of every block applied from now on, undo with the batch
+       *  of every such block that is popped.  Subscribe in plugin_initialize to also receive the
+       *  blocks applied while the chain is replayed.
+       */
+      std::shared_ptr< operation_consumer > subscribe( const std::string& name,
+                                                       operation_consumer::handler_type apply,
+                                                       operation_consumer::handler_type undo );
+
+      /**
+       *  Queues batches of the blocks from first_block to the head block for consumer, for a
+       *  consumer that did not see them, e.g. because it lost reversible state when the node
+       *  stopped.  Blocks are read from the block log, so the batches only contain the operations
+       *  of their transactions and no virtual operations.
+       */
+      void replay( operation_consumer& consumer, uint32_t first_block );
+
+      /** waits until consumer handled every batch queued for it */
+      void flush( operation_consumer& consumer );
+
+      /** handles the queued batches and stops all consumers */
+      void stop();
+
+      operation_queue_statistics get_statistics()const;
+
+   private:
+      void on_operation( const chain::operation_object& op );
+      void on_pre_apply_block( const chain::signed_block& b );
+      void on_applied_block( const chain::signed_block& b );
+
+      void push( operation_consumer& consumer, std::shared_ptr< const operation_batch > batch, bool undo );
+
+      chain::database&                                           _db;
+
+      boost::signals2::scoped_connection                         _operation_connection;
+      boost::signals2::scoped_connection                         _pre_apply_block_connection;
+      boost::signals2::scoped_connection                         _applied_block_connection;
+
+      /** of the block being applied, since its pre_apply_block */
+      std::vector< chain::operation_object >                     _operations;
+
+      /** batches of popped blocks, in case they are applied again from their redo state */
+      std::map< chain::block_id_type, std::shared_ptr< const operation_batch > >  _popped;
+
+      std::vector< std::shared_ptr< operation_consumer > >       _consumers;
+
+      mutable std::mutex                                         _statistics_mutex;
+      operation_queue_statistics                                 _statistics;
+};
+
+} } // steemit::app
+
+FC_REFLECT( steemit::app::operation_batch, (block_num)(block_id)(timestamp)(last_irreversible_block_num)(operations) )
+FC_REFLECT( steemit::app::operation_consumer_statistics,
+            (name)(queue_depth)(max_queue_depth)(last_block_num)(applied)(undone)(errors)(total_handling_time)(max_handling_time) )
+FC_REFLECT( steemit::app::operation_queue_statistics,
+            (max_pending_blocks)(blocks)(operations)(stalls)(stall_time)(consumers) )
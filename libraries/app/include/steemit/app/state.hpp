@@ -51,6 +51,7 @@ namespace steemit { namespace app {
       asset                       pending_payout_value; ///< sbd
       asset                       total_pending_payout_value; ///< sbd including replies
       vector<vote_state>          active_votes;
+      uint32_t                    active_vote_count = 0; ///< filled even when active_votes is not
       vector<string>              replies; ///< author/slug mapping
    };
 
@@ -160,6 +161,6 @@ FC_REFLECT( steemit::app::account_vote, (authorperm)(weight)(rshares)(percent)(t
 
 FC_REFLECT( steemit::app::discussion_index, (category)(trending)(updated)(created)(responses)(active)(votes)(maturing)(best)(hot) )
 FC_REFLECT( steemit::app::category_index, (trending)(active)(recent)(best) )
-FC_REFLECT_DERIVED( steemit::app::discussion, (steemit::chain::comment_object), (url)(root_title)(pending_payout_value)(total_pending_payout_value)(active_votes)(replies) )
+FC_REFLECT_DERIVED( steemit::app::discussion, (steemit::chain::comment_object), (url)(root_title)(pending_payout_value)(total_pending_payout_value)(active_votes)(active_vote_count)(replies) )
 
 FC_REFLECT( steemit::app::state, (current_route)(props)(category_idx)(categories)(content)(accounts)(pow_queue)(witnesses)(discussion_idx)(witness_schedule)(feed_price)(error) )
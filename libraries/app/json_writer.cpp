@@ -0,0 +1,105 @@
+#include <steemit/app/json_writer.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+namespace steemit { namespace app {
+
+struct json_writer::operation_visitor
+{
+   typedef void result_type;
+
+   operation_visitor( json_writer& w ) : _w( w ) {}
+
+   template< typename T >
+   void operator()( const T& op )const
+   {
+      // the same name as fc::to_variant( operation ) uses, the type name without namespace and "_operation"
+      std::string type_name = fc::get_typename< T >::name();
+      auto start = type_name.find_last_of( ':' ) + 1;
+      auto end   = type_name.find_last_of( '_' );
+
+      _w._out += '[';
+      _w.write_string( type_name.data() + start, end - start );
+      _w._out += ',';
+      _w.write_value( op );
+      _w._out += ']';
+   }
+
+   json_writer& _w;
+};
+
+void json_writer::write_value( const chain::operation& op )
+{
+   op.visit( operation_visitor( *this ) );
+}
+
+void json_writer::write_string( const char* s )
+{
+   write_string( s, strlen( s ) );
+}
+
+void json_writer::write_string( const char* s, size_t size )
+{
+   static const char hex[] = "0123456789abcdef";
+
+   _out += '"';
+   const char* run = s;
+   const char* end = s + size;
+   for( const char* c = s; c != end; ++c )
+   {
+      unsigned char ch = static_cast< unsigned char >( *c );
+      if( ch >= 0x20 && ch != '"' && ch != '\\' )
+         continue;
+
+      _out.append( run, c - run );
+      run = c + 1;
+      switch( ch )
+      {
+         case '"':  _out += "\\\""; break;
+         case '\\': _out += "\\\\"; break;
+         case '\b': _out += "\\b";  break;
+         case '\f': _out += "\\f";  break;
+         case '\n': _out += "\\n";  break;
+         case '\r': _out += "\\r";  break;
+         case '\t': _out += "\\t";  break;
+         default:
+            _out += "\\u00";
+            _out += hex[ ch >> 4 ];
+            _out += hex[ ch & 0xf ];
+      }
+   }
+   _out.append( run, end - run );
+   _out += '"';
+}
+
+void json_writer::write_int64( int64_t i )
+{
+   char buf[24];
+   int n = snprintf( buf, sizeof( buf ), "%lld", static_cast< long long >( i ) );
+   // fc::json quotes integers that do not fit in 32 bits so JavaScript clients do not lose precision
+   if( i > 0xffffffff )
+   {
+      _out += '"';
+      _out.append( buf, n );
+      _out += '"';
+   }
+   else
+      _out.append( buf, n );
+}
+
+void json_writer::write_uint64( uint64_t i )
+{
+   char buf[24];
+   int n = snprintf( buf, sizeof( buf ), "%llu", static_cast< unsigned long long >( i ) );
+   if( i > 0xffffffff )
+   {
+      _out += '"';
+      _out.append( buf, n );
+      _out += '"';
+   }
+   else
+      _out.append( buf, n );
+}
+
+} } // steemit::app
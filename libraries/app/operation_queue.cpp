@@ -0,0 +1,298 @@
+#include <steemit/app/operation_queue.hpp>
+
+#include <steemit/chain/global_property_object.hpp>
+
+namespace steemit { namespace app {
+
+operation_consumer::operation_consumer( const std::string& name, handler_type apply, handler_type undo )
+   : _name( name ), _apply( std::move( apply ) ), _undo( std::move( undo ) ),
+     _thread( new fc::thread( "operation_consumer_" + name ) )
+{
+   _statistics.name = name;
+}
+
+operation_consumer::~operation_consumer()
+{
+   _thread->quit();
+}
+
+void operation_consumer::deliver()
+{
+   while( true )
+   {
+      event e;
+      {
+         std::lock_guard< std::mutex > lock( _mutex );
+         if( _pending.empty() )
+         {
+            _delivering = false;
+            _changed.notify_all();
+            return;
+         }
+         e = std::move( _pending.front() );
+         _pending.pop_front();
+         _statistics.queue_depth = _pending.size();
+      }
+      _changed.notify_all();
+
+      bool failed = false;
+      fc::time_point start = fc::time_point::now();
+      try
+      {
+         if( e.undo )
+            _undo( *e.batch );
+         else
+            _apply( *e.batch );
+      }
+      catch( const fc::exception& ex )
+      {
+         elog( "${c} failed to handle block ${b}: ${e}", ("c", _name)("b", e.batch->block_num)("e", ex.to_detail_string()) );
+         failed = true;
+      }
+      catch( const std::exception& ex )
+      {
+         elog( "${c} failed to handle block ${b}: ${e}", ("c", _name)("b", e.batch->block_num)("e", ex.what()) );
+         failed = true;
+      }
+      uint64_t time = ( fc::time_point::now() - start ).count();
+
+      std::lock_guard< std::mutex > lock( _mutex );
+      if( e.undo )
+         ++_statistics.undone;
+      else
+         ++_statistics.applied;
+      if( failed )
+         ++_statistics.errors;
+      _statistics.last_block_num = e.batch->block_num;
+      _statistics.total_handling_time += time;
+      _statistics.max_handling_time = std::max( _statistics.max_handling_time, time );
+   }
+}
+
+operation_queue::operation_queue( chain::database& db )
+   : _db( db )
+{
+   _operation_connection = _db.pre_apply_operation.connect( [this]( const chain::operation_object& op ){ on_operation( op ); } );
+   _pre_apply_block_connection = _db.pre_apply_block.connect( [this]( const chain::signed_block& b ){ on_pre_apply_block( b ); } );
+   _applied_block_connection = _db.applied_block.connect( [this]( const chain::signed_block& b ){ on_applied_block( b ); } );
+}
+
+operation_queue::~operation_queue()
+{
+   stop();
+}
+
+void operation_queue::set_max_pending_blocks( uint32_t max_pending_blocks )
+{
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   _statistics.max_pending_blocks = max_pending_blocks;
+}
+
+std::shared_ptr< operation_consumer > operation_queue::subscribe( const std::string& name,
+                                                                  operation_consumer::handler_type apply,
+                                                                  operation_consumer::handler_type undo )
+{
+   auto result = std::make_shared< operation_consumer >( name, std::move( apply ), std::move( undo ) );
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   _consumers.push_back( result );
+   return result;
+}
+
+void operation_queue::on_operation( const chain::operation_object& op )
+{
+   if( !_consumers.empty() )
+      _operations.push_back( op );
+}
+
+void operation_queue::on_pre_apply_block( const chain::signed_block& b )
+{
+   // the operations of pending transactions, which are not part of the block
+   _operations.clear();
+}
+
+void operation_queue::on_applied_block( const chain::signed_block& b )
+{
+   std::vector< chain::operation_object > operations;
+   std::swap( operations, _operations );
+   if( _consumers.empty() )
+      return;
+
+   uint32_t block_num = b.block_num();
+   auto block_id = b.id();
+   uint32_t last_irreversible = _db.get_dynamic_global_properties().last_irreversible_block_num;
+
+   std::shared_ptr< operation_batch > batch;
+   auto popped = _popped.find( block_id );
+   if( popped != _popped.end() )
+   {
+      // applied again, possibly from its redo state which does not apply any operation
+      batch = std::make_shared< operation_batch >( *popped->second );
+      _popped.erase( popped );
+   }
+   else
+   {
+      batch = std::make_shared< operation_batch >();
+      batch->block_num = block_num;
+      batch->block_id = block_id;
+      batch->timestamp = b.timestamp;
+      batch->operations = std::move( operations );
+   }
+   batch->last_irreversible_block_num = last_irreversible;
+
+   for( const auto& c : _consumers )
+   {
+      // the blocks of the consumer that are not below b anymore were popped
+      while( !c->_reversible.empty() &&
+             ( c->_reversible.back()->block_num >= block_num ||
+               ( c->_reversible.back()->block_num + 1 == block_num && c->_reversible.back()->block_id != b.previous ) ) )
+      {
+         auto undone = c->_reversible.back();
+         c->_reversible.pop_back();
+         _popped[ undone->block_id ] = undone;
+         push( *c, undone, true );
+      }
+
+      push( *c, batch, false );
+      c->_reversible.push_back( batch );
+      while( !c->_reversible.empty() && c->_reversible.front()->block_num <= last_irreversible )
+         c->_reversible.pop_front();
+   }
+
+   for( auto itr = _popped.begin(); itr != _popped.end(); )
+   {
+      if( itr->second->block_num <= last_irreversible )
+         itr = _popped.erase( itr );
+      else
+         ++itr;
+   }
+
+   std::lock_guard< std::mutex > lock( _statistics_mutex );
+   ++_statistics.blocks;
+   _statistics.operations += batch->operations.size();
+}
+
+void operation_queue::replay( operation_consumer& consumer, uint32_t first_block )
+{
+   _db.with_read_lock( [&]()
+   {
+      uint32_t last_irreversible = _db.get_dynamic_global_properties().last_irreversible_block_num;
+      for( uint32_t block_num = std::max( first_block, 1u ); block_num <= _db.head_block_num(); ++block_num )
+      {
+         auto b = _db.fetch_block_by_number( block_num );
+         FC_ASSERT( b.valid(), "Block ${n} is missing from the block log", ("n", block_num) );
+
+         auto batch = std::make_shared< operation_batch >();
+         batch->block_num = block_num;
+         batch->block_id = b->id();
+         batch->timestamp = b->timestamp;
+         batch->last_irreversible_block_num = last_irreversible;
+
+         for( uint16_t trx_in_block = 0; trx_in_block < b->transactions.size(); ++trx_in_block )
+         {
+            const auto& trx = b->transactions[ trx_in_block ];
+            auto trx_id = trx.id();
+            for( uint16_t op_in_trx = 0; op_in_trx < trx.operations.size(); ++op_in_trx )
+            {
+               chain::operation_object op;
+               op.trx_id = trx_id;
+               op.block = block_num;
+               op.trx_in_block = trx_in_block;
+               op.op_in_trx = op_in_trx;
+               op.timestamp = b->timestamp;
+               op.op = trx.operations[ op_in_trx ];
+               batch->operations.push_back( std::move( op ) );
+            }
+         }
+
+         push( consumer, batch, false );
+         if( block_num > last_irreversible )
+            consumer._reversible.push_back( batch );
+      }
+   });
+}
+
+void operation_queue::flush( operation_consumer& consumer )
+{
+   std::unique_lock< std::mutex > lock( consumer._mutex );
+   consumer._changed.wait( lock, [&](){ return !consumer._delivering; } );
+}
+
+void operation_queue::stop()
+{
+   std::vector< std::shared_ptr< operation_consumer > > consumers;
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      std::swap( consumers, _consumers );
+   }
+
+   for( const auto& c : consumers )
+   {
+      flush( *c );
+      std::lock_guard< std::mutex > lock( c->_mutex );
+      c->_stopped = true;
+   }
+}
+
+operation_queue_statistics operation_queue::get_statistics()const
+{
+   operation_queue_statistics result;
+   std::vector< std::shared_ptr< operation_consumer > > consumers;
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      result = _statistics;
+      consumers = _consumers;
+   }
+
+   for( const auto& c : consumers )
+   {
+      std::lock_guard< std::mutex > lock( c->_mutex );
+      result.consumers.push_back( c->_statistics );
+   }
+   return result;
+}
+
+void operation_queue::push( operation_consumer& consumer, std::shared_ptr< const operation_batch > batch, bool undo )
+{
+   uint32_t max_pending_blocks = 0;
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      max_pending_blocks = _statistics.max_pending_blocks;
+   }
+
+   int64_t stall_time = -1;
+   {
+      std::unique_lock< std::mutex > lock( consumer._mutex );
+      if( consumer._stopped )
+         return;
+
+      if( max_pending_blocks > 0 && consumer._pending.size() >= max_pending_blocks )
+      {
+         fc::time_point start = fc::time_point::now();
+         consumer._changed.wait( lock, [&](){ return consumer._pending.size() < max_pending_blocks; } );
+         stall_time = ( fc::time_point::now() - start ).count();
+      }
+
+      operation_consumer::event e;
+      e.batch = std::move( batch );
+      e.undo = undo;
+      consumer._pending.push_back( std::move( e ) );
+      consumer._statistics.queue_depth = consumer._pending.size();
+      consumer._statistics.max_queue_depth = std::max< uint32_t >( consumer._statistics.max_queue_depth, consumer._pending.size() );
+
+      if( !consumer._delivering )
+      {
+         consumer._delivering = true;
+         operation_consumer* c = &consumer;
+         consumer._thread->async( [c](){ c->deliver(); }, "operation_consumer" );
+      }
+   }
+
+   if( stall_time >= 0 )
+   {
+      std::lock_guard< std::mutex > lock( _statistics_mutex );
+      ++_statistics.stalls;
+      _statistics.stall_time += stall_time;
+   }
+}
+
+} } // steemit::app
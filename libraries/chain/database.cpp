@@ -22,6 +22,7 @@
 
 #include <fc/io/fstream.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <functional>
@@ -56,6 +57,7 @@ const uint8_t witness_object::type_id;
 
 
 database::database()
+   : _write_lock_owner( std::thread::id() )
 {
    initialize_indexes();
    initialize_evaluators();
@@ -66,6 +68,62 @@ database::~database()
    clear_pending();
 }
 
+namespace detail {
+   /**
+    *  databases whose read lock is held by the current thread, shared by all fc tasks of the
+    *  thread which is why api_executor runs at most one locking call per worker thread
+    */
+   static thread_local std::vector< const database* > read_locked_databases;
+}
+
+database::read_lock_guard::read_lock_guard( const database& db )
+   : _db( db )
+{
+   if( db._write_lock_owner.load() == std::this_thread::get_id() )
+      return;
+   auto& held = detail::read_locked_databases;
+   if( std::find( held.begin(), held.end(), &db ) != held.end() )
+      return;
+
+   db._state_mutex.lock_shared();
+   held.push_back( &db );
+   _locked = true;
+}
+
+database::read_lock_guard::~read_lock_guard()
+{
+   if( !_locked )
+      return;
+   auto& held = detail::read_locked_databases;
+   held.erase( std::find( held.begin(), held.end(), &_db ) );
+   _db._state_mutex.unlock_shared();
+}
+
+database::write_lock_guard::write_lock_guard( database& db )
+   : _db( db )
+{
+   if( db._write_lock_owner.load() == std::this_thread::get_id() )
+   {
+      ++db._write_lock_depth;
+      return;
+   }
+   const auto& held = detail::read_locked_databases;
+   FC_ASSERT( std::find( held.begin(), held.end(), &db ) == held.end(),
+              "the database cannot be modified by a thread holding its read lock" );
+
+   db._state_mutex.lock();
+   db._write_lock_owner = std::this_thread::get_id();
+   db._write_lock_depth = 1;
+}
+
+database::write_lock_guard::~write_lock_guard()
+{
+   if( --_db._write_lock_depth > 0 )
+      return;
+   _db._write_lock_owner = std::thread::id();
+   _db._state_mutex.unlock();
+}
+
 void database::open( const fc::path& data_dir, uint64_t initial_supply )
 {
    try
@@ -276,7 +334,7 @@ block_id_type  database::get_block_id_for_num( uint32_t block_num )const
 optional<signed_block> database::fetch_block_by_id( const block_id_type& id )const
 {
    auto b = _fork_db.fetch_block( id );
-   if( !b )
+   if( !b || b->pruned )
       return _block_id_to_block.fetch_optional(id);
    return b->data;
 }
@@ -284,7 +342,7 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
-   if( results.size() == 1 )
+   if( results.size() == 1 && !results[0]->pruned )
       return results[0]->data;
    else
       return _block_id_to_block.fetch_by_number(num);
@@ -496,16 +554,19 @@ bool database::before_last_checkpoint()const
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
    bool result;
-   detail::with_skip_flags( *this, skip, [&]()
+   with_write_lock( [&]()
    {
-      detail::without_pending_transactions( *this, std::move(_pending_tx),
-      [&]()
+      detail::with_skip_flags( *this, skip, [&]()
       {
-         try
+         detail::without_pending_transactions( *this,
+         [&]()
          {
-            result = _push_block(new_block);
-         }
-         FC_CAPTURE_AND_RETHROW( (new_block) )
+            try
+            {
+               result = _push_block(new_block);
+            }
+            FC_CAPTURE_AND_RETHROW( (new_block) )
+         });
       });
    });
    return result;
@@ -539,7 +600,7 @@ bool database::_push_block(const signed_block& new_block)
                 try
                 {
                    undo_database::session session = _undo_db.start_undo_session();
-                   apply_block( (*ritr)->data, skip );
+                   apply_fork_block( *ritr, skip );
                    _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
                    session.commit();
                 }
@@ -563,7 +624,7 @@ bool database::_push_block(const signed_block& new_block)
                    for( auto ritr = branches.second.rbegin(); ritr != branches.second.rend(); ++ritr )
                    {
                       auto session = _undo_db.start_undo_session();
-                      apply_block( (*ritr)->data, skip );
+                      apply_fork_block( *ritr, skip );
                       _block_id_to_block.store( new_block.id(), (*ritr)->data );
                       session.commit();
                    }
@@ -610,7 +671,10 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
       try
       {
          set_producing( true );
-         detail::with_skip_flags( *this, skip, [&]() { _push_transaction( trx ); } );
+         with_write_lock( [&]()
+         {
+            detail::with_skip_flags( *this, skip, [&]() { _push_transaction( trx ); } );
+         });
          set_producing(false);
       }
       catch( ... )
@@ -623,6 +687,27 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
 }
 
 void database::_push_transaction( const signed_transaction& trx )
+{
+   pending_transaction pending;
+   pending.trx = trx;
+   pending.id = trx.id();
+   pending.packed_size = fc::raw::pack_size( trx );
+
+   FC_ASSERT( !_pending_tx.contains( pending.id ), "transaction is already pending", ("id", pending.id) );
+
+   flat_set<string> required; vector<authority> other;
+   trx.get_required_authorities( required, required, required, other );
+   if( required.size() )
+      pending.account = *required.begin();
+   pending.priority = calculate_pending_transaction_priority( pending );
+
+   // reject the transaction before spending any time applying it if there is no room for it
+   _pending_tx.check_capacity( pending );
+   _push_pending_transaction( std::move( pending ) );
+   ++_pending_tx.statistics().accepted;
+}
+
+void database::_push_pending_transaction( pending_transaction&& trx )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
@@ -635,15 +720,84 @@ void database::_push_transaction( const signed_transaction& trx )
    // apply the changes.
 
    auto temp_session = _undo_db.start_undo_session();
-   _apply_transaction( trx );
-   _pending_tx.push_back( trx );
+   _verified_authority_digests.clear();
+   if( pending_transaction_authorities_unchanged( trx ) )
+   {
+      // the signatures were verified against the very same authorities when the transaction was first pushed
+      uint32_t skip = get_node_properties().skip_flags;
+      detail::with_skip_flags( *this, skip | skip_transaction_signatures, [&]() { _apply_transaction( trx.trx ); } );
+      ++_pending_tx.statistics().reapplied_without_signature_check;
+   }
+   else
+   {
+      _apply_transaction( trx.trx );
+   }
+
+   if( _verified_authority_digests.size() )
+      trx.authority_digests.swap( _verified_authority_digests );
+
+   transaction_id_type trx_id = trx.id;
+   _pending_tx.insert( std::move( trx ) );
 
    notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
    temp_session.merge();
 
    // notify anyone listening to pending transactions
-   on_pending_transaction( trx );
+   const pending_transaction* pending = _pending_tx.find( trx_id );
+   if( pending != nullptr )
+      on_pending_transaction( pending->trx );
+}
+
+bool database::pending_transaction_authorities_unchanged( const pending_transaction& trx )const
+{
+   if( trx.authority_digests.empty() )
+      return false;
+
+   const auto& accounts_by_name = get_index_type<account_index>().indices().get<by_name>();
+   for( const auto& entry : trx.authority_digests )
+   {
+      auto itr = accounts_by_name.find( entry.first );
+      if( itr == accounts_by_name.end() || get_authority_digest( *itr ) != entry.second )
+         return false;
+   }
+   return true;
+}
+
+fc::sha256 database::get_authority_digest( const account_object& a )const
+{
+   fc::sha256::encoder enc;
+   fc::raw::pack( enc, a.owner );
+   fc::raw::pack( enc, a.active );
+   fc::raw::pack( enc, a.posting );
+   return enc.result();
+}
+
+/**
+ * Steem does not charge transaction fees, so pending transactions are ranked by the vesting
+ * shares of the account per unit of bandwidth it has recently used, including this transaction.
+ * Accounts with a large stake that transact rarely come first, accounts flooding the network last.
+ */
+uint64_t database::calculate_pending_transaction_priority( const pending_transaction& trx )const
+{
+   const auto& accounts_by_name = get_index_type<account_index>().indices().get<by_name>();
+   auto itr = accounts_by_name.find( trx.account );
+   if( itr == accounts_by_name.end() )
+      return 0;
+
+   fc::uint128 vesting_shares( uint64_t( itr->vesting_shares.amount.value ) );
+   fc::uint128 bandwidth( itr->average_bandwidth );
+   bandwidth += fc::uint128( uint64_t( trx.packed_size ) ) * uint64_t( STEEMIT_BANDWIDTH_PRECISION );
+
+   fc::uint128 priority = ( vesting_shares * uint64_t( STEEMIT_BANDWIDTH_PRECISION ) ) / bandwidth;
+   if( priority > fc::uint128( uint64_t(-1) ) )
+      return uint64_t(-1);
+   return priority.to_uint64();
+}
+
+void database::set_pending_transaction_limits( uint32_t max_transactions, uint64_t max_size, uint32_t max_transactions_per_account )
+{
+   _pending_tx.set_limits( max_transactions, max_size, max_transactions_per_account );
 }
 
 signed_block database::generate_block(
@@ -654,14 +808,17 @@ signed_block database::generate_block(
    )
 {
    signed_block result;
-   detail::with_skip_flags( *this, skip, [&]()
+   with_write_lock( [&]()
    {
-      try
+      detail::with_skip_flags( *this, skip, [&]()
       {
-         result = _generate_block( when, witness_owner, block_signing_private_key );
-      }
-      FC_CAPTURE_AND_RETHROW( (witness_owner) )
-   } );
+         try
+         {
+            result = _generate_block( when, witness_owner, block_signing_private_key );
+         }
+         FC_CAPTURE_AND_RETHROW( (witness_owner) )
+      } );
+   });
    return result;
 }
 
@@ -671,6 +828,113 @@ signed_block database::_generate_block(
    const string& witness_owner,
    const fc::ecc::private_key& block_signing_private_key
    )
+{
+   check_block_producer( when, witness_owner, &block_signing_private_key );
+   size_t block_size = 0;
+   auto transactions = apply_pending_transactions_for_block( when, block_size );
+
+   // We have temporarily broken the invariant that
+   // _pending_tx_session is the result of applying _pending_tx, as
+   // _pending_tx now consists of the set of postponed transactions.
+   // However, the push_block() call in finish_block() will re-create the
+   // _pending_tx_session.
+   _pending_tx_session.reset();
+
+   return finish_block( when, witness_owner, block_signing_private_key, transactions );
+}
+
+block_template database::build_block_template( fc::time_point_sec when, const string& witness_owner, uint32_t skip )
+{
+   block_template result;
+   with_write_lock( [&]()
+   {
+      detail::with_skip_flags( *this, skip, [&]()
+      {
+         try
+         {
+            check_block_producer( when, witness_owner, nullptr );
+            result.previous = head_block_id();
+            result.timestamp = when;
+            result.witness = witness_owner;
+            result.transactions = apply_pending_transactions_for_block( when, result.block_size );
+            result.includes_all_pending = result.transactions.size() == _pending_tx.size();
+
+            if( !result.includes_all_pending )
+            {
+               // keep the invariant that the pending state is the result of the pending transactions
+               flat_set< transaction_id_type > included;
+               for( const auto& trx : result.transactions )
+                  included.insert( trx.id() );
+
+               for( const pending_transaction& pending : _pending_tx.indices().get< by_sequence >() )
+               {
+                  if( included.find( pending.id ) != included.end() )
+                     continue;
+                  try
+                  {
+                     auto temp_session = _undo_db.start_undo_session();
+                     if( pending_transaction_authorities_unchanged( pending ) )
+                        detail::with_skip_flags( *this, skip | skip_transaction_signatures, [&]() { _apply_transaction( pending.trx ); } );
+                     else
+                        _apply_transaction( pending.trx );
+                     temp_session.merge();
+                  }
+                  catch( const fc::exception& )
+                  {
+                     // it is dropped from the pending state like in apply_pending_transactions_for_block
+                  }
+               }
+            }
+         }
+         FC_CAPTURE_AND_RETHROW( (witness_owner) )
+      } );
+   });
+   return result;
+}
+
+signed_block database::generate_block(
+   const block_template& tmpl,
+   const fc::ecc::private_key& block_signing_private_key,
+   uint32_t skip /* = 0 */
+   )
+{
+   signed_block result;
+   with_write_lock( [&]()
+   {
+      detail::with_skip_flags( *this, skip, [&]()
+      {
+         try
+         {
+            // the transactions of the template were applied to the head block when it was built
+            FC_ASSERT( tmpl.previous == head_block_id(), "Block template is not built on the head block" );
+            check_block_producer( tmpl.timestamp, tmpl.witness, &block_signing_private_key );
+            _pending_tx_session.reset();
+            detail::with_skip_flags( *this, skip | skip_transaction_signatures, [&]()
+            {
+               result = finish_block( tmpl.timestamp, tmpl.witness, block_signing_private_key, tmpl.transactions );
+            } );
+         }
+         FC_CAPTURE_AND_RETHROW( (tmpl.witness) )
+      } );
+   });
+   return result;
+}
+
+bool database::extend_block_template( block_template& tmpl, const signed_transaction& trx )const
+{
+   if( !tmpl.includes_all_pending || tmpl.previous != head_block_id() || tmpl.transactions.size() + 1 != _pending_tx.size() )
+      return false;
+
+   const pending_transaction* pending = _pending_tx.find( trx.id() );
+   if( pending == nullptr || trx.expiration < tmpl.timestamp || tmpl.block_size + pending->packed_size >= STEEMIT_MAX_BLOCK_SIZE )
+      return false;
+
+   tmpl.transactions.push_back( trx );
+   tmpl.block_size += pending->packed_size;
+   return true;
+}
+
+void database::check_block_producer( fc::time_point_sec when, const string& witness_owner, const fc::ecc::private_key* block_signing_private_key )const
 {
    uint32_t skip = get_node_properties().skip_flags;
    uint32_t slot_num = get_slot_at_time( when );
@@ -678,16 +942,19 @@ signed_block database::_generate_block(
    string scheduled_witness = get_scheduled_witness( slot_num );
    FC_ASSERT( scheduled_witness == witness_owner );
 
-   const auto& witness_obj = get_witness( witness_owner );
+   if( block_signing_private_key != nullptr && !(skip & skip_witness_signature) )
+      FC_ASSERT( get_witness( witness_owner ).signing_key == block_signing_private_key->get_public_key() );
+}
 
-   if( !(skip & skip_witness_signature) )
-      FC_ASSERT( witness_obj.signing_key == block_signing_private_key.get_public_key() );
+vector< signed_transaction > database::apply_pending_transactions_for_block( fc::time_point_sec when, size_t& block_size )
+{
+   uint32_t skip = get_node_properties().skip_flags;
 
    static const size_t max_block_header_size = fc::raw::pack_size( signed_block_header() ) + 4;
    auto maximum_block_size = STEEMIT_MAX_BLOCK_SIZE;
    size_t total_block_size = max_block_header_size;
 
-   signed_block pending_block;
+   vector< signed_transaction > transactions;
 
    //
    // The following code throws away existing pending_tx_session and
@@ -705,15 +972,17 @@ signed_block database::_generate_block(
 
    uint64_t postponed_tx_count = 0;
    // pop pending state (reset to head block state)
-   for( const signed_transaction& tx : _pending_tx )
+   for( const pending_transaction& pending : _pending_tx.indices().get< by_sequence >() )
    {
+      const signed_transaction& tx = pending.trx;
+
       // Only include transactions that have not expired yet for currently generating block,
       // this should clear problem transactions and allow block production to continue
 
       if( tx.expiration < when )
          continue;
 
-      uint64_t new_total_size = total_block_size + fc::raw::pack_size( tx );
+      uint64_t new_total_size = total_block_size + pending.packed_size;
 
       // postpone transaction if it would make block too big
       if( new_total_size >= maximum_block_size )
@@ -725,11 +994,14 @@ signed_block database::_generate_block(
       try
       {
          auto temp_session = _undo_db.start_undo_session();
-         _apply_transaction( tx );
+         if( pending_transaction_authorities_unchanged( pending ) )
+            detail::with_skip_flags( *this, skip | skip_transaction_signatures, [&]() { _apply_transaction( tx ); } );
+         else
+            _apply_transaction( tx );
          temp_session.merge();
 
-         total_block_size += fc::raw::pack_size( tx );
-         pending_block.transactions.push_back( tx );
+         total_block_size += pending.packed_size;
+         transactions.push_back( tx );
       }
       catch ( const fc::exception& e )
       {
@@ -743,14 +1015,21 @@ signed_block database::_generate_block(
       wlog( "Postponed ${n} transactions due to block size limit", ("n", postponed_tx_count) );
    }
 
-   _pending_tx_session.reset();
+   block_size = total_block_size;
+   return transactions;
+}
 
-   // We have temporarily broken the invariant that
-   // _pending_tx_session is the result of applying _pending_tx, as
-   // _pending_tx now consists of the set of postponed transactions.
-   // However, the push_block() call below will re-create the
-   // _pending_tx_session.
+signed_block database::finish_block(
+   fc::time_point_sec when,
+   const string& witness_owner,
+   const fc::ecc::private_key& block_signing_private_key,
+   const vector< signed_transaction >& transactions
+   )
+{
+   uint32_t skip = get_node_properties().skip_flags;
 
+   signed_block pending_block;
+   pending_block.transactions = transactions;
    pending_block.previous = head_block_id();
    pending_block.timestamp = when;
    pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
@@ -796,6 +1075,7 @@ void database::pop_block()
 {
    try
    {
+      write_lock_guard guard( *this );
       _pending_tx_session.reset();
       auto head_id = head_block_id();
 
@@ -803,9 +1083,21 @@ void database::pop_block()
       optional<signed_block> head_block = fetch_block_by_id( head_id );
       STEEMIT_ASSERT( head_block.valid(), pop_empty_chain, "there are no blocks to pop" );
 
+      // the block log will not have it anymore, the fork database needs it if we switch back
+      _fork_db.restore_block( *head_block );
       _fork_db.pop_block();
       _block_id_to_block.remove( head_id );
-      pop_undo();
+
+      // keep the changes of the block in case we switch back to its fork
+      auto item = _fork_db.fetch_block( head_id );
+      if( item )
+      {
+         auto redo = std::make_shared< graphene::db::redo_state >();
+         pop_undo( redo.get() );
+         item->redo = redo;
+      }
+      else
+         pop_undo();
 
       _popped_tx.insert( _popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end() );
 
@@ -817,7 +1109,7 @@ void database::clear_pending()
 {
    try
    {
-      assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
+      write_lock_guard guard( *this );
       _pending_tx.clear();
       _pending_tx_session.reset();
    }
@@ -2145,6 +2437,8 @@ void database::notify_changed_objects()
          changed_ids.push_back( item.first );
          removed.emplace_back( item.second.get() );
       }
+      // before changed_objects, so observers have the last value of the removed ids it contains
+      removed_objects(removed);
       changed_objects(changed_ids);
    }
 } FC_CAPTURE_AND_RETHROW() }
@@ -2186,6 +2480,29 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
       validate_invariants();
 }
 
+void database::apply_fork_block( const item_ptr& item, uint32_t skip )
+{
+   if( !item->redo )
+   {
+      apply_block( item->data, skip );
+      return;
+   }
+
+   // the block was applied to this same state before it was popped, so the changes it
+   // made then are the changes it makes now
+   auto redo = std::move( item->redo );
+   pre_apply_block( item->data );
+   _undo_db.redo( std::move( *redo ) );
+
+   const auto& dgp = get_dynamic_global_properties();
+   _undo_db.set_max_size( dgp.head_block_number - dgp.last_irreversible_block_num + 1 );
+   _fork_db.set_max_size( dgp.head_block_number - dgp.last_irreversible_block_num + 1 );
+   _fork_db.prune_blocks( dgp.head_block_id );
+
+   applied_block( item->data );
+   notify_changed_objects();
+}
+
 void database::_apply_block( const signed_block& next_block )
 { try {
    uint32_t next_block_num = next_block.block_num();
@@ -2198,6 +2515,8 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
+   pre_apply_block( next_block );
+
    /// modify current witness so transaction evaluators can know who included the transaction,
    /// this is mostly for POW operations which must pay the current_witness
    modify( get_dynamic_global_properties(), [&]( dynamic_global_property_object& dgp ){
@@ -2365,11 +2684,17 @@ void database::_apply_transaction(const signed_transaction& trx)
 
    if( !(skip & (skip_transaction_signatures | skip_authority_check) ) )
    {
-      auto get_active  = [&]( const string& name ) { return &get_account(name).active; };
-      auto get_owner   = [&]( const string& name ) { return &get_account(name).owner;  };
-      auto get_posting = [&]( const string& name ) { return &get_account(name).posting;  };
+      // remember which accounts were consulted so the pending pool can tell if this check needs to be repeated
+      flat_set<string> consulted_accounts;
+      auto get_active  = [&]( const string& name ) -> const authority* { consulted_accounts.insert(name); return &get_account(name).active; };
+      auto get_owner   = [&]( const string& name ) -> const authority* { consulted_accounts.insert(name); return &get_account(name).owner;  };
+      auto get_posting = [&]( const string& name ) -> const authority* { consulted_accounts.insert(name); return &get_account(name).posting;  };
 
       trx.verify_authority( chain_id, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH );
+
+      _verified_authority_digests.clear();
+      for( const auto& name : consulted_accounts )
+         _verified_authority_digests[ name ] = get_authority_digest( get_account( name ) );
    }
    flat_set<string> required; vector<authority> other;
    trx.get_required_authorities( required, required, required, other );
@@ -2561,6 +2886,7 @@ void database::update_global_dynamic_data( const signed_block& b )
 
    _undo_db.set_max_size( _dgp.head_block_number - _dgp.last_irreversible_block_num + 1 );
    _fork_db.set_max_size( _dgp.head_block_number - _dgp.last_irreversible_block_num + 1 );
+   _fork_db.prune_blocks( _dgp.head_block_id );
 }
 
 void database::update_signing_witness(const witness_object& signing_witness, const signed_block& new_block)
@@ -2626,9 +2952,26 @@ void database::update_last_irreversible_block()
 }
 
 
+namespace {
+
+/** the reward delta of owner in rewards, added when owner is not in rewards yet */
+database::liquidity_reward_delta& get_reward_delta( vector< database::liquidity_reward_delta >& rewards, account_id_type owner )
+{
+   for( auto& r : rewards )
+      if( r.owner == owner )
+         return r;
+
+   rewards.emplace_back();
+   rewards.back().owner = owner;
+   return rewards.back();
+}
+
+} // anonymous namespace
+
 bool database::apply_order( const limit_order_object& new_order_object )
 {
    auto order_id = new_order_object.id;
+   const auto& seller = get_account( new_order_object.seller );
 
    const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
 
@@ -2636,19 +2979,31 @@ bool database::apply_order( const limit_order_object& new_order_object )
    auto limit_itr = limit_price_idx.lower_bound(max_price.max());
    auto limit_end = limit_price_idx.upper_bound(max_price);
 
+   vector< liquidity_reward_delta > rewards;
    bool finished = false;
    while( !finished && limit_itr != limit_end )
    {
       auto old_limit_itr = limit_itr;
       ++limit_itr;
       // match returns 2 when only the old order was fully filled. In this case, we keep matching; otherwise, we stop.
-      finished = ( match(new_order_object, *old_limit_itr, old_limit_itr->sell_price) & 0x1 );
+      finished = ( match( new_order_object, seller, *old_limit_itr, old_limit_itr->sell_price, rewards ) & 0x1 );
    }
 
+   adjust_liquidity_rewards( rewards );
+
    return find_object(order_id) == nullptr;
 }
 
 int database::match( const limit_order_object& new_order, const limit_order_object& old_order, const price& match_price )
+{
+   vector< liquidity_reward_delta > rewards;
+   int result = match( new_order, get_account( new_order.seller ), old_order, match_price, rewards );
+   adjust_liquidity_rewards( rewards );
+   return result;
+}
+
+int database::match( const limit_order_object& new_order, const account_object& new_seller, const limit_order_object& old_order,
+                     const price& match_price, vector< liquidity_reward_delta >& rewards )
 {
    assert( new_order.sell_price.quote.symbol == old_order.sell_price.base.symbol );
    assert( new_order.sell_price.base.symbol  == old_order.sell_price.quote.symbol );
@@ -2682,24 +3037,26 @@ int database::match( const limit_order_object& new_order, const limit_order_obje
    assert( new_order_pays == new_order.amount_for_sale() ||
            old_order_pays == old_order.amount_for_sale() );
 
+   const auto& old_seller = get_account( old_order.seller );
+
    auto age = head_block_time() - old_order.created;
    if( age >= STEEMIT_MIN_LIQUIDITY_REWARD_PERIOD_SEC )
    {
       if( old_order_receives.symbol == STEEM_SYMBOL )
       {
-         adjust_liquidity_reward( get_account( old_order.seller ), old_order_receives, false );
-         adjust_liquidity_reward( get_account( new_order.seller ), -old_order_receives, false );
+         get_reward_delta( rewards, old_seller.id ).steem_volume += old_order_receives.amount.value;
+         get_reward_delta( rewards, new_seller.id ).steem_volume -= old_order_receives.amount.value;
       }
       else
       {
-         adjust_liquidity_reward( get_account( old_order.seller ), new_order_receives, true );
-         adjust_liquidity_reward( get_account( new_order.seller ), -new_order_receives, true );
+         get_reward_delta( rewards, old_seller.id ).sbd_volume += new_order_receives.amount.value;
+         get_reward_delta( rewards, new_seller.id ).sbd_volume -= new_order_receives.amount.value;
       }
    }
 
    int result = 0;
-   result |= fill_order( new_order, new_order_pays, new_order_receives );
-   result |= fill_order( old_order, old_order_pays, old_order_receives ) << 1;
+   result |= fill_order( new_order, new_seller, new_order_pays, new_order_receives );
+   result |= fill_order( old_order, old_seller, old_order_pays, old_order_receives ) << 1;
    assert( result != 0 );
    return result;
 }
@@ -2741,15 +3098,55 @@ void database::adjust_liquidity_reward( const account_object& owner, const asset
 }
 
 
+void database::adjust_liquidity_rewards( const vector< liquidity_reward_delta >& rewards )
+{
+   // equivalent to adjust_liquidity_reward for each match, since all matches happen at the same head block time
+   // a balance can only time out on its first update
+   const auto& ridx = get_index_type<liquidity_reward_index>().indices().get<by_owner>();
+   for( const auto& delta : rewards )
+   {
+      auto itr = ridx.find( delta.owner );
+      if( itr != ridx.end() )
+      {
+         modify<liquidity_reward_balance_object>( *itr, [&]( liquidity_reward_balance_object& r )
+         {
+            if( head_block_time() - r.last_update >= STEEMIT_LIQUIDITY_TIMEOUT_SEC )
+            {
+               r.sbd_volume = 0;
+               r.steem_volume = 0;
+            }
+
+            r.sbd_volume += delta.sbd_volume;
+            r.steem_volume += delta.steem_volume;
+            r.last_update = head_block_time();
+         } );
+      }
+      else
+      {
+         create<liquidity_reward_balance_object>( [&](liquidity_reward_balance_object& r )
+         {
+            r.owner = delta.owner;
+            r.sbd_volume = delta.sbd_volume;
+            r.steem_volume = delta.steem_volume;
+            r.last_update = head_block_time();
+         } );
+      }
+   }
+}
+
+
 bool database::fill_order( const limit_order_object& order, const asset& pays, const asset& receives )
+{
+   return fill_order( order, get_account( order.seller ), pays, receives );
+}
+
+bool database::fill_order( const limit_order_object& order, const account_object& seller, const asset& pays, const asset& receives )
 {
    try
    {
       FC_ASSERT( order.amount_for_sale().symbol == pays.symbol );
       FC_ASSERT( pays.symbol != receives.symbol );
 
-      const account_object& seller = get_account( order.seller );
-
       adjust_balance( seller, receives );
 
       push_applied_operation( fill_order_operation( order.seller, order.orderid, pays, receives ) );
@@ -72,8 +72,7 @@ void  fork_database::_push_block(const item_ptr& item)
       uint32_t min_num = _head->num - std::min( _max_size, _head->num );
 //      ilog( "min block in fork DB ${n}, max_size: ${m}", ("n",min_num)("m",_max_size) );
       auto& num_idx = _index.get<block_num>();
-      while( num_idx.size() && (*num_idx.begin())->num < min_num )
-         num_idx.erase( num_idx.begin() );
+      num_idx.erase( num_idx.begin(), num_idx.lower_bound( min_num ) );
 
       _unlinked_index.get<block_num>().erase(_head->num - _max_size);
    }
@@ -106,32 +105,71 @@ void fork_database::set_max_size( uint32_t s )
    _max_size = s;
    if( !_head ) return;
 
+   uint32_t min_num = uint32_t( std::max(int64_t(0),int64_t(_head->num) - _max_size) );
    { /// index
       auto& by_num_idx = _index.get<block_num>();
-      auto itr = by_num_idx.begin();
-      while( itr != by_num_idx.end() )
-      {
-         if( (*itr)->num < std::max(int64_t(0),int64_t(_head->num) - _max_size) )
-            by_num_idx.erase(itr);
-         else
-            break;
-         itr = by_num_idx.begin();
-      }
+      by_num_idx.erase( by_num_idx.begin(), by_num_idx.lower_bound( min_num ) );
    }
    { /// unlinked_index
       auto& by_num_idx = _unlinked_index.get<block_num>();
-      auto itr = by_num_idx.begin();
-      while( itr != by_num_idx.end() )
-      {
-         if( (*itr)->num < std::max(int64_t(0),int64_t(_head->num) - _max_size) )
-            by_num_idx.erase(itr);
-         else
-            break;
-         itr = by_num_idx.begin();
-      }
+      by_num_idx.erase( by_num_idx.begin(), by_num_idx.lower_bound( min_num ) );
    }
 }
 
+void fork_database::prune_blocks( const block_id_type& head_id )
+{
+   auto& index = _index.get<block_id>();
+   auto itr = index.find( head_id );
+   if( itr == index.end() )
+      return;
+
+   item_ptr item = *itr;
+   for( uint32_t i = 0; i < FULL_BLOCK_DEPTH && item; ++i )
+      item = item->prev.lock();
+
+   // everything below the first pruned block was pruned along with it
+   while( item && !item->pruned )
+   {
+      vector< signed_transaction >().swap( item->data.transactions );
+      item->pruned = true;
+      item = item->prev.lock();
+   }
+}
+
+void fork_database::restore_block( const signed_block& b )
+{
+   auto item = fetch_block( b.id() );
+   if( item && item->pruned )
+   {
+      item->data = b;
+      item->pruned = false;
+   }
+}
+
+fork_database_statistics fork_database::get_statistics()const
+{
+   fork_database_statistics result;
+   result.blocks = _index.size();
+   result.unlinked_blocks = _unlinked_index.size();
+   if( _head )
+      result.head_block_num = _head->num;
+
+   const auto& num_idx = _index.get<block_num>();
+   if( num_idx.size() )
+      result.oldest_block_num = (*num_idx.begin())->num;
+
+   for( const item_ptr& item : num_idx )
+   {
+      if( item->redo )
+         ++result.redo_blocks;
+      if( item->pruned )
+         continue;
+      ++result.full_blocks;
+      result.full_block_size += item->packed_size;
+   }
+   return result;
+}
+
 bool fork_database::is_known_block(const block_id_type& id)const
 {
    auto& index = _index.get<block_id>();
@@ -186,13 +224,13 @@ pair<fork_database::branch_type,fork_database::branch_type>
    auto second_branch = *second_branch_itr;
 
 
-   while( first_branch->data.block_num() > second_branch->data.block_num() )
+   while( first_branch->num > second_branch->num )
    {
       result.first.push_back(first_branch);
       first_branch = first_branch->prev.lock();
       FC_ASSERT(first_branch);
    }
-   while( second_branch->data.block_num() > first_branch->data.block_num() )
+   while( second_branch->num > first_branch->num )
    {
       result.second.push_back( second_branch );
       second_branch = second_branch->prev.lock();
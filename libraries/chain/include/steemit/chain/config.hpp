@@ -168,6 +168,12 @@
 #define STEEMIT_MAX_UNDO_HISTORY                10000
 
 #define STEEMIT_MIN_TRANSACTION_EXPIRATION_LIMIT (STEEMIT_BLOCK_INTERVAL * 5) // 5 transactions per block
+
+#define STEEMIT_MAX_PENDING_TRANSACTIONS             10000
+#define STEEMIT_MAX_PENDING_TRANSACTIONS_SIZE        (64*1024*1024) // 64 MiB
+#define STEEMIT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT 1000
+#define STEEMIT_PENDING_TRANSACTION_EXECUTION_LIMIT  (fc::milliseconds(200)) // time allowed to re-apply pending transactions after a block, the rest is postponed
+
 #define STEEMIT_BLOCKCHAIN_PRECISION            uint64_t( 1000 )
 
 #define STEEMIT_BLOCKCHAIN_PRECISION_DIGITS     3
@@ -8,6 +8,7 @@
 #include <steemit/chain/node_property_object.hpp>
 #include <steemit/chain/fork_database.hpp>
 #include <steemit/chain/block_database.hpp>
+#include <steemit/chain/pending_transaction_pool.hpp>
 
 #include <steemit/chain/protocol/protocol.hpp>
 
@@ -18,12 +19,34 @@
 
 #include <fc/log/logger.hpp>
 
+#include <boost/thread/shared_mutex.hpp>
+
+#include <atomic>
 #include <map>
+#include <thread>
 
 namespace steemit { namespace chain {
    using graphene::db::abstract_object;
    using graphene::db::object;
 
+   /**
+    *  The transactions of a block assembled from the pending transactions ahead of its slot,
+    *  see database::build_block_template.
+    */
+   struct block_template
+   {
+      block_id_type                  previous;
+      fc::time_point_sec             timestamp;
+      string                         witness;
+      vector< signed_transaction >   transactions;
+
+      /** the packed size of the block so far, including the largest header */
+      size_t                         block_size = 0;
+
+      /** the pending state is exactly the result of transactions, so new ones can be appended */
+      bool                           includes_all_pending = false;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -82,6 +105,34 @@ namespace steemit { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /**
+          *  Read only API calls may run on threads other than the one applying blocks.  Everything
+          *  that modifies the state through the public interface (push_block, push_transaction,
+          *  generate_block, pop_block and clear_pending) holds the write lock, so a reader holding
+          *  the read lock sees the state between two such modifications.
+          *
+          *  Both locks are reentrant on the thread holding them and the thread holding the write
+          *  lock may also take the read lock.  Ownership is tracked per thread, not per fc task,
+          *  so the callback must not yield to other fc tasks of its thread that could take a lock.
+          *  API calls are therefore never executed on the thread applying blocks, see api_executor.
+          */
+         template< typename Lambda >
+         auto with_read_lock( Lambda&& callback )const -> decltype( callback() )
+         {
+            read_lock_guard guard( *this );
+            return callback();
+         }
+
+         template< typename Lambda >
+         auto with_write_lock( Lambda&& callback ) -> decltype( callback() )
+         {
+            write_lock_guard guard( *this );
+            return callback();
+         }
+
+         /** whether the current thread holds the write lock, e.g. in an applied_block handler */
+         bool holds_write_lock()const { return _write_lock_owner.load() == std::this_thread::get_id(); }
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -131,6 +182,26 @@ namespace steemit { namespace chain {
          bool _push_block( const signed_block& b );
          void _push_transaction( const signed_transaction& trx );
 
+         /**
+          *  Applies a transaction from the pending pool to the pending state and puts it back in
+          *  the pool.  If none of the authorities its signatures were checked against have changed
+          *  since, signature verification is skipped.
+          */
+         void _push_pending_transaction( pending_transaction&& trx );
+
+         /** @return true if every authority consulted when trx's signatures were last verified is unchanged */
+         bool pending_transaction_authorities_unchanged( const pending_transaction& trx )const;
+
+         /**
+          *  Limits on the pending transaction pool, see pending_transaction_pool.
+          *  Zero disables the corresponding limit.
+          */
+         void set_pending_transaction_limits( uint32_t max_transactions, uint64_t max_size, uint32_t max_transactions_per_account );
+         pending_transaction_pool_statistics get_pending_transaction_statistics()const { return _pending_tx.get_statistics(); }
+
+         /** the number of blocks in the fork database and the memory held by their transactions */
+         fork_database_statistics get_fork_database_statistics()const { return _fork_db.get_statistics(); }
+
          signed_block generate_block(
             const fc::time_point_sec when,
             const string& witness_owner,
@@ -143,6 +214,33 @@ namespace steemit { namespace chain {
             const fc::ecc::private_key& block_signing_private_key
             );
 
+         /**
+          *  Re-applies the pending transactions like generate_block and returns the ones
+          *  witness_owner would include in a block at when.  The pending transactions that do
+          *  not fit in the block are applied after them, so the pending state still holds every
+          *  pending transaction.
+          */
+         block_template build_block_template( const fc::time_point_sec when, const string& witness_owner, uint32_t skip );
+
+         /**
+          *  Appends trx, which was just added to the pending state, to tmpl if it fits and the
+          *  pending state was the result of tmpl before it.  Returns false if the template has to
+          *  be built again to include trx.
+          */
+         bool extend_block_template( block_template& tmpl, const signed_transaction& trx )const;
+
+         /**
+          *  Generates the block of a template built on the current head block.  The block is
+          *  still applied by push_block, but the signatures and authorities of its transactions
+          *  are not verified again since they were verified on the very same state while the
+          *  template was built.
+          */
+         signed_block generate_block(
+            const block_template& tmpl,
+            const fc::ecc::private_key& block_signing_private_key,
+            uint32_t skip
+            );
+
          void pop_block();
          void clear_pending();
 
@@ -168,10 +266,22 @@ namespace steemit { namespace chain {
 
          /**
           *  This signal is emitted for plugins to process every operation after it has been fully applied.
+          *
+          *  Neither operation signal is emitted for a block that apply_fork_block() redoes, the
+          *  objects its operations changed are restored from the redo state instead.  Plugins
+          *  that keep state outside of the database must rebuild it from pre_apply_block and
+          *  applied_block, which are still emitted.
           */
          fc::signal<void(const operation_object&)> pre_apply_operation;
          fc::signal<void(const operation_object&)> post_apply_operation;
 
+         /**
+          *  This signal is emitted when a block starts to be applied, before any of its
+          *  operations.  Operations emitted since the previous applied_block were those of
+          *  pending transactions.
+          */
+         fc::signal<void(const signed_block&)>           pre_apply_block;
+
          /**
           *  This signal is emitted after all operations and virtual operation for a
           *  block have been applied but before the get_applied_operations() are cleared.
@@ -335,12 +445,33 @@ namespace steemit { namespace chain {
           * can be reapplied at the proper time */
          std::deque< signed_transaction >       _popped_tx;
 
+         /** transactions applied to the pending state but not yet included in a block */
+         pending_transaction_pool               _pending_tx;
+
+
+         /** liquidity reward volume of an account, accumulated while an order is matched */
+         struct liquidity_reward_delta
+         {
+            account_id_type   owner;
+            int64_t           steem_volume = 0;
+            int64_t           sbd_volume = 0;
+         };
 
          bool apply_order( const limit_order_object& new_order_object );
          bool fill_order( const limit_order_object& order, const asset& pays, const asset& receives );
+         bool fill_order( const limit_order_object& order, const account_object& seller, const asset& pays, const asset& receives );
          void cancel_order( const limit_order_object& obj );
          int  match( const limit_order_object& bid, const limit_order_object& ask, const price& trade_price );
 
+         /**
+          *  Matches new_order, sold by new_seller, with old_order.  The liquidity reward volume
+          *  of both sellers is added to rewards instead of being applied, so an order matching
+          *  many others updates the liquidity reward balance of each seller once.
+          */
+         int  match( const limit_order_object& new_order, const account_object& new_seller, const limit_order_object& old_order,
+                     const price& match_price, vector< liquidity_reward_delta >& rewards );
+         void adjust_liquidity_rewards( const vector< liquidity_reward_delta >& rewards );
+
          void perform_vesting_share_split( uint32_t magnitude );
          void retally_witness_votes();
 
@@ -356,10 +487,31 @@ namespace steemit { namespace chain {
           */
    protected:
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
-         void pop_undo() { object_database::pop_undo(); }
+         void pop_undo( graphene::db::redo_state* redo = nullptr ) { object_database::pop_undo( redo ); }
          void notify_changed_objects();
 
       private:
+         struct read_lock_guard
+         {
+            read_lock_guard( const database& db );
+            ~read_lock_guard();
+
+            const database& _db;
+            bool            _locked = false;
+         };
+
+         struct write_lock_guard
+         {
+            write_lock_guard( database& db );
+            ~write_lock_guard();
+
+            database& _db;
+         };
+
+         mutable boost::shared_mutex            _state_mutex;
+         std::atomic< std::thread::id >         _write_lock_owner;
+         uint32_t                               _write_lock_depth = 0;
+
          optional<undo_database::session>       _pending_tx_session;
          vector< unique_ptr<op_evaluator> >     _operation_evaluators;
 
@@ -370,10 +522,31 @@ namespace steemit { namespace chain {
          void _apply_transaction( const signed_transaction& trx );
          void apply_operation( transaction_evaluation_state& eval_state, const operation& op );
 
+         ///Steps involved in generating a block
+         ///@{
+
+         /** the signing key is only checked when block_signing_private_key is not null */
+         void check_block_producer( fc::time_point_sec when, const string& witness_owner, const fc::ecc::private_key* block_signing_private_key )const;
+         /**
+          *  Rebuilds the pending state from the pending transactions that fit in a block at when,
+          *  block_size is set to the packed size of the block
+          */
+         vector< signed_transaction > apply_pending_transactions_for_block( fc::time_point_sec when, size_t& block_size );
+         signed_block finish_block( fc::time_point_sec when, const string& witness_owner,
+                                    const fc::ecc::private_key& block_signing_private_key,
+                                    const vector< signed_transaction >& transactions );
+
+         ///@}
 
          ///Steps involved in applying a new block
          ///@{
 
+         /**
+          *  applies a block of the fork being switched to, from its redo state if it was popped before,
+          *  in which case its operations are not evaluated and the operation signals are not emitted
+          */
+         void apply_fork_block( const item_ptr& item, uint32_t skip );
+
          const witness_object& validate_block_header( uint32_t skip, const signed_block& next_block )const;
          void create_block_summary(const signed_block& next_block);
 
@@ -395,7 +568,9 @@ namespace steemit { namespace chain {
 
          ///@}
 
-         vector< signed_transaction >  _pending_tx;
+         uint64_t calculate_pending_transaction_priority( const pending_transaction& trx )const;
+         fc::sha256 get_authority_digest( const account_object& a )const;
+
          fork_database                 _fork_db;
          fc::time_point_sec            _hardfork_times[ STEEMIT_NUM_HARDFORKS + 1 ];
          hardfork_version              _hardfork_versions[ STEEMIT_NUM_HARDFORKS + 1 ];
@@ -417,6 +592,9 @@ namespace steemit { namespace chain {
          uint16_t                          _current_op_in_trx    = 0;
          uint16_t                          _current_virtual_op   = 0;
 
+         /** digests of the authorities consulted by the most recent signature verification */
+         flat_map<string,fc::sha256>       _verified_authority_digests;
+
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
          node_property_object              _node_property_object;
@@ -45,9 +45,10 @@ struct skip_flags_restorer
  */
 struct pending_transactions_restorer
 {
-   pending_transactions_restorer( database& db, std::vector<signed_transaction>&& pending_transactions )
-      : _db(db), _pending_transactions( std::move(pending_transactions) )
+   pending_transactions_restorer( database& db )
+      : _db(db)
    {
+      _db._pending_tx.take( _pending_transactions );
       _db.clear_pending();
    }
 
@@ -65,28 +66,60 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
-      for( const signed_transaction& tx : _pending_transactions )
+
+      // Transactions that expired or made it into a block are dropped without being applied.  The
+      // rest are re-applied in arrival order until the execution limit is hit, anything left after
+      // that is kept in the pool without being applied and will be retried after the next block.
+      auto& stats = _db._pending_tx.statistics();
+      auto start = fc::time_point::now();
+      auto now = _db.head_block_time();
+      bool apply_trxs = true;
+      auto& pending_by_sequence = _pending_transactions.get< by_sequence >();
+      while( !pending_by_sequence.empty() )
       {
+         pending_transaction trx = *pending_by_sequence.begin();
+         pending_by_sequence.erase( pending_by_sequence.begin() );
+
+         if( trx.expiration() < now )
+         {
+            ++stats.expired;
+            continue;
+         }
+         if( _db.is_known_transaction( trx.id ) )
+         {
+            ++stats.included_in_block;
+            continue;
+         }
+
+         if( apply_trxs && fc::time_point::now() - start > STEEMIT_PENDING_TRANSACTION_EXECUTION_LIMIT )
+            apply_trxs = false;
+
+         if( !apply_trxs )
+         {
+            _db._pending_tx.insert( std::move( trx ) );
+            ++stats.postponed;
+            continue;
+         }
+
          try
          {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               // since push_transaction() takes a signed_transaction,
-               // the operation_results field will be ignored.
-               _db._push_transaction( tx );
-            }
+            _db._push_pending_transaction( std::move( trx ) );
+            ++stats.reapplied;
          }
          catch( const fc::exception& e )
          {
+            ++stats.invalidated;
             /*
             wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", _db.head_block_id())("t",_db.head_block_time()) );
             wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
             */
          }
       }
+      stats.last_reapply_time = ( fc::time_point::now() - start ).count();
    }
 
    database& _db;
-   std::vector< signed_transaction > _pending_transactions;
+   pending_transaction_multi_index_type _pending_transactions;
 };
 
 /**
@@ -116,10 +149,9 @@ void with_skip_flags(
 template< typename Lambda >
 void without_pending_transactions(
    database& db,
-   std::vector<signed_transaction>&& pending_transactions,
    Lambda callback )
 {
-    pending_transactions_restorer restorer( db, std::move(pending_transactions) );
+    pending_transactions_restorer restorer( db );
     callback();
     return;
 }
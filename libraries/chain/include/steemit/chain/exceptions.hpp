@@ -63,6 +63,8 @@ namespace steemit { namespace chain {
    FC_DECLARE_DERIVED_EXCEPTION( invalid_committee_approval,        steemit::chain::transaction_exception, 3030006, "committee account cannot directly approve transaction" )
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_fee,                  steemit::chain::transaction_exception, 3030007, "insufficient fee" )
    FC_DECLARE_DERIVED_EXCEPTION( tx_missing_posting_auth,           steemit::chain::transaction_exception, 3030008, "missing required posting authority" )
+   FC_DECLARE_DERIVED_EXCEPTION( pending_transaction_pool_full,     steemit::chain::transaction_exception, 3030009, "pending transaction pool is full" )
+   FC_DECLARE_DERIVED_EXCEPTION( pending_transaction_account_limit, steemit::chain::transaction_exception, 3030010, "too many pending transactions for account" )
 
    FC_DECLARE_DERIVED_EXCEPTION( pop_empty_chain,                   steemit::chain::undo_database_exception, 3070001, "there are no blocks to pop" )
 
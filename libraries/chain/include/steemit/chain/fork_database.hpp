@@ -1,6 +1,10 @@
 #pragma once
 #include <steemit/chain/protocol/block.hpp>
 
+#include <graphene/db/undo_database.hpp>
+
+#include <fc/io/raw.hpp>
+
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -15,7 +19,7 @@ namespace steemit { namespace chain {
    struct fork_item
    {
       fork_item( signed_block d )
-      :num(d.block_num()),id(d.id()),data( std::move(d) ){}
+      :num(d.block_num()),id(d.id()),packed_size(fc::raw::pack_size(d)),data( std::move(d) ){}
 
       block_id_type previous_id()const { return data.previous; }
 
@@ -26,11 +30,35 @@ namespace steemit { namespace chain {
        * building on top of it.
        */
       bool                  invalid = false;
+      /**
+       * The transactions of data have been released because the block is in the
+       * block log, only its header is kept.
+       */
+      bool                  pruned = false;
       block_id_type         id;
+      uint32_t              packed_size; // of the full block, initialized in ctor
       signed_block          data;
+      /**
+       * The changes applying this block made, kept when it is popped so
+       * it can be applied again without being executed.
+       */
+      shared_ptr< graphene::db::redo_state > redo;
    };
    typedef shared_ptr<fork_item> item_ptr;
 
+   struct fork_database_statistics
+   {
+      uint32_t blocks = 0;
+      uint32_t full_blocks = 0;
+      uint32_t unlinked_blocks = 0;
+      uint32_t redo_blocks = 0;
+      uint32_t head_block_num = 0;
+      uint32_t oldest_block_num = 0;
+
+      /** the packed size of the blocks whose transactions are kept in memory */
+      uint64_t full_block_size = 0;
+   };
+
 
    /**
     *  As long as blocks are pushed in order the fork
@@ -41,6 +69,13 @@ namespace steemit { namespace chain {
     *
     *  Every time a block is pushed into the fork DB the
     *  block with the highest block_num will be returned.
+    *
+    *  Blocks of the applied chain more than FULL_BLOCK_DEPTH
+    *  blocks below its head are already in the block log, so
+    *  prune_blocks() releases their transactions and only their
+    *  headers are kept, which is all that finding the branches
+    *  of a fork needs.  A pruned block gets its transactions
+    *  back from restore_block() when it is popped.
     */
    class fork_database
    {
@@ -48,6 +83,8 @@ namespace steemit { namespace chain {
          typedef vector<item_ptr> branch_type;
          /// The maximum number of blocks that may be skipped in an out-of-order push
          const static int MAX_BLOCK_REORDERING = 1024;
+         /// The number of blocks below the head of the applied chain that are kept in full
+         const static uint32_t FULL_BLOCK_DEPTH = 32;
 
          fork_database();
          void reset();
@@ -66,6 +103,17 @@ namespace steemit { namespace chain {
          shared_ptr<fork_item>            head()const { return _head; }
          void                             pop_block();
 
+         /**
+          *  Releases the transactions of the blocks more than FULL_BLOCK_DEPTH
+          *  blocks below head_id, which must be the head of the applied chain.
+          */
+         void                             prune_blocks( const block_id_type& head_id );
+
+         /** Puts back the transactions of b if they were released by prune_blocks() */
+         void                             restore_block( const signed_block& b );
+
+         fork_database_statistics         get_statistics()const;
+
          /**
           *  Given two head blocks, return two branches of the fork graph that
           *  end with a common ancestor (same prior block)
@@ -99,3 +147,6 @@ namespace steemit { namespace chain {
          shared_ptr<fork_item>    _head;
    };
 } } // steemit::chain
+
+FC_REFLECT( steemit::chain::fork_database_statistics,
+            (blocks)(full_blocks)(unlinked_blocks)(redo_blocks)(head_block_num)(oldest_block_num)(full_block_size) )
@@ -53,27 +53,43 @@ namespace steemit { namespace chain {
        >
    > operation_multi_index_type;
 
+   /**
+    *  An operation in the history of an account.  sequence numbers all operations of the account,
+    *  op_sequence only those of the same type, so the history can be paged by either without
+    *  scanning the other operations.
+    */
    class account_history_object : public abstract_object<account_history_object> {
       public:
          static const uint8_t space_id = implementation_ids;
          static const uint8_t type_id  = impl_account_history_object_type;
 
-         string            account;
+         account_id_type   account;
          uint32_t          sequence = 0;
+         uint16_t          op_type = 0; ///< operation::which() of op
+         uint32_t          op_sequence = 0;
          operation_id_type op;
    };
 
    struct by_account;
+   struct by_account_op_type;
    typedef multi_index_container<
       account_history_object,
       indexed_by<
          ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
          ordered_unique< tag< by_account >,
             composite_key< account_history_object,
-               member< account_history_object, string, &account_history_object::account>,
+               member< account_history_object, account_id_type, &account_history_object::account>,
                member< account_history_object, uint32_t, &account_history_object::sequence>
             >,
-            composite_key_compare< std::less<string>, std::greater<uint32_t> >
+            composite_key_compare< std::less<account_id_type>, std::greater<uint32_t> >
+         >,
+         ordered_unique< tag< by_account_op_type >,
+            composite_key< account_history_object,
+               member< account_history_object, account_id_type, &account_history_object::account>,
+               member< account_history_object, uint16_t, &account_history_object::op_type>,
+               member< account_history_object, uint32_t, &account_history_object::op_sequence>
+            >,
+            composite_key_compare< std::less<account_id_type>, std::less<uint16_t>, std::greater<uint32_t> >
          >
       >
    > account_history_multi_index_type;
@@ -83,4 +99,4 @@ namespace steemit { namespace chain {
 } }
 
 FC_REFLECT_DERIVED( steemit::chain::operation_object, (graphene::db::object), (trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(op) )
-FC_REFLECT_DERIVED( steemit::chain::account_history_object, (graphene::db::object), (account)(sequence)(op) )
+FC_REFLECT_DERIVED( steemit::chain::account_history_object, (graphene::db::object), (account)(sequence)(op_type)(op_sequence)(op) )
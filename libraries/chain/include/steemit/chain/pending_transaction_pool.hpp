@@ -0,0 +1,161 @@
+#pragma once
+#include <steemit/chain/protocol/transaction.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+namespace steemit { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   /**
+    *  A transaction waiting to be included in a block, along with the
+    *  bookkeeping the pool needs to order, limit and cheaply re-validate it.
+    */
+   struct pending_transaction
+   {
+      signed_transaction           trx;
+      transaction_id_type          id;
+
+      /** the first account whose authority the transaction requires, used for per account limits */
+      string                       account;
+
+      /** arrival order, pending transactions are always (re)applied in this order */
+      uint64_t                     sequence = 0;
+      uint32_t                     packed_size = 0;
+
+      /**
+       *  Steem has no transaction fees, so priority is derived from how much of its
+       *  bandwidth allowance the account has left.  Lower priority transactions are
+       *  evicted first when the pool is full.
+       */
+      uint64_t                     priority = 0;
+
+      /**
+       *  Digest of the owner/active/posting authorities of every account consulted the
+       *  last time the signatures of this transaction were verified.  As long as these
+       *  are unchanged the transaction may be re-applied without checking signatures.
+       */
+      flat_map< string, fc::sha256 > authority_digests;
+
+      time_point_sec expiration()const { return trx.expiration; }
+   };
+
+   struct pending_transaction_pool_statistics
+   {
+      uint32_t pending_count = 0;
+      uint64_t pending_size = 0;
+
+      uint64_t accepted = 0;
+      uint64_t rejected_pool_full = 0;
+      uint64_t rejected_account_limit = 0;
+      uint64_t evicted = 0;
+      uint64_t expired = 0;
+      uint64_t included_in_block = 0;
+      uint64_t invalidated = 0;
+      uint64_t reapplied = 0;
+      uint64_t reapplied_without_signature_check = 0;
+      uint64_t postponed = 0;
+
+      /** wall time spent re-applying the pool after the most recent block, in microseconds */
+      int64_t  last_reapply_time = 0;
+   };
+
+   struct by_trx_id;
+   struct by_sequence;
+   struct by_expiration;
+   struct by_account;
+   struct by_priority;
+   typedef multi_index_container<
+      pending_transaction,
+      indexed_by<
+         ordered_unique< tag< by_sequence >, member< pending_transaction, uint64_t, &pending_transaction::sequence > >,
+         hashed_unique< tag< by_trx_id >, member< pending_transaction, transaction_id_type, &pending_transaction::id >, std::hash< transaction_id_type > >,
+         ordered_non_unique< tag< by_expiration >, const_mem_fun< pending_transaction, time_point_sec, &pending_transaction::expiration > >,
+         ordered_unique< tag< by_account >,
+            composite_key< pending_transaction,
+               member< pending_transaction, string, &pending_transaction::account >,
+               member< pending_transaction, uint64_t, &pending_transaction::sequence >
+            >
+         >,
+         ordered_unique< tag< by_priority >,
+            composite_key< pending_transaction,
+               member< pending_transaction, uint64_t, &pending_transaction::priority >,
+               member< pending_transaction, uint64_t, &pending_transaction::sequence >
+            >,
+            composite_key_compare< std::less< uint64_t >, std::greater< uint64_t > >
+         >
+      >
+   > pending_transaction_multi_index_type;
+
+   /**
+    *  Holds the transactions that have been accepted into the pending state but
+    *  are not yet part of a block.  The pool only does bookkeeping; applying the
+    *  transactions to the pending state is left to the database.
+    *
+    *  The pool enforces limits on the number of transactions, their total size
+    *  and the number of transactions per account.  When full, a new transaction
+    *  is only accepted if it has a higher priority than the lowest priority
+    *  pending transaction, which is evicted to make room.  The effects of an
+    *  evicted transaction remain in the pending state until it is rebuilt after
+    *  the next block, but it will not be re-applied or included in a block.
+    */
+   class pending_transaction_pool
+   {
+      public:
+         pending_transaction_pool();
+
+         void set_limits( uint32_t max_transactions, uint64_t max_size, uint32_t max_transactions_per_account );
+
+         bool                       contains( const transaction_id_type& id )const;
+         const pending_transaction* find( const transaction_id_type& id )const;
+
+         /**
+          *  Throws if there is no room for the transaction, see class description.
+          *  Should be called before the transaction is applied to avoid wasted work.
+          */
+         void check_capacity( const pending_transaction& trx );
+
+         /**
+          *  Adds a transaction to the pool, evicting lower priority transactions
+          *  if needed.  Transactions without a sequence number are assigned the
+          *  next one, transactions restored after a block keep theirs.
+          */
+         void insert( pending_transaction&& trx );
+
+         /** Moves every pending transaction into result, leaving the pool empty */
+         void take( pending_transaction_multi_index_type& result );
+         void clear();
+
+         const pending_transaction_multi_index_type& indices()const { return _index; }
+         size_t   size()const          { return _index.size(); }
+         bool     empty()const         { return _index.empty(); }
+         uint64_t size_in_bytes()const { return _size_in_bytes; }
+
+         pending_transaction_pool_statistics&      statistics()          { return _statistics; }
+         pending_transaction_pool_statistics       get_statistics()const;
+
+      private:
+         void erase_lowest_priority();
+
+         uint32_t                              _max_transactions;
+         uint64_t                              _max_size;
+         uint32_t                              _max_transactions_per_account;
+
+         uint64_t                              _next_sequence = 1;
+         uint64_t                              _size_in_bytes = 0;
+         pending_transaction_multi_index_type  _index;
+         pending_transaction_pool_statistics   _statistics;
+   };
+
+} } // steemit::chain
+
+FC_REFLECT( steemit::chain::pending_transaction_pool_statistics,
+            (pending_count)(pending_size)
+            (accepted)(rejected_pool_full)(rejected_account_limit)(evicted)(expired)
+            (included_in_block)(invalidated)(reapplied)(reapplied_without_signature_check)(postponed)
+            (last_reapply_time) )
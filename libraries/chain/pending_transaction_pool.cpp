@@ -0,0 +1,113 @@
+#include <steemit/chain/pending_transaction_pool.hpp>
+#include <steemit/chain/exceptions.hpp>
+
+namespace steemit { namespace chain {
+
+pending_transaction_pool::pending_transaction_pool()
+   : _max_transactions( STEEMIT_MAX_PENDING_TRANSACTIONS ),
+     _max_size( STEEMIT_MAX_PENDING_TRANSACTIONS_SIZE ),
+     _max_transactions_per_account( STEEMIT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT )
+{
+}
+
+void pending_transaction_pool::set_limits( uint32_t max_transactions, uint64_t max_size, uint32_t max_transactions_per_account )
+{
+   _max_transactions = max_transactions;
+   _max_size = max_size;
+   _max_transactions_per_account = max_transactions_per_account;
+}
+
+bool pending_transaction_pool::contains( const transaction_id_type& id )const
+{
+   return find( id ) != nullptr;
+}
+
+const pending_transaction* pending_transaction_pool::find( const transaction_id_type& id )const
+{
+   const auto& by_id = _index.get< by_trx_id >();
+   auto itr = by_id.find( id );
+   if( itr == by_id.end() )
+      return nullptr;
+   return &*itr;
+}
+
+void pending_transaction_pool::check_capacity( const pending_transaction& trx )
+{
+   if( _max_transactions_per_account && trx.account.size() )
+   {
+      const auto& by_acct = _index.get< by_account >();
+      auto range = by_acct.equal_range( boost::make_tuple( trx.account ) );
+      if( size_t( std::distance( range.first, range.second ) ) >= _max_transactions_per_account )
+      {
+         ++_statistics.rejected_account_limit;
+         FC_THROW_EXCEPTION( pending_transaction_account_limit, "account ${a} already has ${n} pending transactions",
+                             ("a", trx.account)("n", _max_transactions_per_account) );
+      }
+   }
+
+   bool full = ( _max_transactions && _index.size() >= _max_transactions )
+            || ( _max_size && _size_in_bytes + trx.packed_size > _max_size );
+   if( !full )
+      return;
+
+   const auto& by_prio = _index.get< by_priority >();
+   if( by_prio.empty() || by_prio.begin()->priority >= trx.priority )
+   {
+      ++_statistics.rejected_pool_full;
+      FC_THROW_EXCEPTION( pending_transaction_pool_full, "pending transaction pool is full",
+                          ("pending", _index.size())("size", _size_in_bytes)("priority", trx.priority) );
+   }
+}
+
+void pending_transaction_pool::erase_lowest_priority()
+{
+   auto& by_prio = _index.get< by_priority >();
+   auto itr = by_prio.begin();
+   _size_in_bytes -= itr->packed_size;
+   by_prio.erase( itr );
+   ++_statistics.evicted;
+}
+
+void pending_transaction_pool::insert( pending_transaction&& trx )
+{
+   if( trx.sequence == 0 )
+      trx.sequence = _next_sequence++;
+
+   uint32_t packed_size = trx.packed_size;
+   auto result = _index.insert( std::move( trx ) );
+   FC_ASSERT( result.second, "transaction is already pending" );
+   _size_in_bytes += packed_size;
+
+   // Never evict the transaction we just inserted, check_capacity() has already ensured it outranks the rest
+   while( _index.size() > 1 &&
+          ( ( _max_transactions && _index.size() > _max_transactions ) ||
+            ( _max_size && _size_in_bytes > _max_size ) ) )
+   {
+      if( &*_index.get< by_priority >().begin() == &*result.first )
+         break;
+      erase_lowest_priority();
+   }
+}
+
+void pending_transaction_pool::take( pending_transaction_multi_index_type& result )
+{
+   result.clear();
+   result.swap( _index );
+   _size_in_bytes = 0;
+}
+
+void pending_transaction_pool::clear()
+{
+   _index.clear();
+   _size_in_bytes = 0;
+}
+
+pending_transaction_pool_statistics pending_transaction_pool::get_statistics()const
+{
+   pending_transaction_pool_statistics result = _statistics;
+   result.pending_count = _index.size();
+   result.pending_size = _size_in_bytes;
+   return result;
+}
+
+} } // steemit::chain
@@ -267,6 +267,18 @@ namespace graphene { namespace db {
          }
 
 
+         /**
+          *  used to put back objects when changes are undone or redone, secondary indexes are
+          *  updated but index observers are not notified of the insertion
+          */
+         virtual const object&  insert( object&& obj )override
+         {
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             const auto& result = DerivedIndex::create( constructor );
@@ -141,7 +141,7 @@ namespace graphene { namespace db {
             return static_cast<IndexType*>(_index[ObjectType::space_id][ObjectType::type_id].get());
          }
 
-         void pop_undo();
+         void pop_undo( redo_state* redo = nullptr );
 
          fc::path get_data_dir()const { return _data_dir; }
 
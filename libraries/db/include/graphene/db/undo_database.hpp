@@ -40,6 +40,18 @@ namespace graphene { namespace db {
       unordered_map<object_id_type, unique_ptr<object> > removed;
    };
 
+   /**
+    *  The changes of a committed undo state, captured when it is popped so they can be
+    *  made again by undo_database::redo() without repeating whatever made them.
+    */
+   struct redo_state
+   {
+      vector< unique_ptr<object> >                   new_values; ///< modified objects, after the changes
+      vector< unique_ptr<object> >                   created;
+      vector< object_id_type >                       removed;
+      unordered_map<object_id_type, object_id_type>  new_index_next_ids;
+   };
+
 
    /**
     * @class undo_database
@@ -123,8 +135,19 @@ namespace graphene { namespace db {
           *  note... this is dangerous if there are
           *  active sessions... thus active sessions should
           *  track
+          *
+          *  When redo is given the changes of the session are
+          *  stored in it before they are undone.
+          */
+         void pop_commit( redo_state* redo = nullptr );
+
+         /**
+          *  Makes the changes of redo in the current session, which can undo them again.  The
+          *  state must be the one the changes were popped from by pop_commit().  Objects are
+          *  removed and modified through the database, which notifies index observers, while
+          *  created objects are inserted like undo() does, which only updates secondary indexes.
           */
-         void pop_commit();
+         void redo( redo_state&& redo );
 
          std::size_t size()const { return _stack.size(); }
          void set_max_size(size_t new_max_size) { _max_size = new_max_size; }
@@ -102,9 +102,9 @@ void object_database::open(const fc::path& data_dir)
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
 
-void object_database::pop_undo()
+void object_database::pop_undo( redo_state* redo )
 { try {
-   _undo_db.pop_commit();
+   _undo_db.pop_commit( redo );
 } FC_CAPTURE_AND_RETHROW() }
 
 void object_database::save_undo( const object& obj )
@@ -244,7 +244,7 @@ void undo_database::commit()
    --_active_sessions;
 }
 
-void undo_database::pop_commit()
+void undo_database::pop_commit( redo_state* redo )
 {
    FC_ASSERT( _active_sessions == 0 );
    FC_ASSERT( !_stack.empty() );
@@ -253,6 +253,21 @@ void undo_database::pop_commit()
    try {
       auto& state = _stack.back();
 
+      if( redo != nullptr )
+      {
+         redo->new_values.reserve( state.old_values.size() );
+         for( auto& item : state.old_values )
+            redo->new_values.push_back( _db.get_object( item.first ).clone() );
+         redo->created.reserve( state.new_ids.size() );
+         for( auto& id : state.new_ids )
+            redo->created.push_back( _db.get_object( id ).clone() );
+         redo->removed.reserve( state.removed.size() );
+         for( auto& item : state.removed )
+            redo->removed.push_back( item.first );
+         for( auto& item : state.old_index_next_ids )
+            redo->new_index_next_ids[item.first] = _db.get_mutable_index( item.first.space(), item.first.type() ).get_next_id();
+      }
+
       for( auto& item : state.old_values )
       {
          _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
@@ -281,6 +296,35 @@ void undo_database::pop_commit()
    }
    enable();
 }
+void undo_database::redo( redo_state&& redo )
+{ try {
+   FC_ASSERT( !_disabled );
+   FC_ASSERT( _active_sessions > 0 );
+   auto& state = _stack.back();
+
+   // removals first and insertions last, so unique keys the changes moved are free
+   for( auto& id : redo.removed )
+      _db.remove( _db.get_object( id ) );
+
+   for( auto& item : redo.new_values )
+      _db.modify( _db.get_object( item->id ), [&]( object& obj ){ obj.move_from( *item ); } );
+
+   for( auto& item : redo.new_index_next_ids )
+   {
+      auto& index = _db.get_mutable_index( item.first.space(), item.first.type() );
+      if( state.old_index_next_ids.find( item.first ) == state.old_index_next_ids.end() )
+         state.old_index_next_ids[item.first] = index.get_next_id();
+      index.set_next_id( item.second );
+   }
+
+   for( auto& item : redo.created )
+   {
+      auto id = item->id;
+      _db.insert( std::move(*item) );
+      state.new_ids.insert( id );
+   }
+} FC_CAPTURE_AND_RETHROW() }
+
 const undo_state& undo_database::head()const
 {
    FC_ASSERT( !_stack.empty() );
@@ -68,6 +68,17 @@
  */
 #define GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS        5
 
+/**
+ * Independent of the block-based expiration above, messages are dropped
+ * from the cache once they are this old, or (oldest first) once the
+ * cache holds more than this many bytes of messages.  This keeps a
+ * transaction flood from growing the cache without bound when blocks
+ * are slow to arrive.  Both limits can be changed at runtime through
+ * set_advanced_node_parameters; zero disables the limit.
+ */
+#define GRAPHENE_NET_MESSAGE_CACHE_MAX_AGE_IN_SECONDS        (GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS * 3 * 2)
+#define GRAPHENE_NET_MESSAGE_CACHE_MAX_SIZE_IN_BYTES         (64 * 1024 * 1024)
+
 /**
  * We prevent a peer from offering us a list of blocks which, if we fetched them
  * all, would result in a blockchain that extended into the future.
@@ -103,3 +114,59 @@
 #define GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH               10000
 
 #define GRAPHENE_NET_MAX_TRX_PER_SECOND                      1000
+
+/**
+ * Peers are scored from 0 to GRAPHENE_NET_PEER_SCORE_MAX based on how quickly
+ * they answer our requests and how much inventory they push at us.  Peers we
+ * know nothing about start out at GRAPHENE_NET_PEER_SCORE_NEUTRAL.
+ */
+#define GRAPHENE_NET_PEER_SCORE_MAX                          1000
+#define GRAPHENE_NET_PEER_SCORE_NEUTRAL                      500
+
+/**
+ * A peer answering requests in this many milliseconds, or delivering items at
+ * this many bytes per second, gets half of the points available for each.
+ */
+#define GRAPHENE_NET_PEER_SCORE_REFERENCE_LATENCY_MS         500
+#define GRAPHENE_NET_PEER_SCORE_REFERENCE_THROUGHPUT         (64 * 1024)
+
+/**
+ * Weight of the history in the moving averages of latency and throughput, a
+ * new sample counts for 1/GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT of the average
+ */
+#define GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT                8
+
+/** a timed out request counts as this many successfully received items */
+#define GRAPHENE_NET_PEER_SCORE_TIMEOUT_WEIGHT               10
+
+/** points deducted for each inventory flood on record */
+#define GRAPHENE_NET_PEER_SCORE_FLOOD_PENALTY                100
+
+/**
+ * A peer at the neutral score may advertise GRAPHENE_NET_MAX_TRX_PER_SECOND
+ * transactions per second, bursting up to this many seconds worth at once.
+ * The allowance scales with the score, but never drops below
+ * GRAPHENE_NET_MIN_TRX_INVENTORY_PER_SECOND.
+ */
+#define GRAPHENE_NET_TRX_INVENTORY_BURST_SECONDS             5
+#define GRAPHENE_NET_MIN_TRX_INVENTORY_PER_SECOND            50
+
+/**
+ * New transactions are collected for up to this many milliseconds before being
+ * advertised, so they go out in a few larger inventory messages instead of one
+ * message per transaction per peer.  Blocks are always advertised immediately,
+ * and a batch is sent early once it reaches GRAPHENE_NET_MAX_INVENTORY_BATCH_SIZE
+ * items, which is also the most items we put in a single inventory message.
+ */
+#define GRAPHENE_NET_INVENTORY_ADVERTISEMENT_INTERVAL_MS     100
+#define GRAPHENE_NET_MAX_INVENTORY_BATCH_SIZE                1000
+
+/**
+ * Sizing of the per-peer filter of items the peer is known to have.  A generation
+ * lasts GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES; with these values each peer
+ * uses 80KiB and the false positive rate stays around 1% up to roughly 270 items
+ * per second.
+ */
+#define GRAPHENE_NET_INVENTORY_FILTER_ITEMS_PER_GENERATION   32768
+#define GRAPHENE_NET_INVENTORY_FILTER_BITS_PER_ITEM          10
+#define GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT             4
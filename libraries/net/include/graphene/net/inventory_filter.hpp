@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/config.hpp>
+
+#include <fc/time.hpp>
+
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * A compact, approximate set of the items a peer is known to have, either because
+   * we advertised them to the peer or the peer advertised them to us.
+   *
+   * Like a bloom filter, might_contain() can return true for an item that was never
+   * inserted, but it never returns false for an item inserted within the last
+   * generation_duration.  It is used to skip the exact (and much larger) inventory
+   * sets in the common case of an item the peer has never heard of; positive answers
+   * must be confirmed against those sets.
+   *
+   * The filter keeps two generations of bits.  When the current generation is older
+   * than generation_duration the older one is cleared and becomes the current one, so
+   * old items are forgotten in bulk without tracking when each was inserted.  If more
+   * than expected_items_per_generation items are inserted in one generation the false
+   * positive rate goes up, but the filter stays correct.
+   */
+  class inventory_filter
+  {
+  public:
+    inventory_filter(const fc::microseconds& generation_duration = fc::minutes(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES),
+                     uint32_t expected_items_per_generation = GRAPHENE_NET_INVENTORY_FILTER_ITEMS_PER_GENERATION);
+
+    void insert(const item_id& item);
+    bool might_contain(const item_id& item) const;
+    void clear();
+
+    /** bytes used by the bit arrays */
+    size_t size_in_bytes() const;
+
+  private:
+    void get_bit_indices(const item_id& item, uint32_t (&bit_indices)[GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT]) const;
+    static bool test_bit(const std::vector<uint64_t>& bits, uint32_t bit_index);
+
+    fc::microseconds      _generation_duration;
+    uint32_t              _number_of_bits;
+    std::vector<uint64_t> _generations[2];
+    unsigned              _current_generation;
+    fc::time_point        _current_generation_start_time;
+  };
+
+} } // end namespace graphene::net
@@ -288,6 +288,18 @@ namespace graphene { namespace net {
         fc::variant_object network_get_info() const;
         fc::variant_object network_get_usage_stats() const;
 
+        /**
+         * Returns the size of the cache of recently broadcast messages along with
+         * its hit, miss, and eviction counters
+         */
+        fc::variant_object get_message_cache_statistics() const;
+
+        /**
+         * Returns counters describing how inventory is batched and deduplicated, along
+         * with the bandwidth and time the p2p layer spends per relayed transaction
+         */
+        fc::variant_object get_inventory_statistics() const;
+
         std::vector<potential_peer_record> get_potential_peers() const;
 
         void disable_peer_advertising();
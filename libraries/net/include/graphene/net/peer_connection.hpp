@@ -25,6 +25,7 @@
 
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/inventory_filter.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
@@ -251,6 +252,7 @@ namespace graphene { namespace net
                                                                                                                  boost::multi_index::member<timestamped_item_id, fc::time_point_sec, &timestamped_item_id::timestamp> > > > timestamped_items_set_type;
       timestamped_items_set_type inventory_peer_advertised_to_us;
       timestamped_items_set_type inventory_advertised_to_peer;
+      inventory_filter known_inventory; /// everything added to the two sets above, checked first to avoid most set lookups
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
       /// @}
@@ -259,6 +261,14 @@ namespace graphene { namespace net
       // blockchain catch up
       fc::time_point transaction_fetching_inhibited_until;
 
+      /// latency/throughput measurements used to score this peer, loaded from and saved back to the peer database
+      peer_performance_record performance;
+
+      /// number of transactions this peer may still advertise to us before we start ignoring its inventory,
+      /// refilled over time at a rate that depends on the peer's score
+      uint64_t trx_inventory_allowance;
+      fc::time_point trx_inventory_allowance_update_time;
+
       uint32_t last_known_fork_block_number;
 
       fc::future<void> accept_or_connect_task_done;
@@ -303,6 +313,8 @@ namespace graphene { namespace net
       bool idle();
 
       bool is_transaction_fetching_inhibited() const;
+      /** returns how many of the next number_of_items transactions the peer advertises we are willing to accept */
+      uint32_t take_trx_inventory_allowance(uint32_t number_of_items);
       fc::sha512 get_shared_secret() const;
       void clear_old_inventory();
       bool is_inventory_advertised_to_us_list_full_for_transactions() const;
@@ -43,6 +43,38 @@ namespace graphene { namespace net {
     last_connection_succeeded
   };
 
+  /**
+   * Running measurements of how well a peer has served us.  These are kept in the
+   * peer database across connections so we can favor fast, well-behaved peers as
+   * soon as we reconnect to them.
+   */
+  struct peer_performance_record
+  {
+    uint32_t                          average_latency_ms; /// moving average of the delay between requesting an item and receiving it
+    uint32_t                          average_throughput; /// moving average of the bytes per second at which requested items arrived
+    uint32_t                          number_of_items_received;
+    uint32_t                          number_of_requests_timed_out;
+    uint32_t                          number_of_inventory_floods; /// times the peer advertised more transactions than we allow
+
+    peer_performance_record() :
+      average_latency_ms(0),
+      average_throughput(0),
+      number_of_items_received(0),
+      number_of_requests_timed_out(0),
+      number_of_inventory_floods(0)
+    {}
+
+    void record_item_received(const fc::microseconds& latency, size_t size_in_bytes);
+    void record_request_timed_out();
+    void record_inventory_flood();
+
+    /** halves the counters so old (mis)behavior weighs less, called whenever we connect to the peer again */
+    void age();
+
+    /** a value between 0 and GRAPHENE_NET_PEER_SCORE_MAX, higher is better */
+    uint32_t score() const;
+  };
+
   struct potential_peer_record
   {
     fc::ip::endpoint                  endpoint;
@@ -52,6 +84,7 @@ namespace graphene { namespace net {
     uint32_t                          number_of_successful_connection_attempts;
     uint32_t                          number_of_failed_connection_attempts;
     fc::optional<fc::exception>       last_error;
+    peer_performance_record           performance;
 
     potential_peer_record() :
       number_of_successful_connection_attempts(0),
@@ -119,4 +152,5 @@ namespace graphene { namespace net {
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error) )
+FC_REFLECT(graphene::net::peer_performance_record, (average_latency_ms)(average_throughput)(number_of_items_received)(number_of_requests_timed_out)(number_of_inventory_floods) )
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error)(performance) )
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/inventory_filter.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  inventory_filter::inventory_filter(const fc::microseconds& generation_duration, uint32_t expected_items_per_generation) :
+    _generation_duration(generation_duration),
+    _number_of_bits(std::max<uint32_t>(expected_items_per_generation, 1) * GRAPHENE_NET_INVENTORY_FILTER_BITS_PER_ITEM),
+    _current_generation(0),
+    _current_generation_start_time(fc::time_point::now())
+  {
+    for (std::vector<uint64_t>& generation : _generations)
+      generation.resize((_number_of_bits + 63) / 64);
+  }
+
+  void inventory_filter::get_bit_indices(const item_id& item, uint32_t (&bit_indices)[GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT]) const
+  {
+    // item hashes are already uniformly distributed except for the first word, which holds
+    // the block number in block ids, so we can take our indices straight from the remaining words
+    static_assert(GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT <= 4, "an item hash only has four usable words");
+    for (unsigned i = 0; i < GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT; ++i)
+      bit_indices[i] = (item.item_hash._hash[i + 1] ^ (item.item_type * 0x9e3779b9)) % _number_of_bits;
+  }
+
+  bool inventory_filter::test_bit(const std::vector<uint64_t>& bits, uint32_t bit_index)
+  {
+    return (bits[bit_index / 64] & (uint64_t(1) << (bit_index % 64))) != 0;
+  }
+
+  void inventory_filter::insert(const item_id& item)
+  {
+    fc::time_point now = fc::time_point::now();
+    if (now - _current_generation_start_time >= _generation_duration)
+    {
+      _current_generation ^= 1;
+      std::fill(_generations[_current_generation].begin(), _generations[_current_generation].end(), 0);
+      _current_generation_start_time = now;
+    }
+
+    uint32_t bit_indices[GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT];
+    get_bit_indices(item, bit_indices);
+    std::vector<uint64_t>& bits = _generations[_current_generation];
+    for (uint32_t bit_index : bit_indices)
+      bits[bit_index / 64] |= uint64_t(1) << (bit_index % 64);
+  }
+
+  bool inventory_filter::might_contain(const item_id& item) const
+  {
+    uint32_t bit_indices[GRAPHENE_NET_INVENTORY_FILTER_HASH_COUNT];
+    get_bit_indices(item, bit_indices);
+    for (const std::vector<uint64_t>& bits : _generations)
+    {
+      bool all_bits_set = true;
+      for (uint32_t bit_index : bit_indices)
+        if (!test_bit(bits, bit_index))
+        {
+          all_bits_set = false;
+          break;
+        }
+      if (all_bits_set)
+        return true;
+    }
+    return false;
+  }
+
+  void inventory_filter::clear()
+  {
+    for (std::vector<uint64_t>& generation : _generations)
+      std::fill(generation.begin(), generation.end(), 0);
+    _current_generation = 0;
+    _current_generation_start_time = fc::time_point::now();
+  }
+
+  size_t inventory_filter::size_in_bytes() const
+  {
+    return (_generations[0].size() + _generations[1].size()) * sizeof(uint64_t);
+  }
+
+} } // end namespace graphene::net
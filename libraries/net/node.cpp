@@ -123,6 +123,13 @@ namespace graphene { namespace net {
   namespace detail
   {
     namespace bmi = boost::multi_index;
+    /**
+     * Holds messages we've broadcast so we can serve them to peers that request them
+     * after seeing our inventory.  Messages expire after a number of blocks have been
+     * accepted, after a fixed age, or (oldest first) once the total size of the cached
+     * messages exceeds a byte limit, so a flood of transactions can't grow the cache
+     * without bound.
+     */
     class blockchain_tied_message_cache
     {
     private:
@@ -131,11 +138,14 @@ namespace graphene { namespace net {
       struct message_hash_index{};
       struct message_contents_hash_index{};
       struct block_clock_index{};
+      struct insertion_order_index{};
       struct message_info
       {
         message_hash_type message_hash;
         message           message_body;
         uint32_t          block_clock_when_received;
+        fc::time_point    time_when_cached;
+        size_t            size_in_bytes; // approximate memory used by this entry, used for the cache's byte accounting
 
         // for network performance stats
         message_propagation_data propagation_data;
@@ -149,27 +159,52 @@ namespace graphene { namespace net {
           message_hash( message_hash ),
           message_body( message_body ),
           block_clock_when_received( block_clock_when_received ),
+          time_when_cached( fc::time_point::now() ),
+          size_in_bytes( sizeof(message_info) + message_body.data.size() ),
           propagation_data( propagation_data ),
           message_contents_hash( message_contents_hash )
         {}
       };
       typedef boost::multi_index_container
         < message_info,
-            bmi::indexed_by< bmi::ordered_unique< bmi::tag<message_hash_index>,
-                                                  bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
-                                                      bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
+            bmi::indexed_by< bmi::hashed_unique< bmi::tag<message_hash_index>,
+                                                 bmi::member<message_info, message_hash_type, &message_info::message_hash>,
+                                                 std::hash<message_hash_type> >,
+                             bmi::hashed_non_unique< bmi::tag<message_contents_hash_index>,
+                                                     bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash>,
+                                                     std::hash<fc::uint160_t> >,
                              bmi::ordered_non_unique< bmi::tag<block_clock_index>,
-                                                      bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
+                                                      bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> >,
+                             bmi::sequenced< bmi::tag<insertion_order_index> > >
         > message_cache_container;
 
       message_cache_container _message_cache;
 
       uint32_t block_clock;
 
+      size_t   _max_size_in_bytes;
+      uint32_t _max_age_in_seconds;
+      size_t   _total_size_in_bytes;
+
+      uint64_t _hit_count;
+      uint64_t _miss_count;
+      uint64_t _expired_count;
+      uint64_t _evicted_for_size_count;
+
+      void erase_oldest_message();
+      void expire_old_messages();
+      void enforce_size_limit();
+
     public:
       blockchain_tied_message_cache() :
-        block_clock( 0 )
+        block_clock( 0 ),
+        _max_size_in_bytes( GRAPHENE_NET_MESSAGE_CACHE_MAX_SIZE_IN_BYTES ),
+        _max_age_in_seconds( GRAPHENE_NET_MESSAGE_CACHE_MAX_AGE_IN_SECONDS ),
+        _total_size_in_bytes( 0 ),
+        _hit_count( 0 ),
+        _miss_count( 0 ),
+        _expired_count( 0 ),
+        _evicted_for_size_count( 0 )
       {}
       void block_accepted();
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
@@ -177,14 +212,66 @@ namespace graphene { namespace net {
       message get_message( const message_hash_type& hash_of_message_to_lookup );
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
+      size_t size_in_bytes() const { return _total_size_in_bytes; }
+
+      void set_max_size_in_bytes( size_t max_size_in_bytes );
+      size_t get_max_size_in_bytes() const { return _max_size_in_bytes; }
+      void set_max_age_in_seconds( uint32_t max_age_in_seconds );
+      uint32_t get_max_age_in_seconds() const { return _max_age_in_seconds; }
+
+      fc::variant_object get_statistics() const;
     };
 
+    void blockchain_tied_message_cache::erase_oldest_message()
+    {
+      auto& insertion_order = _message_cache.get<insertion_order_index>();
+      assert( !insertion_order.empty() );
+      _total_size_in_bytes -= insertion_order.front().size_in_bytes;
+      insertion_order.pop_front();
+    }
+
+    void blockchain_tied_message_cache::expire_old_messages()
+    {
+      if( block_clock > cache_duration_in_blocks )
+      {
+        auto& block_clock_idx = _message_cache.get<block_clock_index>();
+        auto end = block_clock_idx.lower_bound( block_clock - cache_duration_in_blocks );
+        for( auto itr = block_clock_idx.begin(); itr != end; )
+        {
+          _total_size_in_bytes -= itr->size_in_bytes;
+          itr = block_clock_idx.erase( itr );
+          ++_expired_count;
+        }
+      }
+
+      if( _max_age_in_seconds )
+      {
+        // messages are cached in order of arrival, so the oldest ones are always at the front
+        fc::time_point expiration_time = fc::time_point::now() - fc::seconds( _max_age_in_seconds );
+        auto& insertion_order = _message_cache.get<insertion_order_index>();
+        while( !insertion_order.empty() && insertion_order.front().time_when_cached < expiration_time )
+        {
+          erase_oldest_message();
+          ++_expired_count;
+        }
+      }
+    }
+
+    void blockchain_tied_message_cache::enforce_size_limit()
+    {
+      if( !_max_size_in_bytes )
+        return;
+      while( _total_size_in_bytes > _max_size_in_bytes && !_message_cache.empty() )
+      {
+        erase_oldest_message();
+        ++_evicted_for_size_count;
+      }
+    }
+
     void blockchain_tied_message_cache::block_accepted()
     {
       ++block_clock;
-      if( block_clock > cache_duration_in_blocks )
-        _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                                                      _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
+      expire_old_messages();
     }
 
     void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
@@ -192,11 +279,17 @@ namespace graphene { namespace net {
                                                      const message_propagation_data& propagation_data,
                                                      const fc::uint160_t& message_content_hash )
     {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
+      expire_old_messages();
+      auto insert_result = _message_cache.insert( message_info(hash_of_message_to_cache,
+                                                               message_to_cache,
+                                                               block_clock,
+                                                               propagation_data,
+                                                               message_content_hash ) );
+      if( insert_result.second )
+      {
+        _total_size_in_bytes += insert_result.first->size_in_bytes;
+        enforce_size_limit();
+      }
     }
 
     message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
@@ -204,7 +297,11 @@ namespace graphene { namespace net {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
       if( iter != _message_cache.get<message_hash_index>().end() )
+      {
+        ++_hit_count;
         return iter->message_body;
+      }
+      ++_miss_count;
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
@@ -220,6 +317,32 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    void blockchain_tied_message_cache::set_max_size_in_bytes( size_t max_size_in_bytes )
+    {
+      _max_size_in_bytes = max_size_in_bytes;
+      enforce_size_limit();
+    }
+
+    void blockchain_tied_message_cache::set_max_age_in_seconds( uint32_t max_age_in_seconds )
+    {
+      _max_age_in_seconds = max_age_in_seconds;
+      expire_old_messages();
+    }
+
+    fc::variant_object blockchain_tied_message_cache::get_statistics() const
+    {
+      fc::mutable_variant_object result;
+      result["message_count"] = _message_cache.size();
+      result["size_in_bytes"] = _total_size_in_bytes;
+      result["max_size_in_bytes"] = _max_size_in_bytes;
+      result["max_age_in_seconds"] = _max_age_in_seconds;
+      result["hits"] = _hit_count;
+      result["misses"] = _miss_count;
+      result["expired"] = _expired_count;
+      result["evicted_for_size"] = _evicted_for_size_count;
+      return result;
+    }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     // This specifies configuration info for the local node.  It's stored as JSON
@@ -473,6 +596,24 @@ namespace graphene { namespace net { namespace detail {
       fc::promise<void>::ptr        _retrigger_advertise_inventory_loop_promise;
       fc::future<void>              _advertise_inventory_loop_done;
       std::unordered_set<item_id>   _new_inventory; /// list of items we have received but not yet advertised to our peers
+      bool                          _new_inventory_contains_block; /// blocks in _new_inventory are advertised without waiting for the batch to fill
+      uint32_t                      _inventory_advertisement_interval_ms; /// how long to collect transactions before advertising them
+      // @}
+
+      /// measurements of the cost of relaying inventory, see get_inventory_statistics()
+      // @{
+      uint64_t                      _inventory_batches_sent;
+      uint64_t                      _inventory_messages_sent;
+      uint64_t                      _inventory_items_advertised; /// counted once per peer the item was advertised to
+      uint64_t                      _inventory_items_suppressed; /// items not advertised to a peer because it already had them
+      uint64_t                      _inventory_filter_false_positives;
+      uint64_t                      _transaction_inventory_bytes_sent;
+      uint64_t                      _transaction_inventory_bytes_received;
+      uint64_t                      _transactions_relayed; /// transactions advertised to at least one peer
+      uint64_t                      _transaction_bytes_sent; /// transactions sent in reply to fetch requests
+      fc::microseconds              _inventory_advertisement_time;
+      fc::microseconds              _transaction_inventory_processing_time;
+      fc::microseconds              _transaction_validation_time;
       // @}
 
       fc::future<void>     _terminate_inactive_connections_loop_done;
@@ -700,6 +841,9 @@ namespace graphene { namespace net { namespace detail {
       void move_peer_to_closing_list(const peer_connection_ptr& peer);
       void move_peer_to_terminating_list(const peer_connection_ptr& peer);
 
+      std::vector<peer_connection_ptr> get_active_connections_by_score() const;
+      void save_peer_performance_record(const peer_connection_ptr& peer);
+
       peer_connection_ptr get_connection_to_endpoint( const fc::ip::endpoint& remote_endpoint );
 
       void dump_node_status();
@@ -749,6 +893,8 @@ namespace graphene { namespace net { namespace detail {
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
+      fc::variant_object         get_message_cache_statistics() const;
+      fc::variant_object         get_inventory_statistics() const;
 
       bool is_hard_fork_block(uint32_t block_number) const;
       uint32_t get_next_known_hard_fork_block_number(uint32_t block_number) const;
@@ -819,7 +965,18 @@ namespace graphene { namespace net { namespace detail {
       _node_is_shutting_down(false),
       _maximum_number_of_blocks_to_handle_at_one_time(MAXIMUM_NUMBER_OF_BLOCKS_TO_HANDLE_AT_ONE_TIME),
       _maximum_number_of_sync_blocks_to_prefetch(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH),
-      _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING)
+      _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING),
+      _new_inventory_contains_block(false),
+      _inventory_advertisement_interval_ms(GRAPHENE_NET_INVENTORY_ADVERTISEMENT_INTERVAL_MS),
+      _inventory_batches_sent(0),
+      _inventory_messages_sent(0),
+      _inventory_items_advertised(0),
+      _inventory_items_suppressed(0),
+      _inventory_filter_false_positives(0),
+      _transaction_inventory_bytes_sent(0),
+      _transaction_inventory_bytes_received(0),
+      _transactions_relayed(0),
+      _transaction_bytes_sent(0)
     {
       _rate_limiter.set_actual_rate_time_constant(fc::seconds(2));
       fc::rand_pseudo_bytes(&_node_id.data[0], (int)_node_id.size());
@@ -1035,8 +1192,8 @@ namespace graphene { namespace net { namespace detail {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
-            for( const peer_connection_ptr& peer : _active_connections )
+            // for each idle peer that we're syncing with, fastest peers first so they get the first pick of blocks
+            for( const peer_connection_ptr& peer : get_active_connections_by_score() )
             {
               if( peer->we_need_sync_items_from_peer &&
                   sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() && // if we've already scheduled a request for this peer, don't consider scheduling another
@@ -1044,6 +1201,10 @@ namespace graphene { namespace net { namespace detail {
               {
                 if (!peer->inhibit_fetching_sync_blocks)
                 {
+                  // peers scoring below neutral get proportionally smaller batches
+                  uint32_t maximum_blocks_for_this_peer = std::max<uint32_t>(1,
+                      (uint32_t)std::min<uint64_t>(_maximum_blocks_per_peer_during_syncing,
+                                                   (uint64_t)_maximum_blocks_per_peer_during_syncing * peer->performance.score() / GRAPHENE_NET_PEER_SCORE_NEUTRAL));
                   // loop through the items it has that we don't yet have on our blockchain
                   for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
                   {
@@ -1056,7 +1217,7 @@ namespace graphene { namespace net { namespace detail {
                       // then schedule a request from this peer
                       sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
                       sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _maximum_blocks_per_peer_during_syncing)
+                      if (sync_item_requests_to_send[peer].size() >= maximum_blocks_for_this_peer)
                         break;
                     }
                   }
@@ -1116,20 +1277,24 @@ namespace graphene { namespace net { namespace detail {
 
         // we need to construct a list of items to request from each peer first,
         // then send the messages (in two steps, to avoid yielding while iterating)
-        // we want to evenly distribute our requests among our peers.
-        struct requested_item_count_index {};
+        // we want to distribute our requests among our peers in proportion to their
+        // scores, so the cost of asking a peer for one more item grows with the number
+        // of items we've already asked it for and shrinks as its score goes up.
+        struct fetch_cost_index {};
         struct peer_and_items_to_fetch
         {
           peer_connection_ptr peer;
+          uint32_t peer_score;
           std::vector<item_id> item_ids;
-          peer_and_items_to_fetch(const peer_connection_ptr& peer) : peer(peer) {}
+          peer_and_items_to_fetch(const peer_connection_ptr& peer) : peer(peer), peer_score(peer->performance.score()) {}
           bool operator<(const peer_and_items_to_fetch& rhs) const { return peer < rhs.peer; }
           size_t number_of_items() const { return item_ids.size(); }
+          uint64_t fetch_cost() const { return (uint64_t)(item_ids.size() + 1) * GRAPHENE_NET_PEER_SCORE_MAX * 1000 / (peer_score + 1); }
         };
         typedef boost::multi_index_container<peer_and_items_to_fetch,
                                              boost::multi_index::indexed_by<boost::multi_index::ordered_unique<boost::multi_index::member<peer_and_items_to_fetch, peer_connection_ptr, &peer_and_items_to_fetch::peer> >,
-                                                                            boost::multi_index::ordered_non_unique<boost::multi_index::tag<requested_item_count_index>,
-                                                                                                                   boost::multi_index::const_mem_fun<peer_and_items_to_fetch, size_t, &peer_and_items_to_fetch::number_of_items> > > > fetch_messages_to_send_set;
+                                                                            boost::multi_index::ordered_non_unique<boost::multi_index::tag<fetch_cost_index>,
+                                                                                                                   boost::multi_index::const_mem_fun<peer_and_items_to_fetch, uint64_t, &peer_and_items_to_fetch::fetch_cost> > > > fetch_messages_to_send_set;
         fetch_messages_to_send_set items_by_peer;
 
         // initialize the fetch_messages_to_send with an empty set of items for all idle peers
@@ -1150,9 +1315,9 @@ namespace graphene { namespace net { namespace detail {
           }
           else
           {
-            // find a peer that has it, we'll use the one who has the least requests going to it to load balance
+            // find a peer that has it, we'll use the one with the lowest fetch cost to load balance
             bool item_fetched = false;
-            for (auto peer_iter = items_by_peer.get<requested_item_count_index>().begin(); peer_iter != items_by_peer.get<requested_item_count_index>().end(); ++peer_iter)
+            for (auto peer_iter = items_by_peer.get<fetch_cost_index>().begin(); peer_iter != items_by_peer.get<fetch_cost_index>().end(); ++peer_iter)
             {
               const peer_connection_ptr& peer = peer_iter->peer;
               // if they have the item and we haven't already decided to ask them for too many other items
@@ -1169,7 +1334,7 @@ namespace graphene { namespace net { namespace detail {
                   peer->items_requested_from_peer.insert(peer_connection::item_to_time_map_type::value_type(item_id_to_fetch, fc::time_point::now()));
                   item_iter = _items_to_fetch.erase(item_iter);
                   item_fetched = true;
-                  items_by_peer.get<requested_item_count_index>().modify(peer_iter, [&item_id_to_fetch](peer_and_items_to_fetch& peer_and_items) {
+                  items_by_peer.get<fetch_cost_index>().modify(peer_iter, [&item_id_to_fetch](peer_and_items_to_fetch& peer_and_items) {
                     peer_and_items.item_ids.push_back(item_id_to_fetch);
                   });
                   break;
@@ -1234,20 +1399,42 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       while (!_advertise_inventory_loop_done.canceled())
       {
+        // give transactions a short window to accumulate so they go out in a few larger
+        // inventory messages instead of one message per transaction per peer.  Blocks are
+        // latency-critical and are never held back.
+        fc::time_point batch_deadline = fc::time_point::now() + fc::milliseconds(_inventory_advertisement_interval_ms);
+        while (!_new_inventory_contains_block &&
+               _new_inventory.size() < GRAPHENE_NET_MAX_INVENTORY_BATCH_SIZE &&
+               fc::time_point::now() < batch_deadline)
+        {
+          _retrigger_advertise_inventory_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_advertise_inventory_loop"));
+          try
+          {
+            _retrigger_advertise_inventory_loop_promise->wait(batch_deadline - fc::time_point::now());
+          }
+          catch (const fc::timeout_exception&)
+          {
+          }
+          _retrigger_advertise_inventory_loop_promise.reset();
+        }
+
         dlog("beginning an iteration of advertise inventory");
+        fc::time_point advertisement_start_time = fc::time_point::now();
         // swap inventory into local variable, clearing the node's copy
         std::unordered_set<item_id> inventory_to_advertise;
         inventory_to_advertise.swap(_new_inventory);
+        _new_inventory_contains_block = false;
 
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
         // we're computing the messages)
         std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > inventory_messages_to_send;
+        std::unordered_set<item_id> transactions_relayed;
 
-        for (const peer_connection_ptr& peer : _active_connections)
+        // advertise to the best peers first, they are the ones most likely to fetch and relay the items quickly
+        for (const peer_connection_ptr& peer : get_active_connections_by_score())
         {
           // only advertise to peers who are in sync with us
-           wdump((peer->peer_needs_sync_items_from_us));
           if( !peer->peer_needs_sync_items_from_us )
           {
             std::map<uint32_t, std::vector<item_hash_t> > items_to_advertise_by_type;
@@ -1255,38 +1442,60 @@ namespace graphene { namespace net { namespace detail {
             // or anything it has advertised to us
             // group the items we need to send by type, because we'll need to send one inventory message per type
             unsigned total_items_to_send_to_this_peer = 0;
-            wdump((inventory_to_advertise));
             for (const item_id& item_to_advertise : inventory_to_advertise)
             {
-              if (peer->inventory_advertised_to_peer.find(item_to_advertise) != peer->inventory_advertised_to_peer.end() )
-                 wdump((*peer->inventory_advertised_to_peer.find(item_to_advertise)));
-              if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
-                 wdump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
+              // the filter answers most lookups for items the peer has never seen without touching the sets
+              if (peer->known_inventory.might_contain(item_to_advertise))
+              {
+                if (peer->inventory_advertised_to_peer.find(item_to_advertise) != peer->inventory_advertised_to_peer.end() ||
+                    peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end())
+                {
+                  ++_inventory_items_suppressed;
+                  continue;
+                }
+                ++_inventory_filter_false_positives;
+              }
 
-              if (peer->inventory_advertised_to_peer.find(item_to_advertise) == peer->inventory_advertised_to_peer.end() &&
-                  peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end())
+              items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
+              peer->inventory_advertised_to_peer.insert(peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
+              peer->known_inventory.insert(item_to_advertise);
+              ++total_items_to_send_to_this_peer;
+              if (item_to_advertise.item_type == trx_message_type)
               {
-                items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
-                peer->inventory_advertised_to_peer.insert(peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
-                ++total_items_to_send_to_this_peer;
-                if (item_to_advertise.item_type == trx_message_type)
-                  testnetlog("advertising transaction ${id} to peer ${endpoint}", ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
-                dlog("advertising item ${id} to peer ${endpoint}", ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
+                transactions_relayed.insert(item_to_advertise);
+                testnetlog("advertising transaction ${id} to peer ${endpoint}", ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
               }
             }
-              dlog("advertising ${count} new item(s) of ${types} type(s) to peer ${endpoint}",
-                   ("count", total_items_to_send_to_this_peer)
-                   ("types", items_to_advertise_by_type.size())
-                   ("endpoint", peer->get_remote_endpoint()));
-            for (auto items_group : items_to_advertise_by_type)
-              inventory_messages_to_send.push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first, items_group.second)));
+            dlog("advertising ${count} new item(s) of ${types} type(s) to peer ${endpoint}",
+                 ("count", total_items_to_send_to_this_peer)
+                 ("types", items_to_advertise_by_type.size())
+                 ("endpoint", peer->get_remote_endpoint()));
+            _inventory_items_advertised += total_items_to_send_to_this_peer;
+            for (const auto& items_group : items_to_advertise_by_type)
+              for (size_t first_item = 0; first_item < items_group.second.size(); first_item += GRAPHENE_NET_MAX_INVENTORY_BATCH_SIZE)
+              {
+                size_t last_item = std::min<size_t>(first_item + GRAPHENE_NET_MAX_INVENTORY_BATCH_SIZE, items_group.second.size());
+                inventory_messages_to_send.push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first,
+                                                                                                      std::vector<item_hash_t>(items_group.second.begin() + first_item,
+                                                                                                                               items_group.second.begin() + last_item))));
+              }
           }
           peer->clear_old_inventory();
         }
+        _transactions_relayed += transactions_relayed.size();
 
+        if (!inventory_messages_to_send.empty())
+          ++_inventory_batches_sent;
         for (auto iter = inventory_messages_to_send.begin(); iter != inventory_messages_to_send.end(); ++iter)
-          iter->first->send_message(iter->second);
+        {
+          message inventory_message(iter->second);
+          if (iter->second.item_type == trx_message_type)
+            _transaction_inventory_bytes_sent += inventory_message.size + sizeof(message_header);
+          ++_inventory_messages_sent;
+          iter->first->send_message(inventory_message);
+        }
         inventory_messages_to_send.clear();
+        _inventory_advertisement_time += fc::time_point::now() - advertisement_start_time;
 
         if (_new_inventory.empty())
         {
@@ -1300,7 +1509,8 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::trigger_advertise_inventory_loop()
     {
       VERIFY_CORRECT_THREAD();
-      if( _retrigger_advertise_inventory_loop_promise )
+      // while collecting a batch this is called for every new item, only wake the loop once
+      if( _retrigger_advertise_inventory_loop_promise && !_retrigger_advertise_inventory_loop_promise->ready() )
         _retrigger_advertise_inventory_loop_promise->set_value();
     }
 
@@ -1406,6 +1616,7 @@ namespace graphene { namespace net { namespace detail {
                 }
             if (disconnect_due_to_request_timeout)
             {
+              active_peer->performance.record_request_timed_out();
               // we should probably disconnect nicely and give them a reason, but right now the logic
               // for rescheduling the requests only executes when the connection is fully closed,
               // and we want to get those requests rescheduled as soon as possible
@@ -2755,7 +2966,11 @@ namespace graphene { namespace net { namespace detail {
         if (reply.msg_type == block_message_type)
           originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
         else
+        {
+          if (reply.msg_type == trx_message_type)
+            _transaction_bytes_sent += reply.size + sizeof(message_header);
           originating_peer->send_message(reply);
+        }
       }
     }
 
@@ -2797,20 +3012,40 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::on_item_ids_inventory_message(peer_connection* originating_peer, const item_ids_inventory_message& item_ids_inventory_message_received)
     {
       VERIFY_CORRECT_THREAD();
+      fc::time_point processing_start_time = fc::time_point::now();
 
       // expire old inventory so we'll be making decisions our about whether to fetch blocks below based only on recent inventory
       originating_peer->clear_old_inventory();
 
       dlog( "received inventory of ${count} items from peer ${endpoint}",
            ( "count", item_ids_inventory_message_received.item_hashes_available.size() )("endpoint", originating_peer->get_remote_endpoint() ) );
-      for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
+
+      // throttle transaction inventory according to the peer's score, blocks are never throttled
+      size_t number_of_items_to_consider = item_ids_inventory_message_received.item_hashes_available.size();
+      if (item_ids_inventory_message_received.item_type == graphene::net::trx_message_type)
+      {
+        uint32_t number_of_items_allowed = originating_peer->take_trx_inventory_allowance((uint32_t)number_of_items_to_consider);
+        if (number_of_items_allowed < number_of_items_to_consider)
+        {
+          wlog("peer ${endpoint} is flooding us with transaction inventory, ignoring ${count} of the ${total} items it advertised",
+               ("endpoint", originating_peer->get_remote_endpoint())
+               ("count", number_of_items_to_consider - number_of_items_allowed)
+               ("total", number_of_items_to_consider));
+          originating_peer->performance.record_inventory_flood();
+          number_of_items_to_consider = number_of_items_allowed;
+        }
+      }
+
+      for( size_t i = 0; i < number_of_items_to_consider; ++i )
       {
+        const item_hash_t& item_hash = item_ids_inventory_message_received.item_hashes_available[i];
         item_id advertised_item_id(item_ids_inventory_message_received.item_type, item_hash);
         bool we_advertised_this_item_to_a_peer = false;
         bool we_requested_this_item_from_a_peer = false;
-        for (const peer_connection_ptr peer : _active_connections)
+        for (const peer_connection_ptr& peer : _active_connections)
         {
-          if (peer->inventory_advertised_to_peer.find(advertised_item_id) != peer->inventory_advertised_to_peer.end())
+          if (peer->known_inventory.might_contain(advertised_item_id) &&
+              peer->inventory_advertised_to_peer.find(advertised_item_id) != peer->inventory_advertised_to_peer.end())
           {
             we_advertised_this_item_to_a_peer = true;
             break;
@@ -2830,6 +3065,7 @@ namespace graphene { namespace net { namespace detail {
               originating_peer->is_inventory_advertised_to_us_list_full())
             break;
           originating_peer->inventory_peer_advertised_to_us.insert(peer_connection::timestamped_item_id(advertised_item_id, fc::time_point::now()));
+          originating_peer->known_inventory.insert(advertised_item_id);
           if (!we_requested_this_item_from_a_peer)
           {
             if (_recently_failed_items.find(item_id(item_ids_inventory_message_received.item_type, item_hash)) != _recently_failed_items.end())
@@ -2860,6 +3096,11 @@ namespace graphene { namespace net { namespace detail {
         }
       }
 
+      if (item_ids_inventory_message_received.item_type == graphene::net::trx_message_type)
+      {
+        _transaction_inventory_bytes_received += fc::raw::pack_size(item_ids_inventory_message_received) + sizeof(message_header);
+        _transaction_inventory_processing_time += fc::time_point::now() - processing_start_time;
+      }
     }
 
     void node_impl::on_closing_connection_message( peer_connection* originating_peer, const closing_connection_message& closing_connection_message_received )
@@ -2925,6 +3166,7 @@ namespace graphene { namespace net { namespace detail {
           if (updated_peer_record)
           {
             updated_peer_record->last_seen_time = fc::time_point::now();
+            updated_peer_record->performance = originating_peer->performance;
             _potential_peer_db.update_entry(*updated_peer_record);
           }
         }
@@ -3445,6 +3687,7 @@ namespace graphene { namespace net { namespace detail {
       auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
+        originating_peer->performance.record_item_received(fc::time_point::now() - item_iter->second, message_to_process.data.size());
         originating_peer->items_requested_from_peer.erase(item_iter);
         process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
         if (originating_peer->idle())
@@ -3458,6 +3701,7 @@ namespace graphene { namespace net { namespace detail {
                                                                                             block_message_to_process.block_id));
         if (sync_item_iter != originating_peer->sync_items_requested_from_peer.end())
         {
+          originating_peer->performance.record_item_received(fc::time_point::now() - sync_item_iter->second, message_to_process.data.size());
           originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
           _active_sync_requests.erase(block_message_to_process.block_id);
           process_block_during_sync(originating_peer, block_message_to_process, message_hash);
@@ -3771,6 +4015,7 @@ namespace graphene { namespace net { namespace detail {
       }
       else
       {
+        originating_peer->performance.record_item_received(message_receive_time - iter->second, message_to_process.data.size());
         originating_peer->items_requested_from_peer.erase( iter );
         if (originating_peer->idle())
           trigger_fetch_items_loop();
@@ -3783,7 +4028,9 @@ namespace graphene { namespace net { namespace detail {
           {
             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
             dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
+            fc::time_point validation_start_time = fc::time_point::now();
             _delegate->handle_transaction(transaction_message_to_process);
+            _transaction_validation_time += fc::time_point::now() - validation_start_time;
           }
           else
             _delegate->handle_message( message_to_process );
@@ -3844,6 +4091,8 @@ namespace graphene { namespace net { namespace detail {
 
       try
       {
+        for (const peer_connection_ptr& peer : _active_connections)
+          save_peer_performance_record(peer);
         _potential_peer_db.close();
       }
       catch ( const fc::exception& e )
@@ -4597,12 +4846,56 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::move_peer_to_active_list(const peer_connection_ptr& peer)
     {
       VERIFY_CORRECT_THREAD();
-      _active_connections.insert(peer);
+      if (_active_connections.insert(peer).second)
+      {
+        // pick up where we left off scoring this peer the last time we were connected to it
+        fc::optional<fc::ip::endpoint> endpoint = peer->get_endpoint_for_connecting();
+        if (endpoint)
+        {
+          fc::optional<potential_peer_record> peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint);
+          if (peer_record)
+          {
+            peer->performance = peer_record->performance;
+            peer->performance.age();
+          }
+        }
+      }
       _handshaking_connections.erase(peer);
       _closing_connections.erase(peer);
       _terminating_connections.erase(peer);
     }
 
+    std::vector<peer_connection_ptr> node_impl::get_active_connections_by_score() const
+    {
+      VERIFY_CORRECT_THREAD();
+      std::vector<std::pair<uint32_t, peer_connection_ptr> > peers_and_scores;
+      peers_and_scores.reserve(_active_connections.size());
+      for (const peer_connection_ptr& peer : _active_connections)
+        peers_and_scores.push_back(std::make_pair(peer->performance.score(), peer));
+      std::stable_sort(peers_and_scores.begin(), peers_and_scores.end(),
+                       [](const std::pair<uint32_t, peer_connection_ptr>& lhs, const std::pair<uint32_t, peer_connection_ptr>& rhs) { return lhs.first > rhs.first; });
+
+      std::vector<peer_connection_ptr> peers;
+      peers.reserve(peers_and_scores.size());
+      for (const auto& peer_and_score : peers_and_scores)
+        peers.push_back(peer_and_score.second);
+      return peers;
+    }
+
+    void node_impl::save_peer_performance_record(const peer_connection_ptr& peer)
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::optional<fc::ip::endpoint> endpoint = peer->get_endpoint_for_connecting();
+      if (!endpoint)
+        return;
+      fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint);
+      if (updated_peer_record)
+      {
+        updated_peer_record->performance = peer->performance;
+        _potential_peer_db.update_entry(*updated_peer_record);
+      }
+    }
+
     void node_impl::move_peer_to_closing_list(const peer_connection_ptr& peer)
     {
       VERIFY_CORRECT_THREAD();
@@ -4651,7 +4944,7 @@ namespace graphene { namespace net { namespace detail {
       ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
-      ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
+      ilog( "node._message_cache size: ${size} (${bytes} bytes)", ("size", _message_cache.size() )("bytes", _message_cache.size_in_bytes() ) );
       for( const peer_connection_ptr& peer : _active_connections )
       {
         ilog( "  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint() ) );
@@ -4777,6 +5070,8 @@ namespace graphene { namespace net { namespace detail {
         peer_details["startingheight"] = "";
         peer_details["banscore"] = "";
         peer_details["syncnode"] = "";
+        peer_details["score"] = peer->performance.score();
+        peer_details["performance"] = peer->performance;
 
         if (peer->fc_git_revision_sha)
         {
@@ -4843,6 +5138,8 @@ namespace graphene { namespace net { namespace detail {
 
       _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
       _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
+      if( item_to_broadcast.msg_type == graphene::net::block_message_type )
+        _new_inventory_contains_block = true;
       trigger_advertise_inventory_loop();
     }
 
@@ -4894,6 +5191,12 @@ namespace graphene { namespace net { namespace detail {
         _maximum_number_of_sync_blocks_to_prefetch = params["maximum_number_of_sync_blocks_to_prefetch"].as<uint32_t>();
       if (params.contains("maximum_blocks_per_peer_during_syncing"))
         _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>();
+      if (params.contains("message_cache_max_size_in_bytes"))
+        _message_cache.set_max_size_in_bytes(params["message_cache_max_size_in_bytes"].as<uint64_t>());
+      if (params.contains("message_cache_max_age_in_seconds"))
+        _message_cache.set_max_age_in_seconds(params["message_cache_max_age_in_seconds"].as<uint32_t>());
+      if (params.contains("inventory_advertisement_interval_ms"))
+        _inventory_advertisement_interval_ms = params["inventory_advertisement_interval_ms"].as<uint32_t>();
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -4913,6 +5216,9 @@ namespace graphene { namespace net { namespace detail {
       result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
       result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
       result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+      result["message_cache_max_size_in_bytes"] = _message_cache.get_max_size_in_bytes();
+      result["message_cache_max_age_in_seconds"] = _message_cache.get_max_age_in_seconds();
+      result["inventory_advertisement_interval_ms"] = _inventory_advertisement_interval_ms;
       return result;
     }
 
@@ -5014,6 +5320,43 @@ namespace graphene { namespace net { namespace detail {
       return result;
     }
 
+    fc::variant_object node_impl::get_message_cache_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_cache.get_statistics();
+    }
+
+    fc::variant_object node_impl::get_inventory_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::mutable_variant_object result;
+      result["batches_sent"] = _inventory_batches_sent;
+      result["messages_sent"] = _inventory_messages_sent;
+      result["items_advertised"] = _inventory_items_advertised;
+      result["items_suppressed"] = _inventory_items_suppressed;
+      result["filter_false_positives"] = _inventory_filter_false_positives;
+      result["transactions_relayed"] = _transactions_relayed;
+      result["transaction_inventory_bytes_sent"] = _transaction_inventory_bytes_sent;
+      result["transaction_inventory_bytes_received"] = _transaction_inventory_bytes_received;
+      result["transaction_bytes_sent"] = _transaction_bytes_sent;
+      result["advertisement_time_us"] = _inventory_advertisement_time.count();
+      result["transaction_inventory_processing_time_us"] = _transaction_inventory_processing_time.count();
+      result["transaction_validation_time_us"] = _transaction_validation_time.count();
+
+      // the per transaction figures only cover the p2p layer's own work, validation is reported separately above
+      if (_transactions_relayed)
+      {
+        result["bytes_per_relayed_transaction"] = (_transaction_inventory_bytes_sent + _transaction_inventory_bytes_received + _transaction_bytes_sent) / _transactions_relayed;
+        result["time_per_relayed_transaction_us"] = (_inventory_advertisement_time + _transaction_inventory_processing_time).count() / (int64_t)_transactions_relayed;
+      }
+
+      size_t filter_size_in_bytes = 0;
+      for (const peer_connection_ptr& peer : _active_connections)
+        filter_size_in_bytes += peer->known_inventory.size_in_bytes();
+      result["filter_size_in_bytes"] = filter_size_in_bytes;
+      return result;
+    }
+
     bool node_impl::is_hard_fork_block(uint32_t block_number) const
     {
       return std::binary_search(_hard_fork_block_numbers.begin(), _hard_fork_block_numbers.end(), block_number);
@@ -5191,6 +5534,16 @@ namespace graphene { namespace net { namespace detail {
     INVOKE_IN_IMPL(network_get_usage_stats);
   }
 
+  fc::variant_object node::get_message_cache_statistics() const
+  {
+    INVOKE_IN_IMPL(get_message_cache_statistics);
+  }
+
+  fc::variant_object node::get_inventory_statistics() const
+  {
+    INVOKE_IN_IMPL(get_inventory_statistics);
+  }
+
   void node::close()
   {
     INVOKE_IN_IMPL(close);
@@ -84,6 +84,7 @@ namespace graphene { namespace net
       we_need_sync_items_from_peer(true),
       inhibit_fetching_sync_blocks(false),
       transaction_fetching_inhibited_until(fc::time_point::min()),
+      trx_inventory_allowance(0),
       last_known_fork_block_number(0),
       firewall_check_state(nullptr)
 #ifndef NDEBUG
@@ -455,6 +456,38 @@ namespace graphene { namespace net
       return transaction_fetching_inhibited_until > fc::time_point::now();
     }
 
+    uint32_t peer_connection::take_trx_inventory_allowance(uint32_t number_of_items)
+    {
+      VERIFY_CORRECT_THREAD();
+      uint64_t items_per_second = std::max<uint64_t>((uint64_t)GRAPHENE_NET_MAX_TRX_PER_SECOND * performance.score() / GRAPHENE_NET_PEER_SCORE_NEUTRAL,
+                                                     GRAPHENE_NET_MIN_TRX_INVENTORY_PER_SECOND);
+      uint64_t maximum_allowance = items_per_second * GRAPHENE_NET_TRX_INVENTORY_BURST_SECONDS;
+      fc::time_point now = fc::time_point::now();
+      if (trx_inventory_allowance_update_time == fc::time_point())
+      {
+        trx_inventory_allowance = maximum_allowance;
+        trx_inventory_allowance_update_time = now;
+      }
+      else
+      {
+        // only advance the update time by the time it took to earn the items we add, so
+        // frequent small messages don't lose the fractional part of the allowance
+        int64_t elapsed_time = std::max<int64_t>((now - trx_inventory_allowance_update_time).count(), 0);
+        uint64_t items_earned = (uint64_t)elapsed_time * items_per_second / 1000000;
+        trx_inventory_allowance += items_earned;
+        trx_inventory_allowance_update_time += fc::microseconds(items_earned * 1000000 / items_per_second);
+        if (trx_inventory_allowance >= maximum_allowance)
+        {
+          trx_inventory_allowance = maximum_allowance;
+          trx_inventory_allowance_update_time = now;
+        }
+      }
+
+      uint32_t items_allowed = (uint32_t)std::min<uint64_t>(number_of_items, trx_inventory_allowance);
+      trx_inventory_allowance -= items_allowed;
+      return items_allowed;
+    }
+
     fc::sha512 peer_connection::get_shared_secret() const
     {
       VERIFY_CORRECT_THREAD();
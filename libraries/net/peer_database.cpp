@@ -33,11 +33,78 @@
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
 
+#include <algorithm>
+#include <limits>
+
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/config.hpp>
 
 
 
 namespace graphene { namespace net {
+  namespace
+  {
+    uint32_t update_moving_average(uint32_t average, uint64_t sample, bool first_sample)
+    {
+      if (first_sample)
+        return (uint32_t)std::min<uint64_t>(sample, std::numeric_limits<uint32_t>::max());
+      uint64_t new_average = ((uint64_t)average * (GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT - 1) + sample) / GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT;
+      return (uint32_t)std::min<uint64_t>(new_average, std::numeric_limits<uint32_t>::max());
+    }
+  }
+
+  void peer_performance_record::record_item_received(const fc::microseconds& latency, size_t size_in_bytes)
+  {
+    int64_t latency_us = std::max<int64_t>(latency.count(), 1);
+    bool first_sample = number_of_items_received == 0;
+    average_latency_ms = update_moving_average(average_latency_ms, latency_us / 1000, first_sample);
+    average_throughput = update_moving_average(average_throughput, (uint64_t)size_in_bytes * 1000000 / latency_us, first_sample);
+    if (number_of_items_received < std::numeric_limits<uint32_t>::max())
+      ++number_of_items_received;
+  }
+
+  void peer_performance_record::record_request_timed_out()
+  {
+    if (number_of_requests_timed_out < std::numeric_limits<uint32_t>::max())
+      ++number_of_requests_timed_out;
+  }
+
+  void peer_performance_record::record_inventory_flood()
+  {
+    if (number_of_inventory_floods < std::numeric_limits<uint32_t>::max())
+      ++number_of_inventory_floods;
+  }
+
+  void peer_performance_record::age()
+  {
+    // keep at least one received item so the averages are still treated as measured
+    if (number_of_items_received > 1)
+      number_of_items_received /= 2;
+    number_of_requests_timed_out /= 2;
+    number_of_inventory_floods /= 2;
+  }
+
+  uint32_t peer_performance_record::score() const
+  {
+    uint64_t score = GRAPHENE_NET_PEER_SCORE_NEUTRAL;
+    if (number_of_items_received)
+    {
+      uint64_t latency_score = (uint64_t)GRAPHENE_NET_PEER_SCORE_MAX * GRAPHENE_NET_PEER_SCORE_REFERENCE_LATENCY_MS /
+                               (GRAPHENE_NET_PEER_SCORE_REFERENCE_LATENCY_MS + average_latency_ms);
+      uint64_t throughput_score = (uint64_t)GRAPHENE_NET_PEER_SCORE_MAX * average_throughput /
+                                  (GRAPHENE_NET_PEER_SCORE_REFERENCE_THROUGHPUT + (uint64_t)average_throughput);
+      score = (latency_score + throughput_score) / 2;
+      // scale by the fraction of our requests the peer actually answered
+      score = score * number_of_items_received /
+              (number_of_items_received + (uint64_t)GRAPHENE_NET_PEER_SCORE_TIMEOUT_WEIGHT * number_of_requests_timed_out);
+    }
+    else if (number_of_requests_timed_out)
+      score = 0;
+
+    uint64_t flood_penalty = (uint64_t)GRAPHENE_NET_PEER_SCORE_FLOOD_PENALTY * number_of_inventory_floods;
+    return score > flood_penalty ? (uint32_t)(score - flood_penalty) : 0;
+  }
+
   namespace detail
   {
     using namespace boost::multi_index;
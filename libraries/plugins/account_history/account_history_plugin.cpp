@@ -26,6 +26,7 @@
 
 #include <steemit/app/impacted.hpp>
 
+#include <steemit/chain/account_object.hpp>
 #include <steemit/chain/config.hpp>
 #include <steemit/chain/database.hpp>
 #include <steemit/chain/history_object.hpp>
@@ -52,9 +53,21 @@ class account_history_plugin_impl
       }
 
       void on_operation( const operation_object& op_obj );
+      void on_post_operation( const operation_object& op_obj );
+      void add_history( account_id_type account, uint16_t op_type, operation_id_type op );
+
+      /** an operation impacting an account that did not exist before the operation was applied */
+      struct deferred_history
+      {
+         string               account;
+         operation_id_type    op;
+         uint16_t             op_type = 0;
+         uint32_t             virtual_op = 0;
+      };
 
       account_history_plugin& _self;
       flat_map<string,string> _tracked_accounts;
+      vector<deferred_history> _deferred;
 };
 
 account_history_plugin_impl::~account_history_plugin_impl()
@@ -66,7 +79,8 @@ void account_history_plugin_impl::on_operation( const operation_object& op_obj )
    flat_set<string> impacted;
    steemit::chain::database& db = database();
 
-   const auto& hist_idx = db.get_index_type<account_history_index>().indices().get<by_account>();
+   const auto& accounts = db.get_index_type<account_index>().indices().get<by_name>();
+   uint16_t op_type = op_obj.op.which();
    const operation_object* new_obj = nullptr;
    app::operation_get_impacted_accounts( op_obj.op, impacted );
 
@@ -85,20 +99,73 @@ void account_history_plugin_impl::on_operation( const operation_object& op_obj )
             });
          }
 
-         auto hist_itr = hist_idx.lower_bound( boost::make_tuple( item, uint32_t(-1) ) );
-         uint32_t sequence = 0;
-         if( hist_itr != hist_idx.end() && hist_itr->account == item )
-            sequence = hist_itr->sequence + 1;
-
-         const auto& ahist = db.create<account_history_object>( [&]( account_history_object& ahist ){
-              ahist.account  = item;
-              ahist.sequence = sequence;
-              ahist.op       = new_obj->id;
-         });
+         // operations are announced before they are evaluated, so an account they create,
+         // e.g. by account_create or pow, only has an id once the operation was applied
+         auto acnt = accounts.find( item );
+         if( acnt != accounts.end() ) {
+            add_history( acnt->id, op_type, new_obj->id );
+         } else {
+            deferred_history d;
+            d.account    = item;
+            d.op         = new_obj->id;
+            d.op_type    = op_type;
+            d.virtual_op = op_obj.virtual_op;
+            _deferred.push_back( d );
+         }
       }
    }
 }
 
+/**
+ *  Adds the history of the accounts created by the operation.  Deferred history of operations
+ *  that failed is dropped, their operation_object was undone and its id may have been reused,
+ *  which the virtual_op counter of the operation tells apart.  Names that still do not exist,
+ *  such as the empty proxy of account_witness_proxy, have no history.
+ */
+void account_history_plugin_impl::on_post_operation( const operation_object& op_obj ) {
+   if( _deferred.empty() )
+      return;
+
+   steemit::chain::database& db = database();
+   const auto& accounts = db.get_index_type<account_index>().indices().get<by_name>();
+
+   vector<deferred_history> deferred;
+   std::swap( deferred, _deferred );
+   for( const auto& d : deferred ) {
+      const operation_object* op = db.find( d.op );
+      if( !op || op->virtual_op != d.virtual_op || op->trx_id != op_obj.trx_id || op->op_in_trx != op_obj.op_in_trx )
+         continue;
+
+      auto acnt = accounts.find( d.account );
+      if( acnt != accounts.end() )
+         add_history( acnt->id, d.op_type, d.op );
+   }
+}
+
+void account_history_plugin_impl::add_history( account_id_type account, uint16_t op_type, operation_id_type op ) {
+   steemit::chain::database& db = database();
+   const auto& hist_idx = db.get_index_type<account_history_index>().indices().get<by_account>();
+   const auto& type_idx = db.get_index_type<account_history_index>().indices().get<by_account_op_type>();
+
+   auto hist_itr = hist_idx.lower_bound( boost::make_tuple( account, uint32_t(-1) ) );
+   uint32_t sequence = 0;
+   if( hist_itr != hist_idx.end() && hist_itr->account == account )
+      sequence = hist_itr->sequence + 1;
+
+   auto type_itr = type_idx.lower_bound( boost::make_tuple( account, op_type, uint32_t(-1) ) );
+   uint32_t op_sequence = 0;
+   if( type_itr != type_idx.end() && type_itr->account == account && type_itr->op_type == op_type )
+      op_sequence = type_itr->op_sequence + 1;
+
+   db.create<account_history_object>( [&]( account_history_object& ahist ){
+        ahist.account     = account;
+        ahist.sequence    = sequence;
+        ahist.op_type     = op_type;
+        ahist.op_sequence = op_sequence;
+        ahist.op          = op;
+   });
+}
+
 } // end namespace detail
 
 account_history_plugin::account_history_plugin() :
@@ -131,6 +198,7 @@ void account_history_plugin::plugin_initialize(const boost::program_options::var
 {
    //ilog("Intializing account history plugin" );
    database().on_applied_operation.connect( [&]( const operation_object& b){ my->on_operation(b); } );
+   database().post_apply_operation.connect( [&]( const operation_object& b){ my->on_post_operation(b); } );
    database().add_index< primary_index< operation_index  > >();
    database().add_index< primary_index< account_history_index  > >();
 
@@ -152,8 +152,11 @@ void debug_node_plugin::debug_update( const fc::variant_object& update )
    FC_ASSERT( head_block.valid() );
 
    // What the last block does has been changed by adding to node_property_object, so we have to re-apply it
-   db.pop_block();
-   db.push_block( *head_block );
+   db.with_write_lock( [&]()
+   {
+      db.pop_block();
+      db.push_block( *head_block );
+   });
 }
 
 void debug_node_plugin::on_changed_objects( const std::vector<graphene::db::object_id_type>& ids )
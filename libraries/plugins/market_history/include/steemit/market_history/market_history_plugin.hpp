@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <steemit/app/plugin.hpp>
+#include <steemit/chain/database.hpp>
+
+#include <graphene/db/generic_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+#include <fc/api.hpp>
+
+namespace steemit { namespace market_history {
+using namespace chain;
+
+//
+// Plugins should #define their SPACE_ID's so plugins with
+// conflicting SPACE_ID assignments can be compiled into the
+// same binary (by simply re-assigning some of the conflicting #defined
+// SPACE_ID's in a build script).
+//
+// Assignment of SPACE_ID's cannot be done at run-time because
+// various template automagic depends on them being known at compile
+// time.
+//
+#ifndef MARKET_HISTORY_SPACE_ID
+#define MARKET_HISTORY_SPACE_ID 7
+#endif
+
+enum market_history_object_type
+{
+   order_history_object_type = 0,
+   bucket_object_type = 1,
+   order_book_level_object_type = 2
+};
+
+namespace detail
+{
+   class market_history_plugin_impl;
+}
+
+/**
+ *  The trades of one bucket_size seconds long period, open is the start of the period.
+ *  Prices are kept as the STEEM and SBD amounts of the trade that set them.
+ */
+class bucket_object : public abstract_object< bucket_object >
+{
+   public:
+      static const uint8_t space_id = MARKET_HISTORY_SPACE_ID;
+      static const uint8_t type_id  = bucket_object_type;
+
+      price high()const { return asset( high_sbd, SBD_SYMBOL ) / asset( high_steem, STEEM_SYMBOL ); }
+      price low()const { return asset( low_sbd, SBD_SYMBOL ) / asset( low_steem, STEEM_SYMBOL ); }
+
+      fc::time_point_sec   open;
+      uint32_t             seconds = 0;
+      share_type           high_steem;
+      share_type           high_sbd;
+      share_type           low_steem;
+      share_type           low_sbd;
+      share_type           open_steem;
+      share_type           open_sbd;
+      share_type           close_steem;
+      share_type           close_sbd;
+      share_type           steem_volume;
+      share_type           sbd_volume;
+};
+
+/**
+ *  A trade between the order that was just placed (current) and an order that was already
+ *  on the book (open).
+ */
+class order_history_object : public abstract_object< order_history_object >
+{
+   public:
+      static const uint8_t space_id = MARKET_HISTORY_SPACE_ID;
+      static const uint8_t type_id  = order_history_object_type;
+
+      fc::time_point_sec   time;
+      string               current_owner;
+      uint32_t             current_orderid = 0;
+      asset                current_pays;
+      string               open_owner;
+      uint32_t             open_orderid = 0;
+      asset                open_pays;
+};
+
+/**
+ *  All open orders selling at sell_price.  Levels are refreshed from the limit order index
+ *  whenever an order at their price is created, filled, canceled or expires, so reading the
+ *  order book does not visit every order.
+ */
+class order_book_level_object : public abstract_object< order_book_level_object >
+{
+   public:
+      static const uint8_t space_id = MARKET_HISTORY_SPACE_ID;
+      static const uint8_t type_id  = order_book_level_object_type;
+
+      price                sell_price;
+      share_type           for_sale;   ///< asset id is sell_price.base.symbol
+      share_type           to_receive; ///< asset id is sell_price.quote.symbol
+      uint32_t             orders = 0;
+};
+
+struct by_id;
+struct by_bucket;
+struct by_time;
+struct by_sell_price;
+
+using namespace boost::multi_index;
+
+typedef multi_index_container<
+   bucket_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag< by_bucket >,
+         composite_key< bucket_object,
+            member< bucket_object, uint32_t, &bucket_object::seconds >,
+            member< bucket_object, fc::time_point_sec, &bucket_object::open >
+         >
+      >
+   >
+> bucket_multi_index_type;
+
+typedef multi_index_container<
+   order_history_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag< by_time >,
+         composite_key< order_history_object,
+            member< order_history_object, fc::time_point_sec, &order_history_object::time >,
+            member< object, object_id_type, &object::id >
+         >
+      >
+   >
+> order_history_multi_index_type;
+
+typedef multi_index_container<
+   order_book_level_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag< by_sell_price >, member< order_book_level_object, price, &order_book_level_object::sell_price > >
+   >
+> order_book_level_multi_index_type;
+
+typedef graphene::db::generic_index< bucket_object, bucket_multi_index_type >                      bucket_index;
+typedef graphene::db::generic_index< order_history_object, order_history_multi_index_type >        order_history_index;
+typedef graphene::db::generic_index< order_book_level_object, order_book_level_multi_index_type >  order_book_level_index;
+
+/**
+ *  Maintains the order book aggregated by price, recent trades and OHLCV buckets of the
+ *  internal STEEM:SBD market.
+ *
+ *  Buckets are kept for each of market-history-bucket-size, at most
+ *  market-history-buckets-per-size of each.  Trades are kept as long as the buckets of the
+ *  smallest size.
+ */
+class market_history_plugin : public steemit::app::plugin
+{
+   public:
+      market_history_plugin();
+      virtual ~market_history_plugin();
+
+      std::string plugin_name()const override;
+      virtual void plugin_set_program_options(
+         boost::program_options::options_description& cli,
+         boost::program_options::options_description& cfg) override;
+      virtual void plugin_initialize(const boost::program_options::variables_map& options) override;
+      virtual void plugin_startup() override;
+
+      flat_set< uint32_t > get_tracked_buckets()const;
+      uint32_t get_max_history_per_bucket()const;
+
+      friend class detail::market_history_plugin_impl;
+      std::unique_ptr< detail::market_history_plugin_impl > my;
+};
+
+struct market_ticker
+{
+   double      latest = 0;
+   double      lowest_ask = 0;
+   double      highest_bid = 0;
+   double      percent_change = 0;
+   asset       steem_volume = asset( 0, STEEM_SYMBOL );
+   asset       sbd_volume = asset( 0, SBD_SYMBOL );
+};
+
+struct market_volume
+{
+   asset       steem_volume = asset( 0, STEEM_SYMBOL );
+   asset       sbd_volume = asset( 0, SBD_SYMBOL );
+};
+
+/** the open orders at one price, real_price is in SBD per STEEM */
+struct order_book_level
+{
+   price       order_price;
+   double      real_price = 0;
+   share_type  steem;
+   share_type  sbd;
+   uint32_t    orders = 0;
+};
+
+struct market_order_book
+{
+   vector< order_book_level > bids;
+   vector< order_book_level > asks;
+};
+
+struct market_trade
+{
+   fc::time_point_sec   date;
+   asset                current_pays;
+   asset                open_pays;
+};
+
+class market_history_api
+{
+   public:
+      market_history_api( const app::api_context& ctx );
+
+      void on_api_startup();
+
+      /** the last price, best bid and ask and the change and volume of the last 24 hours */
+      market_ticker get_ticker()const;
+
+      /** the volume of the last 24 hours */
+      market_volume get_volume()const;
+
+      /** up to limit price levels on each side, best first */
+      market_order_book get_order_book( uint32_t limit )const;
+
+      /** up to limit trades from start to end, oldest first */
+      vector< market_trade > get_trade_history( time_point_sec start, time_point_sec end, uint32_t limit )const;
+
+      /** up to limit of the most recent trades, newest first */
+      vector< market_trade > get_recent_trades( uint32_t limit )const;
+
+      /** the buckets of bucket_seconds from start to end, at most 200 */
+      vector< bucket_object > get_market_history( uint32_t bucket_seconds, time_point_sec start, time_point_sec end )const;
+
+      /** the bucket sizes that are tracked */
+      flat_set< uint32_t > get_market_history_buckets()const;
+
+   private:
+      app::application& _app;
+};
+
+} } // steemit::market_history
+
+FC_REFLECT_DERIVED( steemit::market_history::bucket_object, (graphene::db::object),
+                    (open)(seconds)(high_steem)(high_sbd)(low_steem)(low_sbd)(open_steem)(open_sbd)(close_steem)(close_sbd)(steem_volume)(sbd_volume) )
+FC_REFLECT_DERIVED( steemit::market_history::order_history_object, (graphene::db::object),
+                    (time)(current_owner)(current_orderid)(current_pays)(open_owner)(open_orderid)(open_pays) )
+FC_REFLECT_DERIVED( steemit::market_history::order_book_level_object, (graphene::db::object),
+                    (sell_price)(for_sale)(to_receive)(orders) )
+
+FC_REFLECT( steemit::market_history::market_ticker, (latest)(lowest_ask)(highest_bid)(percent_change)(steem_volume)(sbd_volume) )
+FC_REFLECT( steemit::market_history::market_volume, (steem_volume)(sbd_volume) )
+FC_REFLECT( steemit::market_history::order_book_level, (order_price)(real_price)(steem)(sbd)(orders) )
+FC_REFLECT( steemit::market_history::market_order_book, (bids)(asks) )
+FC_REFLECT( steemit::market_history::market_trade, (date)(current_pays)(open_pays) )
+
+FC_API( steemit::market_history::market_history_api,
+        (get_ticker)
+        (get_volume)
+        (get_order_book)
+        (get_trade_history)
+        (get_recent_trades)
+        (get_market_history)
+        (get_market_history_buckets)
+      )
@@ -0,0 +1,567 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <steemit/market_history/market_history_plugin.hpp>
+
+#include <steemit/app/api_executor.hpp>
+
+#include <steemit/chain/config.hpp>
+#include <steemit/chain/database.hpp>
+#include <steemit/chain/history_object.hpp>
+#include <steemit/chain/steem_objects.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <set>
+
+namespace steemit { namespace market_history {
+
+namespace detail
+{
+
+class market_history_plugin_impl
+{
+   public:
+      market_history_plugin_impl( market_history_plugin& _plugin )
+         : _self( _plugin )
+      { }
+
+      steemit::chain::database& database()
+      {
+         return _self.database();
+      }
+
+      void on_pre_operation( const operation_object& o );
+      void on_post_operation( const operation_object& o );
+      void on_block( const signed_block& b );
+
+      void record_trade( const fill_order_operation& current, const fill_order_operation& open );
+      void update_buckets( fc::time_point_sec time, share_type steem, share_type sbd );
+
+      /** recomputes the order book levels of the prices orders were added to or removed from */
+      void refresh_levels();
+      void refresh_level( const price& p );
+
+      market_history_plugin&           _self;
+      flat_set< uint32_t >             _tracked_buckets = { 15, 60, 300, 3600, 86400 };
+      uint32_t                         _maximum_history_per_bucket_size = 5760;
+
+      /** the first fill of the match being applied, the second completes the trade */
+      optional< fill_order_operation > _current_fill;
+
+      /** prices of limit orders created, modified or removed since the levels were refreshed */
+      std::set< price >                _changed_prices;
+};
+
+/**
+ *  Collects the prices of the limit orders that change.  Observers are not notified when
+ *  changes are undone, but the order book levels are undone along with the orders.
+ */
+class limit_order_observer : public graphene::db::index_observer
+{
+   public:
+      limit_order_observer( market_history_plugin_impl& impl ) : _impl( impl ) {}
+
+      virtual void on_add( const object& obj ) override    { changed( obj ); }
+      virtual void on_remove( const object& obj ) override { changed( obj ); }
+      virtual void on_modify( const object& obj ) override { changed( obj ); }
+
+   private:
+      void changed( const object& obj )
+      {
+         _impl._changed_prices.insert( static_cast< const limit_order_object& >( obj ).sell_price );
+      }
+
+      market_history_plugin_impl& _impl;
+};
+
+void market_history_plugin_impl::on_pre_operation( const operation_object& o )
+{
+   // fill_order is a virtual operation, it is only pushed before it is applied
+   if( o.op.which() != operation::tag< fill_order_operation >::value )
+      return;
+
+   // a match fills the new order first and then the order that was on the book
+   const auto& fill = o.op.get< fill_order_operation >();
+   if( !_current_fill.valid() )
+   {
+      _current_fill = fill;
+      return;
+   }
+
+   record_trade( *_current_fill, fill );
+   _current_fill.reset();
+}
+
+void market_history_plugin_impl::on_post_operation( const operation_object& o )
+{
+   _current_fill.reset();
+   refresh_levels();
+}
+
+void market_history_plugin_impl::on_block( const signed_block& b )
+{
+   // expired orders are removed after the last transaction of the block
+   _current_fill.reset();
+   refresh_levels();
+}
+
+void market_history_plugin_impl::record_trade( const fill_order_operation& current, const fill_order_operation& open )
+{
+   auto& db = database();
+   auto now = db.head_block_time();
+
+   db.create< order_history_object >( [&]( order_history_object& h )
+   {
+      h.time = now;
+      h.current_owner = current.owner;
+      h.current_orderid = current.orderid;
+      h.current_pays = current.pays;
+      h.open_owner = open.owner;
+      h.open_orderid = open.orderid;
+      h.open_pays = open.pays;
+   });
+
+   // dust trades have no price
+   if( current.pays.amount > 0 && open.pays.amount > 0 )
+   {
+      if( current.pays.symbol == STEEM_SYMBOL )
+         update_buckets( now, current.pays.amount, open.pays.amount );
+      else
+         update_buckets( now, open.pays.amount, current.pays.amount );
+   }
+
+   // trades are kept as long as the buckets of the smallest size
+   if( _tracked_buckets.size() && _maximum_history_per_bucket_size )
+   {
+      uint64_t history = uint64_t( *_tracked_buckets.begin() ) * _maximum_history_per_bucket_size;
+      if( now.sec_since_epoch() > history )
+      {
+         auto cutoff = fc::time_point_sec( now.sec_since_epoch() - history );
+         const auto& history_idx = db.get_index_type< order_history_index >().indices().get< by_time >();
+         auto itr = history_idx.begin();
+         while( itr != history_idx.end() && itr->time < cutoff )
+         {
+            db.remove( *itr );
+            itr = history_idx.begin();
+         }
+      }
+   }
+}
+
+void market_history_plugin_impl::update_buckets( fc::time_point_sec time, share_type steem, share_type sbd )
+{
+   auto& db = database();
+   const auto& bucket_idx = db.get_index_type< bucket_index >().indices().get< by_bucket >();
+   auto trade_price = asset( sbd, SBD_SYMBOL ) / asset( steem, STEEM_SYMBOL );
+
+   for( auto bucket : _tracked_buckets )
+   {
+      auto open = fc::time_point_sec( ( time.sec_since_epoch() / bucket ) * bucket );
+      auto itr = bucket_idx.find( boost::make_tuple( bucket, open ) );
+
+      if( itr == bucket_idx.end() )
+      {
+         db.create< bucket_object >( [&]( bucket_object& b )
+         {
+            b.open = open;
+            b.seconds = bucket;
+            b.high_steem = b.low_steem = b.open_steem = b.close_steem = steem;
+            b.high_sbd = b.low_sbd = b.open_sbd = b.close_sbd = sbd;
+            b.steem_volume = steem;
+            b.sbd_volume = sbd;
+         });
+
+         // a bucket of this size was opened, drop the oldest ones
+         if( _maximum_history_per_bucket_size )
+         {
+            uint64_t history = uint64_t( bucket ) * _maximum_history_per_bucket_size;
+            if( open.sec_since_epoch() > history )
+            {
+               auto cutoff = fc::time_point_sec( open.sec_since_epoch() - history );
+               itr = bucket_idx.lower_bound( boost::make_tuple( bucket, fc::time_point_sec() ) );
+               while( itr != bucket_idx.end() && itr->seconds == bucket && itr->open < cutoff )
+               {
+                  db.remove( *itr );
+                  itr = bucket_idx.lower_bound( boost::make_tuple( bucket, fc::time_point_sec() ) );
+               }
+            }
+         }
+      }
+      else
+      {
+         db.modify( *itr, [&]( bucket_object& b )
+         {
+            b.steem_volume += steem;
+            b.sbd_volume += sbd;
+            b.close_steem = steem;
+            b.close_sbd = sbd;
+
+            if( trade_price > b.high() )
+            {
+               b.high_steem = steem;
+               b.high_sbd = sbd;
+            }
+
+            if( trade_price < b.low() )
+            {
+               b.low_steem = steem;
+               b.low_sbd = sbd;
+            }
+         });
+      }
+   }
+}
+
+void market_history_plugin_impl::refresh_levels()
+{
+   if( _changed_prices.empty() )
+      return;
+
+   auto prices = std::move( _changed_prices );
+   _changed_prices.clear();
+   for( const auto& p : prices )
+      refresh_level( p );
+}
+
+void market_history_plugin_impl::refresh_level( const price& p )
+{
+   auto& db = database();
+   const auto& order_idx = db.get_index_type< limit_order_index >().indices().get< chain::by_price >();
+   const auto& level_idx = db.get_index_type< order_book_level_index >().indices().get< by_sell_price >();
+
+   share_type for_sale = 0;
+   share_type to_receive = 0;
+   uint32_t orders = 0;
+
+   for( auto itr = order_idx.lower_bound( boost::make_tuple( p ) ); itr != order_idx.end() && itr->sell_price == p; ++itr )
+   {
+      for_sale += itr->for_sale;
+      to_receive += itr->amount_to_receive().amount;
+      ++orders;
+   }
+
+   auto level = level_idx.find( p );
+   if( orders == 0 )
+   {
+      if( level != level_idx.end() )
+         db.remove( *level );
+   }
+   else if( level == level_idx.end() )
+   {
+      db.create< order_book_level_object >( [&]( order_book_level_object& l )
+      {
+         l.sell_price = p;
+         l.for_sale = for_sale;
+         l.to_receive = to_receive;
+         l.orders = orders;
+      });
+   }
+   else
+   {
+      db.modify( *level, [&]( order_book_level_object& l )
+      {
+         l.for_sale = for_sale;
+         l.to_receive = to_receive;
+         l.orders = orders;
+      });
+   }
+}
+
+} // detail
+
+market_history_plugin::market_history_plugin() :
+   my( new detail::market_history_plugin_impl( *this ) )
+{
+}
+
+market_history_plugin::~market_history_plugin()
+{
+}
+
+std::string market_history_plugin::plugin_name()const
+{
+   return "market_history";
+}
+
+void market_history_plugin::plugin_set_program_options(
+   boost::program_options::options_description& cli,
+   boost::program_options::options_description& cfg
+   )
+{
+   cli.add_options()
+         ("market-history-bucket-size", boost::program_options::value<string>()->default_value("[15,60,300,3600,86400]"),
+           "Track market history by grouping orders into buckets of equal size measured in seconds specified as a JSON array of numbers")
+         ("market-history-buckets-per-size", boost::program_options::value<uint32_t>()->default_value(5760),
+           "How far back in time to track history for each bucket size, measured in the number of buckets (default: 5760)")
+         ;
+   cfg.add(cli);
+}
+
+void market_history_plugin::plugin_initialize( const boost::program_options::variables_map& options )
+{
+   try
+   {
+      ilog( "market_history: plugin_initialize() begin" );
+
+      database().pre_apply_operation.connect( [&]( const operation_object& o ){ my->on_pre_operation( o ); } );
+      database().post_apply_operation.connect( [&]( const operation_object& o ){ my->on_post_operation( o ); } );
+      database().applied_block.connect( [&]( const signed_block& b ){ my->on_block( b ); } );
+      database().add_index< primary_index< bucket_index > >();
+      database().add_index< primary_index< order_history_index > >();
+      database().add_index< primary_index< order_book_level_index > >();
+      database().get_mutable_index< limit_order_object >().add_observer( std::make_shared< detail::limit_order_observer >( *my ) );
+
+      if( options.count( "market-history-bucket-size" ) )
+      {
+         std::string buckets = options[ "market-history-bucket-size" ].as< string >();
+         my->_tracked_buckets = fc::json::from_string( buckets ).as< flat_set< uint32_t > >();
+         FC_ASSERT( my->_tracked_buckets.find( 0 ) == my->_tracked_buckets.end(), "Market history bucket sizes must be positive" );
+      }
+      if( options.count( "market-history-buckets-per-size" ) )
+         my->_maximum_history_per_bucket_size = options[ "market-history-buckets-per-size" ].as< uint32_t >();
+
+      app().register_api_factory< market_history_api >( "market_history_api" );
+
+      wlog( "market_history: plugin_initialize() end" );
+   } FC_CAPTURE_AND_RETHROW()
+}
+
+void market_history_plugin::plugin_startup()
+{
+   // the plugin was enabled on a node that already has open orders
+   auto& db = database();
+   if( db.get_index_type< order_book_level_index >().indices().empty() )
+   {
+      for( const auto& o : db.get_index_type< limit_order_index >().indices() )
+         my->_changed_prices.insert( o.sell_price );
+      my->refresh_levels();
+   }
+}
+
+flat_set< uint32_t > market_history_plugin::get_tracked_buckets()const
+{
+   return my->_tracked_buckets;
+}
+
+uint32_t market_history_plugin::get_max_history_per_bucket()const
+{
+   return my->_maximum_history_per_bucket_size;
+}
+
+namespace detail
+{
+   /** SBD per STEEM */
+   double real_price( share_type steem, share_type sbd )
+   {
+      return asset( sbd, SBD_SYMBOL ).to_real() / asset( steem, STEEM_SYMBOL ).to_real();
+   }
+
+   market_trade to_trade( const order_history_object& h )
+   {
+      market_trade trade;
+      trade.date = h.time;
+      trade.current_pays = h.current_pays;
+      trade.open_pays = h.open_pays;
+      return trade;
+   }
+
+   /** the bucket size used for the 24 hour ticker and volume, the largest that is at most an hour */
+   uint32_t day_bucket_size( const flat_set< uint32_t >& buckets )
+   {
+      uint32_t result = 0;
+      for( auto b : buckets )
+         if( b <= 3600 || result == 0 )
+            result = b;
+      return result;
+   }
+
+   template< typename LevelIndex >
+   void add_levels( const LevelIndex& level_idx, asset_symbol_type base, asset_symbol_type quote, uint32_t limit, vector< order_book_level >& result )
+   {
+      auto begin = level_idx.lower_bound( price::min( base, quote ) );
+      auto itr = level_idx.upper_bound( price::max( base, quote ) );
+
+      // the best price for the seller is the one with the most base per quote
+      while( itr != begin && result.size() < limit )
+      {
+         --itr;
+         order_book_level level;
+         level.order_price = itr->sell_price;
+         level.orders = itr->orders;
+         if( base == STEEM_SYMBOL )
+         {
+            level.steem = itr->for_sale;
+            level.sbd = itr->to_receive;
+            level.real_price = ( ~itr->sell_price ).to_real();
+         }
+         else
+         {
+            level.steem = itr->to_receive;
+            level.sbd = itr->for_sale;
+            level.real_price = itr->sell_price.to_real();
+         }
+         result.push_back( level );
+      }
+   }
+}
+
+market_history_api::market_history_api( const app::api_context& ctx )
+   : _app( ctx.app )
+{
+}
+
+void market_history_api::on_api_startup()
+{
+}
+
+market_ticker market_history_api::get_ticker()const
+{
+   auto buckets = get_market_history_buckets();
+   auto book = get_order_book( 1 );
+
+   return _app.get_api_executor().execute( [&]() -> market_ticker
+   {
+      market_ticker result;
+      if( book.asks.size() )
+         result.lowest_ask = book.asks[0].real_price;
+      if( book.bids.size() )
+         result.highest_bid = book.bids[0].real_price;
+
+      uint32_t size = detail::day_bucket_size( buckets );
+      if( size == 0 )
+         return result;
+
+      auto db = _app.chain_database();
+      const auto& bucket_idx = db->get_index_type< bucket_index >().indices().get< by_bucket >();
+      auto now = db->head_block_time();
+      auto start = fc::time_point_sec( now.sec_since_epoch() > 86400 ? now.sec_since_epoch() - 86400 : 0 );
+
+      auto itr = bucket_idx.lower_bound( boost::make_tuple( size, start ) );
+      if( itr == bucket_idx.end() || itr->seconds != size )
+      {
+         // no trades in the last 24 hours, the latest price is that of the last bucket
+         if( itr != bucket_idx.begin() )
+         {
+            --itr;
+            if( itr->seconds == size )
+               result.latest = detail::real_price( itr->close_steem, itr->close_sbd );
+         }
+         return result;
+      }
+
+      double open = detail::real_price( itr->open_steem, itr->open_sbd );
+      for( ; itr != bucket_idx.end() && itr->seconds == size; ++itr )
+      {
+         result.steem_volume.amount += itr->steem_volume;
+         result.sbd_volume.amount += itr->sbd_volume;
+         result.latest = detail::real_price( itr->close_steem, itr->close_sbd );
+      }
+      result.percent_change = ( ( result.latest - open ) / open ) * 100;
+
+      return result;
+   });
+}
+
+market_volume market_history_api::get_volume()const
+{
+   auto ticker = get_ticker();
+
+   market_volume result;
+   result.steem_volume = ticker.steem_volume;
+   result.sbd_volume = ticker.sbd_volume;
+   return result;
+}
+
+market_order_book market_history_api::get_order_book( uint32_t limit )const
+{
+   FC_ASSERT( limit <= 500 );
+
+   return _app.get_api_executor().execute( [&]() -> market_order_book
+   {
+      const auto& level_idx = _app.chain_database()->get_index_type< order_book_level_index >().indices().get< by_sell_price >();
+
+      market_order_book result;
+      detail::add_levels( level_idx, SBD_SYMBOL, STEEM_SYMBOL, limit, result.bids );
+      detail::add_levels( level_idx, STEEM_SYMBOL, SBD_SYMBOL, limit, result.asks );
+      return result;
+   });
+}
+
+vector< market_trade > market_history_api::get_trade_history( time_point_sec start, time_point_sec end, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+
+   return _app.get_api_executor().execute( [&]() -> vector< market_trade >
+   {
+      const auto& history_idx = _app.chain_database()->get_index_type< order_history_index >().indices().get< by_time >();
+
+      vector< market_trade > result;
+      for( auto itr = history_idx.lower_bound( start ); itr != history_idx.end() && itr->time <= end && result.size() < limit; ++itr )
+         result.push_back( detail::to_trade( *itr ) );
+      return result;
+   });
+}
+
+vector< market_trade > market_history_api::get_recent_trades( uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+
+   return _app.get_api_executor().execute( [&]() -> vector< market_trade >
+   {
+      const auto& history_idx = _app.chain_database()->get_index_type< order_history_index >().indices().get< by_time >();
+
+      vector< market_trade > result;
+      for( auto itr = history_idx.rbegin(); itr != history_idx.rend() && result.size() < limit; ++itr )
+         result.push_back( detail::to_trade( *itr ) );
+      return result;
+   });
+}
+
+vector< bucket_object > market_history_api::get_market_history( uint32_t bucket_seconds, time_point_sec start, time_point_sec end )const
+{
+   return _app.get_api_executor().execute( [&]() -> vector< bucket_object >
+   {
+      const auto& bucket_idx = _app.chain_database()->get_index_type< bucket_index >().indices().get< by_bucket >();
+
+      vector< bucket_object > result;
+      for( auto itr = bucket_idx.lower_bound( boost::make_tuple( bucket_seconds, start ) );
+           itr != bucket_idx.end() && itr->seconds == bucket_seconds && itr->open <= end && result.size() < 200;
+           ++itr )
+         result.push_back( *itr );
+      return result;
+   });
+}
+
+flat_set< uint32_t > market_history_api::get_market_history_buckets()const
+{
+   auto plugin = _app.get_plugin< market_history_plugin >( "market_history" );
+   FC_ASSERT( plugin, "The market_history plugin is not enabled" );
+   return plugin->get_tracked_buckets();
+}
+
+} } // steemit::market_history
+
+STEEMIT_DEFINE_PLUGIN( market_history, steemit::market_history::market_history_plugin )
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <steemit/chain/protocol/types.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace steemit { namespace private_message {
+
+using std::string;
+using std::vector;
+using chain::public_key_type;
+
+/**
+ *  A message in the message_log.  Messages are linked to the previous message to the same
+ *  recipient and from the same sender, by their position in the log.
+ */
+struct stored_message
+{
+   uint64_t             position = 0;       ///< of the message in the log, 0 while its block is reversible
+   uint32_t             block_num = 0;
+   string               from;
+   string               to;
+   public_key_type      from_memo_key;
+   public_key_type      to_memo_key;
+   uint64_t             sent_time = 0;
+   fc::time_point_sec   receive_time;
+   uint32_t             checksum = 0;
+   uint32_t             size = 0;           ///< of encrypted_message
+   uint64_t             previous_to = 0;    ///< the previous message to the same recipient, 0 if none
+   uint64_t             previous_from = 0;  ///< the previous message from the same sender, 0 if none
+   vector<char>         encrypted_message;  ///< only loaded when requested
+};
+
+/**
+ *  An append only file of the messages of irreversible blocks.  Each message is linked to
+ *  the previous one of its recipient and of its sender, so only the position of the newest
+ *  message of each account is kept in memory and an inbox is read from the newest message
+ *  back.  The headers of messages are read without their encrypted payloads.
+ *
+ *  May be read from any thread while messages are appended, reads see the messages up to the
+ *  last flush.  Positions are checked to be within the log and to hold a plausible message, a
+ *  read at any other position fails without affecting later reads or appends.
+ */
+class message_log
+{
+   public:
+      void open( const fc::path& dir );
+      bool is_open()const;
+      void close();
+
+      /** the messages of every block up to this one are already stored */
+      uint32_t last_block_num()const;
+
+      /** m.position, m.size and the links are set by the log */
+      void append( const stored_message& m );
+
+      /** records that every message of the blocks up to block_num was appended */
+      void set_last_block_num( uint32_t block_num );
+
+      /** writes the appended messages, then the last block number */
+      void flush();
+
+      /** the position of the newest message to or from account, 0 if there is none */
+      uint64_t newest_to( const string& account )const;
+      uint64_t newest_from( const string& account )const;
+
+      stored_message read( uint64_t position, bool load_payload )const;
+
+   private:
+      struct account_positions
+      {
+         uint64_t newest_to = 0;
+         uint64_t newest_from = 0;
+      };
+
+      /** the header of the message at position, which must end within the first size bytes */
+      stored_message read_header( std::istream& in, uint64_t position, uint64_t size, uint64_t& end )const;
+
+      mutable std::mutex                                    _mutex;
+      std::fstream                                          _file;      ///< only appended to
+      mutable std::ifstream                                 _reader;
+      fc::path                                              _last_block_path;
+      uint64_t                                              _size = 0;
+      uint64_t                                              _flushed_size = 0;  ///< readable by _reader
+      uint32_t                                              _last_block_num = 0;
+      std::unordered_map< string, account_positions >       _accounts;
+};
+
+} } // steemit::private_message
+
+FC_REFLECT( steemit::private_message::stored_message,
+            (position)(block_num)(from)(to)(from_memo_key)(to_memo_key)(sent_time)(receive_time)(checksum)(size)
+            (previous_to)(previous_from)(encrypted_message) )
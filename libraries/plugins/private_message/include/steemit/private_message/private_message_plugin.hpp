@@ -25,9 +25,9 @@
 
 #include <steemit/app/plugin.hpp>
 #include <steemit/chain/database.hpp>
+#include <steemit/private_message/message_log.hpp>
 
-#include <graphene/db/generic_index.hpp>
-#include <boost/multi_index/composite_key.hpp>
+#include <graphene/db/object.hpp>
 
 #include <fc/thread/future.hpp>
 #include <fc/api.hpp>
@@ -87,6 +87,7 @@ class  message_object : public abstract_object<message_object> {
       fc::time_point_sec receive_time; /// time received by blockchain
       uint32_t           checksum = 0;
       vector<char>       encrypted_message;
+      uint32_t           block_num = 0;
 };
 
 struct extended_message_object : public message_object {
@@ -105,43 +106,16 @@ struct private_message_operation {
     vector<char>       encrypted_message;
 };
 
-struct by_to_date;
-struct by_from_date;
-struct by_id;
-
-using namespace boost::multi_index;
-
-typedef multi_index_container<
-   message_object,
-   indexed_by<
-      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
-      ordered_unique< tag< by_to_date >, 
-            composite_key< message_object,
-               member< message_object, string, &message_object::to >,
-               member< message_object, time_point_sec, &message_object::receive_time >,
-               member<object, object_id_type, &object::id >
-            >,
-            composite_key_compare< std::less<string>, std::greater< time_point_sec >, std::less< object_id_type > >
-      >,
-      ordered_unique< tag< by_from_date >, 
-            composite_key< message_object,
-               member< message_object, string, &message_object::from >,
-               member< message_object, time_point_sec, &message_object::receive_time >,
-               member<object, object_id_type, &object::id >
-            >,
-            composite_key_compare< std::less<string>, std::greater< time_point_sec >, std::less< object_id_type > >
-      >
-   >
-> message_multi_index_type;
-
-typedef graphene::db::generic_index< message_object, message_multi_index_type> private_message_index;
-
-
-
 /**
  *   This plugin scans the blockchain for custom operations containing a valid message and authorized
  *   by the posting key.
- *  
+ *
+ *   Blocks are scanned on the plugin's own operation_queue consumer thread, so messages add no
+ *   time to block application.  Messages are kept in memory while their block is reversible and
+ *   dropped when the block is popped.  Once it is irreversible they are moved to a message_log in
+ *   the private_message directory of the data dir, so memory does not grow with every message
+ *   ever sent.  On startup the blocks after the last one in the log are replayed from the block
+ *   log, since the messages of reversible blocks are not saved.
  */
 class private_message_plugin : public steemit::app::plugin
 {
@@ -158,11 +132,29 @@ class private_message_plugin : public steemit::app::plugin
 
 
       flat_map<string,string> tracked_accounts()const; /// map start_range to end_range
+      const message_log& get_message_log()const;
+
+      /**
+       *  The messages of reversible blocks to (inbox) or from account, newest first, and the
+       *  position of the newest stored message of account at the same time, so no message is
+       *  missed or returned twice while a block becomes irreversible.
+       */
+      vector<stored_message> get_reversible_messages( const string& account, bool inbox, bool include_messages,
+                                                      uint64_t& newest_position )const;
 
       friend class detail::private_message_plugin_impl;
       std::unique_ptr<detail::private_message_plugin_impl> my;
 };
 
+/**
+ *  A page of an inbox or outbox, newest first.  Messages of reversible blocks have position 0.
+ */
+struct message_page
+{
+   vector<stored_message>  messages;
+   uint64_t                next = 0; ///< the position to start the next page at, 0 if there are no older messages
+};
+
 class private_message_api : public std::enable_shared_from_this<private_message_api> {
    public:
       private_message_api(){};
@@ -174,12 +166,27 @@ class private_message_api : public std::enable_shared_from_this<private_message_
       }
       
       /**
-       *
+       *  Up to limit messages received no later than newest, newest first.
        */
       vector<message_object> get_inbox( string to, time_point newest, uint16_t limit )const;
       vector<message_object> get_outbox( string from, time_point newest, uint16_t limit )const;
 
+      /**
+       *  Up to limit messages starting at the stored message at start, newest first.  Pass
+       *  uint64_t(-1) to start at the newest message, the first page also includes every message
+       *  of a reversible block.  Encrypted messages are only included if include_messages is set,
+       *  otherwise they can be read with get_encrypted_message.
+       */
+      message_page get_inbox_page( string to, uint64_t start, uint16_t limit, bool include_messages )const;
+      message_page get_outbox_page( string from, uint64_t start, uint16_t limit, bool include_messages )const;
+
+      /** the encrypted message of the stored message at position */
+      vector<char> get_encrypted_message( uint64_t position )const;
+
    private:
+      vector<message_object> get_messages( const string& account, bool inbox, time_point newest, uint16_t limit )const;
+      message_page get_page( const string& account, bool inbox, uint64_t start, uint16_t limit, bool include_messages )const;
+
       app::application* _app = nullptr;
 };
 
@@ -187,12 +194,13 @@ class private_message_api : public std::enable_shared_from_this<private_message_
 
 } } //steemit::private_message
 
-FC_API( steemit::private_message::private_message_api, (get_inbox)(get_outbox) );
+FC_API( steemit::private_message::private_message_api, (get_inbox)(get_outbox)(get_inbox_page)(get_outbox_page)(get_encrypted_message) );
 
 FC_REFLECT( steemit::private_message::message_body, (thread_start)(subject)(body)(json_meta)(cc) );
-FC_REFLECT_DERIVED( steemit::private_message::message_object, (graphene::db::object), (from)(to)(from_memo_key)(to_memo_key)(sent_time)(receive_time)(checksum)(encrypted_message) );
+FC_REFLECT_DERIVED( steemit::private_message::message_object, (graphene::db::object), (from)(to)(from_memo_key)(to_memo_key)(sent_time)(receive_time)(checksum)(encrypted_message)(block_num) );
 FC_REFLECT_DERIVED( steemit::private_message::extended_message_object, (steemit::private_message::message_object), (message) );
 
+FC_REFLECT( steemit::private_message::message_page, (messages)(next) );
 FC_REFLECT( steemit::private_message::private_message_operation, (from)(to)(from_memo_key)(to_memo_key)(sent_time)(checksum)(encrypted_message) );
 
 
@@ -0,0 +1,249 @@
+#include <steemit/private_message/message_log.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace steemit { namespace private_message {
+
+namespace {
+
+/** the fields of a stored_message that are written before its payload */
+struct record_header
+{
+   uint32_t             block_num = 0;
+   string               from;
+   string               to;
+   public_key_type      from_memo_key;
+   public_key_type      to_memo_key;
+   uint64_t             sent_time = 0;
+   fc::time_point_sec   receive_time;
+   uint32_t             checksum = 0;
+   uint32_t             size = 0;
+   uint64_t             previous_to = 0;
+   uint64_t             previous_from = 0;
+};
+
+/** written at the start of the file, so no message is at position 0 */
+const uint64_t log_magic = 0x31474f4c4d50ull; // "PMLOG1"
+
+/** far more than two account names and memo keys take, so a read at a position that is not
+ *  the start of a message fails before allocating an arbitrary amount of memory */
+const uint32_t max_header_size = 1024;
+
+} } } // steemit::private_message::<anonymous>
+
+FC_REFLECT( steemit::private_message::record_header,
+            (block_num)(from)(to)(from_memo_key)(to_memo_key)(sent_time)(receive_time)(checksum)(size)(previous_to)(previous_from) )
+
+namespace steemit { namespace private_message {
+
+void message_log::open( const fc::path& dir )
+{ try {
+   std::lock_guard< std::mutex > lock( _mutex );
+   fc::create_directories( dir );
+   auto path = dir / "messages";
+   _last_block_path = dir / "last_block";
+
+   _accounts.clear();
+   _last_block_num = 0;
+   _size = sizeof( log_magic );
+
+   if( fc::exists( _last_block_path ) )
+   {
+      std::ifstream in( _last_block_path.generic_string().c_str(), std::ifstream::binary );
+      in.read( (char*)&_last_block_num, sizeof( _last_block_num ) );
+      if( !in )
+         _last_block_num = 0;
+   }
+
+   if( !fc::exists( path ) )
+   {
+      std::ofstream out( path.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      out.write( (const char*)&log_magic, sizeof( log_magic ) );
+   }
+   else
+   {
+      // rebuild the newest message of each account
+      uint64_t file_size = fc::file_size( path );
+      std::ifstream in( path.generic_string().c_str(), std::ifstream::binary );
+      uint64_t magic = 0;
+      in.read( (char*)&magic, sizeof( magic ) );
+      FC_ASSERT( in && magic == log_magic, "${p} is not a private message log", ("p", path) );
+
+      while( _size < file_size )
+      {
+         uint64_t end = 0;
+         try
+         {
+            auto m = read_header( in, _size, file_size, end );
+            _accounts[ m.to ].newest_to = _size;
+            _accounts[ m.from ].newest_from = _size;
+            _last_block_num = std::max( _last_block_num, m.block_num );
+         }
+         catch( const fc::exception& )
+         {
+            break;
+         }
+         _size = end;
+      }
+
+      if( _size < file_size )
+      {
+         wlog( "Dropping ${n} bytes of an incomplete message at the end of ${p}", ("n", file_size - _size)("p", path) );
+         in.close();
+         fc::resize_file( path, _size );
+      }
+   }
+
+   _file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _file.open( path.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   _reader.open( path.generic_string().c_str(), std::ifstream::binary );
+   _flushed_size = _size;
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool message_log::is_open()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   return _file.is_open();
+}
+
+void message_log::close()
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _file.close();
+   _reader.close();
+}
+
+uint32_t message_log::last_block_num()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   return _last_block_num;
+}
+
+void message_log::append( const stored_message& m )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   auto& from = _accounts[ m.from ];
+   auto& to = _accounts[ m.to ];
+
+   record_header h;
+   h.block_num     = m.block_num;
+   h.from          = m.from;
+   h.to            = m.to;
+   h.from_memo_key = m.from_memo_key;
+   h.to_memo_key   = m.to_memo_key;
+   h.sent_time     = m.sent_time;
+   h.receive_time  = m.receive_time;
+   h.checksum      = m.checksum;
+   h.size          = m.encrypted_message.size();
+   h.previous_to   = to.newest_to;
+   h.previous_from = from.newest_from;
+
+   auto header = fc::raw::pack( h );
+   uint32_t header_size = header.size();
+
+   try
+   {
+      _file.seekp( _size );
+      _file.write( (const char*)&header_size, sizeof( header_size ) );
+      _file.write( header.data(), header.size() );
+      if( h.size )
+         _file.write( m.encrypted_message.data(), h.size );
+   }
+   catch( ... )
+   {
+      // the next append overwrites what was written of this message
+      _file.clear();
+      throw;
+   }
+
+   to.newest_to = _size;
+   from.newest_from = _size;
+   _last_block_num = std::max( _last_block_num, m.block_num );
+   _size += sizeof( header_size ) + header.size() + h.size;
+}
+
+void message_log::set_last_block_num( uint32_t block_num )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _last_block_num = std::max( _last_block_num, block_num );
+}
+
+void message_log::flush()
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _file.flush();
+   _flushed_size = _size;
+
+   // only after the messages, so a crash does not skip any of them
+   std::ofstream out( _last_block_path.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+   out.write( (const char*)&_last_block_num, sizeof( _last_block_num ) );
+}
+
+uint64_t message_log::newest_to( const string& account )const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   auto itr = _accounts.find( account );
+   return itr == _accounts.end() ? 0 : itr->second.newest_to;
+}
+
+uint64_t message_log::newest_from( const string& account )const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   auto itr = _accounts.find( account );
+   return itr == _accounts.end() ? 0 : itr->second.newest_from;
+}
+
+stored_message message_log::read( uint64_t position, bool load_payload )const
+{ try {
+   std::lock_guard< std::mutex > lock( _mutex );
+   FC_ASSERT( _reader.is_open(), "The private message log is not open" );
+   FC_ASSERT( position >= sizeof( log_magic ) && position < _flushed_size, "No message at ${p}", ("p", position) );
+
+   // positions come from API callers, a failed read must not affect the next one
+   _reader.clear();
+   uint64_t end = 0;
+   auto result = read_header( _reader, position, _flushed_size, end );
+   if( load_payload && result.size )
+   {
+      result.encrypted_message.resize( result.size );
+      _reader.read( result.encrypted_message.data(), result.size );
+      FC_ASSERT( _reader, "Unable to read the message at ${p}", ("p", position) );
+   }
+   return result;
+} FC_CAPTURE_AND_RETHROW( (position) ) }
+
+stored_message message_log::read_header( std::istream& in, uint64_t position, uint64_t size, uint64_t& end )const
+{
+   uint32_t header_size = 0;
+   in.seekg( position );
+   in.read( (char*)&header_size, sizeof( header_size ) );
+   FC_ASSERT( in, "Unable to read the message at ${p}", ("p", position) );
+   FC_ASSERT( header_size <= max_header_size && position + sizeof( header_size ) + header_size <= size,
+              "No message at ${p}", ("p", position) );
+
+   vector<char> header( header_size );
+   if( header_size )
+      in.read( header.data(), header_size );
+   FC_ASSERT( in, "Unable to read the message at ${p}", ("p", position) );
+   auto h = fc::raw::unpack< record_header >( header );
+
+   end = position + sizeof( header_size ) + header_size + h.size;
+   FC_ASSERT( end <= size, "No message at ${p}", ("p", position) );
+
+   stored_message result;
+   result.position      = position;
+   result.block_num     = h.block_num;
+   result.from          = std::move( h.from );
+   result.to            = std::move( h.to );
+   result.from_memo_key = h.from_memo_key;
+   result.to_memo_key   = h.to_memo_key;
+   result.sent_time     = h.sent_time;
+   result.receive_time  = h.receive_time;
+   result.checksum      = h.checksum;
+   result.size          = h.size;
+   result.previous_to   = h.previous_to;
+   result.previous_from = h.previous_from;
+   return result;
+}
+
+} } // steemit::private_message
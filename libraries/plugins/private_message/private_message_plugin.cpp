@@ -25,6 +25,7 @@
 #include <steemit/private_message/private_message_plugin.hpp>
 
 #include <steemit/app/impacted.hpp>
+#include <steemit/app/operation_queue.hpp>
 
 #include <steemit/chain/config.hpp>
 #include <steemit/chain/database.hpp>
@@ -33,6 +34,9 @@
 #include <fc/smart_ref_impl.hpp>
 #include <fc/thread/thread.hpp>
 
+#include <map>
+#include <mutex>
+
 namespace steemit { namespace private_message {
 
 namespace detail
@@ -51,10 +55,28 @@ class private_message_plugin_impl
          return _self.database();
       }
 
-      void on_operation( const operation_object& op_obj );
+      optional<stored_message> get_message( const operation_object& op_obj, fc::time_point_sec receive_time )const;
+      void apply_block( const app::operation_batch& batch );
+      void undo_block( const app::operation_batch& batch );
+      bool is_tracked( const string& account )const;
+      void open_log();
+
+      struct reversible_block
+      {
+         block_id_type           id;
+         vector<stored_message>  messages;
+      };
 
       private_message_plugin& _self;
       flat_map<string,string> _tracked_accounts;
+      fc::path                _log_dir;
+      message_log             _log;
+
+      std::shared_ptr<app::operation_consumer> _consumer;
+
+      /** guards _reversible and moving its messages to _log */
+      mutable std::mutex                       _mutex;
+      std::map<uint32_t, reversible_block>     _reversible;
 };
 
 private_message_plugin_impl::~private_message_plugin_impl()
@@ -62,9 +84,7 @@ private_message_plugin_impl::~private_message_plugin_impl()
    return;
 }
 
-void private_message_plugin_impl::on_operation( const operation_object& op_obj ) {
-   steemit::chain::database& db = database();
-
+optional<stored_message> private_message_plugin_impl::get_message( const operation_object& op_obj, fc::time_point_sec receive_time )const {
    try {
       optional<private_message_operation> opm;
 
@@ -87,34 +107,99 @@ void private_message_plugin_impl::on_operation( const operation_object& op_obj )
       if( opm ) {
          const auto& pm = *opm;
 
-         auto to_itr   = _tracked_accounts.lower_bound(pm.to);
-         auto from_itr = _tracked_accounts.lower_bound(pm.from);
-
          FC_ASSERT( pm.from != pm.to );
          FC_ASSERT( pm.from_memo_key != pm.to_memo_key );
          FC_ASSERT( pm.sent_time != 0 );
          FC_ASSERT( pm.encrypted_message.size() >= 32 );
 
-         if( !_tracked_accounts.size() ||
-             (to_itr != _tracked_accounts.end() && pm.to >= to_itr->first && pm.to <= to_itr->second) ||
-             (from_itr != _tracked_accounts.end() && pm.from >= from_itr->first && pm.from <= from_itr->second) ) 
+         if( is_tracked( pm.to ) || is_tracked( pm.from ) )
          {
-            db.create<message_object>( [&]( message_object& pmo ) {
-               pmo.from               = pm.from;
-               pmo.to                 = pm.to;
-               pmo.from_memo_key      = pm.from_memo_key;
-               pmo.to_memo_key        = pm.to_memo_key;
-               pmo.checksum           = pm.checksum;
-               pmo.sent_time          = pm.sent_time;
-               pmo.receive_time       = db.head_block_time();
-               pmo.encrypted_message  = pm.encrypted_message;
-            });
+            stored_message m;
+            m.block_num          = op_obj.block;
+            m.from               = pm.from;
+            m.to                 = pm.to;
+            m.from_memo_key      = pm.from_memo_key;
+            m.to_memo_key        = pm.to_memo_key;
+            m.checksum           = pm.checksum;
+            m.sent_time          = pm.sent_time;
+            m.receive_time       = receive_time;
+            m.size               = pm.encrypted_message.size();
+            m.encrypted_message  = pm.encrypted_message;
+            return m;
          }
       }
 
    } catch ( const fc::exception& ) {
-      if( db.is_producing() ) throw;
+      // not a valid message, it is ignored
+   }
+   return optional<stored_message>();
+}
+
+bool private_message_plugin_impl::is_tracked( const string& account )const
+{
+   if( _tracked_accounts.empty() )
+      return true;
+
+   // the last range starting at or before account
+   auto itr = _tracked_accounts.upper_bound( account );
+   if( itr == _tracked_accounts.begin() )
+      return false;
+   --itr;
+   return account >= itr->first && account < itr->second;
+}
+
+void private_message_plugin_impl::open_log()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( !_log.is_open() )
+      _log.open( _log_dir );
+}
+
+/**
+ *  Keeps the messages of the block until it is irreversible and moves the messages of blocks
+ *  that became irreversible to the log.  Blocks the log already has are not appended again, they
+ *  are seen again when the chain is reindexed.
+ */
+void private_message_plugin_impl::apply_block( const app::operation_batch& batch )
+{
+   open_log();
+
+   reversible_block block;
+   block.id = batch.block_id;
+   for( const auto& op : batch.operations )
+   {
+      auto m = get_message( op, batch.timestamp );
+      if( m )
+         block.messages.push_back( std::move( *m ) );
+   }
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   _reversible[ batch.block_num ] = std::move( block );
+
+   auto last_block_num = _log.last_block_num();
+   if( batch.last_irreversible_block_num <= last_block_num )
+   {
+      // still behind the log while reindexing
+      _reversible.erase( _reversible.begin(), _reversible.upper_bound( last_block_num ) );
+      return;
    }
+
+   auto end = _reversible.upper_bound( batch.last_irreversible_block_num );
+   for( auto itr = _reversible.upper_bound( last_block_num ); itr != end; ++itr )
+      for( const auto& m : itr->second.messages )
+         _log.append( m );
+   _reversible.erase( _reversible.begin(), end );
+
+   _log.set_last_block_num( batch.last_irreversible_block_num );
+   _log.flush();
+}
+
+void private_message_plugin_impl::undo_block( const app::operation_batch& batch )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _reversible.find( batch.block_num );
+   if( itr != _reversible.end() && itr->second.id == batch.block_id )
+      _reversible.erase( itr );
 }
 
 } // end namespace detail
@@ -148,45 +233,127 @@ void private_message_plugin::plugin_set_program_options(
 void private_message_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
    ilog("Intializing private message plugin" );
-   database().on_applied_operation.connect( [&]( const operation_object& b){ my->on_operation(b); } );
-   database().add_index< primary_index< private_message_index  > >();
-
    app().register_api_factory<private_message_api>("private_message_api");
 
    typedef pair<string,string> pairstring;
-   LOAD_VALUE_SET(options, "pm-accounts", my->_tracked_accounts, pairstring);
+   LOAD_VALUE_SET(options, "pm-account-range", my->_tracked_accounts, pairstring);
+
+   // the log is opened by the consumer thread, which must not use the database
+   my->_log_dir = app().data_dir() / "private_message";
+
+   my->_consumer = app().get_operation_queue().subscribe( "private_message",
+      [this]( const app::operation_batch& b ){ my->apply_block( b ); },
+      [this]( const app::operation_batch& b ){ my->undo_block( b ); } );
 }
 
+namespace {
+
+message_object to_message_object( stored_message&& m )
+{
+   message_object result;
+   result.block_num         = m.block_num;
+   result.from              = std::move( m.from );
+   result.to                = std::move( m.to );
+   result.from_memo_key     = m.from_memo_key;
+   result.to_memo_key       = m.to_memo_key;
+   result.sent_time         = m.sent_time;
+   result.receive_time      = m.receive_time;
+   result.checksum          = m.checksum;
+   result.encrypted_message = std::move( m.encrypted_message );
+   return result;
+}
+
+} // anonymous namespace
+
 vector<message_object> private_message_api::get_inbox( string to, time_point newest, uint16_t limit )const {
+   return get_messages( to, true, newest, limit );
+}
+
+vector<message_object> private_message_api::get_outbox( string from, time_point newest, uint16_t limit )const {
+   return get_messages( from, false, newest, limit );
+}
+
+vector<message_object> private_message_api::get_messages( const string& account, bool inbox, time_point newest, uint16_t limit )const {
    FC_ASSERT( limit <= 100 );
    vector<message_object> result;
-   const auto& idx = _app->chain_database()->get_index_type<private_message_index>().indices().get<by_to_date>();
-   auto itr = idx.lower_bound( std::make_tuple( to, newest ) );
-   while( itr != idx.end() && limit && itr->to == to ) {
-      result.push_back(*itr);
-      ++itr;
+   auto plugin = _app->get_plugin<private_message_plugin>( "private_message" );
+
+   // messages of reversible blocks are newer than any in the log
+   uint64_t pos = 0;
+   for( auto& m : plugin->get_reversible_messages( account, inbox, true, pos ) ) {
+      if( !limit )
+         return result;
+      if( m.receive_time > newest )
+         continue;
+      result.push_back( to_message_object( std::move( m ) ) );
       --limit;
    }
 
+   const auto& log = plugin->get_message_log();
+   while( pos && limit ) {
+      auto m = log.read( pos, false );
+      pos = inbox ? m.previous_to : m.previous_from;
+      if( m.receive_time > newest )
+         continue;
+      result.push_back( to_message_object( log.read( m.position, true ) ) );
+      --limit;
+   }
    return result;
 }
 
-vector<message_object> private_message_api::get_outbox( string from, time_point newest, uint16_t limit )const {
-   FC_ASSERT( limit <= 100 );
-   vector<message_object> result;
-   const auto& idx = _app->chain_database()->get_index_type<private_message_index>().indices().get<by_from_date>();
+message_page private_message_api::get_inbox_page( string to, uint64_t start, uint16_t limit, bool include_messages )const {
+   return get_page( to, true, start, limit, include_messages );
+}
 
-   auto itr = idx.lower_bound( std::make_tuple( from, newest ) );
-   while( itr != idx.end() && limit && itr->from == from ) {
-      result.push_back(*itr);
-      ++itr;
-      --limit;
+message_page private_message_api::get_outbox_page( string from, uint64_t start, uint16_t limit, bool include_messages )const {
+   return get_page( from, false, start, limit, include_messages );
+}
+
+message_page private_message_api::get_page( const string& account, bool inbox, uint64_t start, uint16_t limit, bool include_messages )const {
+   FC_ASSERT( limit <= 100 );
+   message_page result;
+   auto plugin = _app->get_plugin<private_message_plugin>( "private_message" );
+   const auto& log = plugin->get_message_log();
+
+   if( start == uint64_t(-1) )
+      result.messages = plugin->get_reversible_messages( account, inbox, include_messages, start );
+
+   auto pos = start;
+   for( ; pos && limit; --limit ) {
+      auto m = log.read( pos, include_messages );
+      FC_ASSERT( ( inbox ? m.to : m.from ) == account, "The message at ${p} is not ${b} ${a}",
+                 ("p", pos)("b", inbox ? "to" : "from")("a", account) );
+      pos = inbox ? m.previous_to : m.previous_from;
+      result.messages.push_back( std::move( m ) );
    }
+   result.next = pos;
    return result;
 }
 
+vector<char> private_message_api::get_encrypted_message( uint64_t position )const {
+   const auto& log = _app->get_plugin<private_message_plugin>( "private_message" )->get_message_log();
+   return log.read( position, true ).encrypted_message;
+}
+
+/**
+ *  The messages of reversible blocks were lost when the node stopped, they are read again from
+ *  the blocks after the last one in the log that were not seen while the chain was replayed.
+ */
 void private_message_plugin::plugin_startup()
 {
+   auto& queue = app().get_operation_queue();
+   queue.flush( *my->_consumer );
+   my->open_log();
+
+   uint32_t first_block = my->_log.last_block_num() + 1;
+   {
+      std::lock_guard<std::mutex> lock( my->_mutex );
+      if( !my->_reversible.empty() )
+         first_block = std::max( first_block, my->_reversible.rbegin()->first + 1 );
+   }
+   if( first_block <= database().head_block_num() )
+      ilog( "Reading private messages of blocks ${f} to ${h}", ("f", first_block)("h", database().head_block_num()) );
+   queue.replay( *my->_consumer, first_block );
 }
 
 flat_map<string,string> private_message_plugin::tracked_accounts() const
@@ -194,6 +361,30 @@ flat_map<string,string> private_message_plugin::tracked_accounts() const
    return my->_tracked_accounts;
 }
 
+const message_log& private_message_plugin::get_message_log()const
+{
+   return my->_log;
+}
+
+vector<stored_message> private_message_plugin::get_reversible_messages( const string& account, bool inbox, bool include_messages,
+                                                                        uint64_t& newest_position )const
+{
+   vector<stored_message> result;
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   for( auto block = my->_reversible.rbegin(); block != my->_reversible.rend(); ++block ) {
+      const auto& messages = block->second.messages;
+      for( auto itr = messages.rbegin(); itr != messages.rend(); ++itr ) {
+         if( ( inbox ? itr->to : itr->from ) != account )
+            continue;
+         result.push_back( *itr );
+         if( !include_messages )
+            result.back().encrypted_message.clear();
+      }
+   }
+   newest_position = inbox ? my->_log.newest_to( account ) : my->_log.newest_from( account );
+   return result;
+}
+
 } }
 
 STEEMIT_DEFINE_PLUGIN( private_message, steemit::private_message::private_message_plugin )
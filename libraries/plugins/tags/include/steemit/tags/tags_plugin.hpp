@@ -27,6 +27,16 @@ using namespace boost::multi_index;
 #define TAG_SPACE_ID 5
 #endif
 
+/** recommendations kept per account, the rest are dropped lowest score first */
+#ifndef TAGS_RECOMMENDATIONS_PER_ACCOUNT
+#define TAGS_RECOMMENDATIONS_PER_ACCOUNT 100
+#endif
+
+/** accounts, highest rank first, whose recommendations are updated by a vote of their peer */
+#ifndef TAGS_RECOMMENDATION_FANOUT
+#define TAGS_RECOMMENDATION_FANOUT 100
+#endif
+
 
 enum tags_object_type
 {
@@ -35,12 +45,19 @@ enum tags_object_type
    message_object_type = 2,
    tag_object_type = 3,
    tag_stats_object_type = 4,
-   peer_stats_object_type = 5
+   peer_stats_object_type = 5,
+   comment_summary_object_type = 6,
+   recommendation_object_type = 7
 };
 
 
 namespace detail { class tags_plugin_impl; }
 
+class tag_stats_object;
+
+/** tags are interned, the id of a tag is the id of its tag_stats_object */
+typedef object_id< TAG_SPACE_ID, tag_stats_object_type, tag_stats_object > tag_id_type;
+
 
 /**
  *  The purpose of the tag object is to allow the generation and listing of
@@ -52,13 +69,16 @@ namespace detail { class tags_plugin_impl; }
  *  4. netvotes - individual accounts voting for post minus accounts voting against it
  *
  *  When ever a comment is modified, all tag_objects for that comment are updated to match.
+ *
+ *  Every index is partitioned by the integer id of the tag rather than its name, so keeping
+ *  them sorted as votes arrive only compares integers within the partition of the tag.
  */
 class  tag_object : public abstract_object<tag_object> {
    public:
       static const uint8_t space_id = TAG_SPACE_ID;
       static const uint8_t type_id  = tag_object_type;
 
-      string             tag;
+      tag_id_type        tag;
       time_point_sec     created;
       time_point_sec     active;
       time_point_sec     cashout;
@@ -103,91 +123,91 @@ typedef multi_index_container<
       ordered_non_unique< tag< by_comment >, member< tag_object, comment_id_type, &tag_object::comment > >,
       ordered_unique< tag< by_parent_created >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, time_point_sec, &tag_object::created >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_active >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, time_point_sec, &tag_object::active >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_net_rshares >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, int64_t, &tag_object::net_rshares >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< int64_t >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< int64_t >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_net_votes >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, int32_t, &tag_object::net_votes >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< int32_t >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< int32_t >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_children >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, int32_t, &tag_object::children >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< int32_t >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< int32_t >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_hot >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, double, &tag_object::hot >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< double >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< double >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_parent_children_rshares2 >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, comment_id_type, &tag_object::parent >,
                member< tag_object, fc::uint128_t, &tag_object::children_rshares2 >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<comment_id_type>, std::greater< fc::uint128_t >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<comment_id_type>, std::greater< fc::uint128_t >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_cashout >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, time_point_sec, &tag_object::cashout >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::greater< time_point_sec >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_net_rshares >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, int64_t, &tag_object::net_rshares >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::greater< int64_t >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::greater< int64_t >, std::less< object_id_type > >
       >,
       ordered_unique< tag< by_author_parent_created >,
             composite_key< tag_object,
-               member< tag_object, string, &tag_object::tag >,
+               member< tag_object, tag_id_type, &tag_object::tag >,
                member< tag_object, account_id_type, &tag_object::author >,
                member< tag_object, time_point_sec, &tag_object::created >,
                member<object, object_id_type, &object::id >
             >,
-            composite_key_compare< std::less<string>, std::less<account_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
+            composite_key_compare< std::less<tag_id_type>, std::less<account_id_type>, std::greater< time_point_sec >, std::less< object_id_type > >
       >
    >
 > tag_multi_index_type;
@@ -291,6 +311,7 @@ class  peer_stats_object : public abstract_object<peer_stats_object> {
 
 struct by_rank;
 struct by_voter_peer;
+struct by_peer;
 typedef multi_index_container<
    peer_stats_object,
    indexed_by<
@@ -309,6 +330,14 @@ typedef multi_index_container<
             member< peer_stats_object, account_id_type, &peer_stats_object::peer >
          >,
          composite_key_compare< std::less<account_id_type>,  std::less<account_id_type> >
+      >,
+      ordered_unique< tag< by_peer >,
+         composite_key< peer_stats_object,
+            member< peer_stats_object, account_id_type, &peer_stats_object::peer >,
+            member< peer_stats_object, float, &peer_stats_object::rank >,
+            member< peer_stats_object, account_id_type, &peer_stats_object::voter >
+         >,
+         composite_key_compare< std::less<account_id_type>, std::greater<float>, std::less<account_id_type> >
       >
    >
 > peer_stats_multi_index_type;
@@ -317,6 +346,124 @@ typedef graphene::db::generic_index< peer_stats_object, peer_stats_multi_index_t
 
 
 
+/**
+ *  Keeps the parts of a discussion that are expensive to derive from the comment itself, so
+ *  that listing discussions does not have to walk up to the root post or count votes for
+ *  every row.  The url never changes once the comment is created, the title of the root
+ *  post may be edited and is therefore looked up through root_comment.
+ */
+class comment_summary_object : public abstract_object<comment_summary_object> {
+   public:
+      static const uint8_t space_id = TAG_SPACE_ID;
+      static const uint8_t type_id  = comment_summary_object_type;
+
+      comment_id_type    comment;
+      comment_id_type    root_comment;
+      string             url; ///< /category/@rootauthor/root_permlink#author/permlink
+
+      /**
+       *  number of votes cast in the current payout period, votes are removed when the comment is
+       *  paid and the count is reset by the first vote after the payout
+       */
+      uint32_t           active_vote_count = 0;
+
+      /** the tags parsed from json_metadata when the comment was created or last edited */
+      flat_set< tag_id_type > tags;
+      bool               filtered = false; ///< tagged spam, nsfw or test, see update_tags
+};
+
+typedef multi_index_container<
+   comment_summary_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag< by_comment >, member< comment_summary_object, comment_id_type, &comment_summary_object::comment > >
+   >
+> comment_summary_multi_index_type;
+typedef graphene::db::generic_index< comment_summary_object, comment_summary_multi_index_type> comment_summary_index;
+
+
+/**
+ *  A top level post recommended to an account because peers the account ranks highly voted for
+ *  it.  Recommendations are maintained as votes arrive, so get_recommended_for only has to read
+ *  the account's best candidates instead of walking the votes of all of its peers.
+ *
+ *  The score is the sum of rank * vote percent over the votes of the account's peers, it is
+ *  discounted by the age of the post when read.  Recommendations are removed once the account
+ *  votes for the post, once the post is a day old and when the post is deleted.
+ */
+class recommendation_object : public abstract_object<recommendation_object> {
+   public:
+      static const uint8_t space_id = TAG_SPACE_ID;
+      static const uint8_t type_id  = recommendation_object_type;
+
+      account_id_type    account;
+      comment_id_type    comment;
+      time_point_sec     created; ///< of the post
+      float              score = 0;
+};
+
+struct by_account_comment;
+struct by_account_score;
+struct by_post_created;
+typedef multi_index_container<
+   recommendation_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag< by_account_comment >,
+         composite_key< recommendation_object,
+            member< recommendation_object, account_id_type, &recommendation_object::account >,
+            member< recommendation_object, comment_id_type, &recommendation_object::comment >
+         >
+      >,
+      ordered_unique< tag< by_account_score >,
+         composite_key< recommendation_object,
+            member< recommendation_object, account_id_type, &recommendation_object::account >,
+            member< recommendation_object, float, &recommendation_object::score >,
+            member< object, object_id_type, &object::id >
+         >,
+         composite_key_compare< std::less<account_id_type>, std::greater<float>, std::less<object_id_type> >
+      >,
+      ordered_unique< tag< by_post_created >,
+         composite_key< recommendation_object,
+            member< recommendation_object, time_point_sec, &recommendation_object::created >,
+            member< object, object_id_type, &object::id >
+         >
+      >,
+      ordered_unique< tag< by_comment >,
+         composite_key< recommendation_object,
+            member< recommendation_object, comment_id_type, &recommendation_object::comment >,
+            member< recommendation_object, account_id_type, &recommendation_object::account >
+         >
+      >
+   >
+> recommendation_multi_index_type;
+typedef graphene::db::generic_index< recommendation_object, recommendation_multi_index_type> recommendation_index;
+
+/**
+ *  Adds the vote of voter for the post c to the recommendations of the accounts that rank the
+ *  voter as a peer, and removes c from the voter's own recommendations.
+ */
+void update_recommendations( database& db, account_id_type voter, const comment_object& c, int16_t vote_percent );
+
+/** the id of tag, which exists once a post was tagged with it */
+optional< tag_id_type > find_tag( const database& db, const string& tag );
+
+/**
+ *  Updates the tag_objects of comments and their parents to match the comments, each comment
+ *  once.  The plugin calls this at the end of each block with the comments changed in it.
+ */
+void update_tags( database& db, const flat_set< comment_id_type >& comments );
+
+/** removes the recommendations of posts older than a day */
+void remove_expired_recommendations( database& db );
+
+/** removes every recommendation of the post c, which is about to be deleted */
+void remove_recommendations( database& db, comment_id_type c );
+
+/** the posts recommended to account, best first */
+vector< comment_id_type > get_recommendations( const database& db, const account_object& account, uint32_t limit );
+
+
 /**
  * Used to parse the metadata from the comment json_meta field.
  */
@@ -375,4 +522,6 @@ FC_REFLECT_DERIVED( steemit::tags::tag_stats_object, (graphene::db::object),
                     (tag)(total_children_rshares2)(total_payout)(net_votes)(top_posts)(comments) );
 
 FC_REFLECT_DERIVED( steemit::tags::peer_stats_object, (graphene::db::object), (voter)(peer)(direct_positive_votes)(direct_votes)(indirect_positive_votes)(indirect_votes)(rank) );
+FC_REFLECT_DERIVED( steemit::tags::comment_summary_object, (graphene::db::object), (comment)(root_comment)(url)(active_vote_count)(tags)(filtered) );
+FC_REFLECT_DERIVED( steemit::tags::recommendation_object, (graphene::db::object), (account)(comment)(created)(score) );
 FC_REFLECT( steemit::tags::comment_metadata, (tags) );
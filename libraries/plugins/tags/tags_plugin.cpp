@@ -14,6 +14,9 @@
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
 
+#include <iterator>
+#include <limits>
+
 namespace steemit { namespace tags {
 
 namespace detail {
@@ -31,9 +34,14 @@ class tags_plugin_impl
          return _self.database();
       }
 
+      void on_pre_operation( const operation_object& op_obj );
       void on_operation( const operation_object& op_obj );
+      void on_block( const signed_block& b );
 
       tags_plugin& _self;
+
+      /** comments whose tags are updated at the end of the block */
+      flat_set<comment_id_type> _changed_comments;
 };
 
 tags_plugin_impl::~tags_plugin_impl()
@@ -41,11 +49,16 @@ tags_plugin_impl::~tags_plugin_impl()
    return;
 }
 
+/**
+ *  Comments changed by an operation are only collected in changed, their tags are updated once
+ *  at the end of the block however many operations changed them.
+ */
 struct operation_visitor {
-   operation_visitor( database& db ):_db(db){};
+   operation_visitor( database& db, flat_set<comment_id_type>& changed ):_db(db),_changed(changed){};
    typedef void result_type;
 
    database& _db;
+   flat_set<comment_id_type>& _changed;
 
    void remove_stats( const tag_object& tag, const tag_stats_object& stats )const {
       _db.modify( stats, [&]( tag_stats_object& s ) {
@@ -55,8 +68,8 @@ struct operation_visitor {
            } else {
               s.comments--;
            }
-           s.net_votes   -= tag.net_votes;
-           s.total_payout += tag.total_payout;
+           s.net_votes    -= tag.net_votes;
+           s.total_payout -= tag.total_payout;
       });
    }
    void add_stats( const tag_object& tag, const tag_stats_object& stats )const {
@@ -67,12 +80,13 @@ struct operation_visitor {
            } else {
               s.comments++;
            }
-           s.net_votes   += tag.net_votes;
+           s.net_votes    += tag.net_votes;
+           s.total_payout += tag.total_payout;
       });
    }
 
    void remove_tag( const tag_object& tag )const {
-      /// TODO: update tag stats object
+      remove_stats( tag, tag.tag( _db ) );
       _db.remove(tag);
    }
 
@@ -88,8 +102,25 @@ struct operation_visitor {
 
    void update_tag( const tag_object& current, const comment_object& comment, double hot )const
    {
-       const auto& stats = get_stats( current.tag );
-       remove_stats( current, stats );
+       /// tags that did not change are not modified, so they are neither copied to the undo state nor re-sorted
+       if( current.active            == comment.active &&
+           current.cashout           == comment.cashout_time &&
+           current.children          == comment.children &&
+           current.net_rshares       == comment.net_rshares.value &&
+           current.net_votes         == comment.net_votes &&
+           current.children_rshares2 == comment.children_rshares2 &&
+           current.hot               == hot &&
+           current.total_payout      == comment.total_payout_value )
+          return;
+
+       _db.modify( current.tag( _db ), [&]( tag_stats_object& s ) {
+           if( current.parent == comment_id_type() ) {
+              s.total_children_rshares2 -= current.children_rshares2;
+              s.total_children_rshares2 += comment.children_rshares2;
+           }
+           s.net_votes    += comment.net_votes - current.net_votes;
+           s.total_payout += comment.total_payout_value - current.total_payout;
+       });
        _db.modify( current, [&]( tag_object& obj ) {
           obj.active            = comment.active;
           obj.cashout           = comment.cashout_time;
@@ -100,10 +131,9 @@ struct operation_visitor {
           obj.hot               = hot;
           obj.total_payout      = comment.total_payout_value;
       });
-      add_stats( current, stats );
    }
 
-   void create_tag( const string& tag, const comment_object& comment, double hot )const {
+   void create_tag( const tag_stats_object& stats, const comment_object& comment, double hot )const {
 
 
       comment_id_type parent;
@@ -113,7 +143,7 @@ struct operation_visitor {
          parent = _db.get_comment( comment.parent_author, comment.parent_permlink ).id;
 
       const auto& tag_obj = _db.create<tag_object>( [&]( tag_object& obj ) {
-          obj.tag               = tag;
+          obj.tag               = stats.get_id();
           obj.comment           = comment.id;
           obj.parent            = parent;
           obj.created           = comment.created;
@@ -123,11 +153,12 @@ struct operation_visitor {
           obj.children          = comment.children;
           obj.net_rshares       = comment.net_rshares.value;
           obj.children_rshares2 = comment.children_rshares2;
+          obj.hot               = hot;
           obj.total_payout      = comment.total_payout_value;
           obj.author            = author;
           obj.net_votes         = comment.net_votes;
       });
-      add_stats( tag_obj, get_stats( tag ) );
+      add_stats( tag_obj, stats );
    }
 
    /**
@@ -144,16 +175,19 @@ struct operation_visitor {
       return sign * order + double(seconds) / 45000.0;
    }
 
-   /** finds tags that have been added or removed or updated */
-   void update_tags( const comment_object& c )const {
-      try {
-
-      auto hot = calculate_hot(c);
-
+   /**
+    *  The tags of the json_metadata of c and, before hardfork 5, its category.  filtered is set
+    *  if c is tagged spam, nsfw or test.
+    */
+   flat_set<tag_id_type> parse_tags( const comment_object& c, bool& filtered )const {
       comment_metadata meta;
 
       if( c.json_metadata.size() ){
-         meta = fc::json::from_string( c.json_metadata ).as<comment_metadata>();
+         try {
+            meta = fc::json::from_string( c.json_metadata ).as<comment_metadata>();
+         } catch( const fc::exception& ) {
+            /// invalid metadata is treated as metadata without tags
+         }
       }
 
       set<string> lower_tags;
@@ -162,52 +196,79 @@ struct operation_visitor {
       if( !_db.has_hardfork( STEEMIT_HARDFORK_0_5 ) )
          lower_tags.insert( c.category );
 
+      filtered = lower_tags.find( "spam" ) != lower_tags.end() ||
+                 lower_tags.find( "nsfw" ) != lower_tags.end() ||
+                 lower_tags.find( "test" ) != lower_tags.end();
 
-      /// the universal tag applies to everything safe for work or nsfw with a positive payout
-      if( c.net_rshares >= 0 ||
-          (lower_tags.find( "spam" ) == lower_tags.end() &&
-           lower_tags.find( "nsfw" ) == lower_tags.end() &&
-           lower_tags.find( "test" ) == lower_tags.end() )  )
-      {
-         lower_tags.insert( string() ); /// add it to the universal tag
+      flat_set<tag_id_type> result;
+      for( const auto& tag : lower_tags )
+         result.insert( get_stats( tag ).get_id() );
+      return result;
+   }
+
+   /** parses the metadata of a comment that was created or edited */
+   void update_metadata( const comment_object& c )const {
+      const auto& summary = get_or_create_summary( c );
+      bool filtered = false;
+      auto tags = parse_tags( c, filtered );
+      if( tags != summary.tags || filtered != summary.filtered ) {
+         _db.modify( summary, [&]( comment_summary_object& s ) {
+            s.tags     = std::move( tags );
+            s.filtered = filtered;
+         });
       }
+   }
+
+   /** finds tags that have been added or removed or updated */
+   void update_comment_tags( const comment_object& c )const {
+      try {
+
+      const auto& summary = get_or_create_summary( c );
+      auto hot = calculate_hot(c);
 
-      meta.tags = lower_tags; /// TODO: std::move???
+      flat_set<tag_id_type> tags = summary.tags;
+
+      /// the universal tag applies to everything safe for work or nsfw with a positive payout
+      if( c.net_rshares >= 0 || !summary.filtered )
+         tags.insert( get_stats( string() ).get_id() ); /// add it to the universal tag
 
       const auto& comment_idx = _db.get_index_type<tag_index>().indices().get<by_comment>();
       auto citr = comment_idx.lower_bound( c.id );
 
-      map<string, const tag_object*> existing_tags;
       vector<const tag_object*> remove_queue;
       while( citr != comment_idx.end() && citr->comment == c.id ) {
          const tag_object* tag = &*citr;
          ++citr;
-         if( meta.tags.find( tag->tag ) == meta.tags.end() ) {
+         auto itr = tags.find( tag->tag );
+         if( itr == tags.end() ) {
             remove_queue.push_back(tag);
          } else {
-            existing_tags[tag->tag] = tag;
+            update_tag( *tag, c, hot );
+            tags.erase( itr );
          }
       }
 
-      for( const auto& tag : meta.tags ) {
-         auto existing = existing_tags.find(tag);
-         if( existing == existing_tags.end() ) {
-            create_tag( tag, c, hot );
-         } else {
-            update_tag( *existing->second, c, hot );
-         }
-      }
+      for( const auto& tag : tags )
+         create_tag( tag( _db ), c, hot );
 
       for( const auto& item : remove_queue )
          remove_tag(*item);
 
-      if( c.parent_author.size() )
-      {
-         update_tags( _db.get_comment( c.parent_author, c.parent_permlink ) );
-      }
      } FC_CAPTURE_LOG_AND_RETHROW( (c) )
    }
 
+   /** updates the tags of each of comments and of their parents once */
+   void update_tags( const flat_set<comment_id_type>& comments )const {
+      flat_set<comment_id_type> updated;
+      for( const auto& id : comments ) {
+         const comment_object* c = _db.find( id );
+         while( c != nullptr && updated.insert( c->get_id() ).second ) {
+            update_comment_tags( *c );
+            c = c->parent_author.size() ? &_db.get_comment( c->parent_author, c->parent_permlink ) : nullptr;
+         }
+      }
+   }
+
    const peer_stats_object& get_or_create_peer_stats( account_id_type voter, account_id_type peer )const {
       const auto& peeridx = _db.get_index_type<peer_stats_index>().indices().get<by_voter_peer>();
       auto itr = peeridx.find( boost::make_tuple( voter, peer ) );
@@ -254,20 +315,79 @@ struct operation_visitor {
       }
    }
 
+   /** creates the summary of a new comment, the url and root are fixed once the comment exists */
+   const comment_summary_object& get_or_create_summary( const comment_object& c )const {
+      const auto& summary_idx = _db.get_index_type<comment_summary_index>().indices().get<by_comment>();
+      auto itr = summary_idx.find( c.id );
+      if( itr != summary_idx.end() ) return *itr;
+
+      const comment_object* root = &c;
+      if( c.parent_author.size() ) {
+         const auto& parent = _db.get_comment( c.parent_author, c.parent_permlink );
+         auto parent_itr = summary_idx.find( parent.id );
+         if( parent_itr != summary_idx.end() ) {
+            root = &parent_itr->root_comment( _db );
+         } else {
+            root = &parent;
+            while( root->parent_author.size() )
+               root = &_db.get_comment( root->parent_author, root->parent_permlink );
+         }
+      }
+
+      bool filtered = false;
+      auto tags = parse_tags( c, filtered );
+
+      /// only the votes of comments that existed before the plugin are counted here, new comments have none
+      const auto& voteidx = _db.get_index_type<comment_vote_index>().indices().get<by_comment_voter>();
+      uint32_t votes = 0;
+      for( auto itr = voteidx.lower_bound( comment_id_type( c.id ) ); itr != voteidx.end() && itr->comment == c.id; ++itr )
+         ++votes;
+
+      return _db.create<comment_summary_object>( [&]( comment_summary_object& s ) {
+         s.comment      = c.id;
+         s.root_comment = root->id;
+         s.tags         = std::move( tags );
+         s.filtered     = filtered;
+         s.active_vote_count = votes;
+         s.url          = "/" + root->category + "/@" + root->author + "/" + root->permlink;
+         if( root != &c )
+            s.url += "#@" + c.author + "/" + c.permlink;
+      });
+   }
+
+   /** counts the vote of voter on c if it is new, a changed vote has num_changes set */
+   void update_active_vote_count( const comment_object& c, const account_object& voter )const {
+      bool created = _db.get_index_type<comment_summary_index>().indices().get<by_comment>().count( c.id ) == 0;
+      const auto& summary = get_or_create_summary( c );
+      if( created )
+         return;
+
+      const auto& voteidx = _db.get_index_type<comment_vote_index>().indices().get<by_comment_voter>();
+      auto itr = voteidx.find( boost::make_tuple( comment_id_type( c.id ), voter.get_id() ) );
+      if( itr != voteidx.end() && itr->num_changes == 0 )
+         _db.modify( summary, [&]( comment_summary_object& s ) { ++s.active_vote_count; } );
+   }
+
    void operator()( const comment_operation& op )const {
-      update_tags( _db.get_comment( op.author, op.permlink ) );
+      const auto& c = _db.get_comment( op.author, op.permlink );
+      update_metadata( c );
+      _changed.insert( c.get_id() );
    }
 
    void operator()( const vote_operation& op )const {
-      update_tags( _db.get_comment( op.author, op.permlink ) );
-      update_peer_stats( _db.get_account(op.voter),
+      const auto& c = _db.get_comment( op.author, op.permlink );
+      const auto& voter = _db.get_account( op.voter );
+      update_active_vote_count( c, voter );
+      _changed.insert( c.get_id() );
+      update_peer_stats( voter,
                          _db.get_account(op.author),
-                         _db.get_comment(op.author, op.permlink),
+                         c,
                          op.weight );
+      update_recommendations( _db, voter.id, c, op.weight );
    }
 
    void operator()( const comment_payout_operation& op )const {
-       update_tags( _db.get_comment( op.author, op.permlink ) );
+       _changed.insert( _db.get_comment( op.author, op.permlink ).get_id() );
    }
 
    template<typename Op>
@@ -276,9 +396,69 @@ struct operation_visitor {
 
 
 
+/**
+ *  Removes what refers to a comment before delete_comment removes it.  If the deletion fails the
+ *  removals are undone with the rest of its transaction.
+ *
+ *  The payout of a comment removes its votes and sets its cashout time to maximum, whether or not
+ *  a comment_payout operation is emitted, so the first vote after it starts a new vote count.
+ */
+void tags_plugin_impl::on_pre_operation( const operation_object& op_obj ) {
+   try { /// plugins shouldn't ever throw
+      auto& db = database();
+      if( op_obj.op.which() == operation::tag<vote_operation>::value ) {
+         const auto& op = op_obj.op.get<vote_operation>();
+         const auto& comment_idx = db.get_index_type<comment_index>().indices().get<by_permlink>();
+         auto c = comment_idx.find( boost::make_tuple( op.author, op.permlink ) );
+         if( c == comment_idx.end() || c->cashout_time != fc::time_point_sec::maximum() )
+            return;
+
+         const auto& summary_idx = db.get_index_type<comment_summary_index>().indices().get<by_comment>();
+         auto summary = summary_idx.find( c->id );
+         if( summary != summary_idx.end() && summary->active_vote_count != 0 )
+            db.modify( *summary, [&]( comment_summary_object& s ) { s.active_vote_count = 0; } );
+         return;
+      }
+
+      if( op_obj.op.which() != operation::tag<delete_comment_operation>::value )
+         return;
+
+      const auto& op = op_obj.op.get<delete_comment_operation>();
+      const auto& comment_idx = db.get_index_type<comment_index>().indices().get<by_permlink>();
+      auto c = comment_idx.find( boost::make_tuple( op.author, op.permlink ) );
+      if( c == comment_idx.end() )
+         return;
+
+      remove_recommendations( db, c->id );
+
+      const auto& summary_idx = db.get_index_type<comment_summary_index>().indices().get<by_comment>();
+      auto summary = summary_idx.find( c->id );
+      if( summary != summary_idx.end() )
+         db.remove( *summary );
+   } catch ( const fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+   } catch ( ... ) {
+      elog( "unhandled exception" );
+   }
+}
+
 void tags_plugin_impl::on_operation( const operation_object& op_obj ) {
    try { /// plugins shouldn't ever throw
-      op_obj.op.visit( operation_visitor( database() ) );
+      op_obj.op.visit( operation_visitor( database(), _changed_comments ) );
+   } catch ( const fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+   } catch ( ... ) {
+      elog( "unhandled exception" );
+   }
+}
+
+void tags_plugin_impl::on_block( const signed_block& b ) {
+   remove_expired_recommendations( database() );
+
+   flat_set<comment_id_type> changed;
+   std::swap( changed, _changed_comments );
+   try {
+      update_tags( database(), changed );
    } catch ( const fc::exception& e ) {
       edump( (e.to_detail_string()) );
    } catch ( ... ) {
@@ -288,6 +468,115 @@ void tags_plugin_impl::on_operation( const operation_object& op_obj ) {
 
 } /// end detail namespace
 
+optional< tag_id_type > find_tag( const database& db, const string& tag )
+{
+   const auto& stats_idx = db.get_index_type<tag_stats_index>().indices().get<by_tag>();
+   auto itr = stats_idx.find( tag );
+   if( itr == stats_idx.end() )
+      return optional< tag_id_type >();
+   return itr->get_id();
+}
+
+void update_tags( database& db, const flat_set< comment_id_type >& comments )
+{
+   flat_set< comment_id_type > changed;
+   detail::operation_visitor( db, changed ).update_tags( comments );
+}
+
+void update_recommendations( database& db, account_id_type voter, const comment_object& c, int16_t vote_percent )
+{
+   const auto& rec_idx = db.get_index_type<recommendation_index>().indices().get<by_account_comment>();
+   const auto& score_idx = db.get_index_type<recommendation_index>().indices().get<by_account_score>();
+
+   auto seen = rec_idx.find( boost::make_tuple( voter, c.id ) );
+   if( seen != rec_idx.end() )
+      db.remove( *seen );
+
+   auto max_age = db.head_block_time() - fc::days(1);
+   if( c.parent_author.size() || c.created <= max_age || vote_percent == 0 )
+      return;
+
+   const auto& peer_idx = db.get_index_type<peer_stats_index>().indices().get<by_peer>();
+   const auto& vote_idx = db.get_index_type<comment_vote_index>().indices().get<by_comment_voter>();
+   account_id_type author = db.get_account( c.author ).id;
+   float vote = float( vote_percent ) / STEEMIT_100_PERCENT;
+
+   uint32_t updated = 0;
+   auto itr = peer_idx.lower_bound( boost::make_tuple( voter, std::numeric_limits<float>::max() ) );
+   for( ; itr != peer_idx.end() && itr->peer == voter && itr->rank > 0 && updated < TAGS_RECOMMENDATION_FANOUT; ++itr ) {
+      account_id_type account = itr->voter;
+      if( account == author || vote_idx.find( boost::make_tuple( c.id, account ) ) != vote_idx.end() )
+         continue;
+      ++updated;
+
+      float score = itr->rank * vote;
+      auto existing = rec_idx.find( boost::make_tuple( account, c.id ) );
+      if( existing != rec_idx.end() ) {
+         db.modify( *existing, [&]( recommendation_object& r ) { r.score += score; } );
+         continue;
+      }
+
+      db.create<recommendation_object>( [&]( recommendation_object& r ) {
+         r.account = account;
+         r.comment = c.id;
+         r.created = c.created;
+         r.score   = score;
+      });
+
+      auto begin = score_idx.lower_bound( account );
+      auto end = score_idx.upper_bound( account );
+      if( uint32_t( std::distance( begin, end ) ) > TAGS_RECOMMENDATIONS_PER_ACCOUNT )
+         db.remove( *std::prev( end ) );
+   }
+}
+
+void remove_expired_recommendations( database& db )
+{
+   const auto& created_idx = db.get_index_type<recommendation_index>().indices().get<by_post_created>();
+   auto max_age = db.head_block_time() - fc::days(1);
+   auto itr = created_idx.begin();
+   while( itr != created_idx.end() && itr->created <= max_age ) {
+      const auto& r = *itr;
+      ++itr;
+      db.remove( r );
+   }
+}
+
+void remove_recommendations( database& db, comment_id_type c )
+{
+   const auto& comment_idx = db.get_index_type<recommendation_index>().indices().get<by_comment>();
+   auto itr = comment_idx.lower_bound( c );
+   while( itr != comment_idx.end() && itr->comment == c ) {
+      const auto& r = *itr;
+      ++itr;
+      db.remove( r );
+   }
+}
+
+vector< comment_id_type > get_recommendations( const database& db, const account_object& account, uint32_t limit )
+{
+   const auto& score_idx = db.get_index_type<recommendation_index>().indices().get<by_account_score>();
+   auto max_age = db.head_block_time() - fc::days(1);
+
+   vector< pair< float, comment_id_type > > scored;
+   for( auto itr = score_idx.lower_bound( account.get_id() ); itr != score_idx.end() && itr->account == account.id && itr->score > 0; ++itr ) {
+      const comment_object* c = db.find( itr->comment );
+      if( c == nullptr || c->created <= max_age || c->net_rshares <= 0 )
+         continue;
+      auto agediscount = float( (c->created - max_age).count() ) / fc::days(1).count();
+      scored.push_back( { agediscount * itr->score, itr->comment } );
+   }
+   std::sort( scored.begin(), scored.end(), std::greater< pair< float, comment_id_type > >() );
+
+   vector< comment_id_type > result;
+   result.reserve( std::min< size_t >( limit, scored.size() ) );
+   for( const auto& item : scored ) {
+      if( result.size() == limit ) break;
+      result.push_back( item.second );
+   }
+   return result;
+}
+
 tags_plugin::tags_plugin() :
    my( new detail::tags_plugin_impl(*this) )
 {
@@ -313,10 +602,14 @@ void tags_plugin::plugin_set_program_options(
 void tags_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
    ilog("Intializing tags plugin" );
+   database().pre_apply_operation.connect( [&]( const operation_object& b){ my->on_pre_operation(b); } );
    database().post_apply_operation.connect( [&]( const operation_object& b){ my->on_operation(b); } );
    database().add_index< primary_index< tag_index  > >();
    database().add_index< primary_index< tag_stats_index > >();
    database().add_index< primary_index< peer_stats_index > >();
+   database().add_index< primary_index< comment_summary_index > >();
+   database().add_index< primary_index< recommendation_index > >();
+   database().applied_block.connect( [&]( const signed_block& b ){ my->on_block( b ); } );
 
    app().register_api_factory<tag_api>("tag_api");
 }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <steemit/chain/protocol/steem_operations.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace steemit { namespace witness_plugin {
+
+struct pow_solution
+{
+   uint64_t    nonce = 0;
+   chain::pow  work;
+};
+
+struct miner_statistics
+{
+   uint32_t                threads = 0;
+   bool                    mining = false;
+
+   /** hashes computed since startup */
+   uint64_t                total_hashes = 0;
+
+   /** hashes computed and their rate, in the current round or the last one if none is running */
+   uint64_t                round_hashes = 0;
+   double                  hashes_per_second = 0;
+
+   std::vector< uint64_t > thread_hashes;
+};
+
+/**
+ *  Searches for proof of work on a pool of threads.
+ *
+ *  Threads claim batches of batch_size nonces from a shared counter and only check whether
+ *  the round is over between batches.  The hash of the block id, which the work input of
+ *  every nonce is derived from, is computed once per round.  Each thread counts its hashes in
+ *  its own counter, which are only summed when statistics are requested.
+ *
+ *  The work of a nonce is the same as pow::create( key, pow_operation::work_input() ).
+ */
+class pow_miner
+{
+   public:
+      typedef std::function< void( const pow_solution& ) > solution_handler;
+
+      pow_miner( uint32_t threads, bool pin_threads );
+      ~pow_miner();
+
+      /**
+       *  Starts a round searching nonces from start_nonce for work below target, stopping any
+       *  round in progress.  The round ends at deadline, when stop() is called or when a
+       *  solution is found, which is passed to on_solution on the mining thread that found it.
+       */
+      void start( const fc::ecc::private_key& key, const chain::block_id_type& block_id, const fc::sha256& target,
+                  uint64_t start_nonce, fc::time_point deadline, solution_handler on_solution );
+      void stop();
+
+      miner_statistics get_statistics()const;
+
+      /** the work input of nonce, block_hash is the hash of the block id */
+      static fc::sha256 work_input( const fc::sha256& block_hash, uint64_t nonce );
+
+      static const uint32_t batch_size = 256;
+
+   private:
+      /** padded to a cache line so threads do not share one */
+      struct thread_counter
+      {
+         std::atomic< uint64_t >   hashes;
+         char                      padding[ 64 - sizeof( std::atomic< uint64_t > ) ];
+      };
+
+      void mine( uint32_t thread, uint64_t round, fc::ecc::private_key key, fc::sha256 block_hash, fc::sha256 target,
+                 fc::time_point deadline, solution_handler on_solution );
+      uint64_t total_hashes()const;
+
+      std::vector< std::shared_ptr< fc::thread > >   _threads;
+      std::unique_ptr< thread_counter[] >            _counters;
+
+      /** incremented to end the current round */
+      std::atomic< uint64_t >                        _round;
+      std::atomic< uint64_t >                        _next_nonce;
+      std::atomic< uint32_t >                        _active_threads;
+
+      std::atomic< int64_t >                         _round_start;
+      std::atomic< int64_t >                         _round_end;
+      std::atomic< uint64_t >                        _round_start_hashes;
+};
+
+} } // steemit::witness_plugin
+
+FC_REFLECT( steemit::witness_plugin::miner_statistics,
+            (threads)(mining)(total_hashes)(round_hashes)(hashes_per_second)(thread_hashes) )
@@ -23,8 +23,10 @@
  */
 #pragma once
 
+#include <steemit/app/latency_histogram.hpp>
 #include <steemit/app/plugin.hpp>
 #include <steemit/chain/database.hpp>
+#include <steemit/witness/miner.hpp>
 
 #include <fc/thread/future.hpp>
 
@@ -50,12 +52,34 @@ namespace block_production_condition
    };
 }
 
+struct block_production_statistics
+{
+   uint32_t                produced = 0;
+   /** blocks produced from a template that was still current at their slot */
+   uint32_t                produced_from_template = 0;
+   uint32_t                template_builds = 0;
+   /** transactions appended to a template without building it again */
+   uint32_t                template_extensions = 0;
+   uint32_t                template_failures = 0;
+   /** slots that were skipped because the node woke up more than 500ms from the slot time */
+   uint32_t                lag_misses = 0;
+
+   /** the time to build a block template */
+   app::latency_histogram  template_build;
+   /** the time from waking up for a slot to having pushed its block */
+   app::latency_histogram  generation;
+   /** how far from the slot time the node woke up to produce its block */
+   app::latency_histogram  wake_lag;
+};
+
 class witness_plugin : public steemit::app::plugin {
 public:
    ~witness_plugin() {
       try {
          if( _block_production_task.valid() )
             _block_production_task.cancel_and_wait(__FUNCTION__);
+         if( _block_template_task.valid() )
+            _block_template_task.cancel_and_wait(__FUNCTION__);
       } catch(fc::canceled_exception&) {
          //Expected exception. Move along.
       } catch(fc::exception& e) {
@@ -76,6 +100,12 @@ public:
    virtual void plugin_startup() override;
    virtual void plugin_shutdown() override;
 
+   /** the hash rate of the proof of work miner */
+   miner_statistics get_miner_statistics()const;
+
+   /** the latency of producing blocks and of building their templates */
+   block_production_statistics get_block_production_statistics()const;
+
 private:
    void on_applied_block( const chain::signed_block& b );
    void start_mining( const fc::ecc::public_key& pub, const fc::ecc::private_key& pk,
@@ -86,23 +116,59 @@ private:
    block_production_condition::block_production_condition_enum block_production_loop();
    block_production_condition::block_production_condition_enum maybe_produce_block( fc::mutable_variant_object& capture );
 
+   /**
+    *  The block of the next slot is assembled ahead of time when one of our witnesses is
+    *  scheduled to produce it, so that producing it at the slot does not have to re-apply the
+    *  pending transactions or verify their signatures.  It is built again when the head block
+    *  changes.  New transactions are appended to it while it holds every pending transaction,
+    *  otherwise it is rebuilt at most once a second.
+    */
+   void schedule_block_template( bool head_changed );
+   void build_block_template();
+
    boost::program_options::variables_map _options;
    bool _production_enabled = false;
    uint32_t _required_witness_participation = 33 * STEEMIT_1_PERCENT;
    uint32_t _production_skip_flags = steemit::chain::database::skip_nothing;
    uint32_t _mining_threads = 0;
+   bool _pin_mining_threads = false;
 
-   uint64_t         _head_block_num       = 0;
-   uint64_t         _total_hashes         = 0;
-   fc::time_point   _hash_start_time;
-
-   std::vector<std::shared_ptr<fc::thread> > _thread_pool;
+   std::unique_ptr<pow_miner>                      _miner;
 
    std::map<public_key_type, fc::ecc::private_key> _private_keys;
    std::set<string>                                _witnesses;
    std::map<string,public_key_type>                _miners;
    chain::chain_properties                         _miner_prop_vote;
    fc::future<void>                                _block_production_task;
+
+   fc::optional<chain::block_template>             _block_template;
+   fc::future<void>                                _block_template_task;
+   fc::time_point                                  _block_template_task_time;
+   fc::time_point                                  _last_block_template_build;
+   block_production_statistics                     _production_stats;
+};
+
+class witness_api
+{
+   public:
+      witness_api( const app::api_context& ctx );
+
+      void on_api_startup();
+
+      miner_statistics get_miner_statistics()const;
+      block_production_statistics get_block_production_statistics()const;
+
+   private:
+      app::application& _app;
 };
 
 } } //steemit::witness_plugin
+
+FC_REFLECT( steemit::witness_plugin::block_production_statistics,
+            (produced)(produced_from_template)(template_builds)(template_extensions)(template_failures)(lag_misses)
+            (template_build)(generation)(wake_lag) )
+
+FC_API( steemit::witness_plugin::witness_api,
+        (get_miner_statistics)
+        (get_block_production_statistics)
+      )
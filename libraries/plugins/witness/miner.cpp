@@ -0,0 +1,157 @@
+#include <steemit/witness/miner.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <thread>
+
+namespace steemit { namespace witness_plugin {
+
+namespace {
+
+void pin_to_cpu( uint32_t cpu )
+{
+#ifdef __linux__
+   uint32_t cpus = std::max( std::thread::hardware_concurrency(), 1u );
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   CPU_SET( cpu % cpus, &set );
+   if( pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) != 0 )
+      wlog( "Unable to pin mining thread to cpu ${c}", ("c", cpu % cpus) );
+#else
+   wlog( "Pinning mining threads is not supported on this platform" );
+#endif
+}
+
+} // anonymous namespace
+
+pow_miner::pow_miner( uint32_t threads, bool pin_threads )
+   : _counters( new thread_counter[ threads ] ),
+     _round( 0 ), _next_nonce( 0 ), _active_threads( 0 ),
+     _round_start( 0 ), _round_end( 0 ), _round_start_hashes( 0 )
+{
+   for( uint32_t i = 0; i < threads; ++i )
+   {
+      _counters[i].hashes = 0;
+      _threads.push_back( std::make_shared< fc::thread >( "pow_miner_" + std::to_string( i ) ) );
+      if( pin_threads )
+         _threads.back()->async( [i](){ pin_to_cpu( i ); }, "pin_to_cpu" ).wait();
+   }
+}
+
+pow_miner::~pow_miner()
+{
+   stop();
+   _threads.clear();
+}
+
+fc::sha256 pow_miner::work_input( const fc::sha256& block_hash, uint64_t nonce )
+{
+   // pow_operation::work_input
+   auto hash = block_hash;
+   hash._hash[0] = nonce;
+   return fc::sha256::hash( hash );
+}
+
+void pow_miner::start( const fc::ecc::private_key& key, const chain::block_id_type& block_id, const fc::sha256& target,
+                       uint64_t start_nonce, fc::time_point deadline, solution_handler on_solution )
+{
+   uint64_t round = ++_round;
+   _next_nonce = start_nonce;
+   _round_start_hashes = total_hashes();
+   _round_start = fc::time_point::now().time_since_epoch().count();
+
+   auto block_hash = fc::sha256::hash( block_id );
+   for( uint32_t i = 0; i < _threads.size(); ++i )
+   {
+      _threads[i]->async( [=](){ mine( i, round, key, block_hash, target, deadline, on_solution ); }, "pow_miner" );
+   }
+}
+
+void pow_miner::stop()
+{
+   ++_round;
+}
+
+void pow_miner::mine( uint32_t thread, uint64_t round, fc::ecc::private_key key, fc::sha256 block_hash, fc::sha256 target,
+                      fc::time_point deadline, solution_handler on_solution )
+{
+   ++_active_threads;
+   auto& hashes = _counters[ thread ].hashes;
+
+   while( _round.load( std::memory_order_relaxed ) == round && fc::time_point::now() < deadline )
+   {
+      uint64_t first = _next_nonce.fetch_add( batch_size, std::memory_order_relaxed );
+      fc::optional< pow_solution > solution;
+
+      for( uint64_t nonce = first; nonce < first + batch_size; ++nonce )
+      {
+         chain::pow work;
+         work.create( key, work_input( block_hash, nonce ) );
+         if( work.work < target )
+         {
+            hashes.fetch_add( nonce - first + 1, std::memory_order_relaxed );
+            solution = pow_solution();
+            solution->nonce = nonce;
+            solution->work = work;
+            break;
+         }
+      }
+
+      if( solution.valid() )
+      {
+         // only the first solution of a round is reported, it also ends the round
+         uint64_t expected = round;
+         if( _round.compare_exchange_strong( expected, round + 1 ) )
+            on_solution( *solution );
+         break;
+      }
+
+      hashes.fetch_add( batch_size, std::memory_order_relaxed );
+   }
+
+   if( --_active_threads == 0 )
+      _round_end = fc::time_point::now().time_since_epoch().count();
+}
+
+uint64_t pow_miner::total_hashes()const
+{
+   uint64_t total = 0;
+   for( uint32_t i = 0; i < _threads.size(); ++i )
+      total += _counters[i].hashes.load( std::memory_order_relaxed );
+   return total;
+}
+
+miner_statistics pow_miner::get_statistics()const
+{
+   miner_statistics result;
+   result.threads = _threads.size();
+   result.mining = _active_threads > 0;
+
+   for( uint32_t i = 0; i < _threads.size(); ++i )
+   {
+      result.thread_hashes.push_back( _counters[i].hashes.load( std::memory_order_relaxed ) );
+      result.total_hashes += result.thread_hashes.back();
+   }
+
+   int64_t start = _round_start;
+   if( start == 0 )
+      return result;
+
+   int64_t end = _round_end;
+   if( result.mining || end < start )
+      end = fc::time_point::now().time_since_epoch().count();
+
+   result.round_hashes = result.total_hashes - _round_start_hashes;
+   if( end > start )
+      result.hashes_per_second = double( result.round_hashes ) * 1000000 / ( end - start );
+
+   return result;
+}
+
+} } // steemit::witness_plugin
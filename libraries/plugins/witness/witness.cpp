@@ -73,6 +73,7 @@ void witness_plugin::plugin_set_program_options(
           ("name of witness controlled by this node (e.g. " + witness_id_example+" )" ).c_str())
          ("miner,m", bpo::value<vector<string>>()->composing()->multitoken(), "name of miner and its private key (e.g. [\"account\",\"WIF PRIVATE KEY\"] )" )
          ("mining-threads,t", bpo::value<uint32_t>(),"Number of threads to use for proof of work mining" )
+         ("mining-pin-threads", bpo::bool_switch()->default_value(false), "Pin each proof of work mining thread to its own CPU core" )
          ("private-key", bpo::value<vector<string>>()->composing()->multitoken(), "WIF PRIVATE KEY to be used by one or more witnesses or miners" )
          ("miner-account-creation-fee", bpo::value<uint64_t>()->implicit_value(100000),"Account creation fee to be voted on upon successful POW - Minimum fee is 100.000 STEEM (written as 100000)")
          ("miner-maximum-block-size", bpo::value<uint32_t>()->implicit_value(131072),"Maximum block size (in bytes) to be voted on upon successful POW - Max block size must be between 128 KB and 750 MB")
@@ -115,9 +116,8 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
    if( options.count("mining-threads") )
    {
       _mining_threads = std::min( options["mining-threads"].as<uint32_t>(), uint32_t(64) );
-      _thread_pool.resize( _mining_threads );
-      for( uint32_t i = 0; i < _mining_threads; ++i )
-         _thread_pool[i] = std::make_shared<fc::thread>();
+      _pin_mining_threads = options.count("mining-pin-threads") && options["mining-pin-threads"].as<bool>();
+      _miner.reset( new pow_miner( _mining_threads, _pin_mining_threads ) );
    }
 
    if( options.count("private-key") )
@@ -161,6 +161,8 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
       _miner_prop_vote.sbd_interest_rate = options["miner-sbd-interest-rate"].as<uint32_t>();
    }
 
+   app().register_api_factory< witness_api >( "witness_api" );
+
    ilog("witness plugin:  plugin_initialize() end");
 } FC_LOG_AND_RETHROW() }
 
@@ -181,6 +183,18 @@ void witness_plugin::plugin_startup()
             new_chain_banner(d);
          _production_skip_flags |= steemit::chain::database::skip_undo_history_check;
       }
+      d.applied_block.connect( [this]( const chain::signed_block& b )
+      {
+         _block_template.reset();
+         schedule_block_template( true );
+      } );
+      d.on_pending_transaction.connect( [this]( const chain::signed_transaction& trx )
+      {
+         if( _block_template.valid() && database().extend_block_template( *_block_template, trx ) )
+            ++_production_stats.template_extensions;
+         else
+            schedule_block_template( false );
+      } );
       schedule_production_loop();
    } else
       elog("No witnesses configured! Please add witness names and private keys to configuration.");
@@ -198,11 +212,25 @@ void witness_plugin::plugin_startup()
 
 void witness_plugin::plugin_shutdown()
 {
+   try
+   {
+      if( _block_template_task.valid() )
+         _block_template_task.cancel_and_wait( __FUNCTION__ );
+   }
+   catch( const fc::canceled_exception& )
+   {
+   }
+   catch( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+   }
+   _block_template.reset();
+
    graphene::time::shutdown_ntp_time();
    if( !_miners.empty() )
    {
       ilog( "shutting downing mining threads" );
-      _thread_pool.clear();
+      _miner.reset();
    }
    return;
 }
@@ -296,6 +324,7 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
 block_production_condition::block_production_condition_enum witness_plugin::maybe_produce_block( fc::mutable_variant_object& capture )
 {
    chain::database& db = database();
+   fc::time_point start = fc::time_point::now();
    fc::time_point now_fine = graphene::time::now();
    fc::time_point_sec now = now_fine + fc::microseconds( 500000 );
 
@@ -354,27 +383,48 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
       return block_production_condition::low_participation;
    }
 
+   _production_stats.wake_lag.record( llabs( (now_fine - fc::time_point( scheduled_time )).count() ), false );
+
    if( llabs((scheduled_time - now).count()) > fc::milliseconds( 500 ).count() )
    {
+      ++_production_stats.lag_misses;
       capture("scheduled_time", scheduled_time)("now", now);
       return block_production_condition::lag;
    }
 
+   fc::optional< chain::signed_block > block;
+
+   // a template built on the head block for this slot holds the transactions the block would have
+   if( _block_template.valid() && _block_template->previous == db.head_block_id()
+       && _block_template->timestamp == scheduled_time && _block_template->witness == scheduled_witness )
+   {
+      try
+      {
+         block = db.generate_block( *_block_template, private_key_itr->second, _production_skip_flags );
+         ++_production_stats.produced_from_template;
+      }
+      catch( const fc::canceled_exception& )
+      {
+         throw;
+      }
+      catch( fc::exception& e )
+      {
+         wlog( "Unable to produce block from its template, generating it again: ${e}", ("e",e.to_detail_string()) );
+      }
+   }
+   _block_template.reset();
+
    int retry = 0;
-   do
+   while( !block.valid() && retry < 2 )
    {
       try
       {
-      auto block = db.generate_block(
+      block = db.generate_block(
          scheduled_time,
          scheduled_witness,
          private_key_itr->second,
          _production_skip_flags
          );
-         capture("n", block.block_num())("t", block.timestamp)("c", now)("w",scheduled_witness);
-         fc::async( [this,block](){ p2p_node().broadcast(graphene::net::block_message(block)); } );
-
-         return block_production_condition::produced;
       }
       catch( fc::exception& e )
       {
@@ -383,9 +433,73 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
          db.clear_pending();
          retry++;
       }
-   } while( retry < 2 );
+   }
+
+   _production_stats.generation.record( (fc::time_point::now() - start).count(), !block.valid() );
+   if( !block.valid() )
+      return block_production_condition::exception_producing_block;
+
+   ++_production_stats.produced;
+   capture("n", block->block_num())("t", block->timestamp)("c", now)("w",scheduled_witness);
+   fc::async( [this,block](){ p2p_node().broadcast(graphene::net::block_message(*block)); } );
+
+   return block_production_condition::produced;
+}
+
+void witness_plugin::schedule_block_template( bool head_changed )
+{
+   // transactions arriving in a burst are collected into one rebuild
+   if( _block_template_task.valid() && !_block_template_task.ready() )
+   {
+      if( !head_changed || _block_template_task_time <= fc::time_point::now() + fc::milliseconds( 100 ) )
+         return;
+      _block_template_task.cancel();
+   }
+
+   // a template that is only missing new transactions is rebuilt at most once a second,
+   // one on a new head block is needed for the next slot and is built right away
+   auto when = fc::time_point::now() + fc::milliseconds( 100 );
+   if( !head_changed )
+      when = std::max( when, _last_block_template_build + fc::seconds( 1 ) );
+
+   _block_template_task_time = when;
+   _block_template_task = fc::schedule( [this]{ build_block_template(); }, when, "Witness Block Template" );
+}
+
+void witness_plugin::build_block_template()
+{
+   chain::database& db = database();
+   if( !_production_enabled )
+      return;
+
+   fc::time_point_sec when = db.get_slot_time( 1 );
+   string scheduled_witness = db.get_scheduled_witness( 1 );
+   if( _witnesses.find( scheduled_witness ) == _witnesses.end()
+       || _private_keys.find( db.get_witness( scheduled_witness ).signing_key ) == _private_keys.end() )
+   {
+      _block_template.reset();
+      return;
+   }
 
-   return block_production_condition::exception_producing_block;
+   fc::time_point start = fc::time_point::now();
+   _last_block_template_build = start;
+   try
+   {
+      _block_template = db.build_block_template( when, scheduled_witness, _production_skip_flags );
+      ++_production_stats.template_builds;
+      _production_stats.template_build.record( (fc::time_point::now() - start).count(), false );
+   }
+   catch( const fc::canceled_exception& )
+   {
+      throw;
+   }
+   catch( const fc::exception& e )
+   {
+      _block_template.reset();
+      ++_production_stats.template_failures;
+      _production_stats.template_build.record( (fc::time_point::now() - start).count(), true );
+      wlog( "Unable to build the block template for ${w}: ${e}", ("w",scheduled_witness)("e",e.to_detail_string()) );
+   }
 }
 
 /**
@@ -407,8 +521,11 @@ void witness_plugin::on_applied_block( const chain::signed_block& b )
   if( !_mining_threads || _miners.size() == 0 ) return;
   chain::database& db = database();
 
+   // the work of the last round is for the previous block
+   _miner->stop();
+
    const auto& dgp = db.get_dynamic_global_properties();
-   double hps   = (_total_hashes*1000000)/(fc::time_point::now()-_hash_start_time).count();
+   double hps   = _miner->get_statistics().hashes_per_second;
    int64_t bits    = (dgp.num_pow_witnesses/4) + 4;
    fc::uint128 hashes  = fc::uint128(1) << bits;
    hashes *= 1000000;
@@ -424,10 +541,6 @@ void witness_plugin::on_applied_block( const chain::signed_block& b )
               ("x",uint64_t(hps)) ("t",bits) ("m", minutes ) ("l",dgp.num_pow_witnesses)
          );
 
-
-  _head_block_num = b.block_num();
-  /// save these variables to be captured by worker lambda
-
   for( const auto& miner : _miners ) {
     const auto* w = db.find_witness( miner.first );
     if( !w || w->pow_worker == 0 ) {
@@ -463,62 +576,73 @@ void witness_plugin::start_mining( const fc::ecc::public_key& pub, const fc::ecc
     auto target = db.get_pow_target();
     fc::thread* mainthread = &fc::thread::current();
 
-    _total_hashes = 0;
-    _hash_start_time = fc::time_point::now();
-
+    // the work is useless two block intervals after the head block, as measured by NTP
     auto stop = head_block_time + fc::seconds( STEEMIT_BLOCK_INTERVAL * 2 );
-
-    uint32_t thread_num = 0;
-    uint32_t num_threads = _mining_threads;
-    for( auto& t : _thread_pool ) {
-       t->async( [=](){
-          chain::pow_operation op;
-          op.block_id = block_id;
-          op.worker_account = miner;
-          op.work.worker = pub;
-          op.nonce = start + thread_num;
-          op.props = _miner_prop_vote;
-          while( true )
-          {
-          //  if( ((op.nonce/num_threads) % 1000) == 0 ) idump((op.nonce));
-            if( graphene::time::nonblocking_now() > stop )
-            {
-           //     ilog( "stop mining due to time out, nonce: ${n}", ("n",op.nonce) );
-                return;
-            }
-            if( this->_head_block_num != head_block_num )
-            {
-           //     wlog( "stop mining due new block arrival, nonce: ${n}", ("n",op.nonce));
-                return;
-            }
-            ++this->_total_hashes;
-
-            op.nonce += num_threads;
-            op.work.create( pk, op.work_input() );
-            if( op.work.work < target )
-            {
-               ++this->_head_block_num; /// signal other workers to stop
-
-               chain::signed_transaction trx;
-               trx.operations.push_back(op);
-               trx.ref_block_num = head_block_num;
-               trx.ref_block_prefix = op.block_id._hash[1];
-               trx.set_expiration( head_block_time + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
-               mainthread->async( [this,miner,trx](){
-                  try {
-                     database().push_transaction( trx );
-                     ilog( "Broadcasting Proof of Work for ${miner}", ("miner",miner) );
-                     p2p_node().broadcast( graphene::net::trx_message(trx) );
-                  } catch ( const fc::exception& e ) {
-                  //   wdump((e.to_detail_string()));
-                  }
-               });
-               return;
-            }
+    auto deadline = fc::time_point::now() + ( fc::time_point( stop ) - graphene::time::nonblocking_now() );
+
+    chain::pow_operation op;
+    op.block_id = block_id;
+    op.worker_account = miner;
+    op.work.worker = pub;
+    op.props = _miner_prop_vote;
+
+    _miner->start( pk, block_id, target, start, deadline, [=]( const pow_solution& solution ){
+       chain::pow_operation pow = op;
+       pow.nonce = solution.nonce;
+       pow.work.input = solution.work.input;
+       pow.work.signature = solution.work.signature;
+       pow.work.work = solution.work.work;
+
+       chain::signed_transaction trx;
+       trx.operations.push_back(pow);
+       trx.ref_block_num = head_block_num;
+       trx.ref_block_prefix = pow.block_id._hash[1];
+       trx.set_expiration( head_block_time + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+       mainthread->async( [this,miner,trx](){
+          try {
+             database().push_transaction( trx );
+             ilog( "Broadcasting Proof of Work for ${miner}", ("miner",miner) );
+             p2p_node().broadcast( graphene::net::trx_message(trx) );
+          } catch ( const fc::exception& e ) {
+          //   wdump((e.to_detail_string()));
           }
        });
-       ++thread_num;
-    }
+    });
+}
+
+miner_statistics witness_plugin::get_miner_statistics()const
+{
+   if( !_miner )
+      return miner_statistics();
+   return _miner->get_statistics();
+}
+
+block_production_statistics witness_plugin::get_block_production_statistics()const
+{
+   return _production_stats;
+}
+
+witness_api::witness_api( const app::api_context& ctx )
+   : _app( ctx.app )
+{
+}
+
+void witness_api::on_api_startup()
+{
+}
+
+miner_statistics witness_api::get_miner_statistics()const
+{
+   auto plugin = _app.get_plugin< witness_plugin >( "witness" );
+   FC_ASSERT( plugin, "The witness plugin is not enabled" );
+   return plugin->get_miner_statistics();
+}
+
+block_production_statistics witness_api::get_block_production_statistics()const
+{
+   auto plugin = _app.get_plugin< witness_plugin >( "witness" );
+   FC_ASSERT( plugin, "The witness plugin is not enabled" );
+   return plugin->get_block_production_statistics();
 }
 
 STEEMIT_DEFINE_PLUGIN( witness, steemit::witness_plugin::witness_plugin )
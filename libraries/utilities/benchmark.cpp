@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/benchmark.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+
+#include <iostream>
+
+namespace bpo = boost::program_options;
+
+namespace graphene { namespace utilities {
+
+namespace detail {
+
+   /** the value of an option of one of the types benchmarks use, null for other types */
+   fc::variant option_to_variant( const boost::any& value )
+   {
+      if( auto v = boost::any_cast< uint32_t >( &value ) )
+         return fc::variant( *v );
+      if( auto v = boost::any_cast< uint64_t >( &value ) )
+         return fc::variant( *v );
+      if( auto v = boost::any_cast< int32_t >( &value ) )
+         return fc::variant( *v );
+      if( auto v = boost::any_cast< double >( &value ) )
+         return fc::variant( *v );
+      if( auto v = boost::any_cast< bool >( &value ) )
+         return fc::variant( *v );
+      if( auto v = boost::any_cast< std::string >( &value ) )
+         return fc::variant( *v );
+      return fc::variant();
+   }
+
+} // detail
+
+int benchmark_main( int argc, char** argv, const std::string& name,
+                    const std::function< void( bpo::options_description& ) >& add_options,
+                    const std::function< fc::mutable_variant_object() >& run )
+{
+   try
+   {
+      bpo::options_description options( name + " options" );
+      options.add_options()
+         ("help,h", "Print this help message and exit")
+         ;
+      add_options( options );
+
+      bpo::variables_map vm;
+      bpo::store( bpo::parse_command_line( argc, argv, options ), vm );
+      bpo::notify( vm );
+      if( vm.count( "help" ) )
+      {
+         std::cout << options << "\n";
+         return 0;
+      }
+
+      fc::mutable_variant_object used_options;
+      for( const auto& option : vm )
+         used_options[ option.first ] = detail::option_to_variant( option.second.value() );
+
+      auto result = run();
+
+      fc::mutable_variant_object output;
+      output[ "options" ] = used_options;
+      for( const auto& field : result )
+         output[ field.key() ] = field.value();
+
+      std::cout << fc::json::to_pretty_string( fc::variant( output ) ) << "\n";
+      return 0;
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+   }
+   catch( const std::exception& e )
+   {
+      std::cerr << e.what() << "\n";
+   }
+   return 1;
+}
+
+} } // graphene::utilities
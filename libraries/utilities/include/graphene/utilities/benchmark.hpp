@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/variant_object.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <functional>
+#include <string>
+
+namespace graphene { namespace utilities {
+
+/**
+ *  The main function of a benchmark program.  Parses the options add_options declares and prints
+ *  them, followed by the fields of the result of run, as one pretty printed JSON object.
+ *  --help prints the options instead of running the benchmark.
+ *
+ *  @return the exit code of the program, 1 if the options are invalid or run throws
+ */
+int benchmark_main( int argc, char** argv, const std::string& name,
+                    const std::function< void( boost::program_options::options_description& ) >& add_options,
+                    const std::function< fc::mutable_variant_object() >& run );
+
+} } // graphene::utilities
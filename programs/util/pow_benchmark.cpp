@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Measures the proof of work hash rate of the witness plugin miner, with all of its
+ *  threads, against computing pow_operation::work_input and pow::create for one nonce at a
+ *  time on a single thread as the miner used to.
+ */
+
+#include <steemit/witness/miner.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <thread>
+
+using namespace steemit;
+using namespace steemit::witness_plugin;
+
+namespace bpo = boost::program_options;
+
+int main( int argc, char** argv )
+{
+   uint32_t threads;
+   uint32_t seconds;
+   bool pin_threads = false;
+
+   return graphene::utilities::benchmark_main( argc, argv, "pow_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("threads", bpo::value< uint32_t >( &threads )->default_value( std::max( std::thread::hardware_concurrency(), 1u ) ), "Mining threads")
+            ("seconds", bpo::value< uint32_t >( &seconds )->default_value( 10 ), "Duration of each measurement")
+            ("pin-threads", bpo::bool_switch( &pin_threads ), "Pin each mining thread to its own CPU core")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "pow_benchmark" ) ) );
+         chain::pow_operation op;
+         op.block_id._hash[0] = 0x12345678;
+         op.worker_account = "miner";
+         op.work.worker = key.get_public_key();
+
+         // the miner must produce the same work as pow_operation
+         auto block_hash = fc::sha256::hash( op.block_id );
+         for( op.nonce = 0; op.nonce < 16; ++op.nonce )
+         {
+            FC_ASSERT( pow_miner::work_input( block_hash, op.nonce ) == op.work_input() );
+            op.work.create( key, op.work_input() );
+            op.work.validate();
+         }
+
+         // one nonce at a time on a single thread
+         uint64_t single_hashes = 0;
+         auto start = fc::time_point::now();
+         auto end = start + fc::seconds( seconds );
+         while( fc::time_point::now() < end )
+         {
+            ++op.nonce;
+            op.work.create( key, op.work_input() );
+            ++single_hashes;
+         }
+         double single_rate = double( single_hashes ) * 1000000 / ( fc::time_point::now() - start ).count();
+
+         // no work is below a target of zero, so the miner runs until the deadline
+         pow_miner miner( threads, pin_threads );
+         miner.start( key, op.block_id, fc::sha256(), 0, fc::time_point::now() + fc::seconds( seconds ), []( const pow_solution& ){} );
+         fc::usleep( fc::seconds( seconds ) + fc::milliseconds( 500 ) );
+         auto stats = miner.get_statistics();
+
+         fc::mutable_variant_object single;
+         single[ "hashes" ] = single_hashes;
+         single[ "hashes_per_second" ] = single_rate;
+
+         fc::mutable_variant_object result;
+         result[ "single_thread" ] = single;
+         result[ "miner" ] = fc::variant( stats );
+         result[ "speedup" ] = stats.hashes_per_second / std::max( single_rate, 1.0 );
+         result[ "speedup_per_thread" ] = stats.hashes_per_second / std::max( single_rate, 1.0 ) / std::max( threads, 1u );
+
+         return result;
+      });
+}
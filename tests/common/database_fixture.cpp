@@ -8,6 +8,7 @@
 #include <steemit/chain/steem_objects.hpp>
 #include <steemit/chain/history_object.hpp>
 #include <steemit/account_history/account_history_plugin.hpp>
+#include <steemit/market_history/market_history_plugin.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -41,6 +42,7 @@ clean_database_fixture::clean_database_fixture()
          std::cout << "running test " << boost::unit_test::framework::current_test_case().p_name << std::endl;
    }
    auto ahplugin = app.register_plugin< steemit::account_history::account_history_plugin >();
+   auto mhplugin = app.register_plugin< steemit::market_history::market_history_plugin >();
    init_account_pub_key = init_account_priv_key.get_public_key();
 
    boost::program_options::variables_map options;
@@ -50,6 +52,8 @@ clean_database_fixture::clean_database_fixture()
    // app.initialize();
    ahplugin->plugin_set_app( &app );
    ahplugin->plugin_initialize( options );
+   mhplugin->plugin_set_app( &app );
+   mhplugin->plugin_initialize( options );
 
    generate_block();
    db.set_hardfork( STEEMIT_NUM_HARDFORKS );
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Measures how long a database takes to switch between two forks that keep overtaking each
+ *  other.  Two producing databases build competing branches of transfer blocks from the same
+ *  head, which are pushed to a third one.  Each time the shorter branch becomes the longer one
+ *  the third database pops the other branch and applies this one.  Apart from the two newest,
+ *  its blocks were applied before and are applied again from their redo state.  The time of
+ *  these switches per block applied is compared with the time of applying new blocks.
+ *
+ *  Like the block tests this needs a test net build, the blocks are signed with the init key.
+ */
+
+#include <steemit/chain/database.hpp>
+#include <steemit/chain/steem_objects.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/variant_object.hpp>
+
+using namespace steemit::chain;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+struct benchmark_options
+{
+   uint32_t rounds;
+   uint32_t switches;
+   uint32_t transactions;
+};
+
+struct benchmark_result
+{
+   uint32_t switches = 0;
+   uint64_t switched_blocks = 0;   ///< blocks applied while switching forks
+   int64_t  switch_time = 0;
+   uint64_t new_blocks = 0;        ///< blocks applied on top of the head
+   int64_t  new_block_time = 0;
+};
+
+#ifdef IS_TEST_NET
+
+const uint64_t initial_supply = 10000000000ll;
+
+/** generates a block of transfers on db, at its slot'th slot */
+signed_block produce( database& db, uint32_t slot, uint32_t transactions, const string& branch )
+{
+   auto key = STEEMIT_INIT_PRIVATE_KEY;
+   for( uint32_t i = 0; i < transactions; ++i )
+   {
+      transfer_operation op;
+      op.from = STEEMIT_INIT_MINER_NAME;
+      op.to = STEEMIT_NULL_ACCOUNT;
+      op.amount = asset( 1, STEEM_SYMBOL );
+      op.memo = branch + std::to_string( db.head_block_num() ) + "-" + std::to_string( i );
+
+      signed_transaction trx;
+      trx.operations.push_back( op );
+      trx.set_expiration( db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+      trx.sign( key, db.get_chain_id() );
+      db.push_transaction( trx, 0 );
+   }
+   return db.generate_block( db.get_slot_time( slot ), db.get_scheduled_witness( slot ), key, database::skip_nothing );
+}
+
+/** pushes b to db, which switches forks when b makes its branch the longest */
+void push( database& db, const signed_block& b, benchmark_result& result, uint32_t applied_on_switch )
+{
+   auto head = db.head_block_id();
+   fc::time_point start = fc::time_point::now();
+   bool switched = db.push_block( b, database::skip_nothing );
+   int64_t time = ( fc::time_point::now() - start ).count();
+
+   if( switched )
+   {
+      ++result.switches;
+      result.switched_blocks += applied_on_switch;
+      result.switch_time += time;
+   }
+   else if( db.head_block_id() != head )
+   {
+      ++result.new_blocks;
+      result.new_block_time += time;
+   }
+}
+
+benchmark_result run( const benchmark_options& o )
+{
+   fc::temp_directory dir_a( graphene::utilities::temp_directory_path() ),
+                      dir_b( graphene::utilities::temp_directory_path() ),
+                      dir_t( graphene::utilities::temp_directory_path() );
+   database producer_a, producer_b, target;
+   producer_a.open( dir_a.path(), initial_supply );
+   producer_b.open( dir_b.path(), initial_supply );
+   target.open( dir_t.path(), initial_supply );
+
+   benchmark_result result;
+   for( uint32_t round = 0; round < o.rounds; ++round )
+   {
+      // both branches start at the head of the target, a is first and b starts a slot later
+      vector< signed_block > branch_a, branch_b;
+      branch_a.push_back( produce( producer_a, 1, o.transactions, "a" ) );
+      push( target, branch_a.back(), result, 0 );
+      branch_b.push_back( produce( producer_b, 2, o.transactions, "b" ) );
+      push( target, branch_b.back(), result, 0 );
+
+      bool on_a = true;
+      for( uint32_t i = 0; i < o.switches; ++i )
+      {
+         // grow the other branch until it is the longest
+         auto& producer = on_a ? producer_b : producer_a;
+         auto& blocks = on_a ? branch_b : branch_a;
+         const auto& other = on_a ? branch_a : branch_b;
+         while( blocks.size() <= other.size() )
+         {
+            blocks.push_back( produce( producer, 1, o.transactions, on_a ? "b" : "a" ) );
+            push( target, blocks.back(), result, blocks.size() );
+         }
+         on_a = !on_a;
+      }
+
+      // the losing producer catches up with the winning branch before the next round
+      auto& loser = on_a ? producer_b : producer_a;
+      for( const auto& b : on_a ? branch_a : branch_b )
+         loser.push_block( b, database::skip_nothing );
+      FC_ASSERT( loser.head_block_id() == target.head_block_id() );
+
+      // the transfers of the losing branch would otherwise be re-applied after every block
+      loser.clear_pending();
+      target.clear_pending();
+   }
+
+   producer_a.close();
+   producer_b.close();
+   target.close();
+   return result;
+}
+
+#endif
+
+fc::mutable_variant_object to_object( const benchmark_result& r )
+{
+   fc::mutable_variant_object result;
+   result[ "switches" ] = r.switches;
+   result[ "switched_blocks" ] = r.switched_blocks;
+   result[ "switch_time_ms" ] = r.switch_time / 1000;
+   if( r.switched_blocks > 0 )
+      result[ "us_per_switched_block" ] = r.switch_time / int64_t( r.switched_blocks );
+   result[ "new_blocks" ] = r.new_blocks;
+   result[ "new_block_time_ms" ] = r.new_block_time / 1000;
+   if( r.new_blocks > 0 )
+      result[ "us_per_new_block" ] = r.new_block_time / int64_t( r.new_blocks );
+   return result;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   benchmark_options o;
+
+   return graphene::utilities::benchmark_main( argc, argv, "fork_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("rounds", bpo::value< uint32_t >( &o.rounds )->default_value( 20 ), "Times two branches compete from a common head")
+            ("switches", bpo::value< uint32_t >( &o.switches )->default_value( 6 ), "Times the branches overtake each other in a round")
+            ("transactions", bpo::value< uint32_t >( &o.transactions )->default_value( 200 ), "Transfers in each block")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+#ifdef IS_TEST_NET
+         // the branches must stay above the last irreversible block
+         FC_ASSERT( o.switches > 0 && o.switches < STEEMIT_MAX_MINERS / 2 );
+
+         return to_object( run( o ) );
+#else
+         FC_THROW( "fork_benchmark signs blocks with the init key and needs a test net build" );
+#endif
+      });
+}
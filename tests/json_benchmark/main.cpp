@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Compares steemit::app::json_writer with converting to an fc::variant and then
+ *  calling fc::json::to_string, which is how websocket API results are serialized.
+ *  For synthetic results shaped like get_discussions_by_*, get_state,
+ *  get_account_history and get_block it reports throughput and the peak number of
+ *  bytes allocated while serializing, both for the result alone and for the whole
+ *  JSON-RPC response as http_rpc_server writes it, and checks that both produce
+ *  the same JSON.
+ */
+
+#include <steemit/app/http_rpc_server.hpp>
+#include <steemit/app/json_writer.hpp>
+#include <steemit/app/state.hpp>
+#include <steemit/chain/history_object.hpp>
+#include <steemit/chain/protocol/block.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using steemit::app::discussion;
+using steemit::app::http_rpc_server;
+using steemit::app::json_writer;
+using steemit::app::state;
+using steemit::app::vote_state;
+using steemit::chain::asset;
+using steemit::chain::operation_object;
+using steemit::chain::signed_block;
+using steemit::chain::signed_transaction;
+using steemit::chain::transfer_operation;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+std::atomic< int64_t > allocated_bytes( 0 );
+std::atomic< int64_t > peak_allocated_bytes( 0 );
+std::atomic< uint64_t > allocation_count( 0 );
+
+/** every allocation is prefixed with its size so operator delete can account for it */
+const size_t allocation_header = 16;
+
+void* tracked_allocate( size_t size )
+{
+   void* p = std::malloc( size + allocation_header );
+   if( p == nullptr )
+      throw std::bad_alloc();
+   *static_cast< size_t* >( p ) = size;
+
+   int64_t current = allocated_bytes += size;
+   int64_t peak = peak_allocated_bytes.load();
+   while( current > peak && !peak_allocated_bytes.compare_exchange_weak( peak, current ) ) {}
+   ++allocation_count;
+   return static_cast< char* >( p ) + allocation_header;
+}
+
+void tracked_free( void* p )
+{
+   if( p == nullptr )
+      return;
+   void* block = static_cast< char* >( p ) - allocation_header;
+   allocated_bytes -= *static_cast< size_t* >( block );
+   std::free( block );
+}
+
+} // anonymous namespace
+
+void* operator new( size_t size ) { return tracked_allocate( size ); }
+void* operator new[]( size_t size ) { return tracked_allocate( size ); }
+void operator delete( void* p ) noexcept { tracked_free( p ); }
+void operator delete[]( void* p ) noexcept { tracked_free( p ); }
+
+namespace {
+
+std::string make_text( uint32_t size, uint32_t seed )
+{
+   static const char sample[] = "Lorem ipsum \"dolor\" sit amet,\nconsectetur\tadipiscing elit. ";
+   std::string result;
+   result.reserve( size );
+   for( uint32_t i = 0; result.size() < size; ++i )
+      result += sample[ ( i + seed ) % ( sizeof( sample ) - 1 ) ];
+   return result;
+}
+
+discussion make_discussion( uint32_t n, uint32_t body_size, uint32_t votes )
+{
+   discussion d;
+   d.id = graphene::db::object_id_type( 2, 8, n );
+   d.category = "steem";
+   d.author = "author" + std::to_string( n % 100 );
+   d.permlink = "post-number-" + std::to_string( n );
+   d.parent_permlink = d.category;
+   d.title = "Post number " + std::to_string( n );
+   d.body = make_text( body_size, n );
+   d.json_metadata = "{\"tags\":[\"steem\",\"benchmark\"]}";
+   d.created = fc::time_point_sec( 1467000000 + n );
+   d.last_update = d.created;
+   d.active = d.created;
+   d.cashout_time = d.created + fc::days( 1 );
+   d.children = n % 7;
+   d.children_rshares2 = fc::uint128_t( n ) * 1000000007ull;
+   d.net_rshares = int64_t( n ) * 123456789;
+   d.abs_rshares = d.net_rshares;
+   d.total_vote_weight = uint64_t( n ) * 9876543210ull;
+   d.net_votes = votes;
+   d.url = "/steem/@" + d.author + "/" + d.permlink;
+   d.root_title = d.title;
+   d.pending_payout_value = asset( n * 1000, SBD_SYMBOL );
+   d.total_pending_payout_value = d.pending_payout_value;
+   d.active_vote_count = votes;
+   for( uint32_t i = 0; i < votes; ++i )
+   {
+      vote_state v;
+      v.voter = "voter" + std::to_string( i );
+      v.weight = uint64_t( i ) * 5000000000ull;
+      v.rshares = int64_t( i ) * 100000000;
+      v.percent = 10000;
+      v.time = d.created + i;
+      d.active_votes.push_back( v );
+   }
+   return d;
+}
+
+std::map< uint32_t, operation_object > make_history( uint32_t count )
+{
+   std::map< uint32_t, operation_object > history;
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob" + std::to_string( i % 10 );
+      op.amount = asset( 1000 + i, STEEM_SYMBOL );
+      op.memo = make_text( 40, i );
+
+      operation_object o;
+      o.block = 1000000 + i / 10;
+      o.trx_in_block = i % 10;
+      o.timestamp = fc::time_point_sec( 1467000000 + i * 3 );
+      o.op = op;
+      history[ i ] = o;
+   }
+   return history;
+}
+
+signed_block make_block( uint32_t transactions )
+{
+   signed_block block;
+   block.timestamp = fc::time_point_sec( 1467000000 );
+   block.witness = "witness";
+   for( uint32_t i = 0; i < transactions; ++i )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob" + std::to_string( i % 10 );
+      op.amount = asset( 1000 + i, STEEM_SYMBOL );
+      op.memo = make_text( 40, i );
+
+      signed_transaction trx;
+      trx.ref_block_num = uint16_t( i );
+      trx.ref_block_prefix = 123456789 + i;
+      trx.expiration = block.timestamp + 60;
+      trx.operations.push_back( op );
+      trx.signatures.resize( 1 );
+      block.transactions.push_back( trx );
+   }
+   return block;
+}
+
+state make_state( uint32_t posts, uint32_t body_size, uint32_t votes )
+{
+   state s;
+   s.current_route = "/trending";
+   for( uint32_t i = 0; i < posts; ++i )
+   {
+      discussion d = make_discussion( i, body_size, votes );
+      std::string key = d.author + "/" + d.permlink;
+      s.discussion_idx[ "" ].trending.push_back( key );
+      s.content[ key ] = d;
+   }
+   s.error = "";
+   return s;
+}
+
+struct measurement
+{
+   double   mb_per_second = 0;
+   double   calls_per_second = 0;
+   int64_t  peak_allocated_bytes = 0;
+   uint64_t allocations_per_call = 0;
+   size_t   output_size = 0;
+};
+
+template< typename Serialize >
+measurement measure( Serialize&& serialize, uint32_t iterations )
+{
+   measurement result;
+
+   // peak allocation of a single call on top of what is already allocated
+   int64_t base = allocated_bytes.load();
+   peak_allocated_bytes = base;
+   uint64_t base_count = allocation_count.load();
+   result.output_size = serialize().size();
+   result.peak_allocated_bytes = peak_allocated_bytes.load() - base;
+   result.allocations_per_call = allocation_count.load() - base_count;
+
+   fc::time_point start = fc::time_point::now();
+   size_t total = 0;
+   for( uint32_t i = 0; i < iterations; ++i )
+      total += serialize().size();
+   int64_t elapsed = std::max< int64_t >( ( fc::time_point::now() - start ).count(), 1 );
+
+   result.mb_per_second = total / double( elapsed );
+   result.calls_per_second = iterations * 1000000.0 / elapsed;
+   return result;
+}
+
+fc::variant_object report( const measurement& m )
+{
+   fc::mutable_variant_object result;
+   result[ "output_bytes" ] = uint64_t( m.output_size );
+   result[ "mb_per_second" ] = m.mb_per_second;
+   result[ "calls_per_second" ] = m.calls_per_second;
+   result[ "peak_allocated_bytes" ] = m.peak_allocated_bytes;
+   result[ "allocations_per_call" ] = m.allocations_per_call;
+   return result;
+}
+
+template< typename T >
+fc::variant_object compare( const T& value, uint32_t iterations )
+{
+   std::string expected = fc::json::to_string( fc::variant( value ) );
+   std::string actual = json_writer::to_string( value );
+   // compare parsed values so that differences in number formatting are not reported
+   FC_ASSERT( fc::json::to_string( fc::json::from_string( expected ) ) == fc::json::to_string( fc::json::from_string( actual ) ),
+              "json_writer output differs from fc::json" );
+
+   measurement variant_result = measure( [&]() -> std::string { return fc::json::to_string( fc::variant( value ) ); }, iterations );
+   measurement writer_result = measure( [&]() -> std::string { return json_writer::to_string( value ); }, iterations );
+
+   // the whole response of a call, as the websocket server and http_rpc_server build it
+   fc::variant id( 1 );
+   expected = fc::json::to_string( fc::mutable_variant_object( "jsonrpc", "2.0" )( "id", id )( "result", fc::variant( value ) ) );
+   actual = http_rpc_server::make_rpc_response( id, json_writer::to_string( value ) );
+   FC_ASSERT( fc::json::to_string( fc::json::from_string( expected ) ) == fc::json::to_string( fc::json::from_string( actual ) ),
+              "http_rpc_server response differs from the variant response" );
+
+   measurement variant_response = measure( [&]() -> std::string
+   {
+      return fc::json::to_string( fc::mutable_variant_object( "jsonrpc", "2.0" )( "id", id )( "result", fc::variant( value ) ) );
+   }, iterations );
+   measurement http_response = measure( [&]() -> std::string
+   {
+      return http_rpc_server::make_rpc_response( id, json_writer::to_string( value ) );
+   }, iterations );
+
+   fc::mutable_variant_object result;
+   result[ "variant" ] = report( variant_result );
+   result[ "json_writer" ] = report( writer_result );
+   if( writer_result.peak_allocated_bytes > 0 )
+      result[ "peak_allocation_ratio" ] = double( variant_result.peak_allocated_bytes ) / writer_result.peak_allocated_bytes;
+   if( variant_result.mb_per_second > 0 )
+      result[ "speedup" ] = writer_result.mb_per_second / variant_result.mb_per_second;
+   result[ "variant_response" ] = report( variant_response );
+   result[ "http_response" ] = report( http_response );
+   if( variant_response.mb_per_second > 0 )
+      result[ "response_speedup" ] = http_response.mb_per_second / variant_response.mb_per_second;
+   return result;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   uint32_t discussion_count;
+   uint32_t body_size;
+   uint32_t votes_per_discussion;
+   uint32_t history_size;
+   uint32_t block_transactions;
+   uint32_t iterations;
+
+   return graphene::utilities::benchmark_main( argc, argv, "json_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("discussions", bpo::value< uint32_t >( &discussion_count )->default_value( 100 ), "Discussions in the discussion list and in state")
+            ("body-size", bpo::value< uint32_t >( &body_size )->default_value( 4000 ), "Bytes in the body of each discussion")
+            ("votes", bpo::value< uint32_t >( &votes_per_discussion )->default_value( 50 ), "Active votes on each discussion")
+            ("history", bpo::value< uint32_t >( &history_size )->default_value( 2000 ), "Operations in the account history")
+            ("block-transactions", bpo::value< uint32_t >( &block_transactions )->default_value( 1000 ), "Transactions in the block")
+            ("iterations", bpo::value< uint32_t >( &iterations )->default_value( 50 ), "Times each result is serialized")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         std::vector< discussion > discussions;
+         for( uint32_t i = 0; i < discussion_count; ++i )
+            discussions.push_back( make_discussion( i, body_size, votes_per_discussion ) );
+         state s = make_state( discussion_count, body_size, votes_per_discussion );
+         auto history = make_history( history_size );
+         fc::optional< signed_block > block = make_block( block_transactions );
+
+         fc::mutable_variant_object result;
+         result[ "discussions" ] = compare( discussions, iterations );
+         result[ "state" ] = compare( s, iterations );
+         result[ "account_history" ] = compare( history, iterations );
+         result[ "block" ] = compare( block, iterations );
+         return result;
+      });
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Measures how many orders per second database::apply_order matches.  A deep book of
+ *  STEEM asks spread over many price levels is created directly in a database, then bids
+ *  which each sweep several asks are applied.  The same orders are also matched one at a
+ *  time with database::match, which updates the liquidity reward balances after every
+ *  match as apply_order did before.
+ */
+
+#include <steemit/chain/account_object.hpp>
+#include <steemit/chain/database.hpp>
+#include <steemit/chain/history_object.hpp>
+#include <steemit/chain/steem_objects.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/variant_object.hpp>
+
+#include <random>
+
+using namespace steemit::chain;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+struct benchmark_options
+{
+   uint32_t accounts;
+   uint32_t depth;
+   uint32_t levels;
+   uint32_t orders;
+   uint32_t sweep;
+};
+
+struct benchmark_result
+{
+   int64_t  time = 0;
+   uint64_t matches = 0;
+   uint32_t filled_orders = 0;
+};
+
+/** the bid sweeping the book in per match mode, like apply_order with a match call per resting order */
+void match_each( database& db, const limit_order_object& new_order )
+{
+   const auto& limit_price_idx = db.get_index_type< limit_order_index >().indices().get< by_price >();
+
+   auto max_price = ~new_order.sell_price;
+   auto limit_itr = limit_price_idx.lower_bound( max_price.max() );
+   auto limit_end = limit_price_idx.upper_bound( max_price );
+
+   bool finished = false;
+   while( !finished && limit_itr != limit_end )
+   {
+      auto old_limit_itr = limit_itr;
+      ++limit_itr;
+      finished = ( db.match( new_order, *old_limit_itr, old_limit_itr->sell_price ) & 0x1 );
+   }
+}
+
+benchmark_result run( const benchmark_options& o, bool batched )
+{
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   database db;
+   db.open( data_dir.path() );
+
+   benchmark_result result;
+   db.pre_apply_operation.connect( [&]( const operation_object& op )
+   {
+      if( op.op.which() == operation::tag< fill_order_operation >::value )
+         ++result.matches;
+   });
+
+   std::mt19937 rng( 42 );
+   auto now = db.head_block_time();
+
+   vector< string > accounts;
+   for( uint32_t i = 0; i < o.accounts; ++i )
+   {
+      accounts.push_back( "trader" + std::to_string( i ) );
+      db.create< account_object >( [&]( account_object& a ) { a.name = accounts.back(); } );
+   }
+
+   // asks of 1 to 100 STEEM at prices from 1.000 SBD up, old enough to earn liquidity rewards
+   uint32_t orderid = 0;
+   uint64_t ask_steem = 0;
+   for( uint32_t i = 0; i < o.depth; ++i )
+   {
+      share_type steem = 1000 * ( 1 + rng() % 100 );
+      share_type sbd_per_1000 = 1000 + rng() % o.levels;
+      ask_steem += steem.value;
+      db.create< limit_order_object >( [&]( limit_order_object& order )
+      {
+         order.created = now - fc::days( 1 );
+         order.expiration = fc::time_point_sec::maximum();
+         order.seller = accounts[ rng() % accounts.size() ];
+         order.orderid = orderid++;
+         order.for_sale = steem;
+         order.sell_price = asset( 1000, STEEM_SYMBOL ) / asset( sbd_per_1000, SBD_SYMBOL );
+      });
+   }
+
+   // bids willing to pay up to 2.000 SBD, each worth about sweep asks at the average price
+   uint64_t average_steem = ask_steem / std::max< uint32_t >( o.depth, 1 );
+   for( uint32_t i = 0; i < o.orders; ++i )
+   {
+      share_type sbd = average_steem * o.sweep * ( 1000 + o.levels / 2 ) / 1000;
+      const auto& bid = db.create< limit_order_object >( [&]( limit_order_object& order )
+      {
+         order.created = now;
+         order.expiration = fc::time_point_sec::maximum();
+         order.seller = accounts[ rng() % accounts.size() ];
+         order.orderid = orderid++;
+         order.for_sale = sbd;
+         order.sell_price = asset( 2000, SBD_SYMBOL ) / asset( 1000, STEEM_SYMBOL );
+      });
+      auto id = bid.id;
+
+      fc::time_point start = fc::time_point::now();
+      if( batched )
+         db.apply_order( bid );
+      else
+         match_each( db, bid );
+      result.time += ( fc::time_point::now() - start ).count();
+
+      if( db.find_object( id ) == nullptr )
+         ++result.filled_orders;
+   }
+
+   db.close();
+   return result;
+}
+
+fc::mutable_variant_object to_object( const benchmark_result& r )
+{
+   fc::mutable_variant_object result;
+   result[ "matches" ] = r.matches / 2;
+   result[ "filled_bids" ] = r.filled_orders;
+   result[ "time_ms" ] = r.time / 1000;
+   if( r.time > 0 )
+      result[ "matches_per_second" ] = double( r.matches / 2 ) * 1000000 / r.time;
+   return result;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   benchmark_options o;
+
+   return graphene::utilities::benchmark_main( argc, argv, "market_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("accounts", bpo::value< uint32_t >( &o.accounts )->default_value( 1000 ), "Accounts placing orders")
+            ("depth", bpo::value< uint32_t >( &o.depth )->default_value( 200000 ), "Asks on the book before the bids are placed")
+            ("levels", bpo::value< uint32_t >( &o.levels )->default_value( 1000 ), "Price levels of the asks")
+            ("orders", bpo::value< uint32_t >( &o.orders )->default_value( 10000 ), "Bids crossing the book")
+            ("sweep", bpo::value< uint32_t >( &o.sweep )->default_value( 10 ), "Asks filled by each bid on average")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         FC_ASSERT( o.accounts > 0 && o.levels > 0 );
+
+         auto per_match = run( o, false );
+         auto batched = run( o, true );
+
+         fc::mutable_variant_object result;
+         result[ "per_match" ] = to_object( per_match );
+         result[ "apply_order" ] = to_object( batched );
+         if( batched.time > 0 )
+            result[ "speedup" ] = double( per_match.time ) / batched.time;
+         return result;
+      });
+}
@@ -0,0 +1,572 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Runs a small p2p network of in-process nodes connected over loopback and
+ *  measures how quickly blocks and transactions propagate and how fast a new
+ *  node can sync, so changes to graphene::net can be compared on a single box.
+ *
+ *  The nodes do not run a steemit::chain::database, they use an in-memory
+ *  node_delegate that accepts any block linking to its head block and any
+ *  transaction it has not seen.  This keeps the measurements focused on the
+ *  network layer.
+ */
+
+#include <graphene/net/node.hpp>
+#include <graphene/net/exceptions.hpp>
+#include <graphene/utilities/benchmark.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <steemit/chain/protocol/block.hpp>
+#include <steemit/chain/protocol/operations.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace graphene::net;
+using steemit::chain::block_header;
+using steemit::chain::block_id_type;
+using steemit::chain::custom_operation;
+using steemit::chain::signed_block;
+using steemit::chain::signed_transaction;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+/** CPU time used by the whole process (all nodes and their threads) */
+fc::microseconds process_cpu_time()
+{
+#ifndef WIN32
+   struct rusage usage;
+   if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+      return fc::seconds( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) +
+             fc::microseconds( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec );
+#endif
+   return fc::microseconds();
+}
+
+/** Records when each item was injected and how long it took to reach the other nodes */
+class propagation_tracker
+{
+   public:
+      void item_injected( const item_id& item )
+      {
+         _injection_times[ item ] = fc::time_point::now();
+         ++_items_injected[ item.item_type ];
+      }
+
+      void item_received( const item_id& item )
+      {
+         auto itr = _injection_times.find( item );
+         if( itr != _injection_times.end() )
+            _latencies[ item.item_type ].push_back( ( fc::time_point::now() - itr->second ).count() );
+      }
+
+      uint64_t deliveries()const
+      {
+         uint64_t result = 0;
+         for( const auto& latencies : _latencies )
+            result += latencies.second.size();
+         return result;
+      }
+
+      /** latency percentiles in milliseconds, along with the fraction of expected deliveries that happened */
+      fc::variant_object report( uint32_t item_type, uint32_t receivers_per_item )const
+      {
+         fc::mutable_variant_object result;
+         auto injected_itr = _items_injected.find( item_type );
+         uint64_t injected = injected_itr == _items_injected.end() ? 0 : injected_itr->second;
+         result[ "injected" ] = injected;
+
+         std::vector< int64_t > latencies;
+         auto latencies_itr = _latencies.find( item_type );
+         if( latencies_itr != _latencies.end() )
+            latencies = latencies_itr->second;
+         result[ "delivered" ] = uint64_t( latencies.size() );
+         if( injected && receivers_per_item )
+            result[ "delivered_fraction" ] = double( latencies.size() ) / ( injected * receivers_per_item );
+         if( latencies.empty() )
+            return result;
+
+         std::sort( latencies.begin(), latencies.end() );
+         auto percentile = [&]( uint32_t p ) -> double
+         {
+            size_t index = std::min< size_t >( latencies.size() - 1, latencies.size() * p / 100 );
+            return latencies[ index ] / 1000.0;
+         };
+         result[ "p50_ms" ] = percentile( 50 );
+         result[ "p90_ms" ] = percentile( 90 );
+         result[ "p99_ms" ] = percentile( 99 );
+         result[ "max_ms" ] = latencies.back() / 1000.0;
+         return result;
+      }
+
+   private:
+      std::unordered_map< item_id, fc::time_point >      _injection_times;
+      std::map< uint32_t, uint64_t >                     _items_injected;
+      std::map< uint32_t, std::vector< int64_t > >       _latencies;
+};
+
+/**
+ *  An in-memory, single chain stand-in for the application's node_delegate.
+ *  Transactions are keyed by their message id, which is what the p2p layer
+ *  uses to refer to them.
+ */
+class benchmark_node_delegate : public node_delegate
+{
+   public:
+      benchmark_node_delegate( propagation_tracker& tracker, fc::time_point_sec genesis_time )
+         : _tracker( tracker ), _genesis_time( genesis_time )
+      {
+         _block_ids.push_back( block_id_type() );
+      }
+
+      uint32_t      head_block_num()const { return _block_ids.size() - 1; }
+      block_id_type head_block_id()const  { return _block_ids.back(); }
+      uint64_t      bytes_of_blocks()const { return _bytes_of_blocks; }
+      uint32_t      connection_count()const { return _connection_count; }
+
+      void push_block( const signed_block& block )
+      {
+         FC_ASSERT( block.previous == head_block_id() );
+         block_id_type id = block.id();
+         _block_ids.push_back( id );
+         _bytes_of_blocks += fc::raw::pack_size( block );
+         _blocks[ id ] = block;
+      }
+
+      /** returns the message id the p2p layer will use for the transaction */
+      message_hash_type push_transaction( const signed_transaction& trx )
+      {
+         trx_message msg( trx );
+         message_hash_type id = message( msg ).id();
+         if( _transactions.emplace( id, msg ).second )
+            _pending_transactions.push_back( id );
+         return id;
+      }
+
+      signed_block generate_block( uint32_t max_transactions )
+      {
+         signed_block block;
+         block.previous = head_block_id();
+         block.timestamp = fc::time_point::now();
+         block.witness = "benchmark";
+         while( !_pending_transactions.empty() && block.transactions.size() < max_transactions )
+         {
+            block.transactions.push_back( _transactions[ _pending_transactions.front() ].trx );
+            _pending_transactions.pop_front();
+         }
+         block.transaction_merkle_root = block.calculate_merkle_root();
+         return block;
+      }
+
+      bool has_item( const item_id& id ) override
+      {
+         if( id.item_type == block_message_type )
+            return _blocks.find( id.item_hash ) != _blocks.end();
+         return _transactions.find( id.item_hash ) != _transactions.end();
+      }
+
+      bool handle_block( const block_message& blk_msg, bool sync_mode,
+                         std::vector< fc::uint160_t >& contained_transaction_message_ids ) override
+      {
+         if( _blocks.find( blk_msg.block_id ) != _blocks.end() )
+            return false;
+         if( blk_msg.block.previous != head_block_id() )
+            FC_THROW_EXCEPTION( graphene::net::unlinkable_block_exception, "block ${id} does not link to our head block ${head}",
+                                ("id", blk_msg.block_id)("head", head_block_id()) );
+         push_block( blk_msg.block );
+         if( !sync_mode )
+            _tracker.item_received( item_id( block_message_type, blk_msg.block_id ) );
+         return false;
+      }
+
+      void handle_transaction( const trx_message& trx_msg ) override
+      {
+         message_hash_type id = message( trx_msg ).id();
+         if( _transactions.emplace( id, trx_msg ).second )
+         {
+            _pending_transactions.push_back( id );
+            _tracker.item_received( item_id( trx_message_type, id ) );
+         }
+      }
+
+      void handle_message( const message& message_to_process ) override
+      {
+         FC_THROW( "Invalid Message Type" );
+      }
+
+      std::vector< item_hash_t > get_block_ids( const std::vector< item_hash_t >& blockchain_synopsis,
+                                                uint32_t& remaining_item_count,
+                                                uint32_t limit ) override
+      {
+         std::vector< item_hash_t > result;
+         remaining_item_count = 0;
+         if( head_block_num() == 0 )
+            return result;
+
+         uint32_t last_known_block_num = 0;
+         if( !blockchain_synopsis.empty() )
+         {
+            bool found_a_block_in_synopsis = false;
+            for( auto itr = blockchain_synopsis.rbegin(); itr != blockchain_synopsis.rend(); ++itr )
+               if( is_included_block( *itr ) )
+               {
+                  last_known_block_num = block_header::num_from_id( *itr );
+                  found_a_block_in_synopsis = true;
+                  break;
+               }
+            if( !found_a_block_in_synopsis )
+               FC_THROW_EXCEPTION( graphene::net::peer_is_on_an_unreachable_fork, "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis" );
+         }
+
+         for( uint32_t num = std::max< uint32_t >( last_known_block_num, 1 ); num <= head_block_num() && result.size() < limit; ++num )
+            result.push_back( _block_ids[ num ] );
+         if( !result.empty() )
+            remaining_item_count = head_block_num() - block_header::num_from_id( result.back() );
+         return result;
+      }
+
+      message get_item( const item_id& id ) override
+      {
+         if( id.item_type == block_message_type )
+         {
+            auto itr = _blocks.find( id.item_hash );
+            if( itr == _blocks.end() )
+               FC_THROW_EXCEPTION( fc::key_not_found_exception, "unknown block ${id}", ("id", id.item_hash) );
+            return block_message( itr->second );
+         }
+         auto itr = _transactions.find( id.item_hash );
+         if( itr == _transactions.end() )
+            FC_THROW_EXCEPTION( fc::key_not_found_exception, "unknown transaction ${id}", ("id", id.item_hash) );
+         return itr->second;
+      }
+
+      /** there are no forks, so this is just the exponentially thinning list of block ids up to the reference point */
+      std::vector< item_hash_t > get_blockchain_synopsis( const item_hash_t& reference_point,
+                                                          uint32_t number_of_blocks_after_reference_point ) override
+      {
+         std::vector< item_hash_t > synopsis;
+         uint32_t high_block_num = reference_point == item_hash_t() ? head_block_num() : block_header::num_from_id( reference_point );
+         FC_ASSERT( high_block_num <= head_block_num() );
+         if( high_block_num == 0 )
+            return synopsis;
+
+         uint32_t low_block_num = 1;
+         uint32_t true_high_block_num = high_block_num + number_of_blocks_after_reference_point;
+         do
+         {
+            synopsis.push_back( _block_ids[ low_block_num ] );
+            low_block_num += ( true_high_block_num - low_block_num + 2 ) / 2;
+         }
+         while( low_block_num <= high_block_num );
+         return synopsis;
+      }
+
+      void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+      void connection_count_changed( uint32_t c ) override { _connection_count = c; }
+
+      uint32_t get_block_number( const item_hash_t& block_id ) override
+      {
+         return block_header::num_from_id( block_id );
+      }
+
+      fc::time_point_sec get_block_time( const item_hash_t& block_id ) override
+      {
+         if( block_id == item_hash_t() )
+            return _genesis_time;
+         auto itr = _blocks.find( block_id );
+         return itr == _blocks.end() ? fc::time_point_sec::min() : itr->second.timestamp;
+      }
+
+      fc::time_point_sec get_blockchain_now() override { return fc::time_point::now(); }
+      item_hash_t get_head_block_id()const override { return head_block_id(); }
+      uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t unix_timestamp )const override { return 0; }
+
+      void error_encountered( const std::string& message, const fc::oexception& error ) override
+      {
+         wlog( "p2p error: ${message}", ("message", message) );
+      }
+
+   private:
+      bool is_included_block( const block_id_type& block_id )const
+      {
+         uint32_t block_num = block_header::num_from_id( block_id );
+         return block_num < _block_ids.size() && _block_ids[ block_num ] == block_id;
+      }
+
+      propagation_tracker&                         _tracker;
+      fc::time_point_sec                           _genesis_time;
+      std::vector< block_id_type >                 _block_ids; ///< _block_ids[n] is the id of block n, 0 is the empty genesis id
+      std::map< block_id_type, signed_block >      _blocks;
+      std::map< message_hash_type, trx_message >   _transactions;
+      std::deque< message_hash_type >              _pending_transactions;
+      uint64_t                                     _bytes_of_blocks = 0;
+      uint32_t                                     _connection_count = 0;
+};
+
+struct benchmark_node
+{
+   std::unique_ptr< benchmark_node_delegate > delegate;
+   node_ptr                                   p2p_node;
+};
+
+benchmark_node start_node( const fc::path& data_dir, propagation_tracker& tracker, fc::time_point_sec genesis_time )
+{
+   benchmark_node result;
+   result.delegate.reset( new benchmark_node_delegate( tracker, genesis_time ) );
+   result.p2p_node = std::make_shared< node >( "p2p benchmark" );
+   result.p2p_node->load_configuration( data_dir );
+   result.p2p_node->set_node_delegate( result.delegate.get() );
+   result.p2p_node->listen_on_endpoint( fc::ip::endpoint::from_string( "127.0.0.1:0" ), false );
+   // keep the requested topology, nodes would otherwise introduce each other
+   result.p2p_node->disable_peer_advertising();
+   result.p2p_node->listen_to_p2p_network();
+   result.p2p_node->connect_to_p2p_network();
+   result.p2p_node->sync_from( item_id( block_message_type, result.delegate->head_block_id() ), std::vector< uint32_t >() );
+   return result;
+}
+
+signed_transaction make_transaction( uint64_t sequence, uint32_t size_in_bytes )
+{
+   custom_operation op;
+   op.required_auths.insert( "benchmark" );
+   op.data.resize( std::max< uint32_t >( size_in_bytes, sizeof( sequence ) ) );
+   memcpy( op.data.data(), &sequence, sizeof( sequence ) );
+
+   signed_transaction trx;
+   trx.expiration = fc::time_point::now() + fc::hours( 1 );
+   trx.operations.push_back( op );
+   return trx;
+}
+
+/** waits until every node has at least the number of connections the topology gives it */
+bool wait_for_connections( const std::vector< benchmark_node >& nodes, const std::vector< uint32_t >& expected_connections, const fc::microseconds& timeout )
+{
+   fc::time_point deadline = fc::time_point::now() + timeout;
+   while( fc::time_point::now() < deadline )
+   {
+      bool all_connected = true;
+      for( size_t i = 0; i < nodes.size(); ++i )
+         if( nodes[ i ].p2p_node->get_connection_count() < expected_connections[ i ] )
+            all_connected = false;
+      if( all_connected )
+         return true;
+      fc::usleep( fc::milliseconds( 100 ) );
+   }
+   return false;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   uint32_t node_count;
+   std::string topology;
+   uint32_t duration_in_seconds;
+   uint32_t block_interval_ms;
+   uint32_t transactions_per_second;
+   uint32_t transaction_size;
+   uint32_t max_block_transactions;
+   uint32_t drain_time_in_seconds;
+   uint32_t sync_block_count;
+   uint32_t transactions_per_sync_block;
+   uint32_t sync_timeout_in_seconds;
+
+   return graphene::utilities::benchmark_main( argc, argv, "p2p_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("nodes", bpo::value< uint32_t >( &node_count )->default_value( 4 ), "Number of nodes in the network")
+            ("topology", bpo::value< std::string >( &topology )->default_value( "ring" ), "How the nodes are connected: line, ring or mesh")
+            ("duration", bpo::value< uint32_t >( &duration_in_seconds )->default_value( 30 ), "Seconds to inject blocks and transactions for")
+            ("block-interval-ms", bpo::value< uint32_t >( &block_interval_ms )->default_value( 3000 ), "Milliseconds between blocks, 0 for no blocks")
+            ("transactions-per-second", bpo::value< uint32_t >( &transactions_per_second )->default_value( 100 ), "Transactions injected per second, spread over all nodes")
+            ("transaction-size", bpo::value< uint32_t >( &transaction_size )->default_value( 200 ), "Payload bytes per transaction")
+            ("max-block-transactions", bpo::value< uint32_t >( &max_block_transactions )->default_value( 1000 ), "Most transactions the producing node puts in a block")
+            ("drain-time", bpo::value< uint32_t >( &drain_time_in_seconds )->default_value( 5 ), "Seconds to wait for the last items to propagate")
+            ("sync-blocks", bpo::value< uint32_t >( &sync_block_count )->default_value( 2000 ), "Extra blocks a new node has to sync, 0 to skip the sync test")
+            ("transactions-per-sync-block", bpo::value< uint32_t >( &transactions_per_sync_block )->default_value( 10 ), "Transactions in each of the extra blocks")
+            ("sync-timeout", bpo::value< uint32_t >( &sync_timeout_in_seconds )->default_value( 300 ), "Seconds to wait for the new node to sync")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         FC_ASSERT( node_count >= 2, "need at least two nodes" );
+         FC_ASSERT( topology == "line" || topology == "ring" || topology == "mesh", "unknown topology ${t}", ("t", topology) );
+
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         fc::time_point_sec genesis_time = fc::time_point::now();
+         propagation_tracker tracker;
+
+         std::vector< benchmark_node > nodes;
+         for( uint32_t i = 0; i < node_count; ++i )
+            nodes.push_back( start_node( data_dir.path() / std::to_string( i ), tracker, genesis_time ) );
+
+         std::vector< std::pair< uint32_t, uint32_t > > links;
+         for( uint32_t i = 1; i < node_count; ++i )
+         {
+            if( topology == "mesh" )
+               for( uint32_t j = 0; j < i; ++j )
+                  links.push_back( std::make_pair( i, j ) );
+            else
+               links.push_back( std::make_pair( i, i - 1 ) );
+         }
+         if( topology == "ring" && node_count > 2 )
+            links.push_back( std::make_pair( 0, node_count - 1 ) );
+
+         std::vector< uint32_t > expected_connections( node_count, 0 );
+         for( const auto& link : links )
+         {
+            ++expected_connections[ link.first ];
+            ++expected_connections[ link.second ];
+            nodes[ link.first ].p2p_node->connect_to_endpoint( nodes[ link.second ].p2p_node->get_actual_listening_endpoint() );
+         }
+         if( !wait_for_connections( nodes, expected_connections, fc::seconds( 30 ) ) )
+            wlog( "not every node reached its expected number of connections, continuing anyway" );
+
+         fc::mutable_variant_object result;
+         result[ "links" ] = uint64_t( links.size() );
+
+         // propagation: node 0 produces the blocks, transactions enter the network at every node in turn
+         {
+            fc::microseconds start_cpu_time = process_cpu_time();
+            fc::time_point start_time = fc::time_point::now();
+            fc::time_point end_time = start_time + fc::seconds( duration_in_seconds );
+            fc::time_point next_block_time = block_interval_ms ? start_time + fc::milliseconds( block_interval_ms ) : fc::time_point::maximum();
+            uint64_t transactions_injected = 0;
+
+            for( fc::time_point now = start_time; now < end_time; now = fc::time_point::now() )
+            {
+               uint64_t transactions_due = transactions_per_second * ( now - start_time ).count() / 1000000;
+               while( transactions_injected < transactions_due )
+               {
+                  benchmark_node& origin = nodes[ transactions_injected % node_count ];
+                  signed_transaction trx = make_transaction( transactions_injected, transaction_size );
+                  tracker.item_injected( item_id( trx_message_type, origin.delegate->push_transaction( trx ) ) );
+                  origin.p2p_node->broadcast( trx_message( trx ) );
+                  ++transactions_injected;
+               }
+
+               if( now >= next_block_time )
+               {
+                  signed_block block = nodes[ 0 ].delegate->generate_block( max_block_transactions );
+                  nodes[ 0 ].delegate->push_block( block );
+                  tracker.item_injected( item_id( block_message_type, block.id() ) );
+                  nodes[ 0 ].p2p_node->broadcast( block_message( block ) );
+                  next_block_time += fc::milliseconds( block_interval_ms );
+               }
+
+               fc::usleep( fc::milliseconds( 1 ) );
+            }
+            fc::usleep( fc::seconds( drain_time_in_seconds ) );
+
+            fc::microseconds cpu_time = process_cpu_time() - start_cpu_time;
+            uint64_t deliveries = tracker.deliveries();
+
+            fc::mutable_variant_object propagation;
+            propagation[ "blocks" ] = tracker.report( block_message_type, node_count - 1 );
+            propagation[ "transactions" ] = tracker.report( trx_message_type, node_count - 1 );
+            propagation[ "cpu_time_us" ] = cpu_time.count();
+            if( deliveries )
+               propagation[ "cpu_time_per_delivery_us" ] = cpu_time.count() / int64_t( deliveries );
+
+            uint64_t transaction_bytes_sent = 0;
+            for( const benchmark_node& n : nodes )
+            {
+               fc::variant_object inventory_statistics = n.p2p_node->get_inventory_statistics();
+               transaction_bytes_sent += inventory_statistics[ "transaction_inventory_bytes_sent" ].as_uint64() +
+                                         inventory_statistics[ "transaction_bytes_sent" ].as_uint64();
+            }
+            if( transactions_injected )
+               propagation[ "network_bytes_per_transaction" ] = transaction_bytes_sent / transactions_injected;
+            result[ "propagation" ] = propagation;
+         }
+
+         // sync: node 0 gets a batch of blocks nobody else has, then a fresh node connects to it and syncs
+         if( sync_block_count )
+         {
+            benchmark_node_delegate& source = *nodes[ 0 ].delegate;
+            uint64_t sequence = uint64_t( 1 ) << 32;
+            for( uint32_t i = 0; i < sync_block_count; ++i )
+            {
+               for( uint32_t j = 0; j < transactions_per_sync_block; ++j )
+                  source.push_transaction( make_transaction( sequence++, transaction_size ) );
+               source.push_block( source.generate_block( transactions_per_sync_block ) );
+            }
+
+            fc::microseconds start_cpu_time = process_cpu_time();
+            fc::time_point start_time = fc::time_point::now();
+            benchmark_node syncing_node = start_node( data_dir.path() / "syncing", tracker, genesis_time );
+            syncing_node.p2p_node->connect_to_endpoint( nodes[ 0 ].p2p_node->get_actual_listening_endpoint() );
+
+            fc::time_point deadline = start_time + fc::seconds( sync_timeout_in_seconds );
+            while( syncing_node.delegate->head_block_num() < source.head_block_num() && fc::time_point::now() < deadline )
+               fc::usleep( fc::milliseconds( 10 ) );
+
+            fc::microseconds elapsed = fc::time_point::now() - start_time;
+            fc::microseconds cpu_time = process_cpu_time() - start_cpu_time;
+            uint32_t blocks_synced = syncing_node.delegate->head_block_num();
+
+            fc::mutable_variant_object sync;
+            sync[ "blocks_to_sync" ] = source.head_block_num();
+            sync[ "blocks_synced" ] = blocks_synced;
+            sync[ "completed" ] = blocks_synced == source.head_block_num();
+            sync[ "elapsed_ms" ] = elapsed.count() / 1000;
+            if( elapsed.count() > 0 )
+            {
+               sync[ "blocks_per_second" ] = blocks_synced * 1000000.0 / elapsed.count();
+               sync[ "bytes_per_second" ] = syncing_node.delegate->bytes_of_blocks() * 1000000.0 / elapsed.count();
+            }
+            sync[ "cpu_time_us" ] = cpu_time.count();
+            if( blocks_synced )
+               sync[ "cpu_time_per_block_us" ] = cpu_time.count() / int64_t( blocks_synced );
+            result[ "sync" ] = sync;
+
+            syncing_node.p2p_node->close();
+            syncing_node.p2p_node.reset();
+         }
+
+         for( benchmark_node& n : nodes )
+         {
+            n.p2p_node->close();
+            n.p2p_node.reset();
+         }
+
+         return result;
+      });
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Compares the recommendations maintained by the tags plugin as votes arrive with
+ *  computing them on demand by walking the votes of the account's peers, which is what
+ *  get_recommended_for did before.  A synthetic social graph of accounts, peer ranks,
+ *  posts and votes is created directly in a database.  It reports the cost of each vote
+ *  and of each query for both, and how many of the top recommendations agree.
+ */
+
+#include <steemit/chain/account_object.hpp>
+#include <steemit/chain/comment_object.hpp>
+#include <steemit/chain/database.hpp>
+#include <steemit/tags/tags_plugin.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+using namespace steemit::chain;
+using namespace steemit::tags;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+/** get_recommended_for before recommendations were maintained incrementally */
+vector< comment_id_type > scan_recommendations( const database& db, const account_object& user, uint32_t limit )
+{
+   const auto& rank_idx = db.get_index_type<peer_stats_index>().indices().get<by_rank>();
+   const auto& vote_idx = db.get_index_type<comment_vote_index>().indices().get<by_voter_last_update>();
+
+   map<comment_id_type,float> stage;
+
+   auto max_age = db.head_block_time() - fc::days(1);
+
+   auto itr = rank_idx.lower_bound( boost::make_tuple( user.get_id(), std::numeric_limits<float>::max() ) );
+   while( itr != rank_idx.end() && itr->voter == user.id && stage.size() < 1000 && itr->rank > 0 ) {
+      auto vitr = vote_idx.lower_bound( boost::make_tuple( itr->peer, fc::time_point_sec::maximum() ) );
+      int32_t max_votes_per_peer = 50;
+      while( max_votes_per_peer && vitr != vote_idx.end() && vitr->voter == itr->peer && vitr->last_update >= max_age ) {
+         const auto& c = vitr->comment(db);
+         if( c.parent_author.size() == 0 && c.created > max_age && c.author != user.name && c.net_rshares > 0 )
+         {
+            auto agediscount = float((c.created - max_age).count())/fc::days(1).count();
+            stage[vitr->comment] += agediscount * itr->rank * vitr->vote_percent;
+            max_votes_per_peer--;
+         }
+         ++vitr;
+      }
+      ++itr;
+   }
+   auto vitr = vote_idx.lower_bound( boost::make_tuple( user.get_id(), fc::time_point_sec::maximum() ) );
+   while( vitr != vote_idx.end() && vitr->voter == user.get_id() && vitr->last_update > max_age ) {
+      stage.erase( vitr->comment );
+      ++vitr;
+   }
+
+   vector< pair<float,comment_id_type> > result;
+   result.reserve(stage.size());
+   for( const auto& item : stage ) result.push_back({item.second,item.first});
+   std::sort( result.begin(), result.end(), std::greater<pair<float,comment_id_type>>() );
+
+   vector< comment_id_type > ids;
+   for( const auto& item : result ) {
+      if( ids.size() == limit ) break;
+      ids.push_back( item.second );
+   }
+   return ids;
+}
+
+/** an index into [0, n) that favors small values, so a few accounts and posts are popular */
+uint32_t skewed( std::mt19937& rng, uint32_t n )
+{
+   double x = std::uniform_real_distribution< double >( 0, 1 )( rng );
+   return std::min< uint32_t >( uint32_t( x * x * n ), n - 1 );
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   uint32_t account_count;
+   uint32_t peers_per_account;
+   uint32_t post_count;
+   uint32_t vote_count;
+   uint32_t query_count;
+   uint32_t limit;
+
+   return graphene::utilities::benchmark_main( argc, argv, "recommendation_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("accounts", bpo::value< uint32_t >( &account_count )->default_value( 5000 ), "Accounts in the social graph")
+            ("peers", bpo::value< uint32_t >( &peers_per_account )->default_value( 50 ), "Peers ranked by each account")
+            ("posts", bpo::value< uint32_t >( &post_count )->default_value( 10000 ), "Posts created in the last day")
+            ("votes", bpo::value< uint32_t >( &vote_count )->default_value( 200000 ), "Votes for the posts")
+            ("queries", bpo::value< uint32_t >( &query_count )->default_value( 1000 ), "Accounts recommendations are requested for")
+            ("limit", bpo::value< uint32_t >( &limit )->default_value( 100 ), "Recommendations requested per query")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         database db;
+         db.add_index< graphene::db::primary_index< peer_stats_index > >();
+         db.add_index< graphene::db::primary_index< recommendation_index > >();
+         db.open( data_dir.path() );
+
+         std::mt19937 rng( 42 );
+         auto now = db.head_block_time();
+
+         vector< const account_object* > accounts;
+         for( uint32_t i = 0; i < account_count; ++i )
+            accounts.push_back( &db.create< account_object >( [&]( account_object& a ) { a.name = "user" + std::to_string( i ); } ) );
+
+         uint64_t peer_count = 0;
+         for( const auto* a : accounts )
+         {
+            std::set< uint32_t > peers;
+            while( peers.size() < std::min( peers_per_account, account_count - 1 ) )
+            {
+               uint32_t p = skewed( rng, account_count );
+               if( accounts[ p ] != a )
+                  peers.insert( p );
+            }
+            for( uint32_t p : peers )
+            {
+               db.create< peer_stats_object >( [&]( peer_stats_object& s )
+               {
+                  s.voter = a->id;
+                  s.peer = accounts[ p ]->id;
+                  s.direct_votes = 1 + rng() % 20;
+                  s.direct_positive_votes = rng() % ( s.direct_votes + 1 );
+                  s.indirect_votes = 1 + rng() % 200;
+                  s.indirect_positive_votes = rng() % ( s.indirect_votes + 1 );
+                  s.update_rank();
+               });
+               ++peer_count;
+            }
+         }
+
+         vector< const comment_object* > posts;
+         for( uint32_t i = 0; i < post_count; ++i )
+         {
+            posts.push_back( &db.create< comment_object >( [&]( comment_object& c )
+            {
+               c.author = accounts[ skewed( rng, account_count ) ]->name;
+               c.permlink = "post-" + std::to_string( i );
+               c.category = "benchmark";
+               c.created = now - fc::seconds( rng() % ( 20 * 60 * 60 ) );
+               c.last_update = c.created;
+               c.active = c.created;
+               c.net_rshares = 1;
+            }));
+         }
+
+         // every vote is applied as the tags plugin applies it, the time spent in the plugin is measured
+         int64_t update_time = 0;
+         uint32_t votes = 0;
+         const auto& vote_idx = db.get_index_type< comment_vote_index >().indices().get< by_comment_voter >();
+         for( uint32_t i = 0; i < vote_count; ++i )
+         {
+            const auto& voter = *accounts[ skewed( rng, account_count ) ];
+            const auto& post = *posts[ skewed( rng, post_count ) ];
+            if( vote_idx.find( boost::make_tuple( post.id, voter.id ) ) != vote_idx.end() )
+               continue;
+            int16_t percent = rng() % 10 == 0 ? -STEEMIT_100_PERCENT : STEEMIT_100_PERCENT;
+            db.create< comment_vote_object >( [&]( comment_vote_object& v )
+            {
+               v.voter = voter.id;
+               v.comment = post.id;
+               v.vote_percent = percent;
+               v.last_update = post.created + fc::seconds( rng() % std::max< int64_t >( ( now - post.created ).to_seconds(), 1 ) );
+            });
+            ++votes;
+
+            fc::time_point start = fc::time_point::now();
+            update_recommendations( db, voter.id, post, percent );
+            update_time += ( fc::time_point::now() - start ).count();
+         }
+
+         int64_t scan_time = 0;
+         int64_t read_time = 0;
+         uint64_t scan_results = 0;
+         uint64_t read_results = 0;
+         uint64_t top_matches = 0;
+         const uint32_t top = std::min< uint32_t >( limit, 10 );
+         for( uint32_t i = 0; i < query_count; ++i )
+         {
+            const auto& user = *accounts[ rng() % account_count ];
+
+            fc::time_point start = fc::time_point::now();
+            auto scanned = scan_recommendations( db, user, limit );
+            fc::time_point middle = fc::time_point::now();
+            auto read = get_recommendations( db, user, limit );
+            fc::time_point end = fc::time_point::now();
+
+            scan_time += ( middle - start ).count();
+            read_time += ( end - middle ).count();
+            scan_results += scanned.size();
+            read_results += read.size();
+
+            std::set< comment_id_type > scanned_top( scanned.begin(), scanned.begin() + std::min< size_t >( top, scanned.size() ) );
+            for( uint32_t j = 0; j < top && j < read.size(); ++j )
+               top_matches += scanned_top.count( read[ j ] );
+         }
+
+         fc::mutable_variant_object graph;
+         graph[ "peer_stats" ] = peer_count;
+         graph[ "votes" ] = votes;
+         graph[ "recommendations" ] = uint64_t( db.get_index_type< recommendation_index >().indices().size() );
+
+         fc::mutable_variant_object incremental;
+         incremental[ "update_us_per_vote" ] = double( update_time ) / std::max< uint32_t >( votes, 1 );
+         incremental[ "query_us" ] = double( read_time ) / std::max< uint32_t >( query_count, 1 );
+         incremental[ "results_per_query" ] = double( read_results ) / std::max< uint32_t >( query_count, 1 );
+
+         fc::mutable_variant_object scan;
+         scan[ "query_us" ] = double( scan_time ) / std::max< uint32_t >( query_count, 1 );
+         scan[ "results_per_query" ] = double( scan_results ) / std::max< uint32_t >( query_count, 1 );
+
+         fc::mutable_variant_object result;
+         result[ "graph" ] = graph;
+         result[ "scan" ] = scan;
+         result[ "incremental" ] = incremental;
+         if( read_time > 0 )
+            result[ "query_speedup" ] = double( scan_time ) / read_time;
+         result[ "top_agreement" ] = double( top_matches ) / std::max< uint64_t >( uint64_t( query_count ) * top, 1 );
+
+         db.close();
+         return result;
+      });
+}
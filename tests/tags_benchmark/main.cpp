@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2016 Steemit, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Measures the time the tags plugin spends on each vote.  Posts and replies are created
+ *  directly in a database with tags drawn from a skewed distribution, so a few tags are on
+ *  most posts like on the live chain, and every vote changes the sort keys of its comment
+ *  and its parents as the chain does.  The tags of the voted comments are updated once per
+ *  block, with --votes-per-block 1 they are updated after every vote.
+ */
+
+#include <steemit/chain/account_object.hpp>
+#include <steemit/chain/comment_object.hpp>
+#include <steemit/chain/database.hpp>
+#include <steemit/tags/tags_plugin.hpp>
+
+#include <graphene/utilities/benchmark.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace steemit::chain;
+using namespace steemit::tags;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+/** an index into [0, n) that favors small values, so a few tags, accounts and posts are popular */
+uint32_t skewed( std::mt19937& rng, uint32_t n )
+{
+   double x = std::uniform_real_distribution< double >( 0, 1 )( rng );
+   return std::min< uint32_t >( uint32_t( x * x * x * n ), n - 1 );
+}
+
+/** the rshares^2 of a comment with net_rshares, as the vote evaluator computes it */
+fc::uint128_t rshares2( int64_t net_rshares )
+{
+   if( net_rshares <= 0 )
+      return 0;
+   fc::uint128_t r( net_rshares );
+   return r * r;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   uint32_t account_count;
+   uint32_t tag_count;
+   uint32_t tags_per_post;
+   uint32_t post_count;
+   uint32_t reply_count;
+   uint32_t vote_count;
+   uint32_t votes_per_block;
+
+   return graphene::utilities::benchmark_main( argc, argv, "tags_benchmark",
+      [&]( bpo::options_description& options )
+      {
+         options.add_options()
+            ("accounts", bpo::value< uint32_t >( &account_count )->default_value( 2000 ), "Authors of posts and replies")
+            ("tags", bpo::value< uint32_t >( &tag_count )->default_value( 5000 ), "Distinct tags")
+            ("tags-per-post", bpo::value< uint32_t >( &tags_per_post )->default_value( 5 ), "Tags in the json metadata of each post")
+            ("posts", bpo::value< uint32_t >( &post_count )->default_value( 20000 ), "Top level posts")
+            ("replies", bpo::value< uint32_t >( &reply_count )->default_value( 40000 ), "Replies to posts and other replies")
+            ("votes", bpo::value< uint32_t >( &vote_count )->default_value( 100000 ), "Votes for posts and replies")
+            ("votes-per-block", bpo::value< uint32_t >( &votes_per_block )->default_value( 50 ), "Votes between updates of the tags")
+            ;
+      },
+      [&]() -> fc::mutable_variant_object
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         database db;
+         db.add_index< graphene::db::primary_index< tag_index > >();
+         db.add_index< graphene::db::primary_index< tag_stats_index > >();
+         db.add_index< graphene::db::primary_index< comment_summary_index > >();
+         db.open( data_dir.path() );
+
+         std::mt19937 rng( 42 );
+         auto now = db.head_block_time();
+
+         vector< const account_object* > accounts;
+         for( uint32_t i = 0; i < account_count; ++i )
+            accounts.push_back( &db.create< account_object >( [&]( account_object& a ) { a.name = "user" + std::to_string( i ); } ) );
+
+         // comments are tagged as the comment operation would tag them, this is not measured
+         vector< const comment_object* > comments;
+         for( uint32_t i = 0; i < post_count + reply_count; ++i )
+         {
+            const comment_object* parent = i < post_count ? nullptr : comments[ skewed( rng, comments.size() ) ];
+            comments.push_back( &db.create< comment_object >( [&]( comment_object& c )
+            {
+               c.author = accounts[ skewed( rng, account_count ) ]->name;
+               c.permlink = "comment-" + std::to_string( i );
+               c.created = now - fc::seconds( rng() % ( 24 * 60 * 60 ) );
+               c.last_update = c.created;
+               c.active = c.created;
+               c.cashout_time = c.created + fc::days( 1 );
+               if( parent != nullptr )
+               {
+                  c.parent_author = parent->author;
+                  c.parent_permlink = parent->permlink;
+                  c.category = parent->category;
+                  c.depth = parent->depth + 1;
+                  return;
+               }
+
+               comment_metadata meta;
+               while( meta.tags.size() < std::min( tags_per_post, tag_count ) )
+                  meta.tags.insert( "tag" + std::to_string( skewed( rng, tag_count ) ) );
+               c.category = *meta.tags.begin();
+               c.json_metadata = fc::json::to_string( meta );
+            }));
+
+            for( const comment_object* p = parent; p != nullptr;
+                 p = p->parent_author.size() ? &db.get_comment( p->parent_author, p->parent_permlink ) : nullptr )
+               db.modify( *p, [&]( comment_object& c ) { c.children++; } );
+            flat_set< comment_id_type > created;
+            created.insert( comments.back()->get_id() );
+            update_tags( db, created );
+         }
+
+         // every vote changes the comment and the children_rshares2 of its parents, the tags are updated at the end of the block
+         int64_t chain_time = 0;
+         int64_t tags_time = 0;
+         flat_set< comment_id_type > changed;
+         for( uint32_t i = 0; i < vote_count; ++i )
+         {
+            const auto& c = *comments[ skewed( rng, comments.size() ) ];
+            int64_t rshares = rng() % 10 == 0 ? -int64_t( rng() % 1000000 ) : int64_t( rng() % 10000000 );
+
+            fc::time_point start = fc::time_point::now();
+            auto old_rshares2 = rshares2( c.net_rshares.value );
+            db.modify( c, [&]( comment_object& o )
+            {
+               o.net_rshares += rshares;
+               o.net_votes += rshares > 0 ? 1 : -1;
+               o.active = now;
+            });
+            db.adjust_rshares2( c, old_rshares2, rshares2( c.net_rshares.value ) );
+            chain_time += ( fc::time_point::now() - start ).count();
+
+            changed.insert( c.get_id() );
+            if( ( i + 1 ) % std::max< uint32_t >( votes_per_block, 1 ) == 0 || i + 1 == vote_count )
+            {
+               start = fc::time_point::now();
+               update_tags( db, changed );
+               tags_time += ( fc::time_point::now() - start ).count();
+               changed.clear();
+            }
+         }
+
+         fc::mutable_variant_object content;
+         content[ "tags" ] = uint64_t( db.get_index_type< tag_stats_index >().indices().size() );
+         content[ "tag_objects" ] = uint64_t( db.get_index_type< tag_index >().indices().size() );
+
+         fc::mutable_variant_object result;
+         result[ "content" ] = content;
+         result[ "chain_us_per_vote" ] = double( chain_time ) / std::max< uint32_t >( vote_count, 1 );
+         result[ "tags_us_per_vote" ] = double( tags_time ) / std::max< uint32_t >( vote_count, 1 );
+         if( chain_time > 0 )
+            result[ "tags_overhead" ] = double( tags_time ) / chain_time;
+
+         db.close();
+         return result;
+      });
+}
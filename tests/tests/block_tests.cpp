@@ -29,10 +29,15 @@
 #include <steemit/chain/steem_objects.hpp>
 #include <steemit/chain/history_object.hpp>
 #include <steemit/account_history/account_history_plugin.hpp>
+#include <steemit/app/api_response_cache.hpp>
+#include <steemit/app/change_subscriptions.hpp>
+#include <steemit/app/database_api.hpp>
 
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
 
 #include "../common/database_fixture.hpp"
 
@@ -101,6 +106,57 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( fork_database_prune )
+{
+   try {
+      fork_database fdb;
+      fdb.set_max_size( 1024 );
+
+      vector< signed_block > blocks;
+      signed_block b;
+      b.witness = STEEMIT_INIT_MINER_NAME;
+      b.transactions.resize( 1 );
+      for( uint32_t i = 0; i < 2 * fork_database::FULL_BLOCK_DEPTH; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.timestamp = fc::time_point_sec( STEEMIT_BLOCK_INTERVAL * ( i + 1 ) );
+         fdb.push_block( b );
+         blocks.push_back( b );
+      }
+
+      BOOST_TEST_MESSAGE( "Blocks below the full block depth only keep their header" );
+      fdb.prune_blocks( blocks.back().id() );
+      auto stats = fdb.get_statistics();
+      BOOST_REQUIRE( stats.blocks == blocks.size() );
+      BOOST_REQUIRE( stats.full_blocks == fork_database::FULL_BLOCK_DEPTH + 1 );
+      BOOST_REQUIRE( stats.full_block_size == stats.full_blocks * fc::raw::pack_size( blocks.back() ) );
+
+      auto oldest = fdb.fetch_block( blocks.front().id() );
+      BOOST_REQUIRE( oldest->pruned );
+      BOOST_REQUIRE( oldest->data.transactions.empty() );
+      BOOST_REQUIRE( oldest->data.id() == blocks.front().id() );
+      BOOST_REQUIRE( !fdb.fetch_block( blocks.back().id() )->pruned );
+
+      BOOST_TEST_MESSAGE( "Restoring a pruned block puts its transactions back" );
+      fdb.restore_block( blocks.front() );
+      BOOST_REQUIRE( !oldest->pruned );
+      BOOST_REQUIRE( oldest->data.transactions.size() == 1 );
+      BOOST_REQUIRE( fdb.get_statistics().full_blocks == fork_database::FULL_BLOCK_DEPTH + 2 );
+
+      BOOST_TEST_MESSAGE( "Branches are found through pruned blocks" );
+      signed_block fork = blocks[2];
+      fork.timestamp += 1;
+      fdb.push_block( fork );
+      auto branches = fdb.fetch_branch_from( blocks.back().id(), fork.id() );
+      BOOST_REQUIRE( branches.first.size() == blocks.size() - 2 );
+      BOOST_REQUIRE( branches.second.size() == 1 );
+      BOOST_REQUIRE( branches.first.back()->previous_id() == blocks[1].id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -327,6 +383,68 @@ BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
    }
 }
 
+BOOST_AUTO_TEST_CASE( switch_forks_redo )
+{
+   try {
+      fc::temp_directory dir1( graphene::utilities::temp_directory_path() ),
+                         dir2( graphene::utilities::temp_directory_path() ),
+                         dir3( graphene::utilities::temp_directory_path() );
+      database db1,
+               db2,
+               db3;
+      db1.open( dir1.path(), INITIAL_TEST_SUPPLY );
+      db2.open( dir2.path(), INITIAL_TEST_SUPPLY );
+      db3.open( dir3.path(), INITIAL_TEST_SUPPLY );
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+      public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+
+      signed_transaction trx;
+      account_create_operation cop;
+      cop.new_account_name = "alice";
+      cop.creator = STEEMIT_INIT_MINER_NAME;
+      cop.owner = authority(1, init_account_pub_key, 1);
+      cop.active = cop.owner;
+      trx.operations.push_back(cop);
+      trx.set_expiration( db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+      trx.sign( init_account_priv_key, db1.get_chain_id() );
+      PUSH_TX( db1, trx );
+
+      // db1 : A1        -> B1 B2 -> A1 A2 A3
+      // db2 : B1 B2
+      // db3 : A1 A2 A3
+      auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db3, b );
+
+      BOOST_TEST_MESSAGE( "Switching to a fork keeps the changes of the popped blocks" );
+      b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db1, b );
+      b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db1, b );
+      BOOST_REQUIRE( db1.head_block_id() == db2.head_block_id() );
+      BOOST_REQUIRE( db1.get_fork_database_statistics().redo_blocks == 1 );
+      db1.clear_pending();
+      STEEMIT_REQUIRE_THROW( db1.get_account( "alice" ), fc::exception );
+
+      BOOST_TEST_MESSAGE( "Switching back applies them again" );
+      b = db3.generate_block(db3.get_slot_time(1), db3.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db1, b );
+      b = db3.generate_block(db3.get_slot_time(1), db3.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      PUSH_BLOCK( db1, b );
+      BOOST_REQUIRE( db1.head_block_id() == db3.head_block_id() );
+      BOOST_REQUIRE( db1.get_fork_database_statistics().redo_blocks == 2 );
+
+      BOOST_REQUIRE( db1.get_account( "alice" ).id == db3.get_account( "alice" ).id );
+      BOOST_REQUIRE( fc::json::to_string( db1.get_account( "alice" ) ) == fc::json::to_string( db3.get_account( "alice" ) ) );
+      BOOST_REQUIRE( fc::json::to_string( db1.get_dynamic_global_properties() ) == fc::json::to_string( db3.get_dynamic_global_properties() ) );
+      BOOST_REQUIRE( db1.get_index( implementation_ids, impl_account_object_type ).get_next_id() ==
+                     db3.get_index( implementation_ids, impl_account_object_type ).get_next_id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( duplicate_transactions )
 {
    try {
@@ -1054,5 +1172,309 @@ BOOST_FIXTURE_TEST_CASE( hardfork_test, database_fixture )
    FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( pending_transaction_pool_limits )
+{
+   try {
+      auto make_pending = [&]( const string& account, uint64_t priority, uint16_t ref_block_num ) -> pending_transaction
+      {
+         pending_transaction pending;
+         pending.trx.ref_block_num = ref_block_num;
+         pending.trx.expiration = fc::time_point_sec( 1000 + ref_block_num );
+         pending.id = pending.trx.id();
+         pending.account = account;
+         pending.packed_size = fc::raw::pack_size( pending.trx );
+         pending.priority = priority;
+         return pending;
+      };
+
+      pending_transaction_pool pool;
+      pool.set_limits( 3, 0, 2 );
+
+      BOOST_TEST_MESSAGE( "Filling the pool" );
+      for( uint16_t i = 1; i <= 3; ++i )
+      {
+         auto pending = make_pending( "alice" + fc::to_string( i ), 10 * i, i );
+         pool.check_capacity( pending );
+         pool.insert( std::move( pending ) );
+      }
+      BOOST_REQUIRE( pool.size() == 3 );
+
+      BOOST_TEST_MESSAGE( "A transaction that does not outrank the lowest priority transaction is rejected" );
+      auto low = make_pending( "bob", 10, 4 );
+      STEEMIT_REQUIRE_THROW( pool.check_capacity( low ), pending_transaction_pool_full );
+
+      BOOST_TEST_MESSAGE( "A higher priority transaction evicts the lowest priority transaction" );
+      auto high = make_pending( "bob", 100, 5 );
+      auto evicted_id = make_pending( "alice1", 10, 1 ).id;
+      pool.check_capacity( high );
+      pool.insert( std::move( high ) );
+      BOOST_REQUIRE( pool.size() == 3 );
+      BOOST_REQUIRE( !pool.contains( evicted_id ) );
+      BOOST_REQUIRE( pool.get_statistics().evicted == 1 );
+
+      BOOST_TEST_MESSAGE( "Transactions keep their arrival order" );
+      const auto& by_seq = pool.indices().get< by_sequence >();
+      BOOST_REQUIRE( by_seq.begin()->account == "alice2" );
+      BOOST_REQUIRE( by_seq.rbegin()->account == "bob" );
+
+      BOOST_TEST_MESSAGE( "The per account limit is enforced" );
+      pool.set_limits( 0, 0, 1 );
+      STEEMIT_REQUIRE_THROW( pool.check_capacity( make_pending( "bob", 1000, 6 ) ), pending_transaction_account_limit );
+      pool.check_capacity( make_pending( "charlie", 1, 7 ) );
+
+      BOOST_TEST_MESSAGE( "Taking the transactions empties the pool" );
+      pending_transaction_multi_index_type taken;
+      pool.take( taken );
+      BOOST_REQUIRE( taken.size() == 3 );
+      BOOST_REQUIRE( pool.empty() );
+      BOOST_REQUIRE( pool.size_in_bytes() == 0 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( state_read_write_lock, database_fixture )
+{
+   try {
+      BOOST_TEST_MESSAGE( "The locks are reentrant on the thread holding the write lock" );
+      uint32_t head = db.with_write_lock( [&]() -> uint32_t
+      {
+         return db.with_write_lock( [&]() -> uint32_t
+         {
+            return db.with_read_lock( [&]() -> uint32_t { return db.head_block_num(); } );
+         });
+      });
+      BOOST_REQUIRE( head == db.head_block_num() );
+
+      BOOST_TEST_MESSAGE( "A thread holding the read lock cannot modify the database" );
+      db.with_read_lock( [&]()
+      {
+         BOOST_REQUIRE_THROW( db.with_write_lock( [](){} ), fc::assert_exception );
+      });
+
+      BOOST_TEST_MESSAGE( "Readers on other threads wait for the writer" );
+      fc::thread reader( "reader" );
+      fc::future< uint32_t > read_result;
+      db.with_write_lock( [&]()
+      {
+         read_result = reader.async( [&]() -> uint32_t
+         {
+            return db.with_read_lock( [&]() -> uint32_t { return db.head_block_num(); } );
+         });
+         fc::usleep( fc::milliseconds( 50 ) );
+         BOOST_REQUIRE( !read_result.ready() );
+         generate_block();
+      });
+      BOOST_REQUIRE( read_result.wait() == head + 1 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( api_response_cache_invalidation, database_fixture )
+{
+   try {
+      steemit::app::api_response_cache cache( 2 );
+      uint32_t computed = 0;
+      auto compute = [&]() -> uint32_t { ++computed; return db.head_block_num(); };
+
+      BOOST_TEST_MESSAGE( "Repeated identical queries are served from the cache" );
+      auto key_a = steemit::app::api_response_cache::make_key( "get_a", string( "x" ), 1 );
+      BOOST_REQUIRE( cache.get_or_compute( db, key_a, compute ) == db.head_block_num() );
+      BOOST_REQUIRE( cache.get_or_compute( db, key_a, compute ) == db.head_block_num() );
+      BOOST_REQUIRE( computed == 1 );
+      BOOST_REQUIRE( cache.get_statistics().hits == 1 );
+
+      BOOST_TEST_MESSAGE( "The least recently used entry is evicted" );
+      cache.get_or_compute( db, "b", compute );
+      cache.get_or_compute( db, key_a, compute );
+      cache.get_or_compute( db, "c", compute );
+      BOOST_REQUIRE( cache.get_statistics().evictions == 1 );
+      cache.get_or_compute( db, key_a, compute );
+      BOOST_REQUIRE( computed == 3 );
+
+      BOOST_TEST_MESSAGE( "A new block invalidates the cache" );
+      generate_block();
+      BOOST_REQUIRE( cache.get_or_compute( db, key_a, compute ) == db.head_block_num() );
+      BOOST_REQUIRE( computed == 4 );
+      BOOST_REQUIRE( cache.get_statistics().invalidations == 1 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( database_api_batch, clean_database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) )
+      generate_blocks( 60 / STEEMIT_BLOCK_INTERVAL );
+
+      signed_transaction tx;
+      comment_operation comment;
+      comment.author = "alice";
+      comment.permlink = "foo";
+      comment.parent_permlink = "test";
+      comment.title = "bar";
+      comment.body = "foo bar";
+      tx.operations.push_back( comment );
+
+      vote_operation vote;
+      vote.voter = "bob";
+      vote.author = "alice";
+      vote.permlink = "foo";
+      vote.weight = STEEMIT_100_PERCENT;
+      tx.operations.push_back( vote );
+      tx.set_expiration( db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+      tx.sign( alice_private_key, db.get_chain_id() );
+      tx.sign( bob_private_key, db.get_chain_id() );
+      db.push_transaction( tx, 0 );
+      generate_block();
+
+      steemit::app::database_api api( db );
+      vector< steemit::app::batch_call > calls;
+      calls.push_back( { "get_content", fc::variants{ "alice", "foo" } } );
+      calls.push_back( { "get_active_votes", fc::variants{ "alice", "foo" } } );
+      calls.push_back( { "get_accounts", fc::variants{ fc::variant( vector< string >{ "alice", "bob" } ) } } );
+      calls.push_back( { "get_active_votes", fc::variants{ "alice", "foo" } } );
+      calls.push_back( { "get_batch", fc::variants() } );
+      calls.push_back( { "get_content", fc::variants{ "alice" } } );
+
+      auto result = api.get_batch( calls );
+      BOOST_REQUIRE( result.head_block_number == db.head_block_num() );
+      BOOST_REQUIRE( result.head_block_id == db.head_block_id() );
+      BOOST_REQUIRE( result.results.size() == calls.size() );
+
+      BOOST_TEST_MESSAGE( "Batched calls return the same results as separate calls" );
+      BOOST_REQUIRE( !result.results[0].error );
+      BOOST_REQUIRE( result.results[0].result.as< steemit::app::discussion >().body == "foo bar" );
+      auto votes = result.results[1].result.as< vector< steemit::app::vote_state > >();
+      BOOST_REQUIRE( votes.size() == 1 );
+      BOOST_REQUIRE( votes[0].voter == "bob" );
+      BOOST_REQUIRE( fc::json::to_string( result.results[1].result ) == fc::json::to_string( fc::variant( api.get_active_votes( "alice", "foo" ) ) ) );
+      BOOST_REQUIRE( result.results[2].result.as< vector< steemit::app::extended_account > >().size() == 2 );
+      BOOST_REQUIRE( fc::json::to_string( result.results[3].result ) == fc::json::to_string( result.results[1].result ) );
+
+      BOOST_TEST_MESSAGE( "A failing call does not fail the batch" );
+      BOOST_REQUIRE( result.results[4].error.valid() );
+      BOOST_REQUIRE( result.results[5].error.valid() );
+
+      BOOST_TEST_MESSAGE( "Batches are limited in size" );
+      calls.resize( 1001, calls[0] );
+      STEEMIT_REQUIRE_THROW( api.get_batch( calls ), fc::assert_exception );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( change_subscriptions, clean_database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) )
+      generate_block();
+
+      steemit::app::change_subscription_manager manager( db );
+      vector< steemit::app::change_notification > received;
+      auto record = [&]( const fc::variant& v ){ received.push_back( v.as< steemit::app::change_notification >() ); };
+
+      STEEMIT_REQUIRE_THROW( manager.subscribe( record, { "comment:alice" } ), fc::assert_exception );
+      auto globals = manager.subscribe( record, { "globals" } );
+      auto accounts = manager.subscribe( record, { "account:alice" } );
+
+      BOOST_TEST_MESSAGE( "Changes of a block are pushed to the matching subscriptions" );
+      transfer( STEEMIT_INIT_MINER_NAME, "alice", 1000 );
+      generate_block();
+      fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE( received.size() == 2 );
+      for( const auto& n : received )
+      {
+         BOOST_REQUIRE( n.block_num == db.head_block_num() );
+         BOOST_REQUIRE( n.changes.size() == 1 );
+      }
+
+      BOOST_TEST_MESSAGE( "Changes waiting to be sent are coalesced" );
+      received.clear();
+      accounts.reset();
+      generate_block();
+      generate_block();
+      fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE( received.size() == 1 );
+      BOOST_REQUIRE( received[0].block_num == db.head_block_num() );
+      BOOST_REQUIRE( received[0].changes.size() == 1 );
+      BOOST_REQUIRE( manager.get_statistics().coalesced_changes == 1 );
+      BOOST_REQUIRE( manager.get_statistics().subscribers == 1 );
+
+      BOOST_TEST_MESSAGE( "A subscriber too far behind is told to refetch" );
+      received.clear();
+      manager.set_max_pending_changes( 0 );
+      generate_block();
+      fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE( received.size() == 1 );
+      BOOST_REQUIRE( received[0].overflow );
+      BOOST_REQUIRE( received[0].changes.empty() );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( account_history_by_type, clean_database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) )
+      fund( "alice", 10000 );
+      transfer( "alice", "bob", 100 );
+      transfer( "alice", "bob", 200 );
+      transfer( "alice", "bob", 300 );
+      generate_block();
+
+      steemit::app::database_api api( db );
+      auto all = api.get_account_history( "alice", uint64_t(-1), 100 );
+      auto transfers = api.get_account_history_by_type( "alice", "transfer", uint64_t(-1), 100 );
+
+      BOOST_TEST_MESSAGE( "Only transfers are returned, numbered among the transfers" );
+      BOOST_REQUIRE( all.size() > transfers.size() );
+      BOOST_REQUIRE( transfers.size() == 3 );
+      uint32_t expected = 0;
+      for( const auto& item : transfers )
+      {
+         BOOST_REQUIRE( item.first == expected++ );
+         BOOST_REQUIRE( item.second.op.which() == operation::tag< transfer_operation >::value );
+      }
+      BOOST_REQUIRE( transfers.rbegin()->second.op.get< transfer_operation >().amount.amount.value == 300 );
+
+      BOOST_TEST_MESSAGE( "Paging starts at from and returns limit operations before it" );
+      auto page = api.get_account_history_by_type( "alice", "transfer", 1, 1 );
+      BOOST_REQUIRE( page.size() == 2 );
+      BOOST_REQUIRE( page.begin()->first == 0 );
+      BOOST_REQUIRE( page.rbegin()->first == 1 );
+
+      BOOST_REQUIRE( api.get_account_history_by_type( "bob", "vote", uint64_t(-1), 100 ).empty() );
+      BOOST_REQUIRE( api.get_account_history_by_type( "nobody", "transfer", uint64_t(-1), 100 ).empty() );
+      STEEMIT_REQUIRE_THROW( api.get_account_history_by_type( "alice", "not_an_operation", uint64_t(-1), 100 ), fc::exception );
+
+      BOOST_TEST_MESSAGE( "The operation creating an account is in its history" );
+      auto created = api.get_account_history_by_type( "alice", "account_create", uint64_t(-1), 100 );
+      BOOST_REQUIRE( created.size() == 1 );
+      BOOST_REQUIRE( created.begin()->second.op.get< account_create_operation >().new_account_name == "alice" );
+      BOOST_REQUIRE( all.begin()->second.op.which() == operation::tag< account_create_operation >::value );
+
+      BOOST_TEST_MESSAGE( "Clearing a proxy does not look up the empty proxy" );
+      account_witness_proxy_operation op;
+      op.account = "alice";
+      op.proxy = "bob";
+
+      signed_transaction tx;
+      tx.set_expiration( db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+      tx.operations.push_back( op );
+      tx.sign( alice_private_key, db.get_chain_id() );
+      db.push_transaction( tx, 0 );
+
+      op.proxy = "";
+      tx.operations.clear();
+      tx.signatures.clear();
+      tx.operations.push_back( op );
+      tx.sign( alice_private_key, db.get_chain_id() );
+      db.push_transaction( tx, 0 );
+      generate_block();
+
+      BOOST_REQUIRE( api.get_account_history_by_type( "alice", "account_witness_proxy", uint64_t(-1), 100 ).size() == 2 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
\ No newline at end of file
@@ -0,0 +1,344 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steemit/app/database_api.hpp>
+#include <steemit/app/http_rpc_server.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace steemit::chain;
+using namespace steemit::chain::test;
+using namespace steemit::app;
+
+struct http_response
+{
+   uint32_t                               status = 0;
+   std::map< std::string, std::string >   headers; ///< by lower case name
+   std::string                            body;
+};
+
+struct http_rpc_fixture : public clean_database_fixture
+{
+   static const uint32_t max_body_size = 1024;
+
+   api_metrics       metrics;
+   http_rpc_server   server;
+
+   http_rpc_fixture()
+      : server( [this]( fc::api_connection& conn, const std::shared_ptr< api_connection_context >& apis )
+                {
+                   return register_apis( conn, apis );
+                }, metrics, max_body_size )
+   {
+      server.listen( fc::ip::endpoint::from_string( "127.0.0.1:0" ) );
+   }
+
+   /** the APIs of each connection, only database_api with id 0 */
+   std::vector< std::string > register_apis( fc::api_connection& conn, const std::shared_ptr< api_connection_context >& apis )
+   {
+      fc::api_ptr api = std::make_shared< fc::api< database_api > >( std::make_shared< database_api >( db ) );
+      apis->api_map[ "database_api" ] = api;
+      fc::api_id_type id = api->register_api( conn );
+
+      std::vector< std::string > names( id + 1 );
+      names[ id ] = "database_api";
+      return names;
+   }
+
+   std::shared_ptr< fc::tcp_socket > connect()
+   {
+      auto socket = std::make_shared< fc::tcp_socket >();
+      socket->connect_to( server.get_local_endpoint() );
+      return socket;
+   }
+
+   static void send( fc::tcp_socket& socket, const std::string& data )
+   {
+      socket.write( data.data(), data.size() );
+      socket.flush();
+   }
+
+   static std::string post( const std::string& body, const std::string& version = "HTTP/1.1", const std::string& headers = "" )
+   {
+      return "POST / " + version + "\r\n"
+             "Host: localhost\r\n"
+             "Content-Length: " + std::to_string( body.size() ) + "\r\n" +
+             headers + "\r\n" + body;
+   }
+
+   static std::string call( uint32_t id, const std::string& method, const std::string& params = "[]" )
+   {
+      return "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string( id ) + ",\"method\":\"call\",\"params\":[0,\"" + method + "\"," + params + "]}";
+   }
+
+   /** reads one response, buffer keeps what was received after it */
+   static http_response read_response( fc::tcp_socket& socket, std::string& buffer )
+   {
+      char chunk[ 4096 ];
+      size_t header_end;
+      while( ( header_end = buffer.find( "\r\n\r\n" ) ) == std::string::npos )
+         buffer.append( chunk, socket.readsome( chunk, sizeof( chunk ) ) );
+
+      http_response result;
+      size_t line_end = buffer.find( "\r\n" );
+      std::string status_line = buffer.substr( 0, line_end );
+      BOOST_REQUIRE( status_line.compare( 0, 9, "HTTP/1.1 " ) == 0 );
+      result.status = std::stoul( status_line.substr( 9, 3 ) );
+
+      size_t pos = line_end + 2;
+      while( pos < header_end )
+      {
+         line_end = buffer.find( "\r\n", pos );
+         size_t colon = buffer.find( ':', pos );
+         BOOST_REQUIRE( colon < line_end );
+         result.headers[ boost::algorithm::to_lower_copy( buffer.substr( pos, colon - pos ) ) ] =
+            boost::algorithm::trim_copy( buffer.substr( colon + 1, line_end - colon - 1 ) );
+         pos = line_end + 2;
+      }
+
+      size_t content_length = 0;
+      if( result.headers.count( "content-length" ) )
+         content_length = std::stoul( result.headers[ "content-length" ] );
+      size_t body_start = header_end + 4;
+      while( buffer.size() < body_start + content_length )
+         buffer.append( chunk, socket.readsome( chunk, sizeof( chunk ) ) );
+
+      result.body = buffer.substr( body_start, content_length );
+      buffer.erase( 0, body_start + content_length );
+      return result;
+   }
+
+   /** sends data on a new connection and returns the single response, after which the server must close the connection */
+   http_response reject( const std::string& data )
+   {
+      auto socket = connect();
+      send( *socket, data );
+      std::string buffer;
+      http_response response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.headers[ "connection" ], "close" );
+      BOOST_REQUIRE( buffer.empty() );
+      require_closed( *socket );
+      return response;
+   }
+
+   static void require_closed( fc::tcp_socket& socket )
+   {
+      char c;
+      BOOST_REQUIRE_THROW( socket.readsome( &c, 1 ), fc::eof_exception );
+   }
+
+   static fc::variant result_of( const http_response& response )
+   {
+      BOOST_REQUIRE_EQUAL( response.status, 200 );
+      auto obj = fc::json::from_string( response.body ).get_object();
+      BOOST_REQUIRE( !obj.contains( "error" ) );
+      return obj[ "result" ];
+   }
+
+   static uint64_t id_of( const http_response& response )
+   {
+      return fc::json::from_string( response.body ).get_object()[ "id" ].as_uint64();
+   }
+};
+
+BOOST_FIXTURE_TEST_SUITE( http_rpc_tests, http_rpc_fixture )
+
+BOOST_AUTO_TEST_CASE( pipelining_and_content_length )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: pipelining_and_content_length" );
+
+      generate_block();
+      uint32_t head = db.head_block_num();
+
+      BOOST_TEST_MESSAGE( "--- Two POSTs sent together are answered in order on the same connection" );
+      auto socket = connect();
+      send( *socket, post( call( 1, "get_dynamic_global_properties" ) ) + post( call( 2, "get_block", "[" + std::to_string( head ) + "]" ) ) );
+
+      std::string buffer;
+      http_response first = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( first.headers[ "connection" ], "keep-alive" );
+      BOOST_REQUIRE_EQUAL( first.headers[ "content-type" ], "application/json" );
+      BOOST_REQUIRE_EQUAL( id_of( first ), 1 );
+      BOOST_REQUIRE_EQUAL( result_of( first ).get_object()[ "head_block_number" ].as_uint64(), head );
+
+      http_response second = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( id_of( second ), 2 );
+      BOOST_REQUIRE( buffer.empty() );
+
+      BOOST_TEST_MESSAGE( "--- get_block is written with json_writer and matches the variant result" );
+      auto expected = fc::json::to_string( fc::json::from_string( fc::json::to_string( fc::variant( db.fetch_block_by_number( head ) ) ) ) );
+      BOOST_REQUIRE_EQUAL( fc::json::to_string( result_of( second ) ), expected );
+
+      auto stats = server.get_statistics();
+      BOOST_REQUIRE_EQUAL( stats.requests, 2 );
+      BOOST_REQUIRE_EQUAL( stats.pipelined_requests, 1 );
+      BOOST_REQUIRE_EQUAL( stats.connections, 1 );
+
+      BOOST_TEST_MESSAGE( "--- A body received in several parts is read up to its Content-Length" );
+      std::string request = post( call( 3, "get_dynamic_global_properties" ) );
+      send( *socket, request.substr( 0, request.size() - 10 ) );
+      fc::usleep( fc::milliseconds( 10 ) );
+      send( *socket, request.substr( request.size() - 10 ) );
+      http_response third = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( id_of( third ), 3 );
+      result_of( third );
+
+      BOOST_TEST_MESSAGE( "--- A batch is answered with an array" );
+      send( *socket, post( "[" + call( 4, "get_dynamic_global_properties" ) + "," + call( 5, "get_config" ) + "]" ) );
+      auto batch = fc::json::from_string( read_response( *socket, buffer ).body ).get_array();
+      BOOST_REQUIRE_EQUAL( batch.size(), 2 );
+      BOOST_REQUIRE_EQUAL( batch[0].get_object()[ "id" ].as_uint64(), 4 );
+      BOOST_REQUIRE_EQUAL( batch[1].get_object()[ "id" ].as_uint64(), 5 );
+
+      BOOST_TEST_MESSAGE( "--- A request that asks to close the connection is answered before it is closed" );
+      send( *socket, post( call( 6, "get_dynamic_global_properties" ), "HTTP/1.1", "Connection: close\r\n" ) );
+      http_response last = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( last.headers[ "connection" ], "close" );
+      BOOST_REQUIRE_EQUAL( id_of( last ), 6 );
+      require_closed( *socket );
+
+      BOOST_REQUIRE_EQUAL( server.get_statistics().requests, 6 );
+      BOOST_REQUIRE_EQUAL( server.get_statistics().rejected_requests, 0 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( expect_continue )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: expect_continue" );
+
+      auto socket = connect();
+      std::string body = call( 1, "get_dynamic_global_properties" );
+      std::string request = post( body, "HTTP/1.1", "Expect: 100-continue\r\n" );
+
+      BOOST_TEST_MESSAGE( "--- The server asks for the body once it accepted the headers" );
+      send( *socket, request.substr( 0, request.size() - body.size() ) );
+      std::string buffer;
+      http_response interim = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( interim.status, 100 );
+      BOOST_REQUIRE( interim.body.empty() );
+      BOOST_REQUIRE( buffer.empty() );
+
+      send( *socket, body );
+      http_response response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( id_of( response ), 1 );
+      result_of( response );
+
+      BOOST_TEST_MESSAGE( "--- No 100 Continue is sent when the body arrived with the headers" );
+      send( *socket, post( call( 2, "get_dynamic_global_properties" ), "HTTP/1.1", "Expect: 100-continue\r\n" ) );
+      response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.status, 200 );
+      BOOST_REQUIRE_EQUAL( id_of( response ), 2 );
+
+      BOOST_TEST_MESSAGE( "--- A body that is too large is rejected without asking for it" );
+      request = "POST / HTTP/1.1\r\nContent-Length: " + std::to_string( max_body_size + 1 ) + "\r\nExpect: 100-continue\r\n\r\n";
+      send( *socket, request );
+      response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.status, 413 );
+      require_closed( *socket );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( http_1_0_keep_alive )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: http_1_0_keep_alive" );
+
+      BOOST_TEST_MESSAGE( "--- HTTP/1.0 connections are closed unless the client asks to keep them alive" );
+      auto socket = connect();
+      send( *socket, post( call( 1, "get_dynamic_global_properties" ), "HTTP/1.0" ) );
+      std::string buffer;
+      http_response response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.headers[ "connection" ], "close" );
+      BOOST_REQUIRE_EQUAL( id_of( response ), 1 );
+      require_closed( *socket );
+
+      BOOST_TEST_MESSAGE( "--- With Connection: keep-alive the connection serves further requests" );
+      socket = connect();
+      buffer.clear();
+      for( uint32_t id = 2; id <= 3; ++id )
+      {
+         send( *socket, post( call( id, "get_dynamic_global_properties" ), "HTTP/1.0", "Connection: Keep-Alive\r\n" ) );
+         response = read_response( *socket, buffer );
+         BOOST_REQUIRE_EQUAL( response.headers[ "connection" ], "keep-alive" );
+         BOOST_REQUIRE_EQUAL( id_of( response ), id );
+      }
+
+      send( *socket, post( call( 4, "get_dynamic_global_properties" ), "HTTP/1.0" ) );
+      response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.headers[ "connection" ], "close" );
+      require_closed( *socket );
+
+      BOOST_REQUIRE_EQUAL( server.get_statistics().total_connections, 2 );
+      BOOST_REQUIRE_EQUAL( server.get_statistics().requests, 4 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( rejected_requests )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: rejected_requests" );
+
+      BOOST_TEST_MESSAGE( "--- Methods other than POST get 405 and the connection stays open" );
+      auto socket = connect();
+      send( *socket, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n" );
+      std::string buffer;
+      http_response response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( response.status, 405 );
+      BOOST_REQUIRE_EQUAL( response.headers[ "allow" ], "POST" );
+      BOOST_REQUIRE_EQUAL( response.headers[ "connection" ], "keep-alive" );
+      send( *socket, post( call( 1, "get_dynamic_global_properties" ) ) );
+      result_of( read_response( *socket, buffer ) );
+
+      BOOST_TEST_MESSAGE( "--- A malformed request line gets 400" );
+      BOOST_REQUIRE_EQUAL( reject( "NOT AN HTTP REQUEST\r\n\r\n" ).status, 400 );
+      BOOST_REQUIRE_EQUAL( reject( "POST /\r\nContent-Length: 2\r\n\r\n{}" ).status, 400 );
+
+      BOOST_TEST_MESSAGE( "--- A header without a colon or an invalid Content-Length gets 400" );
+      BOOST_REQUIRE_EQUAL( reject( "POST / HTTP/1.1\r\nContent-Length 2\r\n\r\n{}" ).status, 400 );
+      BOOST_REQUIRE_EQUAL( reject( "POST / HTTP/1.1\r\nContent-Length: two\r\n\r\n{}" ).status, 400 );
+
+      BOOST_TEST_MESSAGE( "--- A chunked body gets 411" );
+      BOOST_REQUIRE_EQUAL( reject( "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\n{}\r\n0\r\n\r\n" ).status, 411 );
+
+      BOOST_TEST_MESSAGE( "--- A body larger than max_body_size gets 413" );
+      std::string body = "[" + call( 2, "get_dynamic_global_properties" );
+      while( body.size() <= max_body_size )
+         body += "," + call( 2, "get_dynamic_global_properties" );
+      body += "]";
+      BOOST_REQUIRE_EQUAL( reject( post( body ) ).status, 413 );
+
+      BOOST_TEST_MESSAGE( "--- Headers larger than max_header_size get 431" );
+      std::string head = "POST / HTTP/1.1\r\nX-Padding: ";
+      head.resize( http_rpc_server::max_header_size + 1, 'a' );
+      BOOST_REQUIRE_EQUAL( reject( head ).status, 431 );
+
+      auto stats = server.get_statistics();
+      BOOST_REQUIRE_EQUAL( stats.rejected_requests, 8 );
+      BOOST_REQUIRE_EQUAL( stats.requests, 2 );
+
+      BOOST_TEST_MESSAGE( "--- The server still answers after the rejects" );
+      send( *socket, post( call( 3, "get_dynamic_global_properties" ) ) );
+      response = read_response( *socket, buffer );
+      BOOST_REQUIRE_EQUAL( id_of( response ), 3 );
+      BOOST_REQUIRE_EQUAL( server.get_statistics().connections, 1 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -0,0 +1,237 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steemit/chain/database.hpp>
+#include <steemit/chain/steem_objects.hpp>
+#include <steemit/market_history/market_history_plugin.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace steemit::chain;
+using namespace steemit::chain::test;
+using namespace steemit::market_history;
+
+struct market_history_fixture : public clean_database_fixture
+{
+   void create_order( const string& owner, const fc::ecc::private_key& key, uint32_t orderid,
+                      const asset& sell, const asset& receive,
+                      fc::time_point_sec expiration = fc::time_point_sec::maximum() )
+   {
+      limit_order_create_operation op;
+      op.owner = owner;
+      op.orderid = orderid;
+      op.amount_to_sell = sell;
+      op.min_to_receive = receive;
+      op.expiration = expiration;
+
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      tx.set_expiration( db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION );
+      tx.sign( key, db.get_chain_id() );
+      db.push_transaction( tx, 0 );
+   }
+
+   /** the buckets of one size, oldest first */
+   vector< bucket_object > get_buckets( uint32_t seconds )
+   {
+      const auto& bucket_idx = db.get_index_type< bucket_index >().indices().get< by_bucket >();
+
+      vector< bucket_object > result;
+      for( auto itr = bucket_idx.lower_bound( boost::make_tuple( seconds, fc::time_point_sec() ) );
+           itr != bucket_idx.end() && itr->seconds == seconds; ++itr )
+         result.push_back( *itr );
+      return result;
+   }
+
+   const order_book_level_object* find_level( const price& p )
+   {
+      const auto& level_idx = db.get_index_type< order_book_level_index >().indices().get< by_sell_price >();
+      auto itr = level_idx.find( p );
+      return itr == level_idx.end() ? nullptr : &*itr;
+   }
+};
+
+BOOST_FIXTURE_TEST_SUITE( market_history_tests, market_history_fixture )
+
+BOOST_AUTO_TEST_CASE( trade_pairing )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: trade_pairing" );
+
+      set_price_feed( price( ASSET( "1.000 TESTS" ), ASSET( "1.000 TBD" ) ) );
+
+      ACTORS( (alice)(bob) )
+      fund( "alice", 1000000 );
+      fund( "bob", 1000000 );
+      convert( "bob", ASSET( "1000.000 TESTS" ) );
+
+      const auto& history_idx = db.get_index_type< order_history_index >().indices().get< by_time >();
+      BOOST_REQUIRE( history_idx.empty() );
+
+      BOOST_TEST_MESSAGE( "--- The order that is placed pays first, the order on the book second" );
+      create_order( "alice", alice_private_key, 1, ASSET( "10.000 TESTS" ), ASSET( "15.000 TBD" ) );
+      create_order( "bob", bob_private_key, 2, ASSET( "15.000 TBD" ), ASSET( "10.000 TESTS" ) );
+
+      BOOST_TEST_MESSAGE( "--- An order filling several orders on the book is paired with each of them" );
+      create_order( "alice", alice_private_key, 3, ASSET( "10.000 TESTS" ), ASSET( "10.000 TBD" ) );
+      create_order( "alice", alice_private_key, 4, ASSET( "10.000 TESTS" ), ASSET( "10.000 TBD" ) );
+      create_order( "bob", bob_private_key, 5, ASSET( "20.000 TBD" ), ASSET( "20.000 TESTS" ) );
+      generate_block();
+
+      BOOST_REQUIRE_EQUAL( history_idx.size(), 3 );
+      auto itr = history_idx.begin();
+      BOOST_REQUIRE_EQUAL( itr->current_owner, "bob" );
+      BOOST_REQUIRE_EQUAL( itr->current_orderid, 2 );
+      BOOST_REQUIRE( itr->current_pays == ASSET( "15.000 TBD" ) );
+      BOOST_REQUIRE_EQUAL( itr->open_owner, "alice" );
+      BOOST_REQUIRE_EQUAL( itr->open_orderid, 1 );
+      BOOST_REQUIRE( itr->open_pays == ASSET( "10.000 TESTS" ) );
+
+      for( uint32_t open_orderid = 3; open_orderid <= 4; ++open_orderid )
+      {
+         ++itr;
+         BOOST_REQUIRE_EQUAL( itr->current_owner, "bob" );
+         BOOST_REQUIRE_EQUAL( itr->current_orderid, 5 );
+         BOOST_REQUIRE( itr->current_pays == ASSET( "10.000 TBD" ) );
+         BOOST_REQUIRE_EQUAL( itr->open_owner, "alice" );
+         BOOST_REQUIRE_EQUAL( itr->open_orderid, open_orderid );
+         BOOST_REQUIRE( itr->open_pays == ASSET( "10.000 TESTS" ) );
+      }
+
+      BOOST_TEST_MESSAGE( "--- Every bucket size has one bucket with the three trades" );
+      auto time = history_idx.begin()->time;
+      for( auto seconds : { 15, 60, 300, 3600, 86400 } )
+      {
+         auto buckets = get_buckets( seconds );
+         BOOST_REQUIRE_EQUAL( buckets.size(), 1 );
+         const auto& b = buckets[0];
+         BOOST_REQUIRE( b.open == fc::time_point_sec( ( time.sec_since_epoch() / seconds ) * seconds ) );
+         BOOST_REQUIRE( b.steem_volume == ASSET( "30.000 TESTS" ).amount );
+         BOOST_REQUIRE( b.sbd_volume == ASSET( "35.000 TBD" ).amount );
+         BOOST_REQUIRE( b.open_steem == ASSET( "10.000 TESTS" ).amount );
+         BOOST_REQUIRE( b.open_sbd == ASSET( "15.000 TBD" ).amount );
+         BOOST_REQUIRE( b.close_steem == ASSET( "10.000 TESTS" ).amount );
+         BOOST_REQUIRE( b.close_sbd == ASSET( "10.000 TBD" ).amount );
+         BOOST_REQUIRE( b.high() == price( ASSET( "15.000 TBD" ), ASSET( "10.000 TESTS" ) ) );
+         BOOST_REQUIRE( b.low() == price( ASSET( "10.000 TBD" ), ASSET( "10.000 TESTS" ) ) );
+      }
+
+      validate_database();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( bucket_rollover_and_pruning )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: bucket_rollover_and_pruning" );
+
+      set_price_feed( price( ASSET( "1.000 TESTS" ), ASSET( "1.000 TBD" ) ) );
+
+      ACTORS( (alice)(bob) )
+      fund( "alice", 1000000 );
+      fund( "bob", 1000000 );
+      convert( "bob", ASSET( "1000.000 TESTS" ) );
+
+      const auto& history_idx = db.get_index_type< order_history_index >().indices().get< by_time >();
+      uint32_t orderid = 0;
+      auto trade = [&]( const asset& steem, const asset& sbd )
+      {
+         create_order( "alice", alice_private_key, ++orderid, steem, sbd );
+         create_order( "bob", bob_private_key, ++orderid, sbd, steem );
+         generate_block();
+      };
+
+      trade( ASSET( "1.000 TESTS" ), ASSET( "1.000 TBD" ) );
+      auto first = history_idx.rbegin()->time;
+
+      BOOST_TEST_MESSAGE( "--- A trade after the bucket ended opens the next bucket" );
+      generate_blocks( db.head_block_time() + 15 );
+      trade( ASSET( "1.000 TESTS" ), ASSET( "2.000 TBD" ) );
+      auto second = history_idx.rbegin()->time;
+
+      auto buckets = get_buckets( 15 );
+      BOOST_REQUIRE_EQUAL( buckets.size(), 2 );
+      BOOST_REQUIRE( buckets[0].open == fc::time_point_sec( ( first.sec_since_epoch() / 15 ) * 15 ) );
+      BOOST_REQUIRE( buckets[1].open == fc::time_point_sec( ( second.sec_since_epoch() / 15 ) * 15 ) );
+      BOOST_REQUIRE( buckets[0].sbd_volume == ASSET( "1.000 TBD" ).amount );
+      BOOST_REQUIRE( buckets[1].sbd_volume == ASSET( "2.000 TBD" ).amount );
+      BOOST_REQUIRE( buckets[1].open_sbd == ASSET( "2.000 TBD" ).amount );
+      BOOST_REQUIRE_EQUAL( history_idx.size(), 2 );
+
+      BOOST_TEST_MESSAGE( "--- Buckets and trades older than the history of the smallest size are removed" );
+      auto minutes = get_buckets( 60 ).size();
+      auto hours = get_buckets( 3600 ).size();
+      auto days = get_buckets( 86400 ).size();
+      generate_blocks( db.head_block_time() + 15 * 5760 + 60 );
+      trade( ASSET( "1.000 TESTS" ), ASSET( "3.000 TBD" ) );
+      auto third = history_idx.rbegin()->time;
+
+      buckets = get_buckets( 15 );
+      BOOST_REQUIRE_EQUAL( buckets.size(), 1 );
+      BOOST_REQUIRE( buckets[0].open == fc::time_point_sec( ( third.sec_since_epoch() / 15 ) * 15 ) );
+      BOOST_REQUIRE( buckets[0].sbd_volume == ASSET( "3.000 TBD" ).amount );
+
+      BOOST_REQUIRE_EQUAL( history_idx.size(), 1 );
+      BOOST_REQUIRE( history_idx.begin()->current_pays == ASSET( "3.000 TBD" ) );
+
+      BOOST_TEST_MESSAGE( "--- Larger buckets keep their longer history" );
+      BOOST_REQUIRE_EQUAL( get_buckets( 60 ).size(), minutes + 1 );
+      BOOST_REQUIRE_EQUAL( get_buckets( 3600 ).size(), hours + 1 );
+      BOOST_REQUIRE( get_buckets( 86400 ).size() >= days );
+
+      validate_database();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( order_book_levels_after_expiry )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: order_book_levels_after_expiry" );
+
+      ACTORS( (alice) )
+      fund( "alice", 1000000 );
+
+      auto expiration = db.head_block_time() + 60;
+      create_order( "alice", alice_private_key, 1, ASSET( "10.000 TESTS" ), ASSET( "15.000 TBD" ), expiration );
+      create_order( "alice", alice_private_key, 2, ASSET( "5.000 TESTS" ), ASSET( "7.500 TBD" ) );
+      create_order( "alice", alice_private_key, 3, ASSET( "10.000 TESTS" ), ASSET( "20.000 TBD" ), expiration );
+      generate_block();
+
+      BOOST_TEST_MESSAGE( "--- Orders at the same price share a level" );
+      auto shared = price( ASSET( "10.000 TESTS" ), ASSET( "15.000 TBD" ) );
+      auto single = price( ASSET( "10.000 TESTS" ), ASSET( "20.000 TBD" ) );
+      auto level = find_level( shared );
+      BOOST_REQUIRE( level != nullptr );
+      BOOST_REQUIRE_EQUAL( level->orders, 2 );
+      BOOST_REQUIRE( level->for_sale == ASSET( "15.000 TESTS" ).amount );
+      BOOST_REQUIRE( level->to_receive == ASSET( "22.500 TBD" ).amount );
+      level = find_level( single );
+      BOOST_REQUIRE( level != nullptr );
+      BOOST_REQUIRE_EQUAL( level->orders, 1 );
+
+      BOOST_TEST_MESSAGE( "--- Expired orders are removed from their levels" );
+      generate_blocks( expiration + 60 );
+      BOOST_REQUIRE( db.get_index_type< limit_order_index >().indices().size() == 1 );
+
+      level = find_level( shared );
+      BOOST_REQUIRE( level != nullptr );
+      BOOST_REQUIRE_EQUAL( level->orders, 1 );
+      BOOST_REQUIRE( level->for_sale == ASSET( "5.000 TESTS" ).amount );
+      BOOST_REQUIRE( level->to_receive == ASSET( "7.500 TBD" ).amount );
+      BOOST_REQUIRE( find_level( single ) == nullptr );
+      BOOST_REQUIRE_EQUAL( db.get_index_type< order_book_level_index >().indices().size(), 1 );
+
+      validate_database();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -26,6 +26,10 @@
 
 #include <steemit/chain/steem_objects.hpp>
 #include <steemit/chain/database.hpp>
+#include <steemit/chain/history_object.hpp>
+
+#include <steemit/app/json_writer.hpp>
+#include <steemit/app/state.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -255,5 +259,60 @@ BOOST_AUTO_TEST_CASE( hardfork_version_test )
    FC_LOG_AND_RETHROW();
 }
 
+BOOST_AUTO_TEST_CASE( json_writer_test )
+{
+   try
+   {
+      steemit::app::discussion d;
+      d.author = "alice";
+      d.permlink = "test";
+      d.body = "quote \" backslash \\ newline \n tab \t";
+      d.total_vote_weight = 10000000000ull;
+      d.children_rshares2 = fc::uint128_t( 7 );
+      d.pending_payout_value = asset( 1000, SBD_SYMBOL );
+      d.replies.push_back( "bob/re-test" );
+
+      steemit::app::vote_state v;
+      v.voter = "bob";
+      v.weight = 5;
+      v.rshares = -100;
+      d.active_votes.push_back( v );
+
+      auto expected = fc::json::to_string( fc::variant( d ) );
+      BOOST_REQUIRE_EQUAL( steemit::app::json_writer::to_string( d ), expected );
+
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( 100, STEEM_SYMBOL );
+
+      std::map< uint32_t, operation_object > history;
+      history[ 0 ].op = op;
+      history[ 0 ].block = 12;
+
+      expected = fc::json::to_string( fc::variant( history ) );
+      BOOST_REQUIRE_EQUAL( steemit::app::json_writer::to_string( history ), expected );
+
+      steemit::app::state s;
+      s.content[ "alice/test" ] = d;
+      expected = fc::json::to_string( fc::variant( s ) );
+      BOOST_REQUIRE_EQUAL( steemit::app::json_writer::to_string( s ), expected );
+
+      signed_transaction t;
+      t.ref_block_num = 7;
+      t.expiration = fc::time_point_sec( 1467000000 );
+      t.operations.push_back( op );
+      t.signatures.resize( 1 );
+
+      signed_block b;
+      b.witness = "alice";
+      b.transactions.push_back( t );
+      fc::optional< signed_block > block = b;
+      expected = fc::json::to_string( fc::variant( block ) );
+      BOOST_REQUIRE_EQUAL( steemit::app::json_writer::to_string( block ), expected );
+   }
+   FC_LOG_AND_RETHROW();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif